@@ -17,6 +17,8 @@ export interface DetectionEvent {
 export interface EventsResponse {
   events: DetectionEvent[];
   count: number;
+  /** Pass back as `cursor` for the next (older) page; null on the last page */
+  next_cursor: string | null;
 }
 
 export interface Detection {
@@ -36,6 +38,14 @@ export interface EventDetail {
   detections: Detection[];
 }
 
+/** Several event details in one response, in request order */
+export interface EventDetailsResponse {
+  events: EventDetail[];
+  count: number;
+  /** Requested ids with no event */
+  missing: string[];
+}
+
 export interface TimelineHour {
   hour: number;
   event_count: number;
@@ -48,6 +58,20 @@ export interface TimelineData {
   hours: TimelineHour[];
 }
 
+export type TimelineBucket = '15m' | '1h' | '1d';
+
+/** Columnar range response: bucket i starts at start + i * bucket_minutes */
+export interface TimelineRange {
+  start: string;
+  end: string;
+  bucket: TimelineBucket;
+  bucket_minutes: number;
+  bucket_count: number;
+  cameras: string[];
+  event_count: number[][];       // [camera][bucket]
+  total_detections: number[][];  // [camera][bucket]
+}
+
 export interface PeriodicSnapshot {
   type: 'snapshot';
   snapshot_id: number;
@@ -59,6 +83,28 @@ export interface PeriodicSnapshot {
   ai_context?: string;
 }
 
+/** One tile of a sprite sheet: where a periodic snapshot sits in the image */
+export interface SpriteTile {
+  snapshot_id: number;
+  captured_at: string;
+  x: number;
+  y: number;
+}
+
+/** Contact sheet of a camera's periodic snapshots for one day */
+export interface SpriteSheet {
+  camera_id: string;
+  date: string;
+  version: string;
+  image_url: string;
+  tile_width: number;
+  tile_height: number;
+  columns: number;
+  rows: number;
+  count: number;
+  tiles: SpriteTile[];
+}
+
 export interface SearchResult {
   type: 'event' | 'snapshot';
   id: string;
@@ -73,11 +119,13 @@ export interface SearchResult {
   ai_context?: string;
   rank?: number;
   similarity?: number;
+  rrf_score?: number;
 }
 
 export interface SearchResponse {
   events: SearchResult[];
   count: number;
-  search_mode: 'fts' | 'semantic';
+  search_mode: 'fts' | 'semantic' | 'semantic_exact' | 'hybrid';
   query: string;
+  partial?: boolean;
 }
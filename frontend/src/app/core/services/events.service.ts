@@ -5,9 +5,13 @@ import {
   DetectionEvent,
   EventsResponse,
   EventDetail,
+  EventDetailsResponse,
   TimelineData,
+  TimelineRange,
+  TimelineBucket,
   SearchResponse,
-  PeriodicSnapshot
+  PeriodicSnapshot,
+  SpriteSheet
 } from '../models/event.model';
 
 /**
@@ -33,8 +37,32 @@ export class EventsService {
     endDate?: Date,
     limit: number = 100
   ): Observable<DetectionEvent[]> {
+    return this.getEventsPage(cameraId, startDate, endDate, limit).pipe(
+      map(response => response.events)
+    );
+  }
+
+  /**
+   * Get one page of events, newest first
+   * @param cameraId Optional camera filter
+   * @param startDate Optional start date
+   * @param endDate Optional end date
+   * @param limit Maximum number of events per page (default 100)
+   * @param cursor next_cursor of the previous page; omit for the first page
+   */
+  getEventsPage(
+    cameraId?: string,
+    startDate?: Date,
+    endDate?: Date,
+    limit: number = 100,
+    cursor?: string
+  ): Observable<EventsResponse> {
     const params: Record<string, any> = { limit };
 
+    if (cursor) {
+      params['cursor'] = cursor;
+    }
+
     if (cameraId) {
       params['camera_id'] = cameraId;
     }
@@ -47,9 +75,7 @@ export class EventsService {
       params['end'] = endDate.toISOString();
     }
 
-    return this.api.get<EventsResponse>('api/events', params).pipe(
-      map(response => response.events)
-    );
+    return this.api.get<EventsResponse>('api/events', params);
   }
 
   /**
@@ -75,6 +101,15 @@ export class EventsService {
     return this.api.get<EventDetail>(`api/events/${eventId}`);
   }
 
+  /**
+   * Get several events with their detections in one request
+   * (e.g. a page of cards), instead of one getEventDetail call each
+   * @param eventIds Event identifiers (at most 200)
+   */
+  getEventDetails(eventIds: string[]): Observable<EventDetailsResponse> {
+    return this.api.post<EventDetailsResponse>('api/events/batch', { ids: eventIds });
+  }
+
   /**
    * Get timeline data for a specific camera and date
    * Returns hourly aggregated event counts
@@ -88,6 +123,29 @@ export class EventsService {
       date: dateStr
     });
   }
+
+  /**
+   * Get bucketed event counts for several cameras over a date range
+   * in a single request (columnar: one array per camera)
+   * @param cameraIds Camera identifiers
+   * @param start First date (inclusive)
+   * @param end Last date (inclusive)
+   * @param bucket Bucket size: 15m (max 31 days), 1h or 1d (max 366 days)
+   */
+  getTimelineRange(
+    cameraIds: string[],
+    start: Date,
+    end: Date,
+    bucket: TimelineBucket = '1h'
+  ): Observable<TimelineRange> {
+    return this.api.get<TimelineRange>('api/timeline/range', {
+      cameras: cameraIds.join(','),
+      start: start.toISOString().split('T')[0],
+      end: end.toISOString().split('T')[0],
+      bucket
+    });
+  }
+
   /**
    * Search events and periodic snapshots
    */
@@ -128,6 +186,15 @@ export class EventsService {
       map(response => response.snapshots)
     );
   }
+
+  /**
+   * Get the day's periodic snapshots as one tiled sprite image plus offsets,
+   * for timeline hover previews
+   */
+  getSpriteSheet(cameraId: string, date: Date): Observable<SpriteSheet> {
+    const dateStr = date.toISOString().split('T')[0];
+    return this.api.get<SpriteSheet>(`api/cameras/${cameraId}/sprites`, { date: dateStr });
+  }
 }
 
 // Import map operator
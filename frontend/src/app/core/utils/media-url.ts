@@ -41,3 +41,16 @@ export function toRelativeMediaUrl(
 
   return `${prefix}/${filename}`;
 }
+
+/**
+ * Relative URL of a server-side downscaled snapshot, for cards and grids that
+ * draw it far below its full resolution. The server rounds `width` up to one
+ * of its cached sizes (160, 320, 480, 640).
+ */
+export function toSnapshotThumbnailUrl(
+  rawUrl: string | undefined | null,
+  width: number
+): string {
+  const path = toRelativeMediaUrl(rawUrl, 'snapshots');
+  return path ? `${path}?w=${width}` : '';
+}
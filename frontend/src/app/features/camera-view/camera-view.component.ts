@@ -8,8 +8,8 @@ import { combineLatest } from 'rxjs';
 import { CameraService } from '../../core/services/camera.service';
 import { EventsService } from '../../core/services/events.service';
 import { Camera } from '../../core/models/camera.model';
-import { DetectionEvent, SearchResult, PeriodicSnapshot } from '../../core/models/event.model';
-import { toRelativeMediaUrl } from '../../core/utils/media-url';
+import { DetectionEvent, SearchResult, PeriodicSnapshot, SpriteSheet } from '../../core/models/event.model';
+import { toRelativeMediaUrl, toSnapshotThumbnailUrl } from '../../core/utils/media-url';
 
 import { LoadingSpinnerComponent } from '../../shared/components/loading-spinner/loading-spinner.component';
 import { ErrorMessageComponent } from '../../shared/components/error-message/error-message.component';
@@ -68,6 +68,7 @@ export class CameraViewComponent implements OnInit, OnDestroy {
   isSearchLoading = signal(false);
   searchInfo = signal<{ mode: string; count: number } | null>(null);
   periodicSnapshots = signal<PeriodicSnapshot[]>([]);
+  spriteSheet = signal<SpriteSheet | null>(null);
 
   // Live snapshot refresh
   private refreshInterval?: number;
@@ -213,6 +214,11 @@ export class CameraViewComponent implements OnInit, OnDestroy {
       next: (snapshots) => this.periodicSnapshots.set(snapshots),
       error: () => this.periodicSnapshots.set([])
     });
+    // Hover previews are optional; a 404 just means no snapshots that day
+    this.eventsService.getSpriteSheet(camera.id, date).subscribe({
+      next: (sheet) => this.spriteSheet.set(sheet),
+      error: () => this.spriteSheet.set(null)
+    });
   }
 
   onEventSelect(event: DetectionEvent) {
@@ -275,7 +281,7 @@ export class CameraViewComponent implements OnInit, OnDestroy {
 
   getSearchResultSnapshotUrl(result: SearchResult): string {
     if (!result.snapshot_url) return '';
-    return toRelativeMediaUrl(result.snapshot_url, 'snapshots');
+    return toSnapshotThumbnailUrl(result.snapshot_url, 320);
   }
 
   ngOnDestroy() {
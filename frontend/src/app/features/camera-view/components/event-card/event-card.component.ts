@@ -4,7 +4,7 @@ import { DetectionEvent } from '../../../../core/models/event.model';
 import { TimeAgoPipe } from '../../../../shared/pipes/time-ago.pipe';
 import { DurationPipe } from '../../../../shared/pipes/duration.pipe';
 import { LazyLoadDirective } from '../../../../shared/directives/lazy-load.directive';
-import { toRelativeMediaUrl } from '../../../../core/utils/media-url';
+import { toSnapshotThumbnailUrl } from '../../../../core/utils/media-url';
 
 /**
  * Event card component with snapshot on the right
@@ -139,7 +139,8 @@ export class EventCardComponent {
   }
 
   getSnapshotUrl(): string {
-    return toRelativeMediaUrl(this.event.snapshot_url, 'snapshots');
+    // 128px card; 320 stays sharp on high-DPI screens
+    return toSnapshotThumbnailUrl(this.event.snapshot_url, 320);
   }
 
   getExactTime(): string {
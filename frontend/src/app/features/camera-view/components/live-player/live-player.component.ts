@@ -1,7 +1,6 @@
 import {
   Component,
   Input,
-  OnInit,
   OnDestroy,
   OnChanges,
   SimpleChanges,
@@ -12,8 +11,9 @@ import { Camera } from '../../../../core/models/camera.model';
 import { CameraService } from '../../../../core/services/camera.service';
 
 /**
- * Live camera view using refreshing snapshots
- * Shows the most recent snapshot from the camera buffer
+ * Live camera view
+ * Uses the server-pushed MJPEG stream; falls back to refreshing snapshots
+ * if the stream cannot be opened
  */
 @Component({
   selector: 'app-live-player',
@@ -22,9 +22,9 @@ import { CameraService } from '../../../../core/services/camera.service';
   template: `
     <div class="relative w-full h-full bg-black flex items-center justify-center">
       @if (camera.connected) {
-        <!-- Live Snapshot (refreshes via timestamp) -->
+        <!-- Live stream (or snapshot refreshed via timestamp as fallback) -->
         <img
-          [src]="getSnapshotUrl()"
+          [src]="useStream ? getStreamUrl() : getSnapshotUrl()"
           [alt]="camera.name + ' live view'"
           class="max-w-full max-h-full object-contain"
           (error)="onImageError()" />
@@ -59,44 +59,63 @@ import { CameraService } from '../../../../core/services/camera.service';
     }
   `]
 })
-export class LivePlayerComponent implements OnInit, OnDestroy, OnChanges {
+export class LivePlayerComponent implements OnDestroy, OnChanges {
   @Input() camera!: Camera;
 
   private cameraService = inject(CameraService);
   private refreshInterval?: number;
   private lastUpdate = Date.now();
-
-  ngOnInit() {
-    // Refresh snapshot every 2 seconds
-    this.refreshInterval = window.setInterval(() => {
-      this.lastUpdate = Date.now();
-    }, 2000);
-  }
+  useStream = true;
 
   ngOnChanges(changes: SimpleChanges) {
     if (changes['camera'] && !changes['camera'].firstChange) {
       this.lastUpdate = Date.now();
+      this.useStream = true;
+      this.stopPolling();
     }
   }
 
   ngOnDestroy() {
-    if (this.refreshInterval) {
-      clearInterval(this.refreshInterval);
-    }
+    this.stopPolling();
+  }
+
+  /**
+   * Get MJPEG stream URL (multipart/x-mixed-replace, rendered natively by <img>)
+   */
+  getStreamUrl(): string {
+    return `api/cameras/${this.camera.id}/stream`;
   }
 
   /**
    * Get snapshot URL with cache-busting timestamp
-   * This creates a "live view" by refreshing the image every 2 seconds
+   * Fallback "live view" that refreshes the image every 2 seconds
    */
   getSnapshotUrl(): string {
-    // Use the latest snapshot from the most recent event, or a live frame endpoint
-    // For now, we'll use a timestamp-based cache buster to simulate live updates
-    // In production, you might want to add a /api/camera/{id}/live endpoint
     return `api/cameras/${this.camera.id}/snapshot?t=${this.lastUpdate}`;
   }
 
   onImageError() {
+    if (this.useStream) {
+      console.warn(`Live stream unavailable for ${this.camera.id}, falling back to snapshots`);
+      this.useStream = false;
+      this.startPolling();
+      return;
+    }
     console.warn(`Failed to load snapshot for ${this.camera.id}`);
   }
+
+  private startPolling() {
+    this.stopPolling();
+    // Refresh snapshot every 2 seconds
+    this.refreshInterval = window.setInterval(() => {
+      this.lastUpdate = Date.now();
+    }, 2000);
+  }
+
+  private stopPolling() {
+    if (this.refreshInterval) {
+      clearInterval(this.refreshInterval);
+      this.refreshInterval = undefined;
+    }
+  }
 }
@@ -1,10 +1,11 @@
 import { Component, Input, Output, EventEmitter } from '@angular/core';
 import { CommonModule } from '@angular/common';
-import { DetectionEvent, PeriodicSnapshot } from '../../../../core/models/event.model';
+import { DetectionEvent, PeriodicSnapshot, SpriteSheet, SpriteTile } from '../../../../core/models/event.model';
 
 /**
  * 24-hour timeline component
- * Displays events as dots on a horizontal timeline
+ * Displays events as dots on a horizontal timeline; hovering a snapshot dot
+ * previews it from the day's sprite sheet (one image for the whole day)
  */
 @Component({
   selector: 'app-timeline',
@@ -32,6 +33,8 @@ import { DetectionEvent, PeriodicSnapshot } from '../../../../core/models/event.
                   style="width: 6px; height: 6px;"
                   [style.left.%]="getSnapshotPosition(snap)"
                   [title]="getSnapshotTitle(snap)"
+                  (mouseenter)="onSnapshotHover(snap, $event)"
+                  (mouseleave)="hoverPreview = null"
                   (click)="onSnapshotClick(snap)">
                 </button>
               }
@@ -59,6 +62,19 @@ import { DetectionEvent, PeriodicSnapshot } from '../../../../core/models/event.
           </div>
         }
       </div>
+
+      <!-- Hover preview: fixed so the scrolling track does not clip it -->
+      @if (hoverPreview && spriteSheet) {
+        <div
+          class="fixed z-50 pointer-events-none rounded border border-gray-600 shadow-lg bg-gray-900"
+          [style.left.px]="hoverPreview.left"
+          [style.top.px]="hoverPreview.top"
+          [style.width.px]="spriteSheet.tile_width"
+          [style.height.px]="spriteSheet.tile_height"
+          [style.background-image]="'url(' + spriteSheet.image_url + ')'"
+          [style.background-position]="'-' + hoverPreview.tile.x + 'px -' + hoverPreview.tile.y + 'px'">
+        </div>
+      }
     </div>
   `,
   styles: [`
@@ -75,7 +91,20 @@ export class TimelineComponent {
   @Output() eventSelect = new EventEmitter<DetectionEvent>();
   @Output() snapshotSelect = new EventEmitter<PeriodicSnapshot>();
 
+  @Input() set spriteSheet(sheet: SpriteSheet | null) {
+    this.sheet = sheet;
+    this.spriteTiles = new Map((sheet?.tiles ?? []).map(tile => [tile.snapshot_id, tile]));
+    this.hoverPreview = null;
+  }
+  get spriteSheet(): SpriteSheet | null {
+    return this.sheet;
+  }
+
   hours = Array.from({ length: 24 }, (_, i) => i);
+  hoverPreview: { tile: SpriteTile; left: number; top: number } | null = null;
+
+  private sheet: SpriteSheet | null = null;
+  private spriteTiles = new Map<number, SpriteTile>();
 
   getEventsForHour(hour: number): DetectionEvent[] {
     return this.events.filter(event => {
@@ -120,7 +149,34 @@ export class TimelineComponent {
     return `${time} - Periodic snapshot${snap.ai_context ? ': ' + snap.ai_context : ''}`;
   }
 
+  onSnapshotHover(snap: PeriodicSnapshot, event: MouseEvent) {
+    const tile = this.tileFor(snap);
+    if (!tile || !this.sheet) {
+      this.hoverPreview = null;
+      return;
+    }
+    // Centred above the dot
+    const dot = (event.target as HTMLElement).getBoundingClientRect();
+    this.hoverPreview = {
+      tile,
+      left: dot.left + dot.width / 2 - this.sheet.tile_width / 2,
+      top: dot.top - this.sheet.tile_height - 8
+    };
+  }
+
   onSnapshotClick(snap: PeriodicSnapshot) {
     this.snapshotSelect.emit(snap);
   }
+
+  /** The snapshot's own tile, else the last one drawn before it (the sheet keeps one per slot of the day) */
+  private tileFor(snap: PeriodicSnapshot): SpriteTile | undefined {
+    const own = this.spriteTiles.get(snap.snapshot_id);
+    if (own || !this.sheet) return own;
+    let previous: SpriteTile | undefined;
+    for (const tile of this.sheet.tiles) {
+      if (tile.captured_at > snap.captured_at) break;
+      previous = tile;
+    }
+    return previous;
+  }
 }
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace hms {
+
+/// gzip-framed deflate of data at the given zlib level; empty on failure
+std::string gzipCompress(std::string_view data, int level = 9);
+
+/// Brotli at the given quality (0-11); empty on failure
+std::string brotliCompress(std::string_view data, int quality = 11);
+
+/// True when an Accept-Encoding header value allows coding ("gzip", "br").
+/// A "*" entry counts; an explicit q=0 refuses it. Names compare case-insensitively.
+bool acceptsEncoding(std::string_view accept_encoding, std::string_view coding);
+
+} // namespace hms
@@ -1,7 +1,11 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include <memory>
 #include <string>
+#include "media_file_cache.h"
+#include "mp4_index.h"
+#include "thumbnail_cache.h"
 
 namespace hms {
 
@@ -19,7 +23,8 @@ public:
                     std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                     const std::string& filename);
 
-    /// GET /snapshots/{filename} — serve JPEG snapshot files
+    /// GET /snapshots/{filename}[?w=N] — serve JPEG snapshot files; with w, a
+    /// thumbnail at most N pixels wide (rounded up to a cached size)
     void serveSnapshot(const drogon::HttpRequestPtr& req,
                        std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                        const std::string& filename);
@@ -28,17 +33,38 @@ public:
     static void setEventsDir(std::string dir);
     static void setSnapshotsDir(std::string dir);
 
+    /// Set the open-fd cache shared by recordings and snapshots (optional)
+    static void setFileCache(std::shared_ptr<MediaFileCache> cache);
+
+    /// Set the snapshot thumbnail cache; without one, ?w= is ignored
+    static void setThumbnailCache(std::shared_ptr<ThumbnailCache> cache);
+
+    /// Set the MP4 index; range requests for recordings whose moov trails the
+    /// media data are then answered from a fast-start layout (needs the fd cache)
+    static void setMp4Index(std::shared_ptr<Mp4IndexCache> index);
+
 private:
     /// Validate filename to prevent path traversal attacks
     static bool isValidFilename(const std::string& filename);
 
-    /// Serve a file from a directory with content type
-    static void serveFile(const std::string& dir,
+    /// Serve a file from a directory with content type, honouring Range and
+    /// conditional request headers
+    static void serveFile(const drogon::HttpRequestPtr& req,
+                          const std::string& dir,
                           const std::string& filename,
                           std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
+    /// Serve a downscaled copy of a snapshot from the thumbnail cache
+    static void serveThumbnail(const drogon::HttpRequestPtr& req,
+                               const std::string& filename,
+                               int width,
+                               std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+
     static inline std::string events_dir_;
     static inline std::string snapshots_dir_;
+    static inline std::shared_ptr<MediaFileCache> file_cache_;
+    static inline std::shared_ptr<ThumbnailCache> thumbnail_cache_;
+    static inline std::shared_ptr<Mp4IndexCache> mp4_index_;
 };
 
 } // namespace hms
@@ -1,41 +1,93 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include <chrono>
 #include <memory>
+#include "db_executor.h"
 #include "db_pool.h"
+#include "db_router.h"
+#include "detection_client.h"
+#include "embedding_client.h"
+#include "event_feed.h"
+#include "live_stream_hub.h"
+#include "mp4_index.h"
+#include "recording_index.h"
+#include "response_cache.h"
+#include "response_format.h"
+#include "semantic_index.h"
+#include "snapshot_cache.h"
+#include "sprite_sheets.h"
+#include "timeline_rollup.h"
 
 namespace hms {
 
 /// REST API controller for the Angular Timeline UI.
 /// Ports the API endpoints from api_server.py that serve the frontend.
+/// /api/events, /api/search and /api/snapshots also answer in MessagePack or
+/// CBOR when Accept asks for it, and with ?layout=columnar (see response_format.h).
 class UiApiController : public drogon::HttpController<UiApiController> {
 public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(UiApiController::getEvents, "/api/events", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getEventStream, "/api/events/stream", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getEventDetails, "/api/events/details", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getEventDetails, "/api/events/batch", drogon::Post, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getEventDetail, "/api/events/{event_id}", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getEventKeyframes, "/api/events/{event_id}/keyframes", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getTimeline, "/api/timeline", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getTimelineRange, "/api/timeline/range", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getCamerasStatus, "/api/cameras/status", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getCameraSnapshot, "/api/cameras/{camera_id}/snapshot", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getCameraStream, "/api/cameras/{camera_id}/stream", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::searchEvents, "/api/search", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getPeriodicSnapshots, "/api/snapshots", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getSpriteSheet, "/api/cameras/{camera_id}/sprites", drogon::Get, "hms::CorsFilter");
+    ADD_METHOD_TO(UiApiController::getSpriteImage, "/api/cameras/{camera_id}/sprites/image", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getCameraPaused, "/api/cameras/{camera_id}/paused", drogon::Get, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::setCameraPaused, "/api/cameras/{camera_id}/paused", drogon::Post, "hms::CorsFilter");
     ADD_METHOD_TO(UiApiController::getHealth, "/health", drogon::Get);
+    ADD_METHOD_TO(UiApiController::getMetrics, "/metrics", drogon::Get);
     METHOD_LIST_END
 
-    /// GET /api/events?camera_id=X&start=...&end=...&limit=100
+    /// GET /api/events?camera_id=X&start=...&end=...&limit=100&cursor=...
+    /// Newest first. Pass the response's next_cursor back as cursor for the
+    /// following page; it is null once there are no older events.
     void getEvents(const drogon::HttpRequestPtr& req,
                    std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
+    /// GET /api/events/stream?cameras=a,b — Server-Sent Events of new (`event`)
+    /// and changed (`update`) /api/events rows. Honours Last-Event-ID (or
+    /// ?last_event_id=) on reconnect; `resync` means reload /api/events.
+    void getEventStream(const drogon::HttpRequestPtr& req,
+                        std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+
+    /// GET /api/events/details?ids=a,b,c or POST /api/events/batch {"ids": [...]}
+    /// Up to 200 events with their detections, each shaped like
+    /// /api/events/{event_id}, in request order; unknown ids are listed in "missing"
+    void getEventDetails(const drogon::HttpRequestPtr& req,
+                         std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+
     /// GET /api/events/{event_id}
     void getEventDetail(const drogon::HttpRequestPtr& req,
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                         const std::string& event_id);
 
+    /// GET /api/events/{event_id}/keyframes
+    /// Keyframe times of the event's recording and their byte offsets in the
+    /// layout /events/{filename} serves to range requests, for seek previews
+    void getEventKeyframes(const drogon::HttpRequestPtr& req,
+                           std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                           const std::string& event_id);
+
     /// GET /api/timeline?camera_id=X&date=YYYY-MM-DD
     void getTimeline(const drogon::HttpRequestPtr& req,
                      std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
+    /// GET /api/timeline/range?cameras=a,b&start=YYYY-MM-DD&end=YYYY-MM-DD&bucket=15m|1h|1d
+    /// Columnar event counts for several cameras (at most 64) and days in one response
+    void getTimelineRange(const drogon::HttpRequestPtr& req,
+                          std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+
     /// GET /api/cameras/status
     void getCamerasStatus(const drogon::HttpRequestPtr& req,
                           std::function<void(const drogon::HttpResponsePtr&)>&& callback);
@@ -45,7 +97,14 @@ public:
                            std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                            const std::string& camera_id);
 
+    /// GET /api/cameras/{camera_id}/stream — multipart/x-mixed-replace JPEG stream
+    void getCameraStream(const drogon::HttpRequestPtr& req,
+                         std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                         const std::string& camera_id);
+
     /// GET /api/search?q=...&classes=...&camera_id=...&start=...&end=...&limit=50&mode=auto
+    /// mode: auto | fts | semantic | semantic_exact | hybrid (semantic_exact: 503 without
+    /// the semantic index)
     void searchEvents(const drogon::HttpRequestPtr& req,
                       std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
@@ -53,6 +112,18 @@ public:
     void getPeriodicSnapshots(const drogon::HttpRequestPtr& req,
                               std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
+    /// GET /api/cameras/{camera_id}/sprites?date=YYYY-MM-DD
+    /// Tile map of the day's periodic-snapshot contact sheet; image_url fetches the JPEG
+    void getSpriteSheet(const drogon::HttpRequestPtr& req,
+                        std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                        const std::string& camera_id);
+
+    /// GET /api/cameras/{camera_id}/sprites/image?date=YYYY-MM-DD&v=VERSION
+    /// The contact sheet JPEG; immutable when v matches the current version
+    void getSpriteImage(const drogon::HttpRequestPtr& req,
+                        std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                        const std::string& camera_id);
+
     /// GET /api/cameras/{camera_id}/paused — proxy to detection service
     void getCameraPaused(const drogon::HttpRequestPtr& req,
                          std::function<void(const drogon::HttpResponsePtr&)>&& callback,
@@ -67,19 +138,119 @@ public:
     void getHealth(const drogon::HttpRequestPtr& req,
                    std::function<void(const drogon::HttpResponsePtr&)>&& callback);
 
+    /// GET /metrics — Prometheus text exposition
+    void getMetrics(const drogon::HttpRequestPtr& req,
+                    std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+
     /// Set the shared database pool (called once at startup)
     static void setDbPool(std::shared_ptr<DbPool> pool);
 
-    /// Set the detection service URL for snapshot proxying
-    static void setDetectionServiceUrl(std::string url);
+    /// Set the threads that run handlers' database work off the IO loops (optional;
+    /// without it queries run inline on the Drogon thread)
+    static void setDbExecutor(std::shared_ptr<DbExecutor> executor);
+
+    /// Set the read-replica router (optional; without it every query uses the pool)
+    static void setDbRouter(std::shared_ptr<DbRouter> router);
+
+    /// Set the pooled client used to proxy requests to the detection service
+    static void setDetectionClient(std::shared_ptr<DetectionClient> client);
+
+    /// Set the live snapshot cache (shares the detection client)
+    static void setSnapshotCache(std::shared_ptr<SnapshotCache> cache);
 
-    /// Set the Ollama URL for query-time embeddings
-    static void setOllamaUrl(std::string url);
+    /// Set the shared client for query-time embeddings (Ollama)
+    static void setEmbeddingClient(std::shared_ptr<EmbeddingClient> client);
+
+    /// Set the hub that fans live frames out to MJPEG streams
+    static void setLiveStreamHub(std::shared_ptr<LiveStreamHub> hub);
+
+    /// Set the shared tail of new events behind /api/events/stream (optional)
+    static void setEventFeed(std::shared_ptr<EventFeed> feed);
+
+    /// Set the recording filename index used by the only_with_recordings filter
+    static void setRecordingIndex(std::shared_ptr<RecordingIndex> index);
+
+    /// Set the in-process vector index used for semantic search (optional)
+    static void setSemanticIndex(std::shared_ptr<SemanticIndex> index);
+
+    /// Set the in-memory timeline rollup used by /api/timeline (optional)
+    static void setTimelineRollup(std::shared_ptr<TimelineRollup> rollup);
+
+    /// Latency budget and RRF constant for mode=hybrid
+    static void setHybridSearch(std::chrono::milliseconds budget, int rrf_k);
+
+    /// Set the cache of serialized event detail, timeline and snapshot responses (optional)
+    static void setResponseCache(std::shared_ptr<ResponseCache> cache);
+
+    /// Set the builder of periodic-snapshot contact sheets (optional)
+    static void setSpriteSheets(std::shared_ptr<SpriteSheets> sheets);
+
+    /// Set the MP4 keyframe index shared with MediaController (optional)
+    static void setMp4Index(std::shared_ptr<Mp4IndexCache> index);
 
 private:
+    using Callback = std::function<void(const drogon::HttpResponsePtr&)>;
+
+    /// Run work, which queries the database and answers through callback, on
+    /// the DB executor. Answers 503 itself when the executor's queue is full,
+    /// and 500 when work throws before answering.
+    static void runQuery(Callback&& callback, std::function<void(const Callback&)>&& work);
+
+    /// Run query(pool) for a read-only query: on a healthy replica when
+    /// routing is on, repeated on the primary if that replica turns out to
+    /// be gone (DbRouter::read)
+    template <typename Query>
+    static auto readQuery(Query&& query) {
+        return db_router_ ? db_router_->read(query) : query(*db_pool_);
+    }
+
+    /// Semantic search via the in-process index, falling back to pgvector.
+    /// exact ranks every stored embedding instead of walking the HNSW graph.
+    static nlohmann::json semanticSearch(const api_queries::SearchParams& params,
+                                         const std::vector<float>& embedding,
+                                         bool exact = false);
+
+    /// Embed query on a search worker, since a slow Ollama must not hold a DB
+    /// executor thread, then run work with the vector (empty when embedding
+    /// failed) on the DB executor. False, leaving callback to the caller,
+    /// when the search workers are backed up.
+    static bool withQueryEmbedding(const std::string& query, const Callback& callback,
+                                   std::function<void(const Callback&, const std::vector<float>&)>&& work);
+
+    /// mode=hybrid: FTS and embedding+semantic legs run concurrently and are
+    /// merged with reciprocal-rank fusion; answers with whatever has arrived
+    /// once the latency budget expires. With the search workers backed up it
+    /// answers from FTS alone.
+    static void hybridSearch(const api_queries::SearchParams& params,
+                             const ResponseFormat& format,
+                             std::function<void(const drogon::HttpResponsePtr&)>&& callback);
+
+    /// Validate the date parameter, load the day's snapshots and hand the
+    /// sheet to done, which answers through the callback it is given. Answers
+    /// itself on bad input, when disabled, when the query fails and when the
+    /// day has no snapshot to draw.
+    static void withSpriteSheet(const drogon::HttpRequestPtr& req,
+                                const std::string& camera_id,
+                                Callback&& callback,
+                                std::function<void(const Callback&, const std::string& date,
+                                                   const SpriteSheets::SheetPtr&)>&& done);
+
     static inline std::shared_ptr<DbPool> db_pool_;
-    static inline std::string detection_service_url_;
-    static inline std::string ollama_url_;
+    static inline std::shared_ptr<DbExecutor> db_executor_;
+    static inline std::shared_ptr<DbRouter> db_router_;
+    static inline std::shared_ptr<RecordingIndex> recording_index_;
+    static inline std::shared_ptr<DetectionClient> detection_client_;
+    static inline std::shared_ptr<SnapshotCache> snapshot_cache_;
+    static inline std::shared_ptr<LiveStreamHub> live_stream_hub_;
+    static inline std::shared_ptr<EventFeed> event_feed_;
+    static inline std::shared_ptr<EmbeddingClient> embedding_client_;
+    static inline std::shared_ptr<SemanticIndex> semantic_index_;
+    static inline std::shared_ptr<TimelineRollup> timeline_rollup_;
+    static inline std::shared_ptr<ResponseCache> response_cache_;
+    static inline std::shared_ptr<SpriteSheets> sprite_sheets_;
+    static inline std::shared_ptr<Mp4IndexCache> mp4_index_;
+    static inline std::chrono::milliseconds hybrid_budget_{1000};
+    static inline int hybrid_rrf_k_ = 60;
 };
 
 } // namespace hms
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace hms {
+
+/// Bounded queue plus a fixed set of threads for the blocking api_queries /
+/// timeline_queries calls, so they never run on Drogon's IO threads.
+///
+/// With one thread per DbPool connection, jobs wait for a connection here
+/// rather than inside the pool, where the wait is measured and the queue is
+/// capped. A full queue refuses new jobs at once, so handlers can answer
+/// 503 instead of piling requests up behind a slow database. Jobs run in
+/// submission order.
+class DbExecutor {
+public:
+    struct Options {
+        size_t threads = 4;        ///< match DbPool's pool_size
+        size_t max_queue = 256;    ///< waiting jobs before submit() refuses
+    };
+
+    struct Stats {
+        uint64_t queued = 0;          ///< waiting for a thread now
+        uint64_t running = 0;
+        uint64_t submitted = 0;
+        uint64_t rejected = 0;        ///< refused because the queue was full
+        uint64_t completed = 0;
+        double avg_wait_ms = 0.0;     ///< queue time, submit to start
+        double max_wait_ms = 0.0;
+        double avg_run_ms = 0.0;
+    };
+
+    explicit DbExecutor(Options options);
+    ~DbExecutor();
+
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    /// Queue job; false (and job is dropped) when the queue is full or stopping.
+    /// Exceptions escaping job are logged, then on_error runs on the same
+    /// thread, so the request behind a failed job can still be answered.
+    bool submit(std::function<void()> job, std::function<void()> on_error = {});
+
+    /// Finish queued jobs and join the threads (idempotent)
+    void stop();
+
+    Stats stats() const;
+
+private:
+    struct Job {
+        std::function<void()> fn;
+        std::function<void()> on_error;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    void run();
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    std::atomic<uint64_t> running_{0};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> total_wait_us_{0};
+    std::atomic<uint64_t> max_wait_us_{0};
+    std::atomic<uint64_t> total_run_us_{0};
+};
+
+/// A response callback that runs at most once, however many times it is
+/// called. Lets a job's error path answer without knowing whether the job
+/// got as far as answering itself.
+template <typename Response>
+class OnceCallback {
+public:
+    explicit OnceCallback(std::function<void(const Response&)> callback)
+        : callback_(std::move(callback)) {}
+
+    /// False, and response is dropped, when already answered
+    bool operator()(const Response& response) {
+        if (answered_.exchange(true, std::memory_order_acq_rel)) return false;
+        callback_(response);
+        return true;
+    }
+
+    bool answered() const { return answered_.load(std::memory_order_acquire); }
+
+private:
+    std::function<void(const Response&)> callback_;
+    std::atomic<bool> answered_{false};
+};
+
+} // namespace hms
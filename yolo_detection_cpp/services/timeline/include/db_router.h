@@ -0,0 +1,212 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "db_pool.h"
+
+namespace hms {
+
+/// What DbRouter::read(query) treats as a possibly failed result besides a
+/// throw: an empty optional, the timeline_queries convention for a database
+/// error, and JSON without data. api_queries functions answer a database
+/// error with null or an empty document ([], {}, {"events": [], "count": 0}),
+/// which an empty result looks the same as; probing the replica tells the
+/// two apart.
+template <typename T>
+bool isFailedRead(const T&) { return false; }
+
+template <typename T>
+bool isFailedRead(const std::optional<T>& result) { return !result; }
+
+inline bool isFailedRead(const nlohmann::json& result) {
+    if (result.is_array()) return result.empty();
+    if (!result.is_object()) return result.is_null();
+    return std::none_of(result.begin(), result.end(), [](const nlohmann::json& value) {
+        return (value.is_array() || value.is_object()) && !value.empty();
+    });
+}
+
+/// The retry rule of DbRouter::read(query), apart so it can be tested
+/// without databases. replica is null when the read already went to the
+/// primary. After a replica read fails, replica_down() decides whether the
+/// replica itself is gone; only then does query run once more on primary.
+template <typename Pool, typename Query, typename Down>
+auto readWithFallback(Pool* replica, Pool& primary, Query&& query, Down&& replica_down) {
+    if (!replica) return query(primary);
+    try {
+        auto result = query(*replica);
+        if (!isFailedRead(result) || !replica_down()) return result;
+    } catch (...) {
+        if (!replica_down()) throw;
+    }
+    return query(primary);
+}
+
+/// Routes the handlers' read-only queries to PostgreSQL streaming replicas,
+/// so history scans and searches do not compete with the detection engine's
+/// writes on the primary.
+///
+/// A checker thread connects to each replica, confirms it is still in
+/// recovery and measures how far its replay is behind the primary's WAL
+/// position. read() hands out the least busy replica that is reachable and
+/// within max_lag, and the primary when none is. A replica that cannot be
+/// reached at startup is retried on every check. Between checks,
+/// read(query) notices a replica whose connection failed: it takes it out
+/// of service and runs that query again on the primary.
+class DbRouter {
+public:
+    struct Options {
+        std::chrono::seconds check_interval{5};
+        /// Replicas further behind than this are skipped
+        double max_lag_seconds = 10.0;
+        /// Whether a replica still answers, asked after a query on it failed;
+        /// defaults to a trivial timeline_queries call
+        std::function<bool(DbPool&)> probe;
+    };
+
+    struct ReplicaStats {
+        std::string host;
+        int port = 0;
+        bool connected = false;
+        bool healthy = false;            ///< reachable, in recovery and within max_lag
+        double lag_seconds = 0.0;
+        double lag_bytes = 0.0;
+        uint64_t reads = 0;
+        uint64_t failed_checks = 0;      ///< found unreachable, promoted or lagging
+        uint64_t failed_reads = 0;       ///< taken out of service by a failed query
+        std::string last_error;
+    };
+
+    struct Stats {
+        uint64_t primary_reads = 0;
+        uint64_t replica_reads = 0;
+        uint64_t fallbacks = 0;          ///< reads sent to the primary with no healthy replica
+        uint64_t retries = 0;            ///< reads repeated on the primary after a replica failed
+        std::vector<ReplicaStats> replicas;
+    };
+
+    /// Replicas use the same credentials and pool size as primary_config
+    DbRouter(std::shared_ptr<DbPool> primary, const DbPool::Config& primary_config,
+             std::vector<std::pair<std::string, int>> replicas, Options options);
+    ~DbRouter();
+
+    DbRouter(const DbRouter&) = delete;
+    DbRouter& operator=(const DbRouter&) = delete;
+
+    /// Start the checker thread; its first check runs at once
+    void start();
+
+    /// Stop the checker thread (idempotent, also called by the destructor)
+    void stop();
+
+    DbPool& primary() { return *primary_; }
+
+    /// Pool for a read-only query: the healthy replica with the fewest
+    /// connections in use (ties rotate), else the primary. Pools outlive the
+    /// router's users, so the reference stays valid.
+    DbPool& read();
+
+    /// Run query(pool) on the pool read() picks. If that is a replica, the
+    /// query fails or may have (see isFailedRead) and the replica does not
+    /// answer Options::probe either, the replica leaves service until a check
+    /// finds it healthy again and query runs once more on the primary.
+    template <typename Query>
+    auto read(Query&& query) {
+        Replica* replica = nullptr;
+        DbPool& pool = pick(replica);
+        return readWithFallback(replica ? &pool : nullptr, *primary_, query, [&] {
+            if (!replicaDown(*replica)) return false;
+            retries_.fetch_add(1, std::memory_order_relaxed);
+            primary_reads_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        });
+    }
+
+    Stats stats() const;
+
+    /// Index of the replica to read from: the one with the fewest connections
+    /// in use, in_use(i) being nullopt for one out of service. Scans from
+    /// first so ties rotate. nullopt when no replica is in service.
+    template <typename InUse>
+    static std::optional<size_t> pickReplica(size_t count, size_t first, InUse&& in_use) {
+        std::optional<size_t> best;
+        size_t best_in_use = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const size_t index = (first + i) % count;
+            std::optional<size_t> load = in_use(index);
+            if (load && (!best || *load < best_in_use)) {
+                best = index;
+                best_in_use = *load;
+            }
+        }
+        return best;
+    }
+
+    /// Replication lag in seconds from the replica's replay position.
+    /// lag_bytes is the WAL distance to the primary (nullopt when the primary
+    /// could not be asked), replay_age the time since the last replayed
+    /// transaction. A replica that has replayed everything is current even if
+    /// the primary has been idle for a while; one that has not is as far
+    /// behind as its last replayed transaction.
+    static double lagSeconds(std::optional<double> lag_bytes, std::optional<double> replay_age);
+
+    /// Whether a replica in recovery should serve reads. Without the
+    /// primary's position (lag_bytes nullopt) replay_age only bounds the lag
+    /// from above: within max_lag the replica is in service, beyond it the
+    /// previous verdict stands, since an idle primary looks the same as a
+    /// stalled replica.
+    static bool inService(std::optional<double> lag_bytes, std::optional<double> replay_age,
+                          double max_lag_seconds, bool was_in_service);
+
+private:
+    struct Replica {
+        DbPool::Config config;
+        std::shared_ptr<DbPool> pool;       ///< set once the first connect succeeds
+        bool healthy = false;
+        double lag_seconds = 0.0;
+        double lag_bytes = 0.0;
+        std::string last_error;
+        std::atomic<uint64_t> reads{0};
+        std::atomic<uint64_t> failed_checks{0};
+        std::atomic<uint64_t> failed_reads{0};
+    };
+
+    void run();
+    void check();
+    /// read()'s choice; replica is set when it is one
+    DbPool& pick(Replica*& replica);
+    /// Probe replica after a failed query; if it is gone, take it out of service
+    bool replicaDown(Replica& replica);
+    bool waitFor(std::chrono::seconds interval);
+
+    std::shared_ptr<DbPool> primary_;
+    Options options_;
+    std::vector<std::unique_ptr<Replica>> replicas_;
+
+    mutable std::mutex mutex_;              ///< guards Replica pool/health fields
+    size_t next_ = 0;                       ///< rotates the tie-break start
+
+    std::atomic<uint64_t> primary_reads_{0};
+    std::atomic<uint64_t> replica_reads_{0};
+    std::atomic<uint64_t> fallbacks_{0};
+    std::atomic<uint64_t> retries_{0};
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace hms
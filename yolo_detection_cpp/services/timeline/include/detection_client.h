@@ -0,0 +1,99 @@
+#pragma once
+
+#include <drogon/HttpClient.h>
+#include <trantor/net/EventLoopThread.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hms {
+
+/// Asynchronous, pooled HTTP client for the detection service.
+///
+/// Requests run on a dedicated event loop over a small set of keep-alive
+/// connections, so Drogon worker threads never block on upstream I/O. The
+/// upstream host is resolved once (IPv4) and re-resolved only after
+/// connection failures, on a thread of its own: a slow DNS server never
+/// stalls requests in flight. In-flight requests are capped; excess requests
+/// are rejected immediately instead of queueing behind a stalled upstream.
+class DetectionClient {
+public:
+    struct Options {
+        size_t connections = 4;       ///< keep-alive connections to the upstream
+        size_t max_in_flight = 32;    ///< concurrent requests before rejecting
+        double timeout_sec = 4.0;     ///< per-request timeout
+        /// Minimum time between re-resolutions after failures
+        std::chrono::milliseconds resolve_interval{30000};
+        /// Host name to dotted IPv4 address, empty on failure; blocking
+        /// getaddrinfo when unset
+        std::function<std::string(const std::string&)> resolver;
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t errors = 0;          ///< transport failures and 5xx responses
+        uint64_t timeouts = 0;
+        uint64_t rejected = 0;        ///< refused by the in-flight limit
+        uint64_t in_flight = 0;
+        double avg_latency_ms = 0.0;
+        double max_latency_ms = 0.0;
+    };
+
+    /// Result::Ok carries the upstream response; other results carry nullptr.
+    enum class Result { Ok, Rejected, Timeout, Unavailable };
+    using Callback = std::function<void(Result, const drogon::HttpResponsePtr&)>;
+
+    explicit DetectionClient(const std::string& base_url, Options options);
+    ~DetectionClient();
+
+    DetectionClient(const DetectionClient&) = delete;
+    DetectionClient& operator=(const DetectionClient&) = delete;
+
+    /// Send a request; the callback runs on the client's event loop when it completes.
+    void request(drogon::HttpMethod method,
+                 const std::string& path,
+                 std::string body,
+                 Callback&& callback);
+
+    Stats stats() const;
+
+    /// Address the connections currently point at; empty until a resolve succeeds
+    std::string resolvedAddress() const;
+
+private:
+    void connect(const std::string& ip);
+    void scheduleResolve();
+    void record(std::chrono::steady_clock::time_point started, bool error, bool timeout);
+
+    std::string host_;
+    uint16_t port_ = 80;
+    Options options_;
+
+    // Declared before clients_ so the loop outlives the connections bound to it
+    trantor::EventLoopThread loop_thread_;
+    // Runs the blocking lookups; stopped first in the destructor
+    std::unique_ptr<trantor::EventLoopThread> resolver_thread_;
+
+    mutable std::mutex clients_mutex_;
+    std::vector<drogon::HttpClientPtr> clients_;
+    std::string resolved_ip_;
+    std::atomic<bool> resolving_{false};
+    std::chrono::steady_clock::time_point last_resolve_{};
+    std::atomic<size_t> next_client_{0};
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> in_flight_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> total_latency_us_{0};
+    std::atomic<uint64_t> max_latency_us_{0};
+};
+
+} // namespace hms
@@ -1,23 +1,106 @@
 #pragma once
 
+#include "lru_cache.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace hms {
 
-/// Synchronous client for Ollama's /api/embed endpoint.
-/// Uses libcurl — safe to call from any thread.
+/// Client for Ollama's /api/embed endpoint, shared by all request threads.
+///
+/// - curl easy handles are pooled so keep-alive connections to Ollama are reused
+/// - results are kept in an LRU cache keyed on (model, normalized query text);
+///   Ollama is sent the caller's text as it was, so normalizing changes only
+///   which queries share an entry, never the embedding itself
+/// - concurrent embed() calls are coalesced into one request with an array
+///   `input`. A batcher thread owns the batching window and the /api/embed
+///   calls, so callers only wait for their own batch.
 class EmbeddingClient {
 public:
+    struct Options {
+        size_t cache_entries = 1024;                              ///< cached query vectors
+        size_t max_batch = 16;                                    ///< inputs per /api/embed call
+        std::chrono::microseconds batch_window{2000};             ///< how long the oldest query waits for others to join
+        size_t max_idle_handles = 4;                              ///< pooled curl handles kept open
+    };
+
+    struct Stats {
+        uint64_t requests = 0;
+        uint64_t cache_hits = 0;
+        uint64_t cache_misses = 0;
+        uint64_t batches = 0;           ///< /api/embed calls made
+        uint64_t batched_inputs = 0;    ///< inputs sent across all batches
+        uint64_t errors = 0;
+        double hit_rate = 0.0;
+        double avg_latency_ms = 0.0;    ///< per /api/embed call
+    };
+
     explicit EmbeddingClient(const std::string& ollama_url = "http://localhost:11434",
                              const std::string& model = "nomic-embed-text");
+    EmbeddingClient(const std::string& ollama_url, const std::string& model, Options options);
+    ~EmbeddingClient();
+
+    EmbeddingClient(const EmbeddingClient&) = delete;
+    EmbeddingClient& operator=(const EmbeddingClient&) = delete;
 
     /// Generate a 768-dim embedding for text. Returns empty vector on error.
+    /// Thread-safe; blocks until the batch containing this text completes,
+    /// at most batch_window plus the /api/embed calls queued ahead of it.
     std::vector<float> embed(const std::string& text);
 
+    const std::string& model() const { return model_; }
+
+    Stats stats() const;
+
+    /// Lowercase, trim and collapse whitespace so equivalent queries share a cache entry
+    static std::string normalize(const std::string& text);
+
 private:
+    struct Pending {
+        std::string key;       ///< normalize(text): cache and batch dedup key
+        std::string text;      ///< what Ollama embeds
+        std::promise<std::vector<float>> promise;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    void runBatcher();
+    void flush(std::vector<std::shared_ptr<Pending>> batch);
+    std::vector<std::vector<float>> embedBatch(const std::vector<std::string>& inputs);
+    void* acquireHandle();
+    void releaseHandle(void* handle);
+
     std::string url_;
     std::string model_;
+    Options options_;
+
+    std::mutex cache_mutex_;
+    LruCache<std::string, std::vector<float>> cache_;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<std::shared_ptr<Pending>> queue_;
+    bool stopping_ = false;
+
+    std::mutex handles_mutex_;
+    std::vector<void*> idle_handles_;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> batched_inputs_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> total_latency_us_{0};
+
+    std::thread batcher_;     ///< last, so it starts after everything it uses
 };
 
 }  // namespace hms
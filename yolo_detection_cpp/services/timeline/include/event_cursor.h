@@ -0,0 +1,77 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hms {
+
+/// Seek position for keyset pagination of /api/events, which is ordered by
+/// (started_at, event_id) descending. A page continues with the rows strictly
+/// before this key. Clients see it only as an opaque base64url token.
+struct EventCursor {
+    int64_t started_at_us = 0;   ///< started_at, microseconds since the Unix epoch
+    std::string event_id;
+
+    /// base64url (no padding) of "1:<started_at_us>:<event_id>"
+    std::string encode() const {
+        static constexpr char kAlphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        const std::string raw = "1:" + std::to_string(started_at_us) + ":" + event_id;
+        std::string out;
+        out.reserve((raw.size() * 4 + 2) / 3);
+        uint32_t acc = 0;
+        int bits = 0;
+        for (unsigned char c : raw) {
+            acc = (acc << 8) | c;
+            bits += 8;
+            while (bits >= 6) {
+                bits -= 6;
+                out += kAlphabet[(acc >> bits) & 0x3f];
+            }
+        }
+        if (bits > 0) out += kAlphabet[(acc << (6 - bits)) & 0x3f];
+        return out;
+    }
+
+    /// nullopt for anything encode() could not have produced
+    static std::optional<EventCursor> decode(std::string_view token) {
+        if (token.empty() || token.size() > 512) return std::nullopt;
+        std::string raw;
+        raw.reserve(token.size() * 3 / 4);
+        uint32_t acc = 0;
+        int bits = 0;
+        for (char c : token) {
+            int v;
+            if (c >= 'A' && c <= 'Z') v = c - 'A';
+            else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') v = c - '0' + 52;
+            else if (c == '-') v = 62;
+            else if (c == '_') v = 63;
+            else return std::nullopt;
+            acc = (acc << 6) | static_cast<uint32_t>(v);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                raw += static_cast<char>((acc >> bits) & 0xff);
+            }
+        }
+
+        std::string_view view(raw);
+        if (view.substr(0, 2) != "1:") return std::nullopt;
+        view.remove_prefix(2);
+        auto colon = view.find(':');
+        if (colon == std::string_view::npos || colon == 0) return std::nullopt;
+
+        EventCursor cursor;
+        auto [end, ec] = std::from_chars(view.data(), view.data() + colon, cursor.started_at_us);
+        if (ec != std::errc() || end != view.data() + colon) return std::nullopt;
+        cursor.event_id = std::string(view.substr(colon + 1));
+        if (cursor.event_id.empty()) return std::nullopt;
+        return cursor;
+    }
+};
+
+} // namespace hms
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "json_writer.h"
+#include "timeline_queries.h"
+
+namespace hms {
+
+/// The ids of a batch detail request: GET /api/events/details?ids=a,b or
+/// POST /api/events/batch with {"ids": [...]}. Ids keep request order;
+/// duplicates, empty ids and (in a body) non-string entries are dropped.
+struct EventIdList {
+    /// Most events one request may ask for (two pages of cards)
+    static constexpr size_t kMaxIds = 200;
+
+    enum class Error { None, Malformed, Empty, TooMany };
+
+    std::vector<std::string> ids;
+    Error error = Error::None;
+
+    /// Comma-separated ids from the query string
+    static EventIdList fromQuery(std::string_view param) {
+        EventIdList list;
+        std::unordered_set<std::string_view> seen;
+        while (true) {
+            auto comma = param.find(',');
+            list.add(seen, param.substr(0, comma));
+            if (comma == std::string_view::npos) break;
+            param.remove_prefix(comma + 1);
+        }
+        list.validate();
+        return list;
+    }
+
+    /// A JSON object with an "ids" array
+    static EventIdList fromBody(std::string_view body) {
+        EventIdList list;
+        auto doc = nlohmann::json::parse(body, nullptr, false);
+        auto ids = doc.is_object() ? doc.find("ids") : doc.end();
+        if (doc.is_discarded() || !doc.is_object() || ids == doc.end() || !ids->is_array()) {
+            list.error = Error::Malformed;
+            return list;
+        }
+        std::unordered_set<std::string_view> seen;
+        for (const auto& id : *ids) {
+            if (id.is_string()) list.add(seen, id.get_ref<const std::string&>());
+        }
+        list.validate();
+        return list;
+    }
+
+private:
+    // seen views point into the source being parsed, which outlives the loop
+    void add(std::unordered_set<std::string_view>& seen, std::string_view id) {
+        if (!id.empty() && seen.insert(id).second) ids.emplace_back(id);
+    }
+
+    void validate() {
+        if (ids.empty()) error = Error::Empty;
+        else if (ids.size() > kMaxIds) error = Error::TooMany;
+    }
+};
+
+/// {"events": [{"event", "detections"}...], "count", "missing"} with events
+/// in the order of ids and the ids that have no event row in missing
+inline void writeEventDetails(JsonWriter& out, const std::vector<std::string>& ids,
+                              const timeline_queries::EventDetails& details) {
+    out.beginObject().key("events").beginArray();
+    int64_t count = 0;
+    for (const auto& id : ids) {
+        auto it = details.by_id.find(id);
+        if (it == details.by_id.end()) continue;
+        out.beginObject();
+        out.key("event").raw(it->second.event);
+        out.key("detections").raw(it->second.detections);
+        out.endObject();
+        ++count;
+    }
+    out.endArray();
+    out.key("count").value(count);
+    out.key("missing").beginArray();
+    for (const auto& id : ids) {
+        if (!details.by_id.count(id)) out.value(id);
+    }
+    out.endArray().endObject();
+}
+
+} // namespace hms
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <drogon/HttpResponse.h>
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/net/TcpConnection.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "db_pool.h"
+#include "timeline_queries.h"
+
+namespace hms {
+
+/// Pushes new and changed detection events to Server-Sent Events streams
+/// (GET /api/events/stream).
+///
+/// One tail query, shared by every subscriber, re-reads the events that
+/// started within the last `lookback` on each poll while at least one stream
+/// is open. Rows not seen before go out as `event`, rows whose content
+/// changed (an event finishing, gaining detections or an AI summary) as
+/// `update`. Each message is framed once and handed to every subscriber
+/// whose camera filter matches.
+///
+/// Messages carry increasing ids and the last `replay_size` are kept, so a
+/// client that reconnects with Last-Event-ID gets what it missed. When that
+/// is no longer possible it gets a `resync` message and should reload
+/// /api/events. A subscriber whose connection has more than max_backlog
+/// unsent bytes is disconnected rather than buffered; EventSource reconnects
+/// it and the replay catches it up.
+class EventFeed {
+public:
+    struct Options {
+        std::chrono::milliseconds poll_interval{1000};
+        /// Window re-read on every poll; covers events inserted or updated late
+        std::chrono::seconds lookback{300};
+        /// Newest rows read per poll
+        int max_rows = 500;
+        size_t replay_size = 256;
+        size_t max_backlog = 256 * 1024;
+        /// Idle streams get an SSE comment this often so proxies keep them open
+        std::chrono::seconds heartbeat{15};
+        /// Tail query (since_us, lookback_seconds, limit); defaults to
+        /// timeline_queries::load_recent_events
+        std::function<std::optional<std::vector<timeline_queries::FeedRow>>(
+            std::optional<int64_t> since_us, int lookback_seconds, int limit)> load;
+    };
+
+    struct Stats {
+        uint64_t subscribers = 0;
+        uint64_t polls = 0;
+        uint64_t poll_errors = 0;
+        uint64_t messages_published = 0;
+        uint64_t messages_sent = 0;
+        uint64_t replayed = 0;           ///< sent from the replay buffer on reconnect
+        uint64_t resyncs = 0;            ///< reconnects the buffer could not cover
+        uint64_t slow_disconnects = 0;   ///< dropped for exceeding max_backlog
+    };
+
+    /// Remembers the rows already published and classifies a poll's rows
+    class Tracker {
+    public:
+        enum class Change { None, Added, Updated };
+
+        /// Classify row and remember its content
+        Change observe(const timeline_queries::FeedRow& row);
+
+        /// Forget rows that started before since_us (they left the window)
+        void forgetBefore(int64_t since_us);
+
+        void clear() { seen_.clear(); }
+        size_t size() const { return seen_.size(); }
+
+    private:
+        struct Seen {
+            int64_t started_at_us = 0;
+            size_t hash = 0;
+        };
+        std::unordered_map<std::string, Seen> seen_;
+    };
+
+    /// The last `capacity` framed messages, for Last-Event-ID replay
+    class ReplayBuffer {
+    public:
+        struct Message {
+            uint64_t id = 0;
+            std::string camera_id;
+            std::shared_ptr<const std::string> frame;
+        };
+
+        explicit ReplayBuffer(size_t capacity) : capacity_(capacity) {}
+
+        /// Assign the next id, frame the message and keep it
+        const Message& push(const std::string& camera_id, std::string_view type,
+                            std::string_view data);
+
+        /// Drop everything and treat every id issued so far as unreplayable,
+        /// for when messages may have been missed while nobody was polling
+        void reset();
+
+        /// Whether the messages after last_event_id are all still buffered
+        /// (trivially so when it is the latest id)
+        bool covers(uint64_t last_event_id) const;
+
+        /// The last id issued; 0 before the first message
+        uint64_t latest() const { return next_id_ - 1; }
+        const std::deque<Message>& messages() const { return messages_; }
+
+    private:
+        size_t capacity_;
+        std::deque<Message> messages_;
+        uint64_t next_id_ = 1;
+        uint64_t resync_through_ = 0;   ///< Last-Event-IDs up to this cannot be replayed
+    };
+
+    /// Where one stream's messages go. subscribe(stream, conn, ...) wraps a
+    /// Drogon response stream; tests pass their own.
+    struct Sink {
+        /// Queue a message; false once the client is gone
+        std::function<bool(const std::string& data)> send;
+        /// Bytes written to the client's socket so far; nullopt once it closed
+        std::function<std::optional<uint64_t>()> bytes_sent;
+        std::function<void()> close;
+    };
+
+    EventFeed(std::shared_ptr<DbPool> pool, Options options);
+    ~EventFeed();
+
+    EventFeed(const EventFeed&) = delete;
+    EventFeed& operator=(const EventFeed&) = delete;
+
+    /// Attach an SSE response stream. cameras empty means every camera.
+    /// last_event_id is the client's Last-Event-ID, if it sent one.
+    void subscribe(drogon::ResponseStreamPtr stream,
+                   std::weak_ptr<trantor::TcpConnection> conn,
+                   std::unordered_set<std::string> cameras,
+                   std::optional<uint64_t> last_event_id);
+
+    void subscribe(Sink sink, std::unordered_set<std::string> cameras,
+                   std::optional<uint64_t> last_event_id);
+
+    Stats stats() const;
+
+    /// One SSE message: "id: <id>\nevent: <type>\ndata: <data>\n\n"
+    static std::string frame(uint64_t id, std::string_view type, std::string_view data);
+
+private:
+    struct Subscriber {
+        Sink sink;
+        std::unordered_set<std::string> cameras;
+        size_t bytes_queued = 0;
+        uint64_t bytes_sent_base = 0;   ///< sink.bytes_sent() when subscribed
+
+        bool wants(const std::string& camera_id) const {
+            return cameras.empty() || cameras.count(camera_id) > 0;
+        }
+    };
+
+    void tick();
+    void publish(std::string_view type, const timeline_queries::FeedRow& row);
+    bool deliver(Subscriber& sub, const std::string& data);
+
+    std::shared_ptr<DbPool> pool_;
+    Options options_;
+    trantor::EventLoopThread loop_thread_;
+
+    mutable std::mutex mutex_;
+    std::vector<Subscriber> subscribers_;
+    ReplayBuffer replay_;
+    bool polling_ = false;
+    bool reprime_ = false;                 ///< forget tracked rows before the next poll
+    std::chrono::steady_clock::time_point stopped_at_;
+    std::chrono::steady_clock::time_point last_heartbeat_;
+
+    // Touched only by the poll loop
+    Tracker tracker_;
+    bool primed_ = false;                  ///< first poll records rows without publishing
+    std::optional<int64_t> since_us_;      ///< lower bound of the next poll
+
+    std::atomic<uint64_t> polls_{0};
+    std::atomic<uint64_t> poll_errors_{0};
+    std::atomic<uint64_t> messages_published_{0};
+    std::atomic<uint64_t> messages_sent_{0};
+    std::atomic<uint64_t> replayed_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    std::atomic<uint64_t> slow_disconnects_{0};
+};
+
+} // namespace hms
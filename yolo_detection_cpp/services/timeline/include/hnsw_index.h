@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+#include "vector_matrix.h"
+
+namespace hms {
+
+/// Hierarchical navigable small world graph for cosine nearest-neighbour search
+/// (Malkov & Yashunin). Vectors are L2-normalised on insert, so similarity is a
+/// plain dot product. Append-only; not synchronised — the owner serialises
+/// add() against search().
+class HnswIndex {
+public:
+    /// Internal ids are dense insertion indices
+    using Filter = std::function<bool(uint32_t)>;
+    using Match = std::pair<uint32_t, float>;   ///< (id, cosine similarity)
+
+    explicit HnswIndex(size_t dim, size_t m = 16, size_t ef_construction = 100,
+                       uint32_t seed = 42);
+
+    /// Insert a vector of dim() floats; returns its id
+    uint32_t add(const float* vec);
+
+    /// Up to k best matches, best first. Only ids accepted by filter are returned;
+    /// traversal still passes through rejected nodes.
+    std::vector<Match> search(const float* query, size_t k, size_t ef,
+                              const Filter& filter = {}) const;
+
+    size_t size() const { return levels_.size(); }
+    size_t dim() const { return dim_; }
+
+    /// Normalised vector for id (dim() floats)
+    const float* vector(uint32_t id) const { return vectors_.row(id); }
+
+    /// The stored vectors, usable for exact scans
+    const VectorMatrix& vectors() const { return vectors_; }
+
+    /// Cosine similarity of a normalised query against stored vector id
+    float similarity(const float* query, uint32_t id) const;
+
+private:
+    uint32_t greedyClosest(const float* query, uint32_t entry, int level) const;
+    std::vector<Match> searchLayer(const float* query, uint32_t entry, size_t ef, int level,
+                                   const Filter& filter) const;
+    std::vector<uint32_t> selectNeighbors(const std::vector<Match>& candidates, size_t m) const;
+    size_t maxLinks(int level) const { return level == 0 ? 2 * m_ : m_; }
+
+    size_t dim_;
+    size_t m_;
+    size_t ef_construction_;
+    double level_mult_;
+    std::mt19937 rng_;
+
+    VectorMatrix vectors_;
+    std::vector<int> levels_;
+    std::vector<std::vector<std::vector<uint32_t>>> links_;    ///< links_[node][level]
+    uint32_t entry_ = 0;
+    int max_level_ = -1;
+};
+
+} // namespace hms
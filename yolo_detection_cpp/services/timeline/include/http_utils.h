@@ -1,20 +1,147 @@
 #pragma once
 
+#include <drogon/HttpRequest.h>
 #include <drogon/HttpResponse.h>
 #include <nlohmann/json.hpp>
+#include "json_writer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
 
 namespace hms {
 
+/// Create a Drogon HTTP response from an already serialized JSON body
+/// (copied once, at its exact size).
+inline drogon::HttpResponsePtr makeJsonBodyResponse(
+    std::string_view body,
+    drogon::HttpStatusCode code = drogon::k200OK)
+{
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setStatusCode(code);
+    resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    resp->setBody(body.data(), body.size());
+    return resp;
+}
+
 /// Create a Drogon HTTP response with JSON body from an nlohmann::json object.
-/// Drogon's newHttpJsonResponse uses jsoncpp; this helper serialises via nlohmann.
+/// Drogon's newHttpJsonResponse uses jsoncpp; this helper serialises the DOM
+/// with JsonWriter into a pooled buffer.
 inline drogon::HttpResponsePtr makeJsonResponse(
     const nlohmann::json& j,
     drogon::HttpStatusCode code = drogon::k200OK)
+{
+    PooledBuffer buffer;
+    JsonWriter(buffer.str()).value(j);
+    return makeJsonBodyResponse(buffer.str(), code);
+}
+
+/// Strong ETag for a response body (quoted FNV-1a 64-bit hash plus length).
+inline std::string makeEtag(std::string_view body) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "\"%016llx-%zx\"",
+                  static_cast<unsigned long long>(hash), body.size());
+    return buf;
+}
+
+/// True when the request's conditional headers match, i.e. a 304 can be sent.
+/// If-None-Match takes precedence over If-Modified-Since (RFC 9110 §13.2.2).
+inline bool isNotModified(const drogon::HttpRequestPtr& req,
+                          std::string_view etag,
+                          std::string_view last_modified)
+{
+    const auto& if_none_match = req->getHeader("If-None-Match");
+    if (!if_none_match.empty()) {
+        if (etag.empty()) return false;
+        if (if_none_match == "*") return true;
+        // Comma-separated list; accept weak forms (W/"...") of our strong tag
+        std::string_view list(if_none_match);
+        while (!list.empty()) {
+            auto comma = list.find(',');
+            auto token = list.substr(0, comma);
+            while (!token.empty() && token.front() == ' ') token.remove_prefix(1);
+            while (!token.empty() && token.back() == ' ') token.remove_suffix(1);
+            if (token.substr(0, 2) == "W/") token.remove_prefix(2);
+            if (token == etag) return true;
+            if (comma == std::string_view::npos) break;
+            list.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    const auto& if_modified_since = req->getHeader("If-Modified-Since");
+    return !last_modified.empty() && if_modified_since == last_modified;
+}
+
+/// Outcome of matching a Range header against a representation
+enum class RangeResult {
+    Full,             ///< no usable Range: send the whole body with 200
+    Partial,          ///< send [offset, offset + length) with 206
+    Unsatisfiable,    ///< 416 with "Content-Range: bytes */size"
+};
+
+/// Parse a single "bytes=" range (RFC 9110 §14.1.2) against a body of size bytes.
+/// Multiple ranges, other units and malformed headers yield Full, which RFC 9110
+/// allows a server to answer with the whole representation.
+inline RangeResult parseRange(std::string_view header, uint64_t size,
+                              uint64_t& offset, uint64_t& length)
+{
+    constexpr std::string_view kPrefix = "bytes=";
+    if (header.substr(0, kPrefix.size()) != kPrefix) return RangeResult::Full;
+    auto spec = header.substr(kPrefix.size());
+    if (spec.find(',') != std::string_view::npos) return RangeResult::Full;
+    while (!spec.empty() && spec.front() == ' ') spec.remove_prefix(1);
+    while (!spec.empty() && spec.back() == ' ') spec.remove_suffix(1);
+
+    auto dash = spec.find('-');
+    if (dash == std::string_view::npos) return RangeResult::Full;
+    auto parse = [](std::string_view digits, uint64_t& out) {
+        if (digits.empty() || digits.size() > 19) return false;
+        out = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') return false;
+            out = out * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    };
+
+    uint64_t first = 0, last = 0;
+    auto first_str = spec.substr(0, dash);
+    auto last_str = spec.substr(dash + 1);
+    if (first_str.empty()) {
+        // Suffix range: the final N bytes
+        if (!parse(last_str, last)) return RangeResult::Full;
+        if (last == 0 || size == 0) return RangeResult::Unsatisfiable;
+        length = std::min(last, size);
+        offset = size - length;
+        return RangeResult::Partial;
+    }
+    if (!parse(first_str, first)) return RangeResult::Full;
+    if (last_str.empty()) {
+        last = size ? size - 1 : 0;
+    } else if (!parse(last_str, last) || last < first) {
+        return RangeResult::Full;
+    }
+    if (first >= size) return RangeResult::Unsatisfiable;
+    offset = first;
+    length = std::min(last, size - 1) - first + 1;
+    return RangeResult::Partial;
+}
+
+/// 304 response carrying the validators of the cached representation.
+inline drogon::HttpResponsePtr makeNotModifiedResponse(std::string_view etag,
+                                                       std::string_view last_modified)
 {
     auto resp = drogon::HttpResponse::newHttpResponse();
-    resp->setStatusCode(code);
-    resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
-    resp->setBody(j.dump());
+    resp->setStatusCode(drogon::k304NotModified);
+    if (!etag.empty()) resp->addHeader("ETag", std::string(etag));
+    if (!last_modified.empty()) resp->addHeader("Last-Modified", std::string(last_modified));
     return resp;
 }
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hms {
+
+/// Packed 8-bit RGB pixels, row-major with no padding
+struct RgbImage {
+    std::vector<unsigned char> pixels;
+    int width = 0;
+    int height = 0;
+};
+
+/// Decode jpeg to fit within max_width x max_height (0 = unbounded), keeping
+/// the aspect ratio and never upscaling. Uses libjpeg-turbo's DCT-domain
+/// scaling to get close, then a box filter for the exact size. False when
+/// the input is not a decodable JPEG or is unreasonably large.
+bool decodeJpeg(std::string_view jpeg, int max_width, int max_height, RgbImage& out);
+
+/// Baseline JPEG of image; nullopt on encoder failure
+std::optional<std::string> encodeJpeg(const RgbImage& image, int quality);
+
+} // namespace hms
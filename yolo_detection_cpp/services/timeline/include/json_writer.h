@@ -0,0 +1,88 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace hms {
+
+/// Append-only JSON serializer writing straight into a caller's string.
+///
+/// Produces compact JSON equivalent to nlohmann::json::dump() (same escaping,
+/// ".0" on integral doubles, null for NaN/inf) without building a DOM first,
+/// so rows can be serialized as they come off a database result. Commas are
+/// inserted automatically; the caller is responsible for balanced begin/end
+/// calls and for alternating key()/value inside objects. String bytes >= 0x80
+/// are copied as-is: the database and nlohmann's parser already guarantee UTF-8.
+/// Doubles use the shortest round-trip form, so large integral values can be
+/// spelled differently from dump() (1234567890123456.0 vs 1.234567890123456e+15)
+/// while parsing to the same number.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    /// nullptr writes null
+    JsonWriter& value(const char* text);
+    JsonWriter& value(int64_t number);
+    JsonWriter& value(uint64_t number);
+    JsonWriter& value(int number) { return value(static_cast<int64_t>(number)); }
+    JsonWriter& value(double number);
+    JsonWriter& value(bool flag);
+    /// Serialize an existing DOM without copying it
+    JsonWriter& value(const nlohmann::json& doc);
+    JsonWriter& null();
+
+    /// Append an already serialized JSON value (e.g. a cached row)
+    JsonWriter& raw(std::string_view json);
+
+    std::string& out() { return out_; }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    /// Comma before a value or key when it is not the first in its container
+    void separate();
+    void push(bool object);
+    void pop();
+    void writeString(std::string_view text);
+
+    std::string& out_;
+    int depth_ = 0;
+    uint64_t has_items_ = 0;     ///< bit d: container at depth d has an element
+    bool after_key_ = false;
+};
+
+/// Output buffer borrowed from a small per-thread pool.
+///
+/// Serializing into a buffer that already has capacity skips the repeated
+/// regrowth of a fresh string; the response then takes one exactly-sized copy.
+/// The buffer goes back to the pool on destruction unless it grew past
+/// kMaxRetained, so one huge response does not pin memory on every IO thread.
+class PooledBuffer {
+public:
+    static constexpr size_t kMaxRetained = 4 * 1024 * 1024;
+    static constexpr size_t kMaxPooled = 4;
+
+    PooledBuffer();
+    ~PooledBuffer();
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    std::string& str() { return buffer_; }
+
+private:
+    std::string buffer_;
+};
+
+} // namespace hms
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "snapshot_cache.h"
+#include <drogon/HttpResponse.h>
+#include <trantor/net/EventLoopThread.h>
+#include <trantor/net/TcpConnection.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hms {
+
+/// Fans out live camera frames to multipart/x-mixed-replace (MJPEG) streams.
+///
+/// One reader per camera polls the SnapshotCache while the camera has at least
+/// one subscriber; a camera's channel is dropped as soon as its last viewer
+/// leaves. Each new frame is framed once as a multipart part; sending it still
+/// copies it into every subscriber's connection buffer. A subscriber whose
+/// connection has more than max_backlog unsent bytes skips the frame, so slow
+/// clients see a lower frame rate rather than growing server-side buffers.
+class LiveStreamHub {
+public:
+    static constexpr const char* kBoundary = "frame";
+
+    struct Stats {
+        uint64_t channels = 0;         ///< cameras with a running reader
+        uint64_t subscribers = 0;
+        uint64_t frames_published = 0;
+        uint64_t frames_sent = 0;
+        uint64_t frames_dropped = 0;   ///< skipped for slow subscribers
+    };
+
+    /// Where one viewer's frames go. subscribe(stream, conn) wraps a Drogon
+    /// response stream; tests pass their own.
+    struct Sink {
+        /// Queue a part; false once the viewer is gone
+        std::function<bool(const std::string& part)> send;
+        /// Bytes written to the viewer's socket so far; nullopt once it closed
+        std::function<std::optional<uint64_t>()> bytes_sent;
+        std::function<void()> close;
+    };
+
+    LiveStreamHub(std::shared_ptr<SnapshotCache> cache,
+                  std::chrono::milliseconds frame_interval,
+                  size_t max_backlog = 512 * 1024);
+    ~LiveStreamHub();
+
+    LiveStreamHub(const LiveStreamHub&) = delete;
+    LiveStreamHub& operator=(const LiveStreamHub&) = delete;
+
+    /// Attach a response stream; conn is used to observe the socket backlog.
+    /// Callers check that the camera exists first: every camera_id gets a
+    /// reader while it has viewers.
+    void subscribe(const std::string& camera_id,
+                   drogon::ResponseStreamPtr stream,
+                   std::weak_ptr<trantor::TcpConnection> conn);
+
+    void subscribe(const std::string& camera_id, Sink sink);
+
+    Stats stats() const;
+
+private:
+    using FramePtr = std::shared_ptr<const std::string>;
+
+    struct Subscriber {
+        Sink sink;
+        size_t bytes_queued = 0;
+        uint64_t bytes_sent_base = 0;  ///< sink.bytes_sent() when subscribed
+    };
+
+    struct Channel {
+        std::vector<Subscriber> subscribers;
+        FramePtr frame;
+        std::string etag;
+        std::chrono::steady_clock::time_point published_at;
+    };
+
+    void startReader(const std::string& camera_id);
+    void tick(const std::string& camera_id);
+    void publish(const std::string& camera_id, const SnapshotCache::SnapshotPtr& snap);
+    bool deliver(Subscriber& sub, const FramePtr& frame);
+
+    std::shared_ptr<SnapshotCache> cache_;
+    std::chrono::milliseconds frame_interval_;
+    size_t max_backlog_;
+    trantor::EventLoopThread loop_thread_;
+
+    mutable std::mutex mutex_;
+    /// A channel exists exactly while its reader runs
+    std::unordered_map<std::string, Channel> channels_;
+
+    std::atomic<uint64_t> frames_published_{0};
+    std::atomic<uint64_t> frames_sent_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+};
+
+} // namespace hms
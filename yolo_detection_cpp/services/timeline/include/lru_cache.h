@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace hms {
+
+/// Bounded least-recently-used map. Capacity is expressed in caller-defined
+/// cost units (entry count by default, bytes when a cost is passed to put()).
+/// Not synchronised — callers guard it with their own mutex.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+
+    /// Look up and mark as most recently used
+    std::optional<Value> get(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return std::nullopt;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->value;
+    }
+
+    /// Pointer to the cached value without copying; invalidated by the next put()/erase()
+    const Value* peek(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->value;
+    }
+
+    /// Insert or replace, evicting least recently used entries until within capacity.
+    /// An entry costing more than the whole capacity is not stored.
+    void put(const Key& key, Value value, size_t cost = 1) {
+        erase(key);
+        if (cost > capacity_) return;
+        entries_.push_front(Entry{key, std::move(value), cost});
+        index_.emplace(key, entries_.begin());
+        used_ += cost;
+        while (used_ > capacity_) {
+            auto& last = entries_.back();
+            if (on_evict_) on_evict_(last.key, last.value);
+            used_ -= last.cost;
+            index_.erase(last.key);
+            entries_.pop_back();
+        }
+    }
+
+    /// Called with each entry put() evicts for capacity, just before it is dropped
+    void setOnEvict(std::function<void(const Key&, Value&)> cb) { on_evict_ = std::move(cb); }
+
+    bool erase(const Key& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return false;
+        used_ -= it->second->cost;
+        entries_.erase(it->second);
+        index_.erase(it);
+        return true;
+    }
+
+    /// Remove every entry for which pred(key) or pred(key, value) is true
+    template <typename Pred>
+    size_t eraseIf(Pred pred) {
+        size_t removed = 0;
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            bool match;
+            if constexpr (std::is_invocable_v<Pred&, const Key&, const Value&>) {
+                match = pred(it->key, it->value);
+            } else {
+                match = pred(it->key);
+            }
+            if (match) {
+                used_ -= it->cost;
+                index_.erase(it->key);
+                it = entries_.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    void clear() {
+        entries_.clear();
+        index_.clear();
+        used_ = 0;
+    }
+
+    size_t size() const { return index_.size(); }
+    size_t cost() const { return used_; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    size_t capacity_;
+    size_t used_ = 0;
+    std::function<void(const Key&, Value&)> on_evict_;
+    std::list<Entry> entries_;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+};
+
+} // namespace hms
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "lru_cache.h"
+#include <sys/stat.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace hms {
+
+/// Bounded LRU of open file descriptors for media files, keyed by path.
+///
+/// Scrubbing a recording fires a burst of range requests for the same file;
+/// with this cache they share one lookup of the path on the NAS mount instead
+/// of an exists() + stat() each. A hit costs an fstat() on the cached fd,
+/// which also picks up recordings that are still growing. The path itself is
+/// re-stat()ed every revalidate interval so a file replaced under the same
+/// name is noticed.
+///
+/// Each response still costs one open(): Drogon takes a path, not a
+/// descriptor, so it opens /proc/self/fd/<fd> after the handler returns. That
+/// open reaches the cached file without walking the mount's directories, and
+/// always the inode that was stat'ed. Evicted descriptors are therefore
+/// closed only after close_grace, so a number can never be reused for another
+/// file while a response still refers to it.
+class MediaFileCache {
+public:
+    struct Options {
+        size_t max_open = 64;
+        std::chrono::seconds revalidate{5};
+        std::chrono::seconds close_grace{60};
+    };
+
+    /// An open file; the descriptor is closed when the last reference goes
+    class File {
+    public:
+        File(int fd, std::string path) : fd_(fd), path_(std::move(path)) {}
+        ~File();
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        int fd() const { return fd_; }
+        const std::string& path() const { return path_; }
+        /// Path through which another open() reaches this exact file
+        std::string procPath() const { return "/proc/self/fd/" + std::to_string(fd_); }
+
+    private:
+        int fd_;
+        std::string path_;
+    };
+    using FilePtr = std::shared_ptr<const File>;
+
+    /// Open file plus a current fstat() of it
+    struct Handle {
+        FilePtr file;
+        struct stat st {};
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t opens = 0;
+        uint64_t reopened = 0;    ///< replaced or deleted files noticed on revalidation
+        size_t open_fds = 0;      ///< cached plus retired-but-not-yet-closed
+    };
+
+    explicit MediaFileCache(Options options);
+
+    /// Open (or reuse) path; nullopt when it does not exist or is not a regular file
+    std::optional<Handle> acquire(const std::string& path);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        FilePtr file;
+        std::chrono::steady_clock::time_point checked;   ///< last stat() of the path
+    };
+
+    std::optional<Handle> open(const std::string& path);
+    void retire(FilePtr file);
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    LruCache<std::string, Entry> entries_;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, FilePtr>> retired_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> opens_{0};
+    std::atomic<uint64_t> reopened_{0};
+};
+
+} // namespace hms
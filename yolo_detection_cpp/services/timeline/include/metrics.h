@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hms {
+
+/// Process-wide request, database, upstream and media metrics, exported at
+/// /metrics in Prometheus text format.
+///
+/// Recording is a relaxed atomic add into a shard owned by the calling
+/// thread (one cache line per shard), so IO threads never contend, take a
+/// lock or allocate. Reading sums the shards. Latencies go into log-linear
+/// (HDR-style) histograms with eight buckets per power of two: any quantile
+/// is within 12.5% of the true value from 1 us to about 4.7 hours.
+class Metrics {
+public:
+    static constexpr size_t kShards = 8;
+
+    /// Monotonic counter, sharded by thread
+    class Counter {
+    public:
+        void add(uint64_t n = 1);
+        uint64_t value() const;
+
+    private:
+        struct alignas(64) Cell {
+            std::atomic<uint64_t> value{0};
+        };
+        std::array<Cell, kShards> cells_;
+    };
+
+    /// Microsecond latency histogram, sharded by thread
+    class Histogram {
+    public:
+        static constexpr int kSubBucketBits = 3;
+        static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+        /// Values from 2^kMaxExponent us on share the last bucket
+        static constexpr int kMaxExponent = 34;
+        static constexpr size_t kBuckets = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+        struct Snapshot {
+            std::array<uint64_t, kBuckets> counts{};
+            uint64_t count = 0;
+            uint64_t sum_us = 0;
+
+            /// Value at quantile q (0..1) in microseconds; 0 when empty
+            double quantile(double q) const;
+        };
+
+        void record(uint64_t us);
+        Snapshot snapshot() const;
+
+        static size_t bucketOf(uint64_t us);
+        /// Smallest value that lands in bucket i
+        static uint64_t bucketLower(size_t i);
+
+    private:
+        struct alignas(64) Shard {
+            std::array<std::atomic<uint64_t>, kBuckets> counts{};
+            std::atomic<uint64_t> sum_us{0};
+        };
+        std::array<Shard, kShards> shards_;
+    };
+
+    /// Latencies recorded outside the HTTP layer
+    enum class Series {
+        DbWait,       ///< DbExecutor queue wait
+        DbQuery,      ///< DbExecutor job run time
+        Upstream,     ///< detection service proxy calls
+        Embedding,    ///< Ollama /api/embed calls
+        Count,
+    };
+
+    /// Bytes handed to the socket by MediaController
+    enum class Media {
+        Recording,
+        Snapshot,
+        Thumbnail,
+        Count,
+    };
+
+    static Metrics& global();
+
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    /// Pre-routing advice: a request arrived
+    void requestStarted() { started_.add(); }
+
+    /// Post-handling advice: route is the matched path pattern (empty when
+    /// nothing matched). Allocates only the first time a route is seen.
+    void recordRequest(std::string_view method, std::string_view route, int status,
+                       uint64_t latency_us, uint64_t body_bytes);
+
+    void observe(Series series, uint64_t us) {
+        series_[static_cast<size_t>(series)].record(us);
+    }
+
+    void addMediaBytes(Media kind, uint64_t bytes) {
+        media_[static_cast<size_t>(kind)].add(bytes);
+    }
+
+    /// Append everything in Prometheus text exposition format
+    void render(std::string& out) const;
+
+    /// Append one unlabelled gauge, for values sampled at scrape time
+    static void appendGauge(std::string& out, const char* name, const char* help, double value);
+
+    /// Append one unlabelled counter kept elsewhere; name ends in _total
+    static void appendCounter(std::string& out, const char* name, const char* help, double value);
+
+    /// Distinct (method, route) pairs recorded so far
+    size_t routeCount() const;
+
+private:
+    static constexpr size_t kRouteSlots = 256;     ///< power of two, open addressing
+    static constexpr size_t kMaxRoutes = kRouteSlots / 2;
+
+    struct Route {
+        Route(std::string_view m, std::string_view r, uint64_t h) : method(m), route(r), hash(h) {}
+
+        std::string method;
+        std::string route;
+        uint64_t hash = 0;
+        Histogram latency;
+        std::array<Counter, 5> responses;           ///< by status class 1xx..5xx
+        Counter body_bytes;
+    };
+
+    Route* findOrAdd(std::string_view method, std::string_view route);
+
+    std::array<std::atomic<Route*>, kRouteSlots> slots_{};
+    mutable std::mutex add_mutex_;
+    std::vector<std::unique_ptr<Route>> routes_;   ///< owns the slots' routes
+    Route overflow_{"*", "other", 0};              ///< once kMaxRoutes are taken
+
+    Counter started_;
+    Counter finished_;
+    std::array<Histogram, static_cast<size_t>(Series::Count)> series_;
+    std::array<Counter, static_cast<size_t>(Media::Count)> media_;
+};
+
+} // namespace hms
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "lru_cache.h"
+#include <sys/stat.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace hms {
+
+/// Box-level index of one MP4 recording: the video track's keyframes and,
+/// for files whose moov box trails the media data, a fast-start layout.
+///
+/// The fast-start layout is virtual: the source file is never rewritten.
+/// It is the prefix before the first mdat, then the moov box with its chunk
+/// offsets shifted, then any boxes that followed moov, held in memory as head.
+/// After head, the layout continues with the untouched file range
+/// [data_offset, moov_offset).
+struct Mp4Index {
+    enum class Status { Ok, Incomplete, Invalid };
+
+    struct Keyframe {
+        double time_s = 0;          ///< decode time from the start of the track
+        uint64_t offset = 0;        ///< byte offset of the sample in the source file
+    };
+
+    uint64_t file_size = 0;
+    int64_t mtime_ns = 0;
+    double duration_s = 0;
+    uint32_t timescale = 0;
+    std::vector<Keyframe> keyframes;
+
+    bool moov_first = false;        ///< already fast-start on disk
+    std::string head;               ///< virtual layout head; empty when not used
+    uint64_t data_offset = 0;       ///< first mdat; head replaces everything before it
+    uint64_t moov_offset = 0;
+
+    bool hasVirtualLayout() const { return !head.empty(); }
+
+    /// Offset of a source byte in the layout served to Range requests
+    uint64_t servedOffset(uint64_t source_offset) const {
+        if (hasVirtualLayout() && source_offset >= data_offset && source_offset < moov_offset) {
+            return source_offset - data_offset + head.size();
+        }
+        return source_offset;
+    }
+
+    /// Parse an open file. Incomplete means the boxes are cut short or there is
+    /// no moov yet (a recording still being written); Invalid means it is not
+    /// an MP4 this parser understands.
+    static Status parse(int fd, uint64_t file_size, Mp4Index& out);
+    static Status parseFile(const std::string& path, Mp4Index& out);
+};
+
+/// Keyframe / fast-start indexes of the recordings in events_dir.
+///
+/// Entries are keyed by filename and checked against the file's size and
+/// mtime, so a growing or rewritten recording is re-parsed. The result for a
+/// given (size, mtime) is always the same, which keeps the layout served for
+/// one version of a file stable across a player's range requests. New
+/// recordings are queued by the RecordingIndex watcher and parsed on a
+/// background thread, retried while they are still being written, so the
+/// first request for a clip rarely pays for the parse.
+class Mp4IndexCache {
+public:
+    using IndexPtr = std::shared_ptr<const Mp4Index>;
+
+    struct Options {
+        std::string events_dir;
+        /// Memory cap; a fast-start head holds a copy of the file's moov box
+        size_t max_bytes = 32 * 1024 * 1024;
+        /// Delay before (re-)parsing a queued recording
+        std::chrono::seconds retry_delay{10};
+        /// Attempts per queued recording before giving up (covers ~5 minute clips)
+        int max_attempts = 30;
+    };
+
+    struct Stats {
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t pending = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;            ///< find() calls that queued a parse instead
+        uint64_t parsed = 0;
+        uint64_t incomplete = 0;
+        uint64_t invalid = 0;
+        uint64_t virtual_layouts = 0;   ///< parsed files that needed a fast-start head
+    };
+
+    explicit Mp4IndexCache(Options options);
+    ~Mp4IndexCache();
+
+    Mp4IndexCache(const Mp4IndexCache&) = delete;
+    Mp4IndexCache& operator=(const Mp4IndexCache&) = delete;
+
+    /// Start the background parser thread
+    void start();
+
+    /// Stop the background parser thread (idempotent, also called by the destructor)
+    void stop();
+
+    /// Queue a recording (name relative to events_dir) for background indexing
+    void enqueue(const std::string& filename);
+
+    /// Index of filename, open as fd with stat st: cached, or parsed from fd now.
+    /// nullptr when the file is incomplete or not an MP4.
+    IndexPtr get(const std::string& filename, int fd, const struct stat& st);
+
+    /// The cached result for filename at stat st, never parsing: for request
+    /// threads, where a parse can read tens of MiB from the NAS. On a miss
+    /// the file is queued for the parser thread and nullopt is returned.
+    std::optional<IndexPtr> find(const std::string& filename, const struct stat& st);
+
+    /// As get(), opening events_dir/filename; nullptr also when it is missing
+    IndexPtr load(const std::string& filename);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        Mp4Index::Status status = Mp4Index::Status::Invalid;
+        IndexPtr index;             ///< set when status is Ok
+    };
+    struct Job {
+        std::chrono::steady_clock::time_point due;
+        std::string filename;
+        int attempts = 0;
+    };
+
+    IndexPtr lookup(const std::string& filename, int fd, const struct stat& st,
+                    Mp4Index::Status& status);
+    IndexPtr load(const std::string& filename, Mp4Index::Status& status);
+    void run();
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    LruCache<std::string, Entry> entries_;
+
+    mutable std::mutex jobs_mutex_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+    std::unordered_set<std::string> queued_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> parsed_{0};
+    std::atomic<uint64_t> incomplete_{0};
+    std::atomic<uint64_t> invalid_{0};
+    std::atomic<uint64_t> virtual_layouts_{0};
+};
+
+} // namespace hms
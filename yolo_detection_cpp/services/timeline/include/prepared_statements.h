@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pqxx {
+class connection;
+}
+
+namespace hms {
+
+/// A fixed set of named statements, prepared on each pooled connection the
+/// first time it is used and then executed by name.
+///
+/// DbPool hands out long-lived connections, so after the first checkout of a
+/// connection a query skips parsing and analysis: the server keeps the parse
+/// tree and, unless session_setup says otherwise, settles on a generic plan
+/// after a few executions. Sessions are keyed by connection and backend pid,
+/// so a connection that DbPool reopened is prepared again.
+class PreparedStatements {
+public:
+    struct Statement {
+        std::string name;
+        std::string sql;
+    };
+
+    struct Stats {
+        uint64_t sessions = 0;       ///< connections with the statements prepared
+        uint64_t checkouts = 0;      ///< ensure() calls
+        uint64_t prepares = 0;       ///< statements sent to the server
+        uint64_t resets = 0;         ///< sessions forgotten after losing their statements
+    };
+
+    /// session_setup (e.g. a SET) runs once per session before the first
+    /// prepare. If the server rejects it the failure is logged and the
+    /// statements are prepared anyway.
+    explicit PreparedStatements(std::vector<Statement> statements, std::string session_setup = {});
+
+    PreparedStatements(const PreparedStatements&) = delete;
+    PreparedStatements& operator=(const PreparedStatements&) = delete;
+
+    /// Prepare every statement on conn unless its session already has them.
+    /// conn must not be shared with another thread while this runs (a
+    /// connection checked out of DbPool never is).
+    void ensure(pqxx::connection& conn);
+
+    /// Forget conn's session so the next ensure() prepares again, e.g. after
+    /// the server reported a statement as missing
+    void forget(const pqxx::connection& conn);
+
+    const std::vector<Statement>& statements() const { return statements_; }
+
+    Stats stats() const;
+
+private:
+    const std::vector<Statement> statements_;
+    const std::string session_setup_;
+
+    mutable std::mutex mutex_;
+    struct Session {
+        int pid = 0;               ///< backend the statements were prepared on
+        size_t prepared = 0;       ///< statements_[0, prepared) exist there
+    };
+    std::unordered_map<const pqxx::connection*, Session> sessions_;
+
+    std::atomic<uint64_t> checkouts_{0};
+    std::atomic<uint64_t> prepares_{0};
+    std::atomic<uint64_t> resets_{0};
+};
+
+} // namespace hms
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+namespace hms {
+
+/// In-memory set of recording filenames present in events_dir.
+/// Fully rescanned at startup, then kept current by an inotify watcher thread
+/// so that lookups on the request path never touch the filesystem.
+///
+/// inotify only reports changes made through this host's mount, so writes
+/// from another NAS client are picked up by the periodic rescan instead.
+class RecordingIndex {
+public:
+    explicit RecordingIndex(std::string dir,
+                            std::chrono::seconds rescan_interval = std::chrono::minutes(5));
+    ~RecordingIndex();
+
+    RecordingIndex(const RecordingIndex&) = delete;
+    RecordingIndex& operator=(const RecordingIndex&) = delete;
+
+    /// Scan the directory and start the watcher thread.
+    /// Returns false if inotify could not be set up; the scanned set is still usable
+    /// but isLive() stays false so callers fall back to stat(). The thread then
+    /// only rescans periodically.
+    bool start();
+
+    /// Stop the watcher thread (idempotent, also called by the destructor).
+    void stop();
+
+    /// O(1) membership test — no syscalls.
+    bool contains(std::string_view filename) const;
+
+    /// True while the watch is active and the set reflects the directory.
+    bool isLive() const { return live_.load(std::memory_order_acquire); }
+
+    std::size_t size() const;
+
+    /// Invoked from the watcher thread for every file that appears after
+    /// startup, whether inotify reported it or a rescan found it. Set before start().
+    void setOnAdded(std::function<void(const std::string&)> cb) { on_added_ = std::move(cb); }
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    bool addWatch();
+    /// Replace the set with the directory's contents; with notify, call
+    /// on_added_ for names that were not in it (outside the lock)
+    void rescan(bool notify);
+    void watchLoop();
+    void handleEvents(const char* buf, std::size_t len);
+
+    std::string dir_;
+    std::chrono::seconds rescan_interval_;
+    std::function<void(const std::string&)> on_added_;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_set<std::string, StringHash, std::equal_to<>> files_;
+
+    std::atomic<bool> live_{false};
+    std::atomic<bool> running_{false};
+    int inotify_fd_ = -1;
+    int watch_fd_ = -1;
+    int wake_fd_ = -1;
+    std::thread thread_;
+};
+
+} // namespace hms
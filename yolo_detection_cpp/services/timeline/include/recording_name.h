@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdio>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hms {
+
+/// Camera and day a recording file belongs to. Files are named
+/// <camera_id>_<YYYYMMDD>_<HHMMSS>.<ext> in local time; camera ids may
+/// themselves contain underscores.
+struct RecordingName {
+    std::string camera_id;
+    std::string date;      ///< YYYY-MM-DD, local
+
+    static std::optional<RecordingName> parse(std::string_view filename) {
+        auto stem = filename.substr(0, filename.rfind('.'));
+        auto time_sep = stem.rfind('_');
+        if (time_sep == std::string_view::npos || time_sep < 9) return std::nullopt;
+        auto date_sep = stem.rfind('_', time_sep - 1);
+        if (date_sep == std::string_view::npos || time_sep - date_sep != 9 || date_sep == 0) {
+            return std::nullopt;
+        }
+        auto ymd = stem.substr(date_sep + 1, 8);
+        if (ymd.find_first_not_of("0123456789") != std::string_view::npos) return std::nullopt;
+        return RecordingName{
+            std::string(stem.substr(0, date_sep)),
+            std::string(ymd.substr(0, 4)) + "-" + std::string(ymd.substr(4, 2)) + "-" +
+                std::string(ymd.substr(6, 2)),
+        };
+    }
+};
+
+/// Local day (YYYY-MM-DD) of an ISO-8601 timestamp such as an event's
+/// started_at ("2026-02-25T23:30:00Z", fraction and offset optional, UTC when
+/// there is no offset). That is the day a recording of the same moment is
+/// filed under, so ResponseCache tags made with it match RecordingName's.
+/// Empty when the timestamp cannot be read.
+inline std::string localDateOf(const std::string& timestamp) {
+    std::tm tm{};
+    int consumed = 0;
+    if (std::sscanf(timestamp.c_str(), "%4d-%2d-%2d%*1[T ]%2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon,
+                    &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 6) {
+        return {};
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    std::time_t t = ::timegm(&tm);
+
+    auto rest = std::string_view(timestamp).substr(consumed);
+    if (!rest.empty() && rest.front() == '.') {
+        rest.remove_prefix(1);
+        while (!rest.empty() && rest.front() >= '0' && rest.front() <= '9') rest.remove_prefix(1);
+    }
+    int off_h = 0, off_m = 0;
+    if (!rest.empty() && (rest.front() == '+' || rest.front() == '-') &&
+        std::sscanf(std::string(rest.substr(1)).c_str(), "%2d:%2d", &off_h, &off_m) >= 1) {
+        auto offset = static_cast<std::time_t>(off_h * 3600 + off_m * 60);
+        t -= rest.front() == '+' ? offset : -offset;
+    }
+
+    std::tm local{};
+    if (!::localtime_r(&t, &local)) return {};
+    char buf[16];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%d", &local);
+    return buf;
+}
+
+} // namespace hms
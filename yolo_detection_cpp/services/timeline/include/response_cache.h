@@ -0,0 +1,95 @@
+#pragma once
+
+#include "lru_cache.h"
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace hms {
+
+/// Serialized JSON responses keyed by route and normalized parameters.
+///
+/// Each entry holds the dumped body, a gzip copy when that is smaller, and a
+/// strong ETag, so a hit costs neither a PostgreSQL round trip nor a
+/// json::dump. Entries for final (past) days live for final_ttl; entries that
+/// can still change live for live_ttl and are dropped early by invalidate()
+/// when a new event arrives for their camera and date. Memory is bounded by
+/// max_bytes, evicting least recently used entries.
+class ResponseCache {
+public:
+    struct Options {
+        size_t max_bytes = 32 * 1024 * 1024;
+        std::chrono::seconds live_ttl{15};
+        std::chrono::seconds final_ttl{24 * 60 * 60};
+    };
+
+    /// Immutable cached representation, shared by every request that hits it
+    struct Entry {
+        std::string body;
+        std::string gzip;          ///< empty when compression did not pay off
+        std::string etag;          ///< strong validator of body; gzip adds a suffix
+        std::string camera_id;     ///< invalidation tags
+        std::string date;          ///< YYYY-MM-DD
+        bool final = false;
+        std::chrono::steady_clock::time_point expires;
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t not_modified = 0;   ///< hits answered with 304
+        uint64_t invalidated = 0;    ///< entries dropped by invalidate()
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit ResponseCache(Options options);
+
+    /// "route?k1=v1&k2=v2" with parameters sorted by name; empty values are skipped
+    static std::string makeKey(std::string_view route,
+                               std::initializer_list<std::pair<std::string_view, std::string_view>> params);
+
+    /// Cached entry for key, or nullptr when absent or expired
+    EntryPtr get(const std::string& key);
+
+    /// Serialize body, compress it and store it under key
+    EntryPtr put(const std::string& key, const nlohmann::json& body,
+                 std::string camera_id, std::string date, bool final);
+
+    /// As put(), for a body the caller already serialized (e.g. with JsonWriter)
+    EntryPtr putSerialized(const std::string& key, std::string body,
+                           std::string camera_id, std::string date, bool final);
+
+    /// Drop every entry tagged with camera_id and date (any date when empty)
+    size_t invalidate(const std::string& camera_id, const std::string& date = {});
+
+    /// 200 with the best encoding the client accepts, or 304 when its copy is current
+    drogon::HttpResponsePtr respond(const drogon::HttpRequestPtr& req, const EntryPtr& entry);
+
+    Stats stats() const;
+
+    const Options& options() const { return options_; }
+
+private:
+    Options options_;
+
+    mutable std::mutex mutex_;
+    LruCache<std::string, EntryPtr> entries_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> not_modified_{0};
+    std::atomic<uint64_t> invalidated_{0};
+};
+
+} // namespace hms
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <nlohmann/json.hpp>
+#include <string_view>
+
+namespace hms {
+
+/// Wire encoding of an API response body
+enum class BodyFormat { Json, MsgPack, Cbor };
+
+/// Format picked from Accept. Explicit media types beat "*/*" at the same
+/// weight, q=0 refuses a type, and JSON is the fallback. MessagePack is
+/// recognised as application/msgpack, application/x-msgpack and
+/// application/vnd.msgpack.
+BodyFormat preferredBodyFormat(std::string_view accept);
+
+/// Representation a client asked for: body encoding plus, with
+/// ?layout=columnar, column-oriented event and snapshot arrays
+struct ResponseFormat {
+    BodyFormat body = BodyFormat::Json;
+    bool columnar = false;
+
+    static ResponseFormat negotiate(const drogon::HttpRequestPtr& req);
+
+    /// Plain JSON rows, i.e. what endpoints can stream without a DOM
+    bool isDefault() const { return body == BodyFormat::Json && !columnar; }
+    const char* contentType() const;
+};
+
+/// Column-oriented form of an array of objects:
+///   {"layout": "columnar", "count": N, "columns": {key: column, ...}}
+/// A column is an array of the rows' values (null where a row lacks the key),
+/// or, for strings that repeat (at most half as many distinct values as
+/// rows), {"dict": [distinct values], "codes": [index or null per row]}.
+/// Anything that is not an array of objects is returned unchanged.
+nlohmann::json columnarize(const nlohmann::json& rows);
+
+/// Add Accept to the response's Vary header, keeping any value already set
+void addVaryAccept(const drogon::HttpResponsePtr& resp);
+
+/// Response with body encoded as format asks; columnar rewrites the
+/// top-level "events" and "snapshots" arrays. Always carries Vary: Accept.
+drogon::HttpResponsePtr makeApiResponse(const ResponseFormat& format,
+                                        nlohmann::json body,
+                                        drogon::HttpStatusCode code = drogon::k200OK);
+
+} // namespace hms
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hms {
+
+/// Reciprocal-rank fusion (Cormack et al., 2009) of ranked search result lists.
+/// Each list is a JSON array of SearchResult objects identified by (type, id).
+/// A result scores sum(1 / (k + rank)) over the lists it appears in, rank
+/// starting at 1. Fields missing from the first occurrence (e.g. similarity
+/// from the semantic list) are copied from later ones. Returns at most limit
+/// results, best first, each with an "rrf_score".
+inline nlohmann::json reciprocalRankFusion(const std::vector<const nlohmann::json*>& lists,
+                                           int k, size_t limit) {
+    struct Fused {
+        nlohmann::json doc;
+        double score = 0.0;
+        size_t first_seen = 0;
+    };
+    std::vector<Fused> fused;
+    std::unordered_map<std::string, size_t> slot;
+
+    for (const auto* list : lists) {
+        if (!list || !list->is_array()) continue;
+        for (size_t rank = 0; rank < list->size(); ++rank) {
+            const auto& doc = (*list)[rank];
+            auto key = doc.value("type", std::string()) + ":" +
+                       doc.value("id", nlohmann::json()).dump();
+            auto [it, inserted] = slot.emplace(key, fused.size());
+            if (inserted) fused.push_back(Fused{doc, 0.0, fused.size()});
+            auto& entry = fused[it->second];
+            entry.score += 1.0 / (k + static_cast<double>(rank + 1));
+            if (!inserted) {
+                for (auto field = doc.begin(); field != doc.end(); ++field) {
+                    if (!entry.doc.contains(field.key())) entry.doc[field.key()] = field.value();
+                }
+            }
+        }
+    }
+
+    std::sort(fused.begin(), fused.end(), [](const Fused& a, const Fused& b) {
+        return a.score != b.score ? a.score > b.score : a.first_seen < b.first_seen;
+    });
+
+    auto out = nlohmann::json::array();
+    for (size_t i = 0; i < fused.size() && i < limit; ++i) {
+        fused[i].doc["rrf_score"] = fused[i].score;
+        out.push_back(std::move(fused[i].doc));
+    }
+    return out;
+}
+
+} // namespace hms
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "api_queries.h"
+#include "db_pool.h"
+#include "hnsw_index.h"
+#include "lru_cache.h"
+#include "timeline_queries.h"
+#include "vector_matrix.h"
+
+namespace hms {
+
+/// In-process replacement for api_queries::search_events_semantic.
+/// Holds every stored event and periodic-snapshot embedding in an HNSW graph,
+/// loaded once at startup and then topped up by a poller thread, so a semantic
+/// query is answered without a database round trip. Exact searches scan a
+/// contiguous VectorMatrix with SIMD dot products instead of walking the graph.
+///
+/// Memory is dim * 4 bytes plus ~200 bytes of links and metadata per row
+/// (about 3.3 KiB for 768-dim vectors). Without the graph and with int8 storage
+/// it drops to under 1 KiB per row.
+///
+/// Rows deleted from the database (retention) or rewritten with a new
+/// description are noticed by the poller: a rewrite within the lookback on the
+/// next poll, anything else on the next reconcile. The graph and matrix are
+/// append-only, so the old row becomes a tombstone that searches skip; its
+/// vector stays in memory until the next restart.
+class SemanticIndex {
+public:
+    struct Options {
+        size_t dim = 768;
+        std::chrono::seconds poll_interval{30};
+        /// How far back each poll looks for rows that gained an embedding;
+        /// AI descriptions are written some time after the event ends
+        int lookback_minutes = 24 * 60;
+        /// Interval of a full pass over every embedded id, which picks up
+        /// embeddings written for rows older than the lookback (backfills)
+        /// and drops rows that were deleted. The schema has no embedding
+        /// timestamp to poll on instead.
+        std::chrono::seconds reconcile_interval{15 * 60};
+        /// Results below this cosine similarity are dropped
+        float min_similarity = 0.3f;
+        size_t ef_search = 64;
+        int load_batch = 2000;
+        /// Build the HNSW graph; without it every search is an exact scan
+        bool graph = true;
+        /// Row layout for exact scans (Float32 reuses the graph's vectors)
+        VectorMatrix::Storage exact_storage = VectorMatrix::Storage::Float32;
+    };
+
+    struct Stats {
+        size_t vectors = 0;
+        size_t tombstones = 0;      ///< deleted or replaced rows still held in memory
+        uint64_t searches = 0;
+        uint64_t exact_scans = 0;   ///< searches answered by a linear scan
+        uint64_t fallbacks = 0;     ///< searches left to PostgreSQL
+        size_t matrix_bytes = 0;    ///< vector data scanned by exact searches
+        bool ready = false;
+    };
+
+    SemanticIndex(std::shared_ptr<DbPool> pool, Options options);
+    ~SemanticIndex();
+
+    SemanticIndex(const SemanticIndex&) = delete;
+    SemanticIndex& operator=(const SemanticIndex&) = delete;
+
+    /// Start the loader/poller thread. Searches return nullopt until the
+    /// initial load has finished.
+    void start();
+
+    /// Stop the poller thread (idempotent, also called by the destructor).
+    void stop();
+
+    bool isReady() const { return ready_.load(std::memory_order_acquire); }
+
+    /// Same response shape as api_queries::search_events_semantic, or nullopt
+    /// when the caller should fall back to PostgreSQL (not loaded yet, the
+    /// query embedding has a different dimension, or start/end could not be
+    /// converted). Bounds are read in the database session time zone, like
+    /// the SQL search. exact skips the graph and
+    /// ranks every row that passes the filters.
+    std::optional<nlohmann::json> search(const api_queries::SearchParams& params,
+                                         const std::vector<float>& embedding,
+                                         bool exact = false) const;
+
+    const Options& options() const { return options_; }
+
+    Stats stats() const;
+
+private:
+    struct Item {
+        std::string key;                    ///< "event:<id>" / "snapshot:<id>"
+        std::string camera_id;
+        int64_t timestamp = 0;
+        std::vector<std::string> classes;   ///< lowercased, trimmed
+        nlohmann::json doc;
+        int32_t fingerprint = 0;
+        uint32_t pass = 0;                  ///< last reconcile that saw the row
+        bool removed = false;               ///< tombstone: never returned
+    };
+
+    void run();
+    void initialLoad();
+    void poll();
+    void reconcile();
+    /// Load and insert the ids that are not indexed yet or whose fingerprint
+    /// changed; marks the rest as seen by the current reconcile pass
+    void sync(const std::vector<timeline_queries::EmbeddedId>& ids);
+    /// start/end of a query as epoch seconds; nullopt when they cannot be converted
+    std::optional<timeline_queries::SearchBounds> bounds(const api_queries::SearchParams& params) const;
+    /// Insert rows that are not indexed yet, replacing a held row whose
+    /// fingerprint differs; takes the write lock in small chunks
+    void insert(std::vector<timeline_queries::EmbeddingRow>&& rows);
+    /// Tombstone every row the current reconcile pass did not see
+    void dropUnseen();
+    void remove(uint32_t row);   ///< caller holds the write lock
+    bool waitFor(std::chrono::seconds interval);
+    const VectorMatrix& exactMatrix() const;
+
+    std::shared_ptr<DbPool> pool_;
+    Options options_;
+
+    mutable std::shared_mutex mutex_;
+    std::unique_ptr<HnswIndex> graph_;
+    std::unique_ptr<VectorMatrix> matrix_;     ///< set for quantised storage or no graph
+    std::vector<Item> items_;                  ///< indexed by graph / matrix row id
+    std::unordered_map<std::string, uint32_t> known_;   ///< live Item::key -> row id
+    size_t tombstones_ = 0;
+    uint32_t pass_ = 0;                        ///< current reconcile pass (poller thread)
+
+    mutable std::mutex bounds_mutex_;
+    /// "start|end" -> converted bounds; the same few ranges repeat across queries
+    mutable LruCache<std::string, timeline_queries::SearchBounds> bounds_{256};
+
+    std::atomic<bool> ready_{false};
+    mutable std::atomic<uint64_t> searches_{0};
+    mutable std::atomic<uint64_t> exact_scans_{0};
+    mutable std::atomic<uint64_t> fallbacks_{0};
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace hms
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hms {
+
+/// Dot-product kernels for embedding search, dispatched at runtime to the
+/// widest instruction set the CPU supports (AVX-512F, AVX2+FMA, or scalar).
+/// The binary is built for baseline x86-64; only these functions use wider ISAs.
+namespace simd {
+
+enum class Isa { Scalar, Avx2, Avx512 };
+
+/// Instruction set the kernels currently dispatch to
+Isa activeIsa();
+const char* isaName(Isa isa);
+
+/// Override dispatch (clamped to what the CPU supports); returns the ISA in effect.
+/// For benchmarks and tests only — not synchronised with concurrent callers.
+Isa setIsa(Isa isa);
+
+/// sum(a[i] * b[i])
+float dotF32(const float* a, const float* b, size_t n);
+
+/// sum(q[i] * half_to_float(row[i])) — row holds IEEE 754 binary16 values
+float dotF16(const float* q, const uint16_t* row, size_t n);
+
+/// sum(q[i] * row[i]) — caller applies the row's dequantisation scale
+float dotI8(const float* q, const int8_t* row, size_t n);
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+} // namespace simd
+} // namespace hms
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "detection_client.h"
+#include "lru_cache.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hms {
+
+/// Per-camera cache of the latest live snapshot from the detection service.
+///
+/// Each camera is fetched upstream at most once per refresh interval; requests
+/// arriving while a fetch is in flight wait for that fetch instead of starting
+/// their own, so N viewers cost one upstream request per interval. Camera ids
+/// come from the URL, so at most max_cameras are kept; the least recently
+/// viewed one is dropped first.
+class SnapshotCache {
+public:
+    /// Immutable upstream response shared by every viewer of a camera
+    struct Snapshot {
+        drogon::HttpStatusCode status = drogon::k200OK;
+        std::string body;
+        std::string content_type;
+        std::string etag;             ///< strong validator, set for 200 responses
+        std::string last_modified;    ///< HTTP date the body last changed
+        std::chrono::steady_clock::time_point fetched_at;
+    };
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+    using Callback = std::function<void(DetectionClient::Result, const SnapshotPtr&)>;
+
+    struct Stats {
+        uint64_t hits = 0;        ///< served from cache
+        uint64_t fetches = 0;     ///< upstream requests issued
+        uint64_t coalesced = 0;   ///< waited on another request's fetch
+        uint64_t cameras = 0;     ///< cameras with a cached entry
+    };
+
+    SnapshotCache(std::shared_ptr<DetectionClient> client,
+                  std::chrono::milliseconds refresh_interval,
+                  size_t max_cameras = 64);
+
+    /// Deliver the camera's snapshot, fetching upstream if the cached one is older
+    /// than the refresh interval. The callback may run on the detection client's loop.
+    void get(const std::string& camera_id, Callback&& callback);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::mutex mutex;
+        SnapshotPtr latest;
+        bool fetching = false;
+        std::vector<Callback> waiters;
+    };
+
+    using EntryPtr = std::shared_ptr<Entry>;
+
+    EntryPtr entry(const std::string& camera_id);
+    void complete(Entry& entry, DetectionClient::Result result,
+                  const drogon::HttpResponsePtr& upstream);
+
+    std::shared_ptr<DetectionClient> client_;
+    std::chrono::milliseconds refresh_interval_;
+
+    mutable std::mutex entries_mutex_;
+    LruCache<std::string, EntryPtr> entries_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> fetches_{0};
+    std::atomic<uint64_t> coalesced_{0};
+};
+
+} // namespace hms
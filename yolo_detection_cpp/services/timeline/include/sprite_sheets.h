@@ -0,0 +1,129 @@
+#pragma once
+
+#include "jpeg_codec.h"
+#include "lru_cache.h"
+#include <nlohmann/json.hpp>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hms {
+
+/// Contact sheets of a camera's periodic snapshots, for timeline hover previews.
+///
+/// One sheet covers a camera's day: its snapshots downscaled to a fixed tile,
+/// tiled row-major into a single JPEG, plus the tile offsets. A day is cut
+/// into max_tiles equal slots and only the first snapshot of each is drawn, so
+/// a camera snapshotting every few seconds still gets a sheet of bounded size
+/// (12 MB of canvas at the defaults) and height (JPEG stops at 65535 rows).
+/// Slots are fixed, so a new snapshot never changes which others are drawn.
+/// Rows whose captured_at has no time of day are skipped. Decoded tiles are
+/// cached per (camera, date, hour) and an hour is only re-decoded when its list
+/// of snapshots changes, so a new snapshot costs one decode and a re-encode of
+/// the sheet. Builds run on a worker queue; concurrent requests for the same
+/// day wait for one build.
+class SpriteSheets {
+public:
+    struct Options {
+        std::string snapshots_dir;
+        int tile_width = 160;
+        int tile_height = 90;
+        int columns = 12;
+        int quality = 75;
+        /// Most tiles per sheet: one per 5 minutes of the day. Lowered when
+        /// the sheet would be too tall to encode.
+        int max_tiles = 288;
+        /// Memory cap for decoded tiles across all cached hours
+        size_t max_tile_bytes = 64 * 1024 * 1024;
+        /// Encoded sheets kept (one per camera and date)
+        size_t max_sheets = 32;
+    };
+
+    struct Sheet {
+        std::string jpeg;
+        std::string etag;
+        std::string version;       ///< changes whenever the set of snapshots does
+        int columns = 0;
+        int rows = 0;
+        nlohmann::json tiles;      ///< [{snapshot_id, captured_at, x, y}] in time order
+    };
+    using SheetPtr = std::shared_ptr<const Sheet>;
+    /// Receives nullptr when none of the snapshots could be drawn. May run on a worker thread.
+    using Callback = std::function<void(const SheetPtr&)>;
+
+    struct Stats {
+        uint64_t sheet_hits = 0;
+        uint64_t sheets_built = 0;
+        uint64_t hours_built = 0;
+        uint64_t tiles_decoded = 0;
+        uint64_t coalesced = 0;
+        size_t tile_bytes = 0;
+    };
+
+    explicit SpriteSheets(Options options);
+
+    /// Sheet for camera/date given that day's rows from get_periodic_snapshots
+    void get(const std::string& camera_id, const std::string& date,
+             const nlohmann::json& snapshots, Callback&& callback);
+
+    /// Last sheet built for camera/date, if any, without consulting the database
+    SheetPtr find(const std::string& camera_id, const std::string& date);
+
+    const Options& options() const { return options_; }
+    Stats stats() const;
+
+    /// Snapshot file a row refers to: the thumbnail when there is one (smaller
+    /// to decode), else the full snapshot; empty when neither is set
+    static std::string snapshotFile(const nlohmann::json& snapshot);
+
+private:
+    struct Source {
+        int64_t snapshot_id = 0;
+        std::string captured_at;
+        std::string file;
+    };
+    struct Tile {
+        int64_t snapshot_id = 0;
+        std::string captured_at;
+        RgbImage image;            ///< tile_width x tile_height, letterboxed
+    };
+    struct Hour {
+        std::string signature;
+        std::vector<Tile> tiles;
+    };
+    using HourPtr = std::shared_ptr<const Hour>;
+    struct HourGroup {
+        std::string hour;
+        std::string signature;     ///< the hour's snapshot ids and files
+        std::vector<Source> sources;
+    };
+
+    void build(const std::string& day_key, const std::vector<HourGroup>& groups,
+               const std::string& version);
+    HourPtr buildHour(const HourGroup& group);
+    SheetPtr compose(const std::vector<HourPtr>& hours, const std::string& version);
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    LruCache<std::string, HourPtr> hours_;
+    LruCache<std::string, SheetPtr> sheets_;
+    std::unordered_map<std::string, std::vector<Callback>> inflight_;
+
+    std::atomic<uint64_t> sheet_hits_{0};
+    std::atomic<uint64_t> sheets_built_{0};
+    std::atomic<uint64_t> hours_built_{0};
+    std::atomic<uint64_t> tiles_decoded_{0};
+    std::atomic<uint64_t> coalesced_{0};
+
+    // Last, so it is joined before the state its tasks touch is destroyed
+    trantor::ConcurrentTaskQueue workers_;
+};
+
+} // namespace hms
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace hms {
+
+/// The Angular dist/browser tree held in memory.
+///
+/// Every file is read once at load(); text assets also get Brotli and gzip
+/// variants computed up front, so a request is a hash lookup plus picking the
+/// encoding the client accepts. Content-hashed bundle names (main-ABCD1234.js)
+/// are served as immutable; everything else revalidates with its ETag.
+/// index.html is patched with the HA ingress <base href> once per distinct
+/// X-Ingress-Path and the result is kept alongside the plain assets. Past
+/// max_index_variants a new path is patched per request and sent uncompressed.
+class StaticAssets {
+public:
+    struct Options {
+        /// Files larger than this stay on disk and go through newFileResponse
+        size_t max_file_bytes = 16 * 1024 * 1024;
+        /// Distinct ingress paths whose patched index.html is kept
+        size_t max_index_variants = 16;
+    };
+
+    struct Stats {
+        size_t files = 0;
+        size_t bytes = 0;            ///< plain + compressed variants in memory
+        size_t index_variants = 0;
+        uint64_t index_uncached = 0;   ///< index.html patched past max_index_variants
+        uint64_t hits = 0;
+        uint64_t not_modified = 0;
+    };
+
+    StaticAssets(std::string root, Options options);
+
+    /// Read the whole tree; returns false when root has no index.html
+    bool load();
+
+    /// Response for a path relative to root, or nullptr when there is no such file
+    drogon::HttpResponsePtr serve(const drogon::HttpRequestPtr& req, std::string_view sub_path);
+
+    /// index.html with <base href> set to ingress_path ("/" when empty)
+    drogon::HttpResponsePtr serveIndex(const drogon::HttpRequestPtr& req,
+                                       const std::string& ingress_path);
+
+    Stats stats() const;
+
+    /// True for bundler output names carrying a content hash
+    static bool isHashedName(std::string_view filename);
+
+    /// Replace Angular's compiled <base href="/"> with ingress_path (trailing slash added)
+    static std::string patchBaseHref(std::string html, const std::string& ingress_path);
+
+private:
+    struct Asset {
+        std::string body;
+        std::string gzip;            ///< empty when not worth compressing
+        std::string brotli;
+        std::string content_type;
+        std::string etag;
+        std::string disk_path;       ///< set instead of body for oversized files
+        bool immutable = false;
+    };
+    using AssetPtr = std::shared_ptr<const Asset>;
+
+    /// compress=false skips the Brotli/gzip variants
+    AssetPtr makeAsset(std::string body, const std::string& filename, bool immutable,
+                       bool compress = true) const;
+    drogon::HttpResponsePtr respond(const drogon::HttpRequestPtr& req, const Asset& asset);
+
+    std::string root_;
+    Options options_;
+
+    // Written only by load(), before the server starts
+    std::unordered_map<std::string, AssetPtr> assets_;
+    std::string index_html_;
+
+    mutable std::mutex index_mutex_;
+    std::unordered_map<std::string, AssetPtr> index_variants_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> not_modified_{0};
+    std::atomic<uint64_t> index_uncached_{0};
+};
+
+} // namespace hms
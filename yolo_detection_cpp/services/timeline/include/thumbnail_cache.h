@@ -0,0 +1,107 @@
+#pragma once
+
+#include "lru_cache.h"
+#include <trantor/utils/ConcurrentTaskQueue.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hms {
+
+/// Downscaled JPEG thumbnails of snapshot files, for ?w= on /snapshots.
+///
+/// Thumbnails are produced with libjpeg-turbo's DCT-domain scaled decode (the
+/// IDCT emits the image at M/8 size, so a 1080p frame is never fully decoded)
+/// followed by a short box filter to the exact width. Results are kept in a
+/// byte-capped memory LRU and, when a directory is configured, in a byte-capped
+/// on-disk LRU that survives restarts. Requests for a thumbnail that is already
+/// being generated wait for that generation instead of starting their own.
+///
+/// Keys include the source file's size and mtime, so a rewritten snapshot
+/// never serves a stale thumbnail.
+class ThumbnailCache {
+public:
+    struct Options {
+        size_t max_memory_bytes = 16 * 1024 * 1024;
+        /// On-disk cache directory; empty keeps thumbnails in memory only
+        std::string disk_dir;
+        size_t max_disk_bytes = 256 * 1024 * 1024;
+        int quality = 80;
+        /// Threads decoding and encoding, off the HTTP IO loops
+        size_t workers = 2;
+    };
+
+    struct Thumbnail {
+        std::string body;     ///< JPEG bytes
+        std::string etag;
+    };
+    using ThumbnailPtr = std::shared_ptr<const Thumbnail>;
+    /// Receives nullptr when the source is missing or not a decodable JPEG.
+    /// May run on a worker thread.
+    using Callback = std::function<void(const ThumbnailPtr&)>;
+
+    struct Stats {
+        uint64_t memory_hits = 0;
+        uint64_t disk_hits = 0;
+        uint64_t generated = 0;
+        uint64_t coalesced = 0;   ///< waited on another request's generation
+        uint64_t failures = 0;
+        size_t memory_bytes = 0;
+        size_t disk_bytes = 0;
+    };
+
+    explicit ThumbnailCache(Options options);
+
+    /// Widths actually produced; requests are rounded up to one of these so
+    /// clients cannot fill the cache with arbitrary sizes
+    static constexpr int kWidths[] = {160, 320, 480, 640};
+
+    /// Smallest bucket >= requested (the largest for bigger requests); 0 when
+    /// requested is not positive
+    static int bucketWidth(int requested);
+
+    /// Deliver a thumbnail of source_path at most `width` pixels wide
+    void get(const std::string& source_path, int width, Callback&& callback);
+
+    Stats stats() const;
+
+    /// Decode jpeg scaled to at most max_width pixels wide (never upscaled) and
+    /// re-encode it; nullopt when the input cannot be decoded
+    static std::optional<std::string> scaleJpeg(std::string_view jpeg, int max_width, int quality);
+
+private:
+    void generate(const std::string& key, const std::string& source_path, int width);
+    void complete(const std::string& key, const ThumbnailPtr& thumb);
+
+    ThumbnailPtr readDisk(const std::string& key);
+    void writeDisk(const std::string& key, const std::string& body);
+    std::string diskPath(const std::string& key) const;
+    void loadDiskIndex();
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    LruCache<std::string, ThumbnailPtr> memory_;
+    std::unordered_map<std::string, std::vector<Callback>> inflight_;
+
+    mutable std::mutex disk_mutex_;
+    LruCache<std::string, bool> disk_;     ///< cached file names, cost = bytes
+
+    std::atomic<uint64_t> memory_hits_{0};
+    std::atomic<uint64_t> disk_hits_{0};
+    std::atomic<uint64_t> generated_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> failures_{0};
+
+    // Last, so it is joined before the state its tasks touch is destroyed
+    trantor::ConcurrentTaskQueue workers_;
+};
+
+} // namespace hms
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "api_queries.h"
+#include "db_pool.h"
+#include "event_cursor.h"
+#include "prepared_statements.h"
+
+namespace hms {
+
+/// Timeline-service queries that have no counterpart in hms-shared's api_queries.
+/// Same conventions: plain functions over a DbPool, results as JSON-ready data.
+///
+/// Everything but the startup paging loaders runs as a statement prepared
+/// once per pooled connection, so repeat calls skip parsing. Those sessions
+/// use plan_cache_mode = force_custom_plan: the optional-filter statements
+/// need a plan for their actual parameters to use the indexes.
+namespace timeline_queries {
+
+/// Prepared execution on or off (on by default). Turn it off behind a
+/// transaction-mode connection pooler, where a session's statements do not
+/// follow it to the next transaction.
+void set_prepared_statements(bool enabled);
+bool prepared_statements_enabled();
+PreparedStatements::Stats prepared_statement_stats();
+
+/// One stored event or periodic-snapshot embedding plus its search result fields
+struct EmbeddingRow {
+    std::string type;              ///< "event" | "snapshot"
+    std::string id;                ///< event_id, or snapshot_id as text
+    std::string camera_id;
+    int64_t timestamp_epoch = 0;   ///< started_at / captured_at, whole epoch seconds
+    std::string detected_classes;
+    std::vector<float> embedding;
+    nlohmann::json doc;            ///< SearchResult fields (no rank/similarity)
+    int32_t fingerprint = 0;       ///< see EmbeddedId
+};
+
+/// An embedded row's identity without its vector. The schema has no
+/// modification time, so fingerprint (hashtext of ai_context, the text the
+/// embedding is computed from) is what tells a rewritten row from the one
+/// SemanticIndex already holds.
+struct EmbeddedId {
+    std::string type;              ///< "event" | "snapshot"
+    std::string id;                ///< event_id, or snapshot_id as text
+    int32_t fingerprint = 0;
+};
+
+/// Page through event embeddings ordered by event_id (initial index load)
+std::vector<EmbeddingRow> load_event_embeddings(DbPool& pool, const std::string& after_event_id,
+                                                int batch_size);
+
+/// Page through periodic-snapshot embeddings ordered by snapshot_id (initial index load)
+std::vector<EmbeddingRow> load_snapshot_embeddings(DbPool& pool, int64_t after_snapshot_id,
+                                                   int batch_size);
+
+/// Rows with an embedding whose timestamp is within the lookback window.
+/// Cheap: no vectors are transferred.
+std::vector<EmbeddedId> recent_embedded_ids(DbPool& pool, int lookback_minutes);
+
+/// Up to `limit` events with an embedding, after after_event_id in id
+/// order. Ids only, for SemanticIndex's periodic reconciliation. nullopt on error.
+std::optional<std::vector<EmbeddedId>> embedded_event_ids(DbPool& pool,
+                                                         const std::string& after_event_id,
+                                                         int limit);
+
+/// Same for periodic snapshots, ids as text
+std::optional<std::vector<EmbeddedId>> embedded_snapshot_ids(DbPool& pool,
+                                                            int64_t after_snapshot_id,
+                                                            int limit);
+
+/// Full rows for the given ids
+std::vector<EmbeddingRow> load_embeddings_by_id(DbPool& pool,
+                                                const std::vector<std::string>& event_ids,
+                                                const std::vector<std::string>& snapshot_ids);
+
+/// Event totals for one camera in one 15-minute slot of a day
+struct RollupRow {
+    std::string camera_id;
+    std::string date;              ///< YYYY-MM-DD in the database session time zone
+    int slot = 0;                  ///< minute-of-day / 15, 0..95
+    int64_t event_count = 0;
+    int64_t total_detections = 0;
+};
+
+/// Aggregate events by camera, day and 15-minute slot for dates in
+/// [from_date, to_date] (YYYY-MM-DD, inclusive), for camera_ids only unless
+/// that is empty. Empty slots are omitted. nullopt on a database error, so
+/// callers never cache a failed load as empty.
+std::optional<std::vector<RollupRow>> load_rollup(DbPool& pool, const std::string& from_date,
+                                                  const std::string& to_date,
+                                                  const std::vector<std::string>& camera_ids = {});
+
+/// Filters and seek position for load_events_page
+struct EventPageQuery {
+    std::optional<std::string> camera_id;
+    std::optional<std::string> start;           ///< inclusive lower bound on started_at
+    std::optional<std::string> end;             ///< inclusive upper bound on started_at
+    std::optional<EventCursor> before;          ///< continue strictly after this key
+    int limit = 100;
+};
+
+/// One page of /api/events rows, serialized as they are read from the result
+struct EventPage {
+    struct Row {
+        EventCursor key;
+        std::string recording_url;     ///< empty when NULL; for the recording filter
+        size_t begin = 0;              ///< the row's JSON object is json[begin, begin + size)
+        size_t size = 0;
+    };
+    std::string json;                  ///< row objects back to back, same fields as
+                                       ///< api_queries::get_all_events
+    std::vector<Row> rows;
+
+    std::string_view rowJson(const Row& row) const {
+        return std::string_view(json).substr(row.begin, row.size);
+    }
+};
+
+/// Events ordered by (started_at, event_id) descending, seeking past
+/// query.before with a row-value comparison. With an index on
+/// (started_at, event_id), or (camera_id, started_at, event_id) for the camera
+/// filter, every page is an index range scan of `limit` rows no matter how
+/// deep it is. Rows go straight from the result into EventPage::json with
+/// JsonWriter, without a DOM. nullopt on a database error.
+std::optional<EventPage> load_events_page(DbPool& pool, const EventPageQuery& query);
+
+/// An event row for the live feed, serialized like an /api/events row
+struct FeedRow {
+    std::string event_id;
+    std::string camera_id;
+    int64_t started_at_us = 0;
+    std::string json;
+};
+
+/// The newest `limit` events that started at or after since_us (microseconds
+/// since the Unix epoch), or within the last lookback_seconds when since_us is
+/// nullopt, in ascending (started_at, event_id) order. nullopt on a database error.
+std::optional<std::vector<FeedRow>> load_recent_events(DbPool& pool,
+                                                       std::optional<int64_t> since_us,
+                                                       int lookback_seconds, int limit);
+
+/// Events and their detections, serialized like /api/events/{event_id}
+struct EventDetails {
+    struct Entry {
+        std::string event;             ///< event object, same fields as an /api/events row
+        std::string detections;        ///< array of detection objects
+        size_t detection_count = 0;
+    };
+    std::unordered_map<std::string, Entry> by_id;   ///< ids without an event row are absent
+};
+
+/// Events with the given ids plus all their detections, in two set-based
+/// queries however many ids there are (instead of one detail query per
+/// event). nullopt on a database error.
+std::optional<EventDetails> load_event_details(DbPool& pool, const std::vector<std::string>& ids);
+
+/// The primary's current WAL position (pg_lsn as text); nullopt on error
+std::optional<std::string> current_wal_lsn(DbPool& pool);
+
+/// Replication state of a standby, for DbRouter's health checks
+struct ReplicaStatus {
+    bool in_recovery = false;
+    std::optional<double> lag_bytes;     ///< WAL not yet replayed; needs primary_lsn
+    std::optional<double> replay_age;    ///< seconds since the last replayed transaction
+};
+
+/// Unlike the other queries this throws on a database error, so the health
+/// check can report why a standby is down
+std::optional<ReplicaStatus> replica_status(DbPool& pool,
+                                            const std::optional<std::string>& primary_lsn);
+
+/// CURRENT_DATE of the database session as YYYY-MM-DD (nullopt on error)
+std::optional<std::string> current_date(DbPool& pool);
+
+/// Search start/end as epoch seconds, read in the session time zone the way
+/// search_semantic reads them
+struct SearchBounds {
+    std::optional<int64_t> from_epoch;   ///< inclusive
+    std::optional<int64_t> to_epoch;     ///< exclusive; a date-only end covers that whole day
+};
+
+/// Convert the bounds with the database (no round trip when both are unset).
+/// nullopt on a database error or a value PostgreSQL does not accept.
+std::optional<SearchBounds> search_bounds(DbPool& pool, const std::optional<std::string>& start,
+                                          const std::optional<std::string>& end);
+
+/// pgvector nearest events and periodic snapshots: the response of
+/// api_queries::search_events_semantic, as a prepared statement with the
+/// embedding sent in pgvector's binary form. Rows below min_similarity are
+/// dropped. nullopt on a database error.
+std::optional<nlohmann::json> search_semantic(DbPool& pool, const api_queries::SearchParams& params,
+                                              const std::vector<float>& embedding,
+                                              float min_similarity = 0.3f);
+
+} // namespace timeline_queries
+} // namespace hms
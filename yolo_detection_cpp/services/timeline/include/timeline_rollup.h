@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "db_pool.h"
+#include "timeline_queries.h"
+
+namespace hms {
+
+/// In-memory per-camera event rollup at 15-minute granularity, replacing the
+/// per-request aggregation of api_queries::get_timeline_data.
+///
+/// Days before yesterday (database time) are final: they are loaded once on
+/// first use and never change. Yesterday and today are re-aggregated by a
+/// poller thread, since events keep accumulating detections after they start
+/// and an event can straddle midnight. Final days can optionally be persisted
+/// to a JSON file so a restart does not re-query history. At most
+/// Options::max_days dates are held; the oldest final days go first.
+class TimelineRollup {
+public:
+    static constexpr int kSlotMinutes = 15;
+    static constexpr int kSlotsPerDay = 24 * 60 / kSlotMinutes;
+
+    struct Bucket {
+        uint32_t event_count = 0;
+        uint32_t total_detections = 0;
+    };
+    using Day = std::array<Bucket, kSlotsPerDay>;
+    using Date = std::chrono::sys_days;
+
+    struct Options {
+        std::chrono::seconds poll_interval{30};
+        /// File for final days; empty disables persistence
+        std::string persist_path;
+        /// Dates held in memory, beyond the range a request is loading
+        size_t max_days = 400;
+        /// Aggregate for [from, to]; defaults to timeline_queries::load_rollup
+        std::function<std::optional<std::vector<timeline_queries::RollupRow>>(
+            const std::string& from, const std::string& to)> load;
+        /// The database's current date; defaults to timeline_queries::current_date
+        std::function<std::optional<std::string>()> today;
+    };
+
+    struct Stats {
+        size_t days = 0;          ///< dates held in memory
+        uint64_t loads = 0;       ///< on-demand queries for missing dates
+        uint64_t evictions = 0;   ///< dates dropped for max_days
+        uint64_t refreshes = 0;   ///< poller re-aggregations of yesterday/today
+        bool live = false;        ///< the poller has completed at least once
+    };
+
+    TimelineRollup(std::shared_ptr<DbPool> pool, Options options);
+    ~TimelineRollup();
+
+    TimelineRollup(const TimelineRollup&) = delete;
+    TimelineRollup& operator=(const TimelineRollup&) = delete;
+
+    /// Load persisted days, then start the poller thread
+    void start();
+
+    /// Stop the poller thread (idempotent, also called by the destructor)
+    void stop();
+
+    /// Make sure every date in [from, to] is in memory; missing dates are loaded
+    /// with a single query. Returns false if that query failed.
+    bool ensureLoaded(Date from, Date to);
+
+    using Visitor = std::function<void(size_t camera, size_t day_index, const Day& day)>;
+
+    /// Call visit for each of camera_ids with events on each date of [from, to]
+    /// (day_index counts from `from`), loading missing dates first. Dates loaded
+    /// for this call are read even if another request evicts them meanwhile.
+    /// Returns false if the load failed.
+    bool visit(const std::vector<std::string>& camera_ids, Date from, Date to,
+               const Visitor& fn);
+
+    /// True once date can no longer change
+    bool isFinal(Date date) const;
+
+    Stats stats() const;
+
+    /// YYYY-MM-DD; nullopt when malformed or not a calendar date
+    static std::optional<Date> parseDate(const std::string& text);
+    static std::string formatDate(Date date);
+
+private:
+    using CameraDays = std::unordered_map<std::string, Day>;
+
+    /// ensureLoaded() that also hands back the dates it loaded
+    bool load(Date from, Date to, std::map<Date, CameraDays>& loaded);
+    /// Drop the oldest final days outside [keep_from, keep_to] down to
+    /// max_days. Caller holds the unique lock.
+    void evict(Date keep_from, Date keep_to);
+    void run();
+    void refreshRecent();
+    void loadPersisted();
+    void persist();
+    bool waitFor(std::chrono::seconds interval);
+
+    std::shared_ptr<DbPool> pool_;
+    Options options_;
+
+    mutable std::shared_mutex mutex_;
+    std::map<Date, CameraDays> days_;
+    std::optional<Date> mutable_from_;   ///< yesterday at the last refresh
+    bool dirty_ = false;                 ///< final days not yet persisted
+
+    std::atomic<uint64_t> loads_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> refreshes_{0};
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+/// Per-camera totals of /api/timeline/range: rollup slots folded into
+/// consecutive buckets of bucket_minutes from the start of the first day.
+/// Input outside the grid (unknown camera, date or slot) is ignored.
+class TimelineBuckets {
+public:
+    /// bucket_minutes must be a multiple of kSlotMinutes that divides a day
+    TimelineBuckets(size_t cameras, size_t days, int bucket_minutes);
+
+    void add(size_t camera, size_t day_index, int slot, uint64_t events, uint64_t detections);
+    void add(size_t camera, size_t day_index, const TimelineRollup::Day& day);
+    /// Rows of timeline_queries::load_rollup; cameras gives the row order
+    void add(const std::vector<timeline_queries::RollupRow>& rows,
+             const std::vector<std::string>& cameras, TimelineRollup::Date start);
+
+    size_t bucketCount() const { return bucket_count_; }
+    /// [camera][bucket]
+    const std::vector<std::vector<uint64_t>>& eventCount() const { return event_count_; }
+    const std::vector<std::vector<uint64_t>>& totalDetections() const { return total_detections_; }
+
+private:
+    size_t days_;
+    int slots_per_bucket_;
+    size_t buckets_per_day_;
+    size_t bucket_count_;
+    std::vector<std::vector<uint64_t>> event_count_;
+    std::vector<std::vector<uint64_t>> total_detections_;
+};
+
+} // namespace hms
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hms {
+
+/// Timeline-only tuning knobs read from the `timeline:` section of config.yaml.
+/// ConfigManager (hms-shared) ignores keys it does not know, so these live
+/// alongside the shared settings. Every key is optional.
+struct TuningConfig {
+    /// Run handlers' database queries on database.pool_size dedicated threads
+    /// instead of Drogon's IO threads
+    bool db_executor = true;
+    /// Queries waiting for a thread before new requests get 503
+    int db_executor_queue = 256;
+    /// Prepare timeline queries once per pooled connection; turn off behind a
+    /// transaction-mode pooler such as PgBouncer
+    bool prepared_statements = true;
+
+    /// Streaming replicas ({host, port} entries) for read-only handler queries;
+    /// they use the database section's credentials and pool_size. Empty = primary only
+    std::vector<std::pair<std::string, int>> db_replicas;
+    /// Replicas further behind the primary than this get no reads
+    double db_replica_max_lag_s = 10.0;
+    /// Seconds between replica health and lag checks
+    int db_replica_check_s = 5;
+
+    /// Minimum interval between upstream fetches of a camera's live snapshot;
+    /// also the frame interval of /api/cameras/{id}/stream
+    int snapshot_refresh_ms = 1000;
+
+    /// Push new events to /api/events/stream from one shared tail query
+    bool event_stream = true;
+    /// Interval of that query while at least one stream is open
+    int event_stream_poll_ms = 1000;
+    /// Events that started this long ago are still re-read for late inserts and updates
+    int event_stream_lookback_s = 300;
+
+    /// Serve semantic search from an in-process HNSW index instead of pgvector
+    bool semantic_index = false;
+    /// Seconds between polls for newly embedded events/snapshots
+    int semantic_index_poll_s = 30;
+    /// Seconds between full passes that pick up embeddings backfilled for old rows
+    int semantic_index_reconcile_s = 900;
+    /// Index results below this cosine similarity are dropped
+    double semantic_min_similarity = 0.3;
+    /// Build the HNSW graph; false keeps only the exact-scan matrix
+    bool semantic_index_graph = true;
+    /// Exact-scan row layout: "f32" | "f16" | "int8"
+    std::string semantic_exact_storage = "f32";
+
+    /// mode=hybrid answers with the legs that finished within this budget
+    int hybrid_budget_ms = 1000;
+    /// Reciprocal-rank fusion constant (k in 1 / (k + rank))
+    int hybrid_rrf_k = 60;
+
+    /// Serve /api/timeline from the in-memory 15-minute rollup
+    bool timeline_rollup = true;
+    /// Seconds between re-aggregations of yesterday and today
+    int timeline_rollup_poll_s = 30;
+    /// File that keeps final (past) days across restarts; empty = memory only
+    std::string timeline_rollup_path;
+
+    /// Cache serialized event detail, timeline and snapshot responses
+    bool response_cache = true;
+    /// Memory cap for cached bodies (plain plus gzip)
+    int response_cache_mb = 32;
+    /// Lifetime of responses for today/yesterday; new recordings drop them sooner
+    int response_cache_live_ttl_s = 15;
+    /// Lifetime of responses for earlier (final) days
+    int response_cache_final_ttl_s = 24 * 60 * 60;
+
+    /// Open recordings/snapshots kept in the fd cache; 0 opens per request
+    int media_fd_cache = 64;
+
+    /// Memory cap for snapshot thumbnails (/snapshots/{file}?w=N); 0 disables ?w=
+    int thumbnail_cache_mb = 16;
+    /// Directory that keeps thumbnails across restarts; empty = memory only
+    std::string thumbnail_dir;
+    /// Disk cap for thumbnail_dir; least recently used files are deleted
+    int thumbnail_disk_mb = 256;
+
+    /// Serve periodic-snapshot contact sheets at /api/cameras/{id}/sprites
+    bool sprite_sheets = true;
+    /// Memory cap for decoded sprite tiles (cached per camera, date and hour)
+    int sprite_tile_cache_mb = 64;
+
+    /// Memory cap for MP4 keyframe indexes and fast-start heads; 0 disables both
+    int mp4_index_mb = 32;
+
+    /// Record per-route latency and serve Prometheus metrics at /metrics
+    bool metrics = true;
+
+    /// Load from config_path; missing keys keep their defaults
+    static TuningConfig load(const std::string& config_path);
+};
+
+} // namespace hms
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace hms {
+
+/// Allocator returning 64-byte (cache line / AVX-512 register) aligned storage
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static constexpr std::align_val_t kAlignment{64};
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), kAlignment));
+    }
+    void deallocate(T* p, size_t) noexcept { ::operator delete(p, kAlignment); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const noexcept { return true; }
+};
+
+/// Contiguous row-major store of L2-normalised vectors, scored with the SIMD
+/// kernels. Rows are padded to a 64-byte stride so every row starts on a cache
+/// line. Float16 and Int8 layouts trade a little precision for 2x / 4x less
+/// memory. Not synchronised — the owner serialises add() against reads.
+class VectorMatrix {
+public:
+    enum class Storage { Float32, Float16, Int8 };
+
+    using Filter = std::function<bool(uint32_t)>;
+    using Match = std::pair<uint32_t, float>;   ///< (row, cosine similarity)
+
+    explicit VectorMatrix(size_t dim, Storage storage = Storage::Float32);
+
+    /// Normalise and append a vector of dim() floats; returns its row index
+    uint32_t add(const float* vec);
+
+    /// Cosine similarity of a normalised query against row id
+    float similarity(const float* query, uint32_t id) const;
+
+    /// Exact top-k by cosine similarity over rows accepted by filter, best first.
+    /// The query must be normalised.
+    std::vector<Match> topK(const float* query, size_t k, const Filter& filter = {}) const;
+
+    /// Row id as floats — Float32 storage only
+    const float* row(uint32_t id) const { return f32_.data() + static_cast<size_t>(id) * stride_; }
+
+    size_t size() const { return rows_; }
+    size_t dim() const { return dim_; }
+    Storage storage() const { return storage_; }
+    /// Bytes held by vector data (excluding the vector's spare capacity)
+    size_t bytes() const;
+
+    /// Scale v to unit length in place (zero vectors are left as is)
+    static void normalize(float* v, size_t n);
+
+    /// "f32" | "f16" | "int8"
+    static std::optional<Storage> parseStorage(std::string_view name);
+    static const char* storageName(Storage storage);
+
+private:
+    size_t dim_;
+    size_t stride_;     ///< elements per row, padded to 64 bytes
+    Storage storage_;
+    size_t rows_ = 0;
+
+    std::vector<float, AlignedAllocator<float>> f32_;
+    std::vector<uint16_t, AlignedAllocator<uint16_t>> f16_;
+    std::vector<int8_t, AlignedAllocator<int8_t>> i8_;
+    std::vector<float> scales_;   ///< Int8 dequantisation scale per row
+};
+
+} // namespace hms
@@ -0,0 +1,90 @@
+#include "compression.h"
+
+#include <brotli/encode.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+
+namespace hms {
+
+namespace {
+
+// Content-coding and parameter names are case-insensitive (RFC 9110 8.4.1, 5.6.6)
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](unsigned char x, unsigned char y) {
+               return std::tolower(x) == std::tolower(y);
+           });
+}
+
+} // anonymous namespace
+
+std::string gzipCompress(std::string_view data, int level) {
+    z_stream zs{};
+    // windowBits 15 + 16 selects the gzip wrapper
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return {};
+    }
+    std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? out : std::string();
+}
+
+std::string brotliCompress(std::string_view data, int quality) {
+    size_t size = BrotliEncoderMaxCompressedSize(data.size());
+    if (size == 0) return {};
+    std::string out(size, '\0');
+    if (!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+                               &size, reinterpret_cast<uint8_t*>(out.data()))) {
+        return {};
+    }
+    out.resize(size);
+    return out;
+}
+
+bool acceptsEncoding(std::string_view accept_encoding, std::string_view coding) {
+    bool wildcard = false;
+    while (!accept_encoding.empty()) {
+        auto comma = accept_encoding.find(',');
+        auto token = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view()
+                                                          : accept_encoding.substr(comma + 1);
+        while (!token.empty() && token.front() == ' ') token.remove_prefix(1);
+
+        auto semi = token.find(';');
+        auto name = token.substr(0, semi);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+        const bool explicit_entry = equalsIgnoreCase(name, coding);
+        if (!explicit_entry && name != "*") continue;
+
+        // "gzip;q=0" refuses the coding; any other weight accepts it
+        bool accepted = true;
+        auto params = semi == std::string_view::npos ? std::string_view() : token.substr(semi + 1);
+        while (!params.empty()) {
+            auto next = params.find(';');
+            auto param = params.substr(0, next);
+            params = next == std::string_view::npos ? std::string_view() : params.substr(next + 1);
+            while (!param.empty() && param.front() == ' ') param.remove_prefix(1);
+            auto eq = param.find('=');
+            if (eq != std::string_view::npos && equalsIgnoreCase(param.substr(0, eq), "q")) {
+                accepted = std::strtod(std::string(param.substr(eq + 1)).c_str(), nullptr) > 0.0;
+                break;
+            }
+        }
+        // An explicit entry for the coding overrides "*"
+        if (explicit_entry) return accepted;
+        wildcard = accepted;
+    }
+    return wildcard;
+}
+
+} // namespace hms
@@ -1,9 +1,12 @@
 #include "controllers/media_controller.h"
 #include "http_utils.h"
+#include "metrics.h"
 #include <spdlog/spdlog.h>
 #include <nlohmann/json.hpp>
 #include <filesystem>
 #include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <unordered_map>
 
 using namespace drogon;
@@ -39,6 +42,18 @@ void MediaController::setSnapshotsDir(std::string dir) {
     snapshots_dir_ = std::move(dir);
 }
 
+void MediaController::setFileCache(std::shared_ptr<MediaFileCache> cache) {
+    file_cache_ = std::move(cache);
+}
+
+void MediaController::setThumbnailCache(std::shared_ptr<ThumbnailCache> cache) {
+    thumbnail_cache_ = std::move(cache);
+}
+
+void MediaController::setMp4Index(std::shared_ptr<Mp4IndexCache> index) {
+    mp4_index_ = std::move(index);
+}
+
 bool MediaController::isValidFilename(const std::string& filename) {
     // Prevent path traversal: no "..", no "/", no "\"
     if (filename.empty()) return false;
@@ -51,7 +66,8 @@ bool MediaController::isValidFilename(const std::string& filename) {
     });
 }
 
-void MediaController::serveFile(const std::string& dir,
+void MediaController::serveFile(const HttpRequestPtr& req,
+                                 const std::string& dir,
                                  const std::string& filename,
                                  std::function<void(const HttpResponsePtr&)>&& callback) {
     if (!isValidFilename(filename)) {
@@ -61,31 +77,177 @@ void MediaController::serveFile(const std::string& dir,
     }
 
     auto filepath = fs::path(dir) / filename;
+    const auto kind = dir == events_dir_ ? Metrics::Media::Recording : Metrics::Media::Snapshot;
+
+    if (!file_cache_) {
+        if (!fs::exists(filepath)) {
+            callback(makeJsonResponse(json{{"error", "File not found"}}, k404NotFound));
+            return;
+        }
+        auto resp = HttpResponse::newFileResponse(filepath.string());
+        resp->setContentTypeString(getMimeType(filename));
+        resp->addHeader("Access-Control-Allow-Origin", "*");
+        std::error_code ec;
+        const auto file_size = fs::file_size(filepath, ec);
+        if (!ec) Metrics::global().addMediaBytes(kind, file_size);
+        callback(resp);
+        return;
+    }
 
-    if (!fs::exists(filepath)) {
+    auto handle = file_cache_->acquire(filepath.string());
+    if (!handle) {
         callback(makeJsonResponse(json{{"error", "File not found"}}, k404NotFound));
         return;
     }
 
-    // Use Drogon's built-in file response for efficient serving (supports range requests)
-    auto resp = HttpResponse::newFileResponse(filepath.string());
-    resp->setContentTypeString(getMimeType(filename));
-    resp->addHeader("Access-Control-Allow-Origin", "*");
-    callback(resp);
+    // Validators from the inode: a rewritten or still-growing file gets a new ETag
+    const uint64_t size = static_cast<uint64_t>(handle->st.st_size);
+    const int64_t mtime_us = static_cast<int64_t>(handle->st.st_mtim.tv_sec) * 1000000 +
+                             handle->st.st_mtim.tv_nsec / 1000;
+    char inode_etag[64];
+    std::snprintf(inode_etag, sizeof(inode_etag), "\"%llx-%llx-%llx\"",
+                  static_cast<unsigned long long>(handle->st.st_ino),
+                  static_cast<unsigned long long>(size),
+                  static_cast<unsigned long long>(mtime_us));
+    std::string etag = inode_etag;
+    const auto last_modified = utils::getHttpFullDate(trantor::Date(mtime_us));
+    const auto mime_type = getMimeType(filename);
+    const auto& range_header = req->getHeader("Range");
+    const auto& if_range = req->getHeader("If-Range");
+
+    // Players fetch recordings by range. When the moov box trails the media
+    // data, ranges address a fast-start layout of the same size instead, so
+    // playback can start from the first response. It has its own ETag; an
+    // If-Range for anything else keeps the client on the original bytes.
+    // Only a cached index is used: a miss queues the parse and this response
+    // (and its ETag) stays on the original layout, so nothing on the IO
+    // thread reads the moov box.
+    Mp4IndexCache::IndexPtr fast_start;
+    if (mp4_index_ && !range_header.empty() && dir == events_dir_ && mime_type == "video/mp4") {
+        auto index = mp4_index_->find(filename, handle->st).value_or(nullptr);
+        auto fs_etag = etag.substr(0, etag.size() - 1) + "-fs\"";
+        if (index && index->hasVirtualLayout() && (if_range.empty() || if_range == fs_etag)) {
+            fast_start = std::move(index);
+            etag = std::move(fs_etag);
+        }
+    }
+
+    auto withValidators = [&](const HttpResponsePtr& resp) {
+        resp->addHeader("Accept-Ranges", "bytes");
+        resp->addHeader("ETag", etag);
+        resp->addHeader("Last-Modified", last_modified);
+        resp->addHeader("Access-Control-Allow-Origin", "*");
+        return resp;
+    };
+
+    if (isNotModified(req, etag, last_modified)) {
+        callback(withValidators(makeNotModifiedResponse(etag, last_modified)));
+        return;
+    }
+
+    // If-Range: only honour Range when the client's copy is still this one
+    uint64_t offset = 0, length = size;
+    auto range = RangeResult::Full;
+    if (!range_header.empty() && (if_range.empty() || if_range == etag || if_range == last_modified)) {
+        range = parseRange(range_header, size, offset, length);
+    }
+
+    if (range == RangeResult::Unsatisfiable) {
+        auto resp = HttpResponse::newHttpResponse();
+        resp->setStatusCode(k416RequestedRangeNotSatisfiable);
+        resp->addHeader("Content-Range", "bytes */" + std::to_string(size));
+        callback(withValidators(resp));
+        return;
+    }
+    if (fast_start && range == RangeResult::Full) {
+        // A whole-file response is always the file as stored
+        fast_start.reset();
+        etag = inode_etag;
+    }
+
+    HttpResponsePtr resp;
+    if (fast_start && offset < fast_start->head.size()) {
+        // The head is in memory; a short 206 is fine, players ask for the rest
+        length = std::min<uint64_t>(length, fast_start->head.size() - offset);
+        resp = HttpResponse::newHttpResponse();
+        resp->setBody(fast_start->head.substr(offset, length));
+        resp->setContentTypeString(mime_type);
+    } else {
+        // Past the head, the layout is the original file from the first mdat on
+        const uint64_t source = fast_start ? fast_start->data_offset + (offset - fast_start->head.size())
+                                           : offset;
+        // Drogon opens this path again for sendfile(2); going through the cached
+        // fd's /proc link skips the NAS path lookup and pins the inode we stat'ed
+        resp = HttpResponse::newFileResponse(handle->file->procPath(), source, length, false,
+                                             "", CT_NONE, mime_type);
+    }
+    if (range == RangeResult::Partial) {
+        resp->setStatusCode(k206PartialContent);
+        resp->addHeader("Content-Range", "bytes " + std::to_string(offset) + "-" +
+                        std::to_string(offset + length - 1) + "/" + std::to_string(size));
+    }
+    Metrics::global().addMediaBytes(kind, length);
+    callback(withValidators(resp));
 }
 
 void MediaController::serveEvent(const HttpRequestPtr& req,
                                   std::function<void(const HttpResponsePtr&)>&& callback,
                                   const std::string& filename) {
     spdlog::debug("GET /events/{}", filename);
-    serveFile(events_dir_, filename, std::move(callback));
+    serveFile(req, events_dir_, filename, std::move(callback));
 }
 
 void MediaController::serveSnapshot(const HttpRequestPtr& req,
                                      std::function<void(const HttpResponsePtr&)>&& callback,
                                      const std::string& filename) {
     spdlog::debug("GET /snapshots/{}", filename);
-    serveFile(snapshots_dir_, filename, std::move(callback));
+    const auto& w = req->getParameter("w");
+    if (!w.empty() && thumbnail_cache_ && getMimeType(filename) == "image/jpeg") {
+        int width = 0;
+        auto [end, ec] = std::from_chars(w.data(), w.data() + w.size(), width);
+        if (ec != std::errc() || end != w.data() + w.size() || width <= 0) {
+            callback(makeJsonResponse(json{{"error", "w must be a positive integer"}}, k400BadRequest));
+            return;
+        }
+        serveThumbnail(req, filename, ThumbnailCache::bucketWidth(width), std::move(callback));
+        return;
+    }
+    serveFile(req, snapshots_dir_, filename, std::move(callback));
+}
+
+void MediaController::serveThumbnail(const HttpRequestPtr& req,
+                                     const std::string& filename,
+                                     int width,
+                                     std::function<void(const HttpResponsePtr&)>&& callback) {
+    if (!isValidFilename(filename)) {
+        spdlog::warn("Rejected invalid filename: {}", filename);
+        callback(makeJsonResponse(json{{"error", "Invalid filename"}}, k400BadRequest));
+        return;
+    }
+
+    auto filepath = (fs::path(snapshots_dir_) / filename).string();
+    thumbnail_cache_->get(filepath, width,
+        [req, callback = std::move(callback)](const ThumbnailCache::ThumbnailPtr& thumb) {
+            if (!thumb) {
+                callback(makeJsonResponse(json{{"error", "File not found"}}, k404NotFound));
+                return;
+            }
+            // Snapshots are written once; the ETag still covers a rewrite
+            const char* cache_control = "public, max-age=86400";
+            HttpResponsePtr resp;
+            if (isNotModified(req, thumb->etag, {})) {
+                resp = makeNotModifiedResponse(thumb->etag, {});
+            } else {
+                resp = HttpResponse::newHttpResponse();
+                resp->setContentTypeString("image/jpeg");
+                resp->setBody(thumb->body);
+                resp->addHeader("ETag", thumb->etag);
+                Metrics::global().addMediaBytes(Metrics::Media::Thumbnail, thumb->body.size());
+            }
+            resp->addHeader("Cache-Control", cache_control);
+            resp->addHeader("Access-Control-Allow-Origin", "*");
+            callback(resp);
+        });
 }
 
 } // namespace hms
@@ -1,29 +1,286 @@
 #include "controllers/ui_api_controller.h"
 #include "embedding_client.h"
+#include "event_cursor.h"
+#include "event_details.h"
 #include "api_queries.h"
 #include "config_manager.h"
 #include "time_utils.h"
 #include "http_utils.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include "recording_name.h"
+#include "response_format.h"
+#include "search_fusion.h"
+#include "simd_kernels.h"
+#include "timeline_queries.h"
+#include <drogon/HttpAppFramework.h>
 #include <spdlog/spdlog.h>
+#include <trantor/net/EventLoop.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+#include <charconv>
+#include <cmath>
 #include <filesystem>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <unistd.h>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace drogon;
 
 namespace hms {
 
+namespace {
+
+/// Most cameras one /api/timeline/range request may ask for; the response
+/// holds two counters per camera, day and bucket
+constexpr size_t kMaxRangeCameras = 64;
+
+/// Worker threads for the blocking legs of hybrid search (DB and Ollama calls),
+/// so the request's IO loop stays free to fire the budget timer, and for the
+/// query embeddings of the other search modes, so Ollama never holds a DB
+/// executor thread
+trantor::ConcurrentTaskQueue& searchWorkers() {
+    static trantor::ConcurrentTaskQueue queue(4, "hybrid-search");
+    return queue;
+}
+
+/// Tasks waiting for a search worker before searches stop adding more
+/// (a slow Ollama holds a worker for its whole timeout)
+constexpr size_t kMaxQueuedSearchLegs = 32;
+
+struct HybridState {
+    std::mutex mutex;
+    api_queries::SearchParams params;      // read-only once the legs start
+    int rrf_k = 60;
+    ResponseFormat format;
+    std::function<void(const HttpResponsePtr&)> callback;
+    std::optional<nlohmann::json> fts;
+    std::optional<nlohmann::json> semantic;
+    bool semantic_expected = false;
+    int pending = 0;
+    bool done = false;
+};
+
+/// Fuse whatever legs have arrived and respond; only the first call responds
+void finishHybrid(const std::shared_ptr<HybridState>& state) {
+    std::function<void(const HttpResponsePtr&)> callback;
+    PooledBuffer buffer;
+    std::optional<nlohmann::json> body;
+    {
+        std::lock_guard lock(state->mutex);
+        if (state->done) return;
+        state->done = true;
+        callback = std::move(state->callback);
+
+        // FTS first so that equal fused scores favour keyword matches
+        std::vector<const nlohmann::json*> lists;
+        if (state->fts && state->fts->contains("events")) lists.push_back(&state->fts->at("events"));
+        if (state->semantic && state->semantic->contains("events")) {
+            lists.push_back(&state->semantic->at("events"));
+        }
+        auto events = reciprocalRankFusion(lists, state->rrf_k,
+                                           static_cast<size_t>(state->params.limit));
+
+        auto leg_count = [](const std::optional<nlohmann::json>& leg) {
+            return leg ? nlohmann::json(leg->value("count", 0)) : nlohmann::json(nullptr);
+        };
+        const bool partial = !state->fts || (state->semantic_expected && !state->semantic);
+        if (!state->format.isDefault()) {
+            body = nlohmann::json{
+                {"events", std::move(events)},
+                {"search_mode", "hybrid"},
+                {"query", state->params.query},
+                {"partial", partial},
+                {"legs", {{"fts", leg_count(state->fts)}, {"semantic", leg_count(state->semantic)}}},
+            };
+            (*body)["count"] = (*body)["events"].size();
+        } else {
+            JsonWriter(buffer.str())
+                .beginObject()
+                .key("events").value(events)
+                .key("count").value(static_cast<int64_t>(events.size()))
+                .key("search_mode").value("hybrid")
+                .key("query").value(state->params.query)
+                .key("partial").value(partial)
+                .key("legs").beginObject()
+                    .key("fts").value(leg_count(state->fts))
+                    .key("semantic").value(leg_count(state->semantic))
+                .endObject()
+                .endObject();
+        }
+    }
+    if (body) {
+        callback(makeApiResponse(state->format, std::move(*body)));
+        return;
+    }
+    auto resp = makeJsonBodyResponse(buffer.str());
+    addVaryAccept(resp);
+    callback(resp);
+}
+
+/// JSON response with an ETag (or a 304 when the client's copy is current).
+/// Data covering only final days never changes, so the browser can keep it for good.
+HttpResponsePtr makeTimelineResponse(const HttpRequestPtr& req, const nlohmann::json& body,
+                                     bool final_days) {
+    auto resp = makeJsonResponse(body);
+    auto etag = makeEtag(resp->getBody());
+    if (isNotModified(req, etag, {})) return makeNotModifiedResponse(etag, {});
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control",
+                    final_days ? "public, max-age=31536000, immutable" : "no-cache");
+    return resp;
+}
+
+/// True for dates before yesterday. Yesterday still changes: events that
+/// straddle midnight keep accumulating detections after they start.
+bool isPastDay(const std::string& date) {
+    auto day = TimelineRollup::parseDate(date);
+    auto today = TimelineRollup::parseDate(time_utils::to_date_string(std::chrono::system_clock::now()));
+    return day && today && *day < *today - std::chrono::days(1);
+}
+
+/// Record a finished leg; the last one responds
+void completeLeg(const std::shared_ptr<HybridState>& state) {
+    bool last;
+    {
+        std::lock_guard lock(state->mutex);
+        last = --state->pending == 0;
+    }
+    if (last) finishHybrid(state);
+}
+
+} // anonymous namespace
+
 void UiApiController::setDbPool(std::shared_ptr<DbPool> pool) {
     db_pool_ = std::move(pool);
 }
 
-void UiApiController::setDetectionServiceUrl(std::string url) {
-    detection_service_url_ = std::move(url);
+void UiApiController::setDbExecutor(std::shared_ptr<DbExecutor> executor) {
+    db_executor_ = std::move(executor);
+}
+
+void UiApiController::setDbRouter(std::shared_ptr<DbRouter> router) {
+    db_router_ = std::move(router);
+}
+
+void UiApiController::runQuery(Callback&& callback, std::function<void(const Callback&)>&& work) {
+    if (!db_executor_) {
+        work(callback);
+        return;
+    }
+    // Drogon callbacks may be completed from any thread. The executor
+    // swallows a job's exceptions, so a throw before answering (a pqxx error,
+    // a JSON type error) is answered here; one after answering is not.
+    auto answer = std::make_shared<OnceCallback<HttpResponsePtr>>(std::move(callback));
+    Callback once = [answer](const HttpResponsePtr& resp) { (*answer)(resp); };
+    auto on_error = [answer] {
+        (*answer)(makeJsonResponse(
+            nlohmann::json{{"error", "Internal server error"}}, k500InternalServerError));
+    };
+    if (!db_executor_->submit([once, work = std::move(work)] { work(once); }, std::move(on_error))) {
+        auto resp = makeJsonResponse(
+            nlohmann::json{{"error", "Database busy"}}, k503ServiceUnavailable);
+        resp->addHeader("Retry-After", "1");
+        (*answer)(resp);
+    }
+}
+
+void UiApiController::setDetectionClient(std::shared_ptr<DetectionClient> client) {
+    detection_client_ = std::move(client);
+}
+
+void UiApiController::setSnapshotCache(std::shared_ptr<SnapshotCache> cache) {
+    snapshot_cache_ = std::move(cache);
+}
+
+void UiApiController::setEmbeddingClient(std::shared_ptr<EmbeddingClient> client) {
+    embedding_client_ = std::move(client);
+}
+
+void UiApiController::setSemanticIndex(std::shared_ptr<SemanticIndex> index) {
+    semantic_index_ = std::move(index);
+}
+
+void UiApiController::setTimelineRollup(std::shared_ptr<TimelineRollup> rollup) {
+    timeline_rollup_ = std::move(rollup);
+}
+
+void UiApiController::setHybridSearch(std::chrono::milliseconds budget, int rrf_k) {
+    hybrid_budget_ = budget;
+    hybrid_rrf_k_ = rrf_k;
+}
+
+void UiApiController::setResponseCache(std::shared_ptr<ResponseCache> cache) {
+    response_cache_ = std::move(cache);
+}
+
+void UiApiController::setSpriteSheets(std::shared_ptr<SpriteSheets> sheets) {
+    sprite_sheets_ = std::move(sheets);
+}
+
+void UiApiController::setMp4Index(std::shared_ptr<Mp4IndexCache> index) {
+    mp4_index_ = std::move(index);
+}
+
+bool UiApiController::withQueryEmbedding(
+    const std::string& query, const Callback& callback,
+    std::function<void(const Callback&, const std::vector<float>&)>&& work) {
+    if (searchWorkers().getTaskCount() >= kMaxQueuedSearchLegs) return false;
+    searchWorkers().runTaskInQueue([query, callback, work = std::move(work)]() mutable {
+        std::vector<float> embedding;
+        try {
+            embedding = embedding_client_->embed(query);
+        } catch (const std::exception& e) {
+            spdlog::error("Query embedding failed: {}", e.what());
+        }
+        runQuery(Callback(callback), [embedding = std::move(embedding),
+                                      work = std::move(work)](const Callback& callback) {
+            work(callback, embedding);
+        });
+    });
+    return true;
+}
+
+nlohmann::json UiApiController::semanticSearch(const api_queries::SearchParams& params,
+                                               const std::vector<float>& embedding,
+                                               bool exact) {
+    if (semantic_index_) {
+        if (auto result = semantic_index_->search(params, embedding, exact)) return *result;
+    }
+    if (timeline_queries::prepared_statements_enabled()) {
+        float min_similarity = semantic_index_ ? semantic_index_->options().min_similarity : 0.3f;
+        if (auto result = readQuery([&](DbPool& pool) {
+                return timeline_queries::search_semantic(pool, params, embedding, min_similarity);
+            })) {
+            return *result;
+        }
+    }
+    return readQuery([&](DbPool& pool) {
+        return api_queries::search_events_semantic(pool, params, embedding);
+    });
+}
+
+void UiApiController::setLiveStreamHub(std::shared_ptr<LiveStreamHub> hub) {
+    live_stream_hub_ = std::move(hub);
+}
+
+void UiApiController::setEventFeed(std::shared_ptr<EventFeed> feed) {
+    event_feed_ = std::move(feed);
+}
+
+void UiApiController::setRecordingIndex(std::shared_ptr<RecordingIndex> index) {
+    recording_index_ = std::move(index);
+}
+
+/// Extract the recording filename (last path component) from a recording_url
+static std::string recordingFilename(std::string_view recording_url) {
+    auto slash = recording_url.rfind('/');
+    return std::string(slash != std::string_view::npos ? recording_url.substr(slash + 1) : recording_url);
 }
 
-void UiApiController::setOllamaUrl(std::string url) {
-    ollama_url_ = std::move(url);
+/// Recording filename of an event's recording_url
+static std::string recordingFilename(const nlohmann::json& event) {
+    return recordingFilename(event.value("recording_url", ""));
 }
 
 void UiApiController::getEvents(const HttpRequestPtr& req,
@@ -47,43 +304,188 @@ void UiApiController::getEvents(const HttpRequestPtr& req,
         } catch (...) {}
     }
 
-    spdlog::debug("GET /api/events camera_id={} limit={} only_with_recordings={}",
-                  camera_id_param.value_or("all"), limit, only_with_recordings);
+    timeline_queries::EventPageQuery query;
+    query.camera_id = camera_id_param;
+    query.start = start_param;
+    query.end = end_param;
+    query.limit = limit;
+    if (auto cursor_param = req->getOptionalParameter<std::string>("cursor")) {
+        query.before = EventCursor::decode(*cursor_param);
+        if (!query.before) {
+            callback(makeJsonResponse(nlohmann::json{{"error", "Invalid cursor"}}, k400BadRequest));
+            return;
+        }
+    }
 
-    // Query 3x more to account for recording file filtering (matches Python behaviour)
-    auto raw_events = api_queries::get_all_events(
-        *db_pool_, start_param, end_param, camera_id_param, limit * 3);
+    spdlog::debug("GET /api/events camera_id={} limit={} only_with_recordings={} cursor={}",
+                  camera_id_param.value_or("all"), limit, only_with_recordings,
+                  query.before.has_value());
 
-    // Filter to events whose recording file exists on disk (Python: only_with_recordings=True)
-    nlohmann::json events = nlohmann::json::array();
-    if (only_with_recordings) {
+    runQuery(std::move(callback), [req, query, only_with_recordings,
+                                   limit](const Callback& callback) mutable {
+        // Without the recording filter every row is kept; otherwise the index (or,
+        // while it is not live, a stat per candidate) decides
+        const bool use_index = recording_index_ && recording_index_->isLive();
         const auto& events_dir = ConfigManager::get().timeline.events_dir;
-        for (const auto& event : raw_events) {
-            if (events.size() >= static_cast<size_t>(limit)) break;
-            auto recording_url = event.value("recording_url", "");
-            if (recording_url.empty()) continue;
-            // Extract filename from URL (last path component)
-            auto slash = recording_url.rfind('/');
-            std::string filename = (slash != std::string::npos)
-                                   ? recording_url.substr(slash + 1)
-                                   : recording_url;
-            if (!filename.empty() &&
-                std::filesystem::exists(std::filesystem::path(events_dir) / filename)) {
-                events.push_back(event);
+        auto keep = [&](const std::string& recording_url) {
+            if (!only_with_recordings) return true;
+            auto filename = recordingFilename(recording_url);
+            if (filename.empty()) return false;
+            return use_index ? recording_index_->contains(filename)
+                             : std::filesystem::exists(std::filesystem::path(events_dir) / filename);
+        };
+
+        // Seek page by page from the cursor until the response is full. Filtered-out
+        // rows are skipped for good: next_cursor is the key of the last row examined,
+        // not the last one returned, so the next request never re-reads them.
+        // Kept rows are copied as already serialized JSON into the response buffer.
+        constexpr int kMaxRounds = 10;
+        const auto page_size = static_cast<size_t>(limit);
+        PooledBuffer buffer;
+        JsonWriter out(buffer.str());
+        out.beginObject().key("events").beginArray();
+        size_t count = 0;
+        std::optional<EventCursor> last_examined;
+        bool exhausted = false;
+
+        for (int round = 0; round < kMaxRounds && count < page_size; ++round) {
+            auto batch = readQuery([&](DbPool& pool) {
+                return timeline_queries::load_events_page(pool, query);
+            });
+            if (!batch) {
+                callback(makeJsonResponse(
+                    nlohmann::json{{"error", "Database unavailable"}}, k503ServiceUnavailable));
+                return;
             }
+            for (const auto& row : batch->rows) {
+                last_examined = row.key;
+                if (keep(row.recording_url)) {
+                    out.raw(batch->rowJson(row));
+                    ++count;
+                }
+                if (count >= page_size) break;
+            }
+            if (batch->rows.size() < static_cast<size_t>(query.limit)) {
+                // Short batch: nothing older exists once its last row has been examined
+                exhausted = batch->rows.empty() || last_examined->event_id == batch->rows.back().key.event_id;
+                break;
+            }
+            query.before = last_examined;
         }
-    } else {
-        for (const auto& event : raw_events) {
-            if (events.size() >= static_cast<size_t>(limit)) break;
-            events.push_back(event);
+
+        out.endArray();
+        out.key("count").value(static_cast<int64_t>(count));
+        out.key("next_cursor");
+        if (!exhausted && last_examined) {
+            out.value(last_examined->encode());
+        } else {
+            out.null();
         }
+        out.endObject();
+
+        // Binary and columnar bodies are encoded from a DOM of the page
+        const auto format = ResponseFormat::negotiate(req);
+        if (!format.isDefault()) {
+            callback(makeApiResponse(format, nlohmann::json::parse(buffer.str())));
+            return;
+        }
+        auto resp = makeJsonBodyResponse(buffer.str());
+        addVaryAccept(resp);
+        callback(resp);
+    });
+}
+
+void UiApiController::getEventStream(const HttpRequestPtr& req,
+                                      std::function<void(const HttpResponsePtr&)>&& callback) {
+    if (!event_feed_) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Event stream is disabled"}}, k503ServiceUnavailable));
+        return;
     }
 
-    nlohmann::json response;
-    response["events"] = events;
-    response["count"] = static_cast<int>(events.size());
+    std::unordered_set<std::string> cameras;
+    {
+        std::istringstream iss(req->getParameter("cameras"));
+        std::string cam;
+        while (std::getline(iss, cam, ',')) {
+            if (!cam.empty()) cameras.insert(cam);
+        }
+        const auto& camera_id = req->getParameter("camera_id");
+        if (!camera_id.empty()) cameras.insert(camera_id);
+    }
+
+    // EventSource sends Last-Event-ID itself; the parameter serves other clients
+    std::optional<uint64_t> last_event_id;
+    std::string last_id_text = req->getHeader("Last-Event-ID");
+    if (last_id_text.empty()) last_id_text = req->getParameter("last_event_id");
+    if (!last_id_text.empty()) {
+        uint64_t id = 0;
+        auto [end, ec] = std::from_chars(last_id_text.data(), last_id_text.data() + last_id_text.size(), id);
+        if (ec == std::errc() && end == last_id_text.data() + last_id_text.size()) last_event_id = id;
+    }
 
-    callback(makeJsonResponse(response));
+    spdlog::debug("GET /api/events/stream cameras={} last_event_id={}", cameras.size(),
+                  last_event_id ? std::to_string(*last_event_id) : "none");
+
+    auto feed = event_feed_;
+    auto resp = HttpResponse::newAsyncStreamResponse(
+        [feed, conn = req->getConnectionPtr(), cameras = std::move(cameras),
+         last_event_id](ResponseStreamPtr stream) mutable {
+            feed->subscribe(std::move(stream), conn, std::move(cameras), last_event_id);
+        });
+    resp->setContentTypeString("text/event-stream");
+    resp->addHeader("Cache-Control", "no-cache, no-store");
+    // Stops nginx-style proxies (e.g. HA ingress) from buffering the stream
+    resp->addHeader("X-Accel-Buffering", "no");
+    callback(resp);
+}
+
+void UiApiController::getEventDetails(const HttpRequestPtr& req,
+                                       std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto list = req->method() == Post ? EventIdList::fromBody(req->body())
+                                      : EventIdList::fromQuery(req->getParameter("ids"));
+    switch (list.error) {
+        case EventIdList::Error::None:
+            break;
+        case EventIdList::Error::Malformed:
+            callback(makeJsonResponse(nlohmann::json{{"error", "Expected {\"ids\": [...]}"}},
+                                      k400BadRequest));
+            return;
+        case EventIdList::Error::Empty:
+            callback(makeJsonResponse(nlohmann::json{{"error", "ids is required"}}, k400BadRequest));
+            return;
+        case EventIdList::Error::TooMany:
+            callback(makeJsonResponse(
+                nlohmann::json{{"error", "Too many ids"}, {"max", EventIdList::kMaxIds}},
+                k400BadRequest));
+            return;
+    }
+
+    spdlog::debug("{} {} ids={}", req->methodString(), req->path(), list.ids.size());
+
+    runQuery(std::move(callback), [req, ids = std::move(list.ids)](const Callback& callback) {
+        auto details = readQuery([&](DbPool& pool) {
+            return timeline_queries::load_event_details(pool, ids);
+        });
+        if (!details) {
+            callback(makeJsonResponse(
+                nlohmann::json{{"error", "Database unavailable"}}, k503ServiceUnavailable));
+            return;
+        }
+
+        PooledBuffer buffer;
+        JsonWriter out(buffer.str());
+        writeEventDetails(out, ids, *details);
+
+        const auto format = ResponseFormat::negotiate(req);
+        if (!format.isDefault()) {
+            callback(makeApiResponse(format, nlohmann::json::parse(buffer.str())));
+            return;
+        }
+        auto resp = makeJsonBodyResponse(buffer.str());
+        addVaryAccept(resp);
+        callback(resp);
+    });
 }
 
 void UiApiController::getEventDetail(const HttpRequestPtr& req,
@@ -91,16 +493,89 @@ void UiApiController::getEventDetail(const HttpRequestPtr& req,
                                       const std::string& event_id) {
     spdlog::debug("GET /api/events/{}", event_id);
 
-    auto detail = api_queries::get_event_detail(*db_pool_, event_id);
+    const auto cache_key = ResponseCache::makeKey("/api/events/{event_id}", {{"event_id", event_id}});
+    if (response_cache_) {
+        if (auto hit = response_cache_->get(cache_key)) {
+            callback(response_cache_->respond(req, hit));
+            return;
+        }
+    }
 
-    if (detail.is_null()) {
-        callback(makeJsonResponse(
-            nlohmann::json{{"error", "Event not found"}, {"event_id", event_id}},
-            k404NotFound));
+    runQuery(std::move(callback), [req, event_id, cache_key](const Callback& callback) {
+        auto detail = readQuery([&](DbPool& pool) {
+            return api_queries::get_event_detail(pool, event_id);
+        });
+
+        if (detail.is_null()) {
+            callback(makeJsonResponse(
+                nlohmann::json{{"error", "Event not found"}, {"event_id", event_id}},
+                k404NotFound));
+            return;
+        }
+
+        if (response_cache_) {
+            const auto event = detail.value("event", nlohmann::json::object());
+            auto text = [&](const char* field) {
+                auto it = event.find(field);
+                return it != event.end() && it->is_string() ? it->get<std::string>() : std::string();
+            };
+            // Tagged with the local day, as the recording that invalidates it is named
+            auto camera_id = text("camera_id");
+            auto date = localDateOf(text("started_at"));
+            bool final = isPastDay(date);
+            callback(response_cache_->respond(
+                req, response_cache_->put(cache_key, detail, std::move(camera_id), std::move(date), final)));
+            return;
+        }
+        callback(makeJsonResponse(detail));
+    });
+}
+
+void UiApiController::getEventKeyframes(const HttpRequestPtr& req,
+                                         std::function<void(const HttpResponsePtr&)>&& callback,
+                                         const std::string& event_id) {
+    spdlog::debug("GET /api/events/{}/keyframes", event_id);
+    if (!mp4_index_) {
+        callback(makeJsonResponse(nlohmann::json{{"error", "Keyframe index disabled"}},
+                                  k503ServiceUnavailable));
         return;
     }
 
-    callback(makeJsonResponse(detail));
+    runQuery(std::move(callback), [event_id](const Callback& callback) {
+        auto detail = readQuery([&](DbPool& pool) {
+            return api_queries::get_event_detail(pool, event_id);
+        });
+        if (detail.is_null()) {
+            callback(makeJsonResponse(
+                nlohmann::json{{"error", "Event not found"}, {"event_id", event_id}},
+                k404NotFound));
+            return;
+        }
+        auto filename = recordingFilename(detail.value("event", nlohmann::json::object()));
+        auto index = filename.empty() ? nullptr : mp4_index_->load(filename);
+        if (!index) {
+            callback(makeJsonResponse(
+                nlohmann::json{{"error", "No indexable recording"}, {"event_id", event_id}},
+                k404NotFound));
+            return;
+        }
+
+        // Columnar, like /api/timeline/range: a clip has a keyframe every second or two
+        auto times = nlohmann::json::array();
+        auto offsets = nlohmann::json::array();
+        for (const auto& keyframe : index->keyframes) {
+            times.push_back(std::round(keyframe.time_s * 1000) / 1000);
+            offsets.push_back(index->servedOffset(keyframe.offset));
+        }
+        callback(makeJsonResponse(nlohmann::json{
+            {"event_id", event_id},
+            {"recording", filename},
+            {"duration_s", index->duration_s},
+            {"layout", index->hasVirtualLayout() ? "fast_start_virtual" : "original"},
+            {"t", std::move(times)},
+            {"offset", std::move(offsets)},
+        }));
+    });
 }
 
 void UiApiController::getTimeline(const HttpRequestPtr& req,
@@ -120,125 +595,267 @@ void UiApiController::getTimeline(const HttpRequestPtr& req,
 
     spdlog::debug("GET /api/timeline camera_id={} date={}", *camera_id, date_str);
 
-    auto timeline = api_queries::get_timeline_data(*db_pool_, *camera_id, date_str);
-    callback(makeJsonResponse(timeline));
-}
+    const auto cache_key = ResponseCache::makeKey(
+        "/api/timeline", {{"camera_id", *camera_id}, {"date", date_str}});
+    if (response_cache_) {
+        if (auto hit = response_cache_->get(cache_key)) {
+            callback(response_cache_->respond(req, hit));
+            return;
+        }
+    }
 
-void UiApiController::getCamerasStatus(const HttpRequestPtr& req,
-                                        std::function<void(const HttpResponsePtr&)>&& callback) {
-    spdlog::debug("GET /api/cameras/status");
+    runQuery(std::move(callback), [req, camera_id, date_str, cache_key](const Callback& callback) {
+        auto rollup_date = TimelineRollup::parseDate(date_str);
+        TimelineRollup::Day day{};
+        if (timeline_rollup_ && rollup_date &&
+            timeline_rollup_->visit({*camera_id}, *rollup_date, *rollup_date,
+                                    [&day](size_t, size_t, const TimelineRollup::Day& d) { day = d; })) {
+            constexpr int kSlotsPerHour = 60 / TimelineRollup::kSlotMinutes;
+            nlohmann::json hours = nlohmann::json::array();
+            for (int hour = 0; hour < 24; ++hour) {
+                uint64_t event_count = 0, total_detections = 0;
+                for (int i = hour * kSlotsPerHour; i < (hour + 1) * kSlotsPerHour; ++i) {
+                    event_count += day[i].event_count;
+                    total_detections += day[i].total_detections;
+                }
+                hours.push_back({{"hour", hour}, {"event_count", event_count},
+                                 {"total_detections", total_detections}});
+            }
 
-    const auto& config = ConfigManager::get();
-    auto cameras = api_queries::get_cameras_status(*db_pool_, config.cameras);
-    // Match Python response shape: {"cameras": [...]}
-    callback(makeJsonResponse(nlohmann::json{{"cameras", cameras}}));
+            nlohmann::json body{{"camera_id", *camera_id}, {"date", date_str}, {"hours", hours}};
+            bool final = timeline_rollup_->isFinal(*rollup_date);
+            if (response_cache_) {
+                callback(response_cache_->respond(
+                    req, response_cache_->put(cache_key, body, *camera_id, date_str, final)));
+                return;
+            }
+            callback(makeTimelineResponse(req, body, final));
+            return;
+        }
+
+        auto timeline = readQuery([&](DbPool& pool) {
+            return api_queries::get_timeline_data(pool, *camera_id, date_str);
+        });
+        if (response_cache_) {
+            // An empty result may be a failed query; keep it only briefly
+            bool final = isPastDay(date_str) && !timeline.value("hours", nlohmann::json::array()).empty();
+            callback(response_cache_->respond(
+                req, response_cache_->put(cache_key, timeline, *camera_id, date_str, final)));
+            return;
+        }
+        callback(makeJsonResponse(timeline));
+    });
 }
 
-void UiApiController::getCameraSnapshot(const HttpRequestPtr& req,
-                                         std::function<void(const HttpResponsePtr&)>&& callback,
-                                         const std::string& camera_id) {
-    if (detection_service_url_.empty()) {
+void UiApiController::getTimelineRange(const HttpRequestPtr& req,
+                                        std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto cameras_param = req->getOptionalParameter<std::string>("cameras");
+    auto start_param = req->getOptionalParameter<std::string>("start");
+    auto end_param = req->getOptionalParameter<std::string>("end");
+    auto bucket = req->getOptionalParameter<std::string>("bucket").value_or("1h");
+
+    if (!cameras_param || cameras_param->empty() || !start_param) {
         callback(makeJsonResponse(
-            nlohmann::json{{"error", "Detection service URL not configured"}},
-            k503ServiceUnavailable));
+            nlohmann::json{{"error", "cameras and start parameters are required"}},
+            k400BadRequest));
         return;
     }
 
-    // Parse host and port from detection_service_url (e.g. "http://localhost:8000")
-    std::string url = detection_service_url_;
-    if (url.substr(0, 7) == "http://") url = url.substr(7);
-    std::string host = url;
-    std::string port = "80";
-    auto colon = url.rfind(':');
-    if (colon != std::string::npos) {
-        host = url.substr(0, colon);
-        port = url.substr(colon + 1);
+    auto start = TimelineRollup::parseDate(*start_param);
+    auto end = end_param ? TimelineRollup::parseDate(*end_param) : start;
+    if (!start || !end || *end < *start) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "start and end must be YYYY-MM-DD with start <= end"}},
+            k400BadRequest));
+        return;
     }
 
-    std::string path = "/api/cameras/" + camera_id + "/snapshot";
-    spdlog::debug("Proxying snapshot {} {}:{}{}", camera_id, host, port, path);
-
-    // Simple blocking HTTP GET — runs in Drogon's worker thread pool, not the IO loop
-    struct addrinfo hints{}, *res = nullptr;
-    hints.ai_family   = AF_INET;    // Force IPv4 — avoids ::1 resolution when server is 0.0.0.0
-    hints.ai_socktype = SOCK_STREAM;
-    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
-        spdlog::warn("Snapshot proxy: getaddrinfo failed for {}", host);
-        callback(makeJsonResponse(nlohmann::json{{"error", "Detection service unavailable"}}, k502BadGateway));
+    int bucket_minutes = bucket == "15m" ? 15 : bucket == "1h" ? 60 : bucket == "1d" ? 1440 : 0;
+    if (bucket_minutes == 0) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "bucket must be one of 15m, 1h, 1d"}}, k400BadRequest));
         return;
     }
 
-    int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-    struct timeval tv{4, 0};  // 4s timeout
-    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    const auto days = static_cast<size_t>((*end - *start).count()) + 1;
+    const size_t max_days = bucket_minutes == 15 ? 31 : 366;
+    if (days > max_days) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Range too long for bucket " + bucket + " (max " +
+                                         std::to_string(max_days) + " days)"}},
+            k400BadRequest));
+        return;
+    }
 
-    if (fd < 0 || ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
-        freeaddrinfo(res);
-        if (fd >= 0) ::close(fd);
-        spdlog::warn("Snapshot proxy: connect failed for {}:{}", host, port);
-        callback(makeJsonResponse(nlohmann::json{{"error", "Detection service unavailable"}}, k502BadGateway));
+    std::vector<std::string> cameras;
+    {
+        std::unordered_set<std::string> seen;
+        std::istringstream iss(*cameras_param);
+        std::string cam;
+        while (std::getline(iss, cam, ',')) {
+            if (!cam.empty() && seen.insert(cam).second) cameras.push_back(cam);
+        }
+    }
+    if (cameras.size() > kMaxRangeCameras) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Too many cameras"}, {"max", kMaxRangeCameras}}, k400BadRequest));
         return;
     }
-    freeaddrinfo(res);
 
-    // Send HTTP/1.0 request (no keep-alive, server closes after response)
-    std::string request = "GET " + path + " HTTP/1.0\r\n"
-                          "Host: " + host + "\r\n"
-                          "Connection: close\r\n\r\n";
-    ::send(fd, request.c_str(), request.size(), 0);
+    spdlog::debug("GET /api/timeline/range cameras={} start={} end={} bucket={}",
+                  *cameras_param, TimelineRollup::formatDate(*start),
+                  TimelineRollup::formatDate(*end), bucket);
+
+    runQuery(std::move(callback), [req, start, end, days, bucket, bucket_minutes,
+                                   cameras = std::move(cameras)](const Callback& callback) {
+        TimelineBuckets buckets(cameras.size(), days, bucket_minutes);
+
+        bool final_days = false;
+        if (timeline_rollup_ &&
+            timeline_rollup_->visit(cameras, *start, *end,
+                                    [&buckets](size_t c, size_t d, const TimelineRollup::Day& day) {
+                buckets.add(c, d, day);
+            })) {
+            final_days = timeline_rollup_->isFinal(*end);
+        } else {
+            // No rollup: the same aggregate as one set-based query over the whole range
+            auto rows = readQuery([&](DbPool& pool) {
+                return timeline_queries::load_rollup(pool, TimelineRollup::formatDate(*start),
+                                                     TimelineRollup::formatDate(*end), cameras);
+            });
+            if (!rows) {
+                callback(makeJsonResponse(
+                    nlohmann::json{{"error", "Database unavailable"}}, k503ServiceUnavailable));
+                return;
+            }
+            buckets.add(*rows, cameras, *start);
+        }
 
-    // Read full response
-    std::string raw;
-    raw.reserve(128 * 1024);
-    char buf[8192];
-    ssize_t n;
-    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
-        raw.append(buf, n);
-    }
-    ::close(fd);
+        // Columnar: bucket i of every row starts at start + i * bucket_minutes
+        callback(makeTimelineResponse(req, nlohmann::json{
+            {"start", TimelineRollup::formatDate(*start)},
+            {"end", TimelineRollup::formatDate(*end)},
+            {"bucket", bucket},
+            {"bucket_minutes", bucket_minutes},
+            {"bucket_count", buckets.bucketCount()},
+            {"cameras", cameras},
+            {"event_count", buckets.eventCount()},
+            {"total_detections", buckets.totalDetections()},
+        }, final_days));
+    });
+}
 
-    if (raw.empty()) {
-        spdlog::warn("Snapshot proxy: empty response from detection service");
-        callback(makeJsonResponse(nlohmann::json{{"error", "Empty response from detection service"}}, k502BadGateway));
-        return;
+void UiApiController::getCamerasStatus(const HttpRequestPtr& req,
+                                        std::function<void(const HttpResponsePtr&)>&& callback) {
+    spdlog::debug("GET /api/cameras/status");
+
+    runQuery(std::move(callback), [](const Callback& callback) {
+        const auto& config = ConfigManager::get();
+        auto cameras = readQuery([&](DbPool& pool) {
+            return api_queries::get_cameras_status(pool, config.cameras);
+        });
+        // Match Python response shape: {"cameras": [...]}
+        callback(makeJsonResponse(nlohmann::json{{"cameras", cameras}}));
+    });
+}
+
+/// Map a failed detection-service request to the client-facing error response
+static HttpResponsePtr proxyErrorResponse(DetectionClient::Result result) {
+    switch (result) {
+    case DetectionClient::Result::Rejected:
+        return makeJsonResponse(nlohmann::json{{"error", "Detection service busy"}},
+                                k503ServiceUnavailable);
+    case DetectionClient::Result::Timeout:
+        return makeJsonResponse(nlohmann::json{{"error", "Detection service timed out"}},
+                                k504GatewayTimeout);
+    default:
+        return makeJsonResponse(nlohmann::json{{"error", "Detection service unavailable"}},
+                                k502BadGateway);
     }
+}
 
-    // Split HTTP headers from body
-    auto header_end = raw.find("\r\n\r\n");
-    if (header_end == std::string::npos) {
-        callback(makeJsonResponse(nlohmann::json{{"error", "Malformed HTTP response"}}, k502BadGateway));
+void UiApiController::getCameraSnapshot(const HttpRequestPtr& req,
+                                         std::function<void(const HttpResponsePtr&)>&& callback,
+                                         const std::string& camera_id) {
+    if (!snapshot_cache_) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Detection service URL not configured"}},
+            k503ServiceUnavailable));
         return;
     }
 
-    std::string headers = raw.substr(0, header_end);
-    std::string body    = raw.substr(header_end + 4);
+    spdlog::debug("GET /api/cameras/{}/snapshot", camera_id);
 
-    // Parse status code from first line
-    int status_code = 502;
-    if (headers.size() >= 12) {
-        try { status_code = std::stoi(headers.substr(9, 3)); } catch (...) {}
-    }
+    // Served from the per-camera cache; concurrent misses share one upstream fetch
+    snapshot_cache_->get(
+        camera_id,
+        [req, callback = std::move(callback)](DetectionClient::Result result,
+                                              const SnapshotCache::SnapshotPtr& snap) {
+            if (result != DetectionClient::Result::Ok) {
+                callback(proxyErrorResponse(result));
+                return;
+            }
 
-    auto resp = HttpResponse::newHttpResponse();
-    resp->setStatusCode(static_cast<HttpStatusCode>(status_code));
-    resp->setBody(std::move(body));
+            if (!snap->etag.empty() && isNotModified(req, snap->etag, snap->last_modified)) {
+                callback(makeNotModifiedResponse(snap->etag, snap->last_modified));
+                return;
+            }
 
-    // Extract Content-Type header
-    auto ct_pos = headers.find("Content-Type:");
-    if (ct_pos != std::string::npos) {
-        auto ct_end = headers.find("\r\n", ct_pos);
-        std::string ct = headers.substr(ct_pos + 13, ct_end - ct_pos - 13);
-        // trim leading space
-        auto first = ct.find_first_not_of(' ');
-        if (first != std::string::npos) ct = ct.substr(first);
-        resp->addHeader("Content-Type", ct);
-    } else {
-        resp->setContentTypeCode(CT_IMAGE_JPG);
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(snap->status);
+            resp->setContentTypeString(snap->content_type);
+            resp->setBody(snap->body);
+            if (!snap->etag.empty()) {
+                resp->addHeader("ETag", snap->etag);
+                resp->addHeader("Last-Modified", snap->last_modified);
+                resp->addHeader("Cache-Control", "no-cache");
+            }
+            callback(resp);
+        });
+}
+
+void UiApiController::getCameraStream(const HttpRequestPtr& req,
+                                       std::function<void(const HttpResponsePtr&)>&& callback,
+                                       const std::string& camera_id) {
+    if (!live_stream_hub_ || !snapshot_cache_) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Detection service URL not configured"}},
+            k503ServiceUnavailable));
+        return;
     }
 
-    spdlog::debug("Snapshot proxy: {} bytes for {}", body.size(), camera_id);
-    callback(resp);
+    spdlog::debug("GET /api/cameras/{}/stream", camera_id);
+
+    // Only cameras the detection service serves get a reader: the first
+    // snapshot (usually cached) answers unknown ids before the stream opens
+    auto hub = live_stream_hub_;
+    snapshot_cache_->get(
+        camera_id,
+        [hub, camera_id, conn = req->getConnectionPtr(), callback = std::move(callback)](
+            DetectionClient::Result result, const SnapshotCache::SnapshotPtr& snap) {
+            if (result != DetectionClient::Result::Ok) {
+                callback(proxyErrorResponse(result));
+                return;
+            }
+            if (snap->status != k200OK) {
+                auto resp = HttpResponse::newHttpResponse();
+                resp->setStatusCode(snap->status);
+                resp->setContentTypeString(snap->content_type);
+                resp->setBody(snap->body);
+                callback(resp);
+                return;
+            }
+
+            // The connection stays open; the hub pushes each new frame as a multipart part
+            auto resp = HttpResponse::newAsyncStreamResponse(
+                [hub, camera_id, conn](ResponseStreamPtr stream) {
+                    hub->subscribe(camera_id, std::move(stream), conn);
+                });
+            resp->setContentTypeString(std::string("multipart/x-mixed-replace; boundary=") +
+                                       LiveStreamHub::kBoundary);
+            resp->addHeader("Cache-Control", "no-cache, no-store");
+            callback(resp);
+        });
 }
 
 void UiApiController::searchEvents(const HttpRequestPtr& req,
@@ -279,65 +896,153 @@ void UiApiController::searchEvents(const HttpRequestPtr& req,
 
     spdlog::debug("GET /api/search q='{}' mode={} limit={}", params.query, params.mode, params.limit);
 
-    // Try FTS first
-    if (params.mode == "fts" || params.mode == "auto") {
-        auto fts_result = api_queries::search_events_fts(*db_pool_, params);
-        int count = fts_result.value("count", 0);
-
-        // If auto mode and FTS returned enough results, return them
-        if (params.mode == "fts" || count >= 3) {
-            callback(makeJsonResponse(fts_result));
-            return;
-        }
-
-        // Auto mode with <3 FTS results: try semantic search
-        if (!ollama_url_.empty()) {
-            hms::EmbeddingClient emb_client(ollama_url_, "nomic-embed-text");
-            auto query_embedding = emb_client.embed(params.query);
-
-            if (!query_embedding.empty()) {
-                auto sem_result = api_queries::search_events_semantic(
-                    *db_pool_, params, query_embedding);
-                int sem_count = sem_result.value("count", 0);
-
-                if (sem_count > count) {
-                    callback(makeJsonResponse(sem_result));
-                    return;
-                }
-            }
-        }
+    const auto format = ResponseFormat::negotiate(req);
+    if (params.mode == "hybrid") {
+        hybridSearch(params, format, std::move(callback));
+        return;
+    }
 
-        // Return whatever FTS gave us
-        callback(makeJsonResponse(fts_result));
+    if (params.mode != "fts" && params.mode != "auto" &&
+        params.mode != "semantic" && params.mode != "semantic_exact") {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Invalid mode: " + params.mode}}, k400BadRequest));
+        return;
+    }
+    // Only the in-process index can rank every row; pgvector would answer
+    // from its approximate index under the same name
+    if (params.mode == "semantic_exact" && !semantic_index_) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "semantic_exact requires the semantic index (timeline.semantic_index)"}},
+            k503ServiceUnavailable));
         return;
     }
 
-    // Semantic-only mode
-    if (params.mode == "semantic") {
-        if (ollama_url_.empty()) {
+    // Semantic-only mode; semantic_exact scores every stored embedding
+    if (params.mode == "semantic" || params.mode == "semantic_exact") {
+        if (!embedding_client_) {
             callback(makeJsonResponse(
                 nlohmann::json{{"error", "Ollama URL not configured for semantic search"}},
                 k503ServiceUnavailable));
             return;
         }
+        bool queued = withQueryEmbedding(params.query, callback,
+            [params, format](const Callback& callback, const std::vector<float>& query_embedding) {
+                if (query_embedding.empty()) {
+                    callback(makeJsonResponse(
+                        nlohmann::json{{"error", "Failed to generate query embedding"}},
+                        k503ServiceUnavailable));
+                    return;
+                }
+                auto result = semanticSearch(params, query_embedding, params.mode == "semantic_exact");
+                callback(makeApiResponse(format, std::move(result)));
+            });
+        if (!queued) {
+            auto resp = makeJsonResponse(nlohmann::json{{"error", "Search busy"}}, k503ServiceUnavailable);
+            resp->addHeader("Retry-After", "1");
+            callback(resp);
+        }
+        return;
+    }
 
-        hms::EmbeddingClient emb_client(ollama_url_, "nomic-embed-text");
-        auto query_embedding = emb_client.embed(params.query);
+    // FTS first
+    runQuery(std::move(callback), [params, format](const Callback& callback) {
+        auto fts_result = readQuery([&](DbPool& pool) {
+            return api_queries::search_events_fts(pool, params);
+        });
+        int count = fts_result.value("count", 0);
 
-        if (query_embedding.empty()) {
-            callback(makeJsonResponse(
-                nlohmann::json{{"error", "Failed to generate query embedding"}},
-                k503ServiceUnavailable));
+        // If auto mode and FTS returned enough results, return them
+        if (params.mode == "fts" || count >= 3 || !embedding_client_) {
+            callback(makeApiResponse(format, std::move(fts_result)));
             return;
         }
 
-        auto result = api_queries::search_events_semantic(*db_pool_, params, query_embedding);
-        callback(makeJsonResponse(result));
+        // Auto mode with <3 FTS results: try semantic search, keeping
+        // whatever FTS gave us if that fails, finds less, or cannot be queued
+        auto fts = std::make_shared<nlohmann::json>(std::move(fts_result));
+        bool queued = withQueryEmbedding(params.query, callback,
+            [params, format, fts, count](const Callback& callback,
+                                         const std::vector<float>& query_embedding) {
+                if (!query_embedding.empty()) {
+                    auto sem_result = semanticSearch(params, query_embedding);
+                    if (sem_result.value("count", 0) > count) {
+                        callback(makeApiResponse(format, std::move(sem_result)));
+                        return;
+                    }
+                }
+                callback(makeApiResponse(format, std::move(*fts)));
+            });
+        if (!queued) callback(makeApiResponse(format, std::move(*fts)));
+    });
+}
+
+void UiApiController::hybridSearch(const api_queries::SearchParams& params,
+                                   const ResponseFormat& format,
+                                   std::function<void(const HttpResponsePtr&)>&& callback) {
+    auto state = std::make_shared<HybridState>();
+    state->params = params;
+    state->format = format;
+    state->rrf_k = hybrid_rrf_k_;
+    state->semantic_expected = embedding_client_ != nullptr;
+
+    auto fts_leg = [state] {
+        try {
+            auto result = readQuery([&](DbPool& pool) {
+                return api_queries::search_events_fts(pool, state->params);
+            });
+            std::lock_guard lock(state->mutex);
+            state->fts = std::move(result);
+        } catch (const std::exception& e) {
+            spdlog::error("Hybrid search FTS leg failed: {}", e.what());
+        }
+        completeLeg(state);
+    };
+
+    if (searchWorkers().getTaskCount() >= kMaxQueuedSearchLegs) {
+        // Workers backed up: answer from FTS alone (reported as partial), queued
+        // on the bounded DbExecutor, which answers 503 once it is full as well
+        state->pending = 1;
+        runQuery(std::move(callback), [state, fts_leg](const Callback& callback) {
+            {
+                std::lock_guard lock(state->mutex);
+                state->callback = callback;
+            }
+            fts_leg();
+        });
         return;
     }
 
-    callback(makeJsonResponse(
-        nlohmann::json{{"error", "Invalid mode: " + params.mode}}, k400BadRequest));
+    state->callback = std::move(callback);
+    state->pending = state->semantic_expected ? 2 : 1;
+
+    // The handler may run off an event loop (e.g. after a filter hops threads),
+    // so the budget always runs on the main loop
+    drogon::app().getLoop()->runAfter(std::chrono::duration<double>(hybrid_budget_).count(),
+                                      [state] { finishHybrid(state); });
+
+    searchWorkers().runTaskInQueue(std::move(fts_leg));
+
+    if (state->semantic_expected) {
+        searchWorkers().runTaskInQueue([state] {
+            try {
+                auto embedding = embedding_client_->embed(state->params.query);
+                bool expired;
+                {
+                    std::lock_guard lock(state->mutex);
+                    expired = state->done;
+                }
+                // Skip retrieval when Ollama alone used up the budget
+                if (!embedding.empty() && !expired) {
+                    auto result = semanticSearch(state->params, embedding);
+                    std::lock_guard lock(state->mutex);
+                    state->semantic = std::move(result);
+                }
+            } catch (const std::exception& e) {
+                spdlog::error("Hybrid search semantic leg failed: {}", e.what());
+            }
+            completeLeg(state);
+        });
+    }
 }
 
 void UiApiController::getPeriodicSnapshots(const HttpRequestPtr& req,
@@ -355,121 +1060,210 @@ void UiApiController::getPeriodicSnapshots(const HttpRequestPtr& req,
 
     spdlog::debug("GET /api/snapshots camera_id={} date={}", *camera_id, date_str);
 
-    auto snapshots = api_queries::get_periodic_snapshots(*db_pool_, *camera_id, date_str);
-    callback(makeJsonResponse(nlohmann::json{{"snapshots", snapshots}, {"count", static_cast<int>(snapshots.size())}}));
-}
-
-/// Helper: proxy an HTTP request to the detection service, return raw response body + status
-static std::pair<int, std::string> proxyToDetection(
-    const std::string& detection_service_url,
-    const std::string& method,
-    const std::string& path,
-    const std::string& body = "")
-{
-    std::string url = detection_service_url;
-    if (url.substr(0, 7) == "http://") url = url.substr(7);
-    std::string host = url, port = "80";
-    auto colon = url.rfind(':');
-    if (colon != std::string::npos) {
-        host = url.substr(0, colon);
-        port = url.substr(colon + 1);
+    // Only the JSON form is cached; other representations are encoded per request
+    const auto format = ResponseFormat::negotiate(req);
+    if (!format.isDefault()) {
+        runQuery(std::move(callback), [camera_id, date_str, format](const Callback& callback) {
+            auto snapshots = readQuery([&](DbPool& pool) {
+                return api_queries::get_periodic_snapshots(pool, *camera_id, date_str);
+            });
+            const auto count = snapshots.size();
+            callback(makeApiResponse(format, {{"snapshots", std::move(snapshots)}, {"count", count}}));
+        });
+        return;
     }
 
-    struct addrinfo hints{}, *res = nullptr;
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
-        return {502, R"({"error":"Detection service unavailable"})"};
+    const auto cache_key = ResponseCache::makeKey(
+        "/api/snapshots", {{"camera_id", *camera_id}, {"date", date_str}});
+    if (response_cache_) {
+        if (auto hit = response_cache_->get(cache_key)) {
+            auto resp = response_cache_->respond(req, hit);
+            addVaryAccept(resp);
+            callback(resp);
+            return;
+        }
     }
 
-    int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-    struct timeval tv{4, 0};
-    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    runQuery(std::move(callback), [req, camera_id, date_str, cache_key](const Callback& callback) {
+        // Written around the rows' DOM rather than copying it into a wrapper object
+        auto snapshots = readQuery([&](DbPool& pool) {
+            return api_queries::get_periodic_snapshots(pool, *camera_id, date_str);
+        });
+        PooledBuffer buffer;
+        JsonWriter(buffer.str())
+            .beginObject()
+            .key("snapshots").value(snapshots)
+            .key("count").value(static_cast<int64_t>(snapshots.size()))
+            .endObject();
+        if (response_cache_) {
+            // An empty result may be a failed query; keep it only briefly
+            bool final = isPastDay(date_str) && !snapshots.empty();
+            auto resp = response_cache_->respond(
+                req, response_cache_->putSerialized(cache_key, std::string(buffer.str()), *camera_id,
+                                                    date_str, final));
+            addVaryAccept(resp);
+            callback(resp);
+            return;
+        }
+        auto resp = makeJsonBodyResponse(buffer.str());
+        addVaryAccept(resp);
+        callback(resp);
+    });
+}
 
-    if (fd < 0 || ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
-        freeaddrinfo(res);
-        if (fd >= 0) ::close(fd);
-        return {502, R"({"error":"Detection service unavailable"})"};
+void UiApiController::withSpriteSheet(
+    const HttpRequestPtr& req, const std::string& camera_id, Callback&& callback,
+    std::function<void(const Callback&, const std::string&, const SpriteSheets::SheetPtr&)>&& done) {
+    auto date = req->getOptionalParameter<std::string>("date");
+    if (!date || !TimelineRollup::parseDate(*date)) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "date parameter must be YYYY-MM-DD"}}, k400BadRequest));
+        return;
     }
-    freeaddrinfo(res);
-
-    std::string request = method + " " + path + " HTTP/1.0\r\n"
-                          "Host: " + host + "\r\n"
-                          "Content-Type: application/json\r\n";
-    if (!body.empty()) {
-        request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    if (!sprite_sheets_) {
+        callback(makeJsonResponse(
+            nlohmann::json{{"error", "Sprite sheets are disabled"}}, k503ServiceUnavailable));
+        return;
     }
-    request += "Connection: close\r\n\r\n";
-    if (!body.empty()) request += body;
 
-    ::send(fd, request.c_str(), request.size(), 0);
+    // Cheap indexed query; the sheet itself is only rebuilt when this list changes
+    runQuery(std::move(callback), [camera_id, date = *date,
+                                   done = std::move(done)](const Callback& callback) mutable {
+        auto snapshots = readQuery([&](DbPool& pool) -> std::optional<nlohmann::json> {
+            auto rows = api_queries::get_periodic_snapshots(pool, camera_id, date);
+            // A failed query comes back empty too; it is an empty day only
+            // if the database still answers
+            if (rows.empty() && !timeline_queries::current_date(pool)) return std::nullopt;
+            return rows;
+        });
+        if (!snapshots) {
+            callback(makeJsonResponse(
+                nlohmann::json{{"error", "Database unavailable"}}, k503ServiceUnavailable));
+            return;
+        }
+        sprite_sheets_->get(camera_id, date, *snapshots,
+            [callback, date, done = std::move(done)](const SpriteSheets::SheetPtr& sheet) {
+                if (!sheet) {
+                    callback(makeJsonResponse(
+                        nlohmann::json{{"error", "No snapshots for this camera and date"}}, k404NotFound));
+                    return;
+                }
+                done(callback, date, sheet);
+            });
+    });
+}
 
-    std::string raw;
-    raw.reserve(4096);
-    char buf[4096];
-    ssize_t n;
-    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
-        raw.append(buf, n);
-    }
-    ::close(fd);
+void UiApiController::getSpriteSheet(const HttpRequestPtr& req,
+                                     std::function<void(const HttpResponsePtr&)>&& callback,
+                                     const std::string& camera_id) {
+    spdlog::debug("GET /api/cameras/{}/sprites", camera_id);
+    withSpriteSheet(req, camera_id, std::move(callback),
+        [camera_id](const Callback& callback, const std::string& date, const SpriteSheets::SheetPtr& sheet) {
+            const auto& options = sprite_sheets_->options();
+            callback(makeJsonResponse(nlohmann::json{
+                {"camera_id", camera_id},
+                {"date", date},
+                {"version", sheet->version},
+                // Relative, like every other UI URL, so it resolves under HA ingress
+                {"image_url", "api/cameras/" + camera_id + "/sprites/image?date=" + date +
+                              "&v=" + sheet->version},
+                {"tile_width", options.tile_width},
+                {"tile_height", options.tile_height},
+                {"columns", sheet->columns},
+                {"rows", sheet->rows},
+                {"count", sheet->tiles.size()},
+                {"tiles", sheet->tiles},
+            }));
+        });
+}
 
-    if (raw.empty()) return {502, R"({"error":"Empty response from detection service"})"};
+/// Contact sheet JPEG; a versioned URL never changes content, so it is immutable
+static HttpResponsePtr spriteImageResponse(const HttpRequestPtr& req,
+                                           const SpriteSheets::SheetPtr& sheet,
+                                           bool versioned) {
+    const char* cache_control = versioned ? "public, max-age=31536000, immutable" : "no-cache";
+    if (isNotModified(req, sheet->etag, {})) {
+        auto resp = makeNotModifiedResponse(sheet->etag, {});
+        resp->addHeader("Cache-Control", cache_control);
+        return resp;
+    }
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setContentTypeString("image/jpeg");
+    resp->setBody(sheet->jpeg);
+    resp->addHeader("ETag", sheet->etag);
+    resp->addHeader("Cache-Control", cache_control);
+    return resp;
+}
 
-    auto header_end = raw.find("\r\n\r\n");
-    if (header_end == std::string::npos) return {502, R"({"error":"Malformed response"})"};
+void UiApiController::getSpriteImage(const HttpRequestPtr& req,
+                                     std::function<void(const HttpResponsePtr&)>&& callback,
+                                     const std::string& camera_id) {
+    spdlog::debug("GET /api/cameras/{}/sprites/image", camera_id);
+    auto version = req->getOptionalParameter<std::string>("v").value_or("");
+    auto date = req->getOptionalParameter<std::string>("date");
+    if (sprite_sheets_ && date && !version.empty()) {
+        // The map request just built it: skip the database
+        if (auto sheet = sprite_sheets_->find(camera_id, *date); sheet && sheet->version == version) {
+            callback(spriteImageResponse(req, sheet, true));
+            return;
+        }
+    }
 
-    std::string headers = raw.substr(0, header_end);
-    std::string resp_body = raw.substr(header_end + 4);
+    withSpriteSheet(req, camera_id, std::move(callback),
+        [req, version](const Callback& callback, const std::string&, const SpriteSheets::SheetPtr& sheet) {
+            callback(spriteImageResponse(req, sheet, sheet->version == version));
+        });
+}
 
-    int status_code = 502;
-    if (headers.size() >= 12) {
-        try { status_code = std::stoi(headers.substr(9, 3)); } catch (...) {}
+/// Forward a detection-service JSON response (status + body) to the client
+static void forwardJson(const std::function<void(const HttpResponsePtr&)>& callback,
+                        DetectionClient::Result result,
+                        const HttpResponsePtr& upstream) {
+    if (result != DetectionClient::Result::Ok) {
+        callback(proxyErrorResponse(result));
+        return;
     }
-
-    return {status_code, resp_body};
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(upstream->statusCode());
+    resp->setContentTypeCode(CT_APPLICATION_JSON);
+    resp->setBody(std::string(upstream->body()));
+    callback(resp);
 }
 
 void UiApiController::getCameraPaused(const HttpRequestPtr& req,
                                        std::function<void(const HttpResponsePtr&)>&& callback,
                                        const std::string& camera_id) {
-    if (detection_service_url_.empty()) {
+    if (!detection_client_) {
         callback(makeJsonResponse(
             nlohmann::json{{"error", "Detection service URL not configured"}},
             k503ServiceUnavailable));
         return;
     }
 
-    auto [status, body] = proxyToDetection(
-        detection_service_url_, "GET", "/api/cameras/" + camera_id + "/paused");
-
-    auto resp = HttpResponse::newHttpResponse();
-    resp->setStatusCode(static_cast<HttpStatusCode>(status));
-    resp->setContentTypeCode(CT_APPLICATION_JSON);
-    resp->setBody(std::move(body));
-    callback(resp);
+    detection_client_->request(
+        Get, "/api/cameras/" + camera_id + "/paused", {},
+        [callback = std::move(callback)](DetectionClient::Result result,
+                                         const HttpResponsePtr& upstream) {
+            forwardJson(callback, result, upstream);
+        });
 }
 
 void UiApiController::setCameraPaused(const HttpRequestPtr& req,
                                        std::function<void(const HttpResponsePtr&)>&& callback,
                                        const std::string& camera_id) {
-    if (detection_service_url_.empty()) {
+    if (!detection_client_) {
         callback(makeJsonResponse(
             nlohmann::json{{"error", "Detection service URL not configured"}},
             k503ServiceUnavailable));
         return;
     }
 
-    auto [status, body] = proxyToDetection(
-        detection_service_url_, "POST",
-        "/api/cameras/" + camera_id + "/paused",
-        std::string(req->body()));
-
-    auto resp = HttpResponse::newHttpResponse();
-    resp->setStatusCode(static_cast<HttpStatusCode>(status));
-    resp->setContentTypeCode(CT_APPLICATION_JSON);
-    resp->setBody(std::move(body));
-    callback(resp);
+    detection_client_->request(
+        Post, "/api/cameras/" + camera_id + "/paused", std::string(req->body()),
+        [callback = std::move(callback)](DetectionClient::Result result,
+                                         const HttpResponsePtr& upstream) {
+            forwardJson(callback, result, upstream);
+        });
 }
 
 void UiApiController::getHealth(const HttpRequestPtr& req,
@@ -486,9 +1280,222 @@ void UiApiController::getHealth(const HttpRequestPtr& req,
             {"available_connections", stats.available_connections},
             {"in_use_connections", stats.in_use_connections},
         };
+        if (timeline_queries::prepared_statements_enabled()) {
+            auto prepared = timeline_queries::prepared_statement_stats();
+            health["database"]["prepared_statements"] = {
+                {"sessions", prepared.sessions},
+                {"checkouts", prepared.checkouts},
+                {"prepares", prepared.prepares},
+                {"resets", prepared.resets},
+            };
+        }
+        if (db_router_) {
+            auto routing = db_router_->stats();
+            auto replicas = nlohmann::json::array();
+            for (const auto& replica : routing.replicas) {
+                replicas.push_back({
+                    {"host", replica.host},
+                    {"port", replica.port},
+                    {"connected", replica.connected},
+                    {"healthy", replica.healthy},
+                    {"lag_seconds", replica.lag_seconds},
+                    {"lag_bytes", replica.lag_bytes},
+                    {"reads", replica.reads},
+                    {"failed_checks", replica.failed_checks},
+                    {"failed_reads", replica.failed_reads},
+                    {"last_error", replica.last_error},
+                });
+            }
+            health["database"]["routing"] = {
+                {"primary_reads", routing.primary_reads},
+                {"replica_reads", routing.replica_reads},
+                {"fallbacks", routing.fallbacks},
+                {"retries", routing.retries},
+                {"replicas", std::move(replicas)},
+            };
+        }
+    }
+
+    if (db_executor_) {
+        auto executor = db_executor_->stats();
+        health["db_executor"] = {
+            {"queued", executor.queued},
+            {"running", executor.running},
+            {"submitted", executor.submitted},
+            {"rejected", executor.rejected},
+            {"completed", executor.completed},
+            {"avg_wait_ms", executor.avg_wait_ms},
+            {"max_wait_ms", executor.max_wait_ms},
+            {"avg_run_ms", executor.avg_run_ms},
+        };
+    }
+
+    if (detection_client_) {
+        auto proxy = detection_client_->stats();
+        health["detection_proxy"] = {
+            {"requests", proxy.requests},
+            {"errors", proxy.errors},
+            {"timeouts", proxy.timeouts},
+            {"rejected", proxy.rejected},
+            {"in_flight", proxy.in_flight},
+            {"avg_latency_ms", proxy.avg_latency_ms},
+            {"max_latency_ms", proxy.max_latency_ms},
+        };
+    }
+
+    if (snapshot_cache_) {
+        auto cache = snapshot_cache_->stats();
+        health["snapshot_cache"] = {
+            {"hits", cache.hits},
+            {"fetches", cache.fetches},
+            {"coalesced", cache.coalesced},
+            {"cameras", cache.cameras},
+        };
+    }
+
+    if (embedding_client_) {
+        auto emb = embedding_client_->stats();
+        health["embeddings"] = {
+            {"requests", emb.requests},
+            {"cache_hits", emb.cache_hits},
+            {"cache_misses", emb.cache_misses},
+            {"hit_rate", emb.hit_rate},
+            {"batches", emb.batches},
+            {"batched_inputs", emb.batched_inputs},
+            {"errors", emb.errors},
+            {"avg_latency_ms", emb.avg_latency_ms},
+        };
+    }
+
+    if (live_stream_hub_) {
+        auto streams = live_stream_hub_->stats();
+        health["live_streams"] = {
+            {"channels", streams.channels},
+            {"subscribers", streams.subscribers},
+            {"frames_published", streams.frames_published},
+            {"frames_sent", streams.frames_sent},
+            {"frames_dropped", streams.frames_dropped},
+        };
+    }
+
+    if (event_feed_) {
+        auto feed = event_feed_->stats();
+        health["event_stream"] = {
+            {"subscribers", feed.subscribers},
+            {"polls", feed.polls},
+            {"poll_errors", feed.poll_errors},
+            {"messages_published", feed.messages_published},
+            {"messages_sent", feed.messages_sent},
+            {"replayed", feed.replayed},
+            {"resyncs", feed.resyncs},
+            {"slow_disconnects", feed.slow_disconnects},
+        };
+    }
+
+    if (recording_index_) {
+        health["recording_index"] = {
+            {"live", recording_index_->isLive()},
+            {"files", recording_index_->size()},
+        };
+    }
+
+    if (response_cache_) {
+        auto cache = response_cache_->stats();
+        health["response_cache"] = {
+            {"entries", cache.entries},
+            {"bytes", cache.bytes},
+            {"hits", cache.hits},
+            {"misses", cache.misses},
+            {"not_modified", cache.not_modified},
+            {"invalidated", cache.invalidated},
+        };
+    }
+
+    if (sprite_sheets_) {
+        auto sprites = sprite_sheets_->stats();
+        health["sprite_sheets"] = {
+            {"sheet_hits", sprites.sheet_hits},
+            {"sheets_built", sprites.sheets_built},
+            {"hours_built", sprites.hours_built},
+            {"tiles_decoded", sprites.tiles_decoded},
+            {"coalesced", sprites.coalesced},
+            {"tile_bytes", sprites.tile_bytes},
+        };
+    }
+
+    if (mp4_index_) {
+        auto mp4 = mp4_index_->stats();
+        health["mp4_index"] = {
+            {"entries", mp4.entries},
+            {"bytes", mp4.bytes},
+            {"pending", mp4.pending},
+            {"hits", mp4.hits},
+            {"misses", mp4.misses},
+            {"parsed", mp4.parsed},
+            {"incomplete", mp4.incomplete},
+            {"invalid", mp4.invalid},
+            {"virtual_layouts", mp4.virtual_layouts},
+        };
+    }
+
+    if (timeline_rollup_) {
+        auto rollup = timeline_rollup_->stats();
+        health["timeline_rollup"] = {
+            {"live", rollup.live},
+            {"days", rollup.days},
+            {"loads", rollup.loads},
+            {"evictions", rollup.evictions},
+            {"refreshes", rollup.refreshes},
+        };
+    }
+
+    if (semantic_index_) {
+        auto index = semantic_index_->stats();
+        health["semantic_index"] = {
+            {"ready", index.ready},
+            {"vectors", index.vectors},
+            {"tombstones", index.tombstones},
+            {"searches", index.searches},
+            {"exact_scans", index.exact_scans},
+            {"fallbacks", index.fallbacks},
+            {"exact_storage", VectorMatrix::storageName(semantic_index_->options().exact_storage)},
+            {"matrix_bytes", index.matrix_bytes},
+            {"simd", simd::isaName(simd::activeIsa())},
+        };
     }
 
     callback(makeJsonResponse(health));
 }
 
+void UiApiController::getMetrics(const HttpRequestPtr& /*req*/,
+                                  std::function<void(const HttpResponsePtr&)>&& callback) {
+    std::string body;
+    body.reserve(64 * 1024);
+    Metrics::global().render(body);
+
+    // Sampled now rather than recorded, like /health
+    if (db_pool_) {
+        auto stats = db_pool_->stats();
+        Metrics::appendGauge(body, "hms_db_pool_connections_in_use", "Primary pool connections checked out",
+                             static_cast<double>(stats.in_use_connections));
+        Metrics::appendGauge(body, "hms_db_pool_connections_available", "Primary pool connections idle",
+                             static_cast<double>(stats.available_connections));
+    }
+    if (db_executor_) {
+        auto stats = db_executor_->stats();
+        Metrics::appendGauge(body, "hms_db_executor_queued", "Jobs waiting for a DB executor thread",
+                             static_cast<double>(stats.queued));
+        Metrics::appendGauge(body, "hms_db_executor_running", "Jobs running on the DB executor",
+                             static_cast<double>(stats.running));
+        Metrics::appendCounter(body, "hms_db_executor_rejected_total", "Jobs refused because the queue was full",
+                               static_cast<double>(stats.rejected));
+    }
+
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+    resp->addHeader("Cache-Control", "no-store");
+    resp->setBody(std::move(body));
+    callback(resp);
+}
+
 } // namespace hms
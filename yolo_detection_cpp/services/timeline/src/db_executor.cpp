@@ -0,0 +1,114 @@
+#include "db_executor.h"
+#include "metrics.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace hms {
+
+DbExecutor::DbExecutor(Options options) : options_(options) {
+    const size_t count = std::max<size_t>(options_.threads, 1);
+    threads_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        threads_.emplace_back([this] { run(); });
+    }
+}
+
+DbExecutor::~DbExecutor() {
+    stop();
+}
+
+bool DbExecutor::submit(std::function<void()> job, std::function<void()> on_error) {
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_ || queue_.size() >= options_.max_queue) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.push_back(Job{std::move(job), std::move(on_error), std::chrono::steady_clock::now()});
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    cv_.notify_one();
+    return true;
+}
+
+void DbExecutor::stop() {
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+void DbExecutor::run() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;    // stopping, and everything queued has run
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        auto wait_us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(started - job.enqueued).count());
+        total_wait_us_.fetch_add(wait_us, std::memory_order_relaxed);
+        auto prev = max_wait_us_.load(std::memory_order_relaxed);
+        while (wait_us > prev &&
+               !max_wait_us_.compare_exchange_weak(prev, wait_us, std::memory_order_relaxed)) {}
+        Metrics::global().observe(Metrics::Series::DbWait, wait_us);
+
+        running_.fetch_add(1, std::memory_order_relaxed);
+        bool failed = true;
+        try {
+            job.fn();
+            failed = false;
+        } catch (const std::exception& e) {
+            spdlog::error("DbExecutor: job failed: {}", e.what());
+        } catch (...) {
+            spdlog::error("DbExecutor: job failed with an unknown exception");
+        }
+        if (failed && job.on_error) {
+            try {
+                job.on_error();
+            } catch (...) {
+                spdlog::error("DbExecutor: error handler failed");
+            }
+        }
+        running_.fetch_sub(1, std::memory_order_relaxed);
+
+        auto run_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        total_run_us_.fetch_add(run_us, std::memory_order_relaxed);
+        Metrics::global().observe(Metrics::Series::DbQuery, run_us);
+        completed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+DbExecutor::Stats DbExecutor::stats() const {
+    Stats s;
+    {
+        std::lock_guard lock(mutex_);
+        s.queued = queue_.size();
+    }
+    s.running = running_.load(std::memory_order_relaxed);
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.completed = completed_.load(std::memory_order_relaxed);
+    if (s.completed > 0) {
+        s.avg_wait_ms = static_cast<double>(total_wait_us_.load(std::memory_order_relaxed))
+                        / s.completed / 1000.0;
+        s.avg_run_ms = static_cast<double>(total_run_us_.load(std::memory_order_relaxed))
+                       / s.completed / 1000.0;
+    }
+    s.max_wait_ms = static_cast<double>(max_wait_us_.load(std::memory_order_relaxed)) / 1000.0;
+    return s;
+}
+
+} // namespace hms
@@ -0,0 +1,214 @@
+#include "db_router.h"
+#include "timeline_queries.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <limits>
+
+namespace hms {
+
+DbRouter::DbRouter(std::shared_ptr<DbPool> primary, const DbPool::Config& primary_config,
+                   std::vector<std::pair<std::string, int>> replicas, Options options)
+    : primary_(std::move(primary)), options_(std::move(options))
+{
+    if (!options_.probe) {
+        options_.probe = [](DbPool& pool) { return timeline_queries::current_date(pool).has_value(); };
+    }
+    for (auto& [host, port] : replicas) {
+        auto replica = std::make_unique<Replica>();
+        replica->config = primary_config;
+        replica->config.host = std::move(host);
+        replica->config.port = port;
+        replica->last_error = "not checked yet";
+        replicas_.push_back(std::move(replica));
+    }
+}
+
+DbRouter::~DbRouter() {
+    stop();
+}
+
+void DbRouter::start() {
+    if (thread_.joinable() || replicas_.empty()) return;
+    // Reads use the primary until the first check has run
+    thread_ = std::thread([this] { run(); });
+}
+
+void DbRouter::stop() {
+    {
+        std::lock_guard lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool DbRouter::waitFor(std::chrono::seconds interval) {
+    std::unique_lock lock(stop_mutex_);
+    return !stop_cv_.wait_for(lock, interval, [this] { return stopping_; });
+}
+
+void DbRouter::run() {
+    do {
+        check();
+    } while (waitFor(options_.check_interval));
+}
+
+double DbRouter::lagSeconds(std::optional<double> lag_bytes, std::optional<double> replay_age) {
+    if (lag_bytes && *lag_bytes <= 0.0) return 0.0;
+    if (!replay_age) return std::numeric_limits<double>::infinity();
+    return std::max(*replay_age, 0.0);
+}
+
+bool DbRouter::inService(std::optional<double> lag_bytes, std::optional<double> replay_age,
+                         double max_lag_seconds, bool was_in_service) {
+    if (lagSeconds(lag_bytes, replay_age) <= max_lag_seconds) return true;
+    return !lag_bytes && replay_age && was_in_service;
+}
+
+void DbRouter::check() {
+    // One primary position for every replica in this round
+    auto primary_lsn = timeline_queries::current_wal_lsn(*primary_);
+
+    for (auto& replica : replicas_) {
+        std::shared_ptr<DbPool> pool;
+        {
+            std::lock_guard lock(mutex_);
+            pool = replica->pool;
+        }
+
+        bool was_healthy;
+        {
+            std::lock_guard lock(mutex_);
+            was_healthy = replica->healthy;
+        }
+
+        bool healthy = false;
+        double lag_seconds = 0.0;
+        double lag_bytes = 0.0;
+        std::string error;
+        try {
+            // DbPool connects in its constructor, so an unreachable replica
+            // fails here and is tried again next round
+            if (!pool) pool = std::make_shared<DbPool>(replica->config);
+            auto status = timeline_queries::replica_status(*pool, primary_lsn);
+            if (!status) {
+                error = "no status returned";
+            } else if (!status->in_recovery) {
+                // Promoted or misconfigured: its data no longer follows the primary
+                error = "not in recovery";
+            } else {
+                lag_bytes = status->lag_bytes.value_or(0.0);
+                lag_seconds = lagSeconds(status->lag_bytes, status->replay_age);
+                // No primary position this round: an old replay may just mean an idle primary
+                healthy = inService(status->lag_bytes, status->replay_age,
+                                    options_.max_lag_seconds, was_healthy);
+                if (!healthy) error = "lagging";
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!healthy) replica->failed_checks.fetch_add(1, std::memory_order_relaxed);
+
+        {
+            std::lock_guard lock(mutex_);
+            if (pool) replica->pool = pool;
+            // A failed read may have taken it out of service since was_healthy was read
+            if (!replica->healthy) was_healthy = false;
+            replica->healthy = healthy;
+            replica->lag_seconds = lag_seconds;
+            replica->lag_bytes = lag_bytes;
+            replica->last_error = error;
+        }
+        if (healthy && !was_healthy) {
+            spdlog::info("DbRouter: replica {}:{} in service (lag {:.1f} s)",
+                         replica->config.host, replica->config.port, lag_seconds);
+        } else if (!healthy && was_healthy) {
+            spdlog::warn("DbRouter: replica {}:{} out of service: {}",
+                         replica->config.host, replica->config.port, error);
+        }
+    }
+}
+
+DbPool& DbRouter::read() {
+    Replica* replica = nullptr;
+    return pick(replica);
+}
+
+DbPool& DbRouter::pick(Replica*& replica) {
+    {
+        std::lock_guard lock(mutex_);
+        const size_t n = replicas_.size();
+        const size_t first = n ? next_++ % n : 0;
+        auto best = pickReplica(n, first, [this](size_t i) -> std::optional<size_t> {
+            const auto& r = *replicas_[i];
+            if (!r.healthy || !r.pool) return std::nullopt;
+            return static_cast<size_t>(r.pool->stats().in_use_connections);
+        });
+        if (best) {
+            replica = replicas_[*best].get();
+            replica->reads.fetch_add(1, std::memory_order_relaxed);
+            replica_reads_.fetch_add(1, std::memory_order_relaxed);
+            return *replica->pool;
+        }
+        if (n > 0) fallbacks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    primary_reads_.fetch_add(1, std::memory_order_relaxed);
+    return *primary_;
+}
+
+bool DbRouter::replicaDown(Replica& replica) {
+    std::shared_ptr<DbPool> pool;
+    {
+        std::lock_guard lock(mutex_);
+        pool = replica.pool;
+    }
+    // A query error on a live replica (a bad parameter, a recovery conflict)
+    // is answered as it is; only a replica that stopped answering is dropped
+    bool reachable = false;
+    try {
+        reachable = pool && options_.probe(*pool);
+    } catch (const std::exception&) {
+    }
+    if (reachable) return false;
+
+    replica.failed_reads.fetch_add(1, std::memory_order_relaxed);
+    bool was_healthy;
+    {
+        std::lock_guard lock(mutex_);
+        was_healthy = replica.healthy;
+        replica.healthy = false;
+        replica.last_error = "query failed, replica unreachable";
+    }
+    if (was_healthy) {
+        spdlog::warn("DbRouter: replica {}:{} out of service: query failed and it does not answer",
+                     replica.config.host, replica.config.port);
+    }
+    return true;
+}
+
+DbRouter::Stats DbRouter::stats() const {
+    Stats s;
+    s.primary_reads = primary_reads_.load(std::memory_order_relaxed);
+    s.replica_reads = replica_reads_.load(std::memory_order_relaxed);
+    s.fallbacks = fallbacks_.load(std::memory_order_relaxed);
+    s.retries = retries_.load(std::memory_order_relaxed);
+    std::lock_guard lock(mutex_);
+    for (const auto& replica : replicas_) {
+        ReplicaStats r;
+        r.host = replica->config.host;
+        r.port = replica->config.port;
+        r.connected = replica->pool != nullptr;
+        r.healthy = replica->healthy;
+        r.lag_seconds = replica->lag_seconds;
+        r.lag_bytes = replica->lag_bytes;
+        r.reads = replica->reads.load(std::memory_order_relaxed);
+        r.failed_checks = replica->failed_checks.load(std::memory_order_relaxed);
+        r.failed_reads = replica->failed_reads.load(std::memory_order_relaxed);
+        r.last_error = replica->last_error;
+        s.replicas.push_back(std::move(r));
+    }
+    return s;
+}
+
+} // namespace hms
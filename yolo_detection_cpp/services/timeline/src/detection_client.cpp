@@ -0,0 +1,204 @@
+#include "detection_client.h"
+#include "metrics.h"
+
+#include <spdlog/spdlog.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+using namespace drogon;
+
+namespace hms {
+
+/// Resolve host to a dotted IPv4 address. IPv4 only — avoids ::1 resolution
+/// when the detection service listens on 0.0.0.0. Returns empty on failure.
+static std::string resolveIPv4(const std::string& host) {
+    struct addrinfo hints{}, *res = nullptr;
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) return {};
+
+    char buf[INET_ADDRSTRLEN] = {};
+    auto* addr = reinterpret_cast<struct sockaddr_in*>(res->ai_addr);
+    inet_ntop(AF_INET, &addr->sin_addr, buf, sizeof(buf));
+    freeaddrinfo(res);
+    return buf;
+}
+
+DetectionClient::DetectionClient(const std::string& base_url, Options options)
+    : options_(options), loop_thread_("DetectionClient")
+{
+    // Parse host and port from base_url (e.g. "http://localhost:8000")
+    std::string url = base_url;
+    if (url.substr(0, 7) == "http://") url = url.substr(7);
+    auto slash = url.find('/');
+    if (slash != std::string::npos) url = url.substr(0, slash);
+    host_ = url;
+    auto colon = url.rfind(':');
+    if (colon != std::string::npos) {
+        host_ = url.substr(0, colon);
+        try { port_ = static_cast<uint16_t>(std::stoi(url.substr(colon + 1))); } catch (...) {}
+    }
+    if (options_.connections == 0) options_.connections = 1;
+    if (!options_.resolver) options_.resolver = resolveIPv4;
+
+    loop_thread_.run();
+    resolver_thread_ = std::make_unique<trantor::EventLoopThread>("DetectionResolve");
+    resolver_thread_->run();
+
+    auto ip = options_.resolver(host_);
+    last_resolve_ = std::chrono::steady_clock::now();
+    if (ip.empty()) {
+        spdlog::warn("DetectionClient: cannot resolve {}, will retry on demand", host_);
+        return;
+    }
+    connect(ip);
+    spdlog::info("DetectionClient: {}:{} ({}) with {} connections", host_, port_, ip,
+                 options_.connections);
+}
+
+DetectionClient::~DetectionClient() {
+    // Joins the resolver, so no lookup can reconnect once teardown starts
+    resolver_thread_.reset();
+    std::lock_guard lock(clients_mutex_);
+    clients_.clear();
+}
+
+void DetectionClient::connect(const std::string& ip) {
+    std::vector<HttpClientPtr> clients;
+    clients.reserve(options_.connections);
+    for (size_t i = 0; i < options_.connections; ++i) {
+        auto client = HttpClient::newHttpClient(ip, port_, false, loop_thread_.getLoop());
+        client->setUserAgent("yolo-timeline");
+        clients.push_back(std::move(client));
+    }
+
+    std::lock_guard lock(clients_mutex_);
+    clients_.swap(clients);
+    resolved_ip_ = ip;
+}
+
+void DetectionClient::scheduleResolve() {
+    // Connection failures may mean the upstream moved — re-resolve at most
+    // once per resolve_interval
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard lock(clients_mutex_);
+        if (now - last_resolve_ < options_.resolve_interval) return;
+        last_resolve_ = now;
+    }
+    if (resolving_.exchange(true)) return;
+
+    // getaddrinfo can block for seconds; keep it off the loop that carries
+    // the requests. connect() only swaps the client set under the mutex.
+    resolver_thread_->getLoop()->queueInLoop([this]() {
+        auto ip = options_.resolver(host_);
+        bool changed;
+        {
+            std::lock_guard lock(clients_mutex_);
+            changed = !ip.empty() && (ip != resolved_ip_ || clients_.empty());
+        }
+        if (changed) {
+            spdlog::info("DetectionClient: {} now resolves to {}", host_, ip);
+            connect(ip);
+        }
+        resolving_ = false;
+    });
+}
+
+void DetectionClient::request(HttpMethod method,
+                              const std::string& path,
+                              std::string body,
+                              Callback&& callback) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+
+    if (in_flight_.fetch_add(1, std::memory_order_acq_rel) >= options_.max_in_flight) {
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        callback(Result::Rejected, nullptr);
+        return;
+    }
+
+    HttpClientPtr client;
+    {
+        std::lock_guard lock(clients_mutex_);
+        if (!clients_.empty()) {
+            client = clients_[next_client_.fetch_add(1, std::memory_order_relaxed) % clients_.size()];
+        }
+    }
+    if (!client) {
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        scheduleResolve();
+        callback(Result::Unavailable, nullptr);
+        return;
+    }
+
+    auto req = HttpRequest::newHttpRequest();
+    req->setMethod(method);
+    req->setPath(path);
+    if (!body.empty() || method == Post) {
+        req->setContentTypeCode(CT_APPLICATION_JSON);
+        req->setBody(std::move(body));
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    client->sendRequest(
+        req,
+        [this, started, callback = std::move(callback)](ReqResult result,
+                                                        const HttpResponsePtr& resp) {
+            in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+
+            if (result == ReqResult::Ok && resp) {
+                record(started, resp->statusCode() >= 500, false);
+                callback(Result::Ok, resp);
+                return;
+            }
+
+            bool timeout = (result == ReqResult::Timeout);
+            record(started, true, timeout);
+            if (!timeout) scheduleResolve();
+            spdlog::warn("DetectionClient: request to {}:{} failed ({})", host_, port_,
+                         timeout ? "timeout" : "unavailable");
+            callback(timeout ? Result::Timeout : Result::Unavailable, nullptr);
+        },
+        options_.timeout_sec);
+}
+
+void DetectionClient::record(std::chrono::steady_clock::time_point started,
+                             bool error, bool timeout) {
+    auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count());
+
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    total_latency_us_.fetch_add(us, std::memory_order_relaxed);
+    Metrics::global().observe(Metrics::Series::Upstream, us);
+    if (error) errors_.fetch_add(1, std::memory_order_relaxed);
+    if (timeout) timeouts_.fetch_add(1, std::memory_order_relaxed);
+
+    auto prev = max_latency_us_.load(std::memory_order_relaxed);
+    while (us > prev && !max_latency_us_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+}
+
+std::string DetectionClient::resolvedAddress() const {
+    std::lock_guard lock(clients_mutex_);
+    return resolved_ip_;
+}
+
+DetectionClient::Stats DetectionClient::stats() const {
+    Stats s;
+    s.requests = requests_.load(std::memory_order_relaxed);
+    s.errors = errors_.load(std::memory_order_relaxed);
+    s.timeouts = timeouts_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.in_flight = in_flight_.load(std::memory_order_relaxed);
+    auto completed = completed_.load(std::memory_order_relaxed);
+    if (completed > 0) {
+        s.avg_latency_ms = static_cast<double>(total_latency_us_.load(std::memory_order_relaxed))
+                           / completed / 1000.0;
+    }
+    s.max_latency_ms = static_cast<double>(max_latency_us_.load(std::memory_order_relaxed)) / 1000.0;
+    return s;
+}
+
+} // namespace hms
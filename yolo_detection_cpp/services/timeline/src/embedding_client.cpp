@@ -1,8 +1,12 @@
 #include "embedding_client.h"
+#include "metrics.h"
 
 #include <spdlog/spdlog.h>
 #include <nlohmann/json.hpp>
 #include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
@@ -10,29 +14,181 @@ namespace hms {
 
 EmbeddingClient::EmbeddingClient(const std::string& ollama_url,
                                  const std::string& model)
-    : url_(ollama_url + "/api/embed"), model_(model)
+    : EmbeddingClient(ollama_url, model, Options{})
 {
 }
 
+EmbeddingClient::EmbeddingClient(const std::string& ollama_url,
+                                 const std::string& model,
+                                 Options options)
+    : url_(ollama_url + "/api/embed"), model_(model), options_(options),
+      cache_(options.cache_entries)
+{
+    // curl_global_init is not thread-safe; do it before any request thread can
+    static std::once_flag curl_init;
+    std::call_once(curl_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    if (options_.max_batch == 0) options_.max_batch = 1;
+    batcher_ = std::thread([this] { runBatcher(); });
+}
+
+EmbeddingClient::~EmbeddingClient() {
+    {
+        std::lock_guard lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    if (batcher_.joinable()) batcher_.join();     // answers everything still queued
+
+    std::lock_guard lock(handles_mutex_);
+    for (auto* handle : idle_handles_) {
+        curl_easy_cleanup(static_cast<CURL*>(handle));
+    }
+}
+
 static size_t writeCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
     auto* response = static_cast<std::string*>(userdata);
     response->append(ptr, size * nmemb);
     return size * nmemb;
 }
 
+std::string EmbeddingClient::normalize(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    bool pending_space = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            pending_space = !out.empty();
+            continue;
+        }
+        if (pending_space) {
+            out += ' ';
+            pending_space = false;
+        }
+        out += static_cast<char>(std::tolower(c));
+    }
+    return out;
+}
+
 std::vector<float> EmbeddingClient::embed(const std::string& text) {
-    if (text.empty()) return {};
+    auto normalized = normalize(text);
+    if (normalized.empty()) return {};
+
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard lock(cache_mutex_);
+        if (auto hit = cache_.get(normalized)) {
+            cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            return *hit;
+        }
+    }
+
+    auto pending = std::make_shared<Pending>();
+    pending->key = std::move(normalized);
+    pending->text = text;
+    pending->enqueued = std::chrono::steady_clock::now();
+    auto result = pending->promise.get_future();
+    {
+        std::lock_guard lock(queue_mutex_);
+        queue_.push_back(std::move(pending));
+    }
+    queue_cv_.notify_one();
+    return result.get();
+}
+
+void EmbeddingClient::runBatcher() {
+    std::unique_lock lock(queue_mutex_);
+    for (;;) {
+        queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;     // stopping, and everything queued is answered
+
+        // The window runs from the oldest query's arrival, so a backlog that
+        // built up during the previous call is sent at once
+        queue_cv_.wait_until(lock, queue_.front()->enqueued + options_.batch_window, [this] {
+            return stopping_ || queue_.size() >= options_.max_batch;
+        });
+
+        auto n = std::min(queue_.size(), options_.max_batch);
+        std::vector<std::shared_ptr<Pending>> batch(queue_.begin(), queue_.begin() + n);
+        queue_.erase(queue_.begin(), queue_.begin() + n);
+
+        lock.unlock();
+        flush(std::move(batch));
+        lock.lock();
+    }
+}
+
+void EmbeddingClient::flush(std::vector<std::shared_ptr<Pending>> batch) {
+    // Queries with the same key in the same batch are sent once, as the
+    // first caller wrote it; the cache would answer the others with that anyway
+    std::vector<std::string> inputs;
+    std::vector<const std::string*> keys;
+    std::unordered_map<std::string, size_t> slot;
+    for (const auto& p : batch) {
+        if (slot.emplace(p->key, inputs.size()).second) {
+            inputs.push_back(p->text);
+            keys.push_back(&p->key);
+        }
+    }
 
+    std::vector<std::vector<float>> vectors;
+    try {
+        vectors = embedBatch(inputs);
+    } catch (const std::exception& e) {
+        // e.g. json::type_error for input that is not valid UTF-8; the
+        // batcher thread must survive it
+        spdlog::error("EmbeddingClient: batch failed: {}", e.what());
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (vectors.size() == inputs.size()) {
+        std::lock_guard lock(cache_mutex_);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (!vectors[i].empty()) cache_.put(*keys[i], vectors[i]);
+        }
+    }
+    for (const auto& p : batch) {
+        auto i = slot[p->key];
+        p->promise.set_value(i < vectors.size() ? vectors[i] : std::vector<float>{});
+    }
+}
+
+void* EmbeddingClient::acquireHandle() {
+    {
+        std::lock_guard lock(handles_mutex_);
+        if (!idle_handles_.empty()) {
+            auto* handle = idle_handles_.back();
+            idle_handles_.pop_back();
+            return handle;
+        }
+    }
+    return curl_easy_init();
+}
+
+void EmbeddingClient::releaseHandle(void* handle) {
+    {
+        std::lock_guard lock(handles_mutex_);
+        if (idle_handles_.size() < options_.max_idle_handles) {
+            // Keep the handle — its connection cache holds the keep-alive socket
+            curl_easy_reset(static_cast<CURL*>(handle));
+            idle_handles_.push_back(handle);
+            return;
+        }
+    }
+    curl_easy_cleanup(static_cast<CURL*>(handle));
+}
+
+std::vector<std::vector<float>> EmbeddingClient::embedBatch(const std::vector<std::string>& inputs) {
     json body = {
         {"model", model_},
-        {"input", text}
+        {"input", inputs}
     };
     std::string body_str = body.dump();
     std::string response_body;
 
-    CURL* curl = curl_easy_init();
+    auto* curl = static_cast<CURL*>(acquireHandle());
     if (!curl) {
         spdlog::error("EmbeddingClient: curl_easy_init failed");
+        errors_.fetch_add(1, std::memory_order_relaxed);
         return {};
     }
 
@@ -49,37 +205,64 @@ std::vector<float> EmbeddingClient::embed(const std::string& text) {
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
 
+    auto started = std::chrono::steady_clock::now();
     CURLcode res = curl_easy_perform(curl);
+    auto latency_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count());
+    total_latency_us_.fetch_add(latency_us, std::memory_order_relaxed);
+    Metrics::global().observe(Metrics::Series::Embedding, latency_us);
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    batched_inputs_.fetch_add(inputs.size(), std::memory_order_relaxed);
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_slist_free_all(headers);
+    releaseHandle(curl);
 
     if (res != CURLE_OK) {
         spdlog::error("EmbeddingClient: curl error: {}", curl_easy_strerror(res));
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        errors_.fetch_add(1, std::memory_order_relaxed);
         return {};
     }
 
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
     if (http_code != 200) {
         spdlog::error("EmbeddingClient: HTTP {}", http_code);
+        errors_.fetch_add(1, std::memory_order_relaxed);
         return {};
     }
 
     try {
         auto j = json::parse(response_body);
-        if (j.contains("embeddings") && !j["embeddings"].empty()) {
-            return j["embeddings"][0].get<std::vector<float>>();
+        if (j.contains("embeddings") && j["embeddings"].size() == inputs.size()) {
+            return j["embeddings"].get<std::vector<std::vector<float>>>();
         }
-        spdlog::error("EmbeddingClient: no embeddings in response");
+        spdlog::error("EmbeddingClient: expected {} embeddings in response", inputs.size());
     } catch (const json::exception& e) {
         spdlog::error("EmbeddingClient: parse error: {}", e.what());
     }
 
+    errors_.fetch_add(1, std::memory_order_relaxed);
     return {};
 }
 
+EmbeddingClient::Stats EmbeddingClient::stats() const {
+    Stats s;
+    s.requests = requests_.load(std::memory_order_relaxed);
+    s.cache_hits = cache_hits_.load(std::memory_order_relaxed);
+    s.cache_misses = s.requests - s.cache_hits;
+    s.batches = batches_.load(std::memory_order_relaxed);
+    s.batched_inputs = batched_inputs_.load(std::memory_order_relaxed);
+    s.errors = errors_.load(std::memory_order_relaxed);
+    if (s.requests > 0) {
+        s.hit_rate = static_cast<double>(s.cache_hits) / s.requests;
+    }
+    if (s.batches > 0) {
+        s.avg_latency_ms = static_cast<double>(total_latency_us_.load(std::memory_order_relaxed))
+                           / s.batches / 1000.0;
+    }
+    return s;
+}
+
 }  // namespace hms
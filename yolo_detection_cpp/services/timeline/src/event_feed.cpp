@@ -0,0 +1,270 @@
+#include "event_feed.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+using namespace drogon;
+
+namespace hms {
+
+// Sent when a stream opens: EventSource waits this long before reconnecting
+static constexpr const char* kStreamPreamble = "retry: 3000\n\n";
+static constexpr const char* kHeartbeat = ": keepalive\n\n";
+
+EventFeed::Tracker::Change EventFeed::Tracker::observe(const timeline_queries::FeedRow& row) {
+    auto hash = std::hash<std::string>{}(row.json);
+    auto [it, inserted] = seen_.try_emplace(row.event_id, Seen{row.started_at_us, hash});
+    if (inserted) return Change::Added;
+    if (it->second.hash == hash) return Change::None;
+    it->second = Seen{row.started_at_us, hash};
+    return Change::Updated;
+}
+
+void EventFeed::Tracker::forgetBefore(int64_t since_us) {
+    std::erase_if(seen_, [since_us](const auto& entry) {
+        return entry.second.started_at_us < since_us;
+    });
+}
+
+const EventFeed::ReplayBuffer::Message& EventFeed::ReplayBuffer::push(
+    const std::string& camera_id, std::string_view type, std::string_view data) {
+    Message msg;
+    msg.id = next_id_++;
+    msg.camera_id = camera_id;
+    msg.frame = std::make_shared<const std::string>(frame(msg.id, type, data));
+    messages_.push_back(std::move(msg));
+    while (messages_.size() > capacity_) messages_.pop_front();
+    return messages_.back();
+}
+
+void EventFeed::ReplayBuffer::reset() {
+    messages_.clear();
+    resync_through_ = latest();
+}
+
+bool EventFeed::ReplayBuffer::covers(uint64_t last_event_id) const {
+    if (last_event_id <= resync_through_ || last_event_id > latest()) return false;
+    if (last_event_id == latest()) return true;
+    // Every message after last_event_id must still be here
+    return !messages_.empty() && last_event_id + 1 >= messages_.front().id;
+}
+
+EventFeed::EventFeed(std::shared_ptr<DbPool> pool, Options options)
+    : pool_(std::move(pool)),
+      options_(std::move(options)),
+      loop_thread_("EventFeed"),
+      replay_(options_.replay_size)
+{
+    if (!options_.load) {
+        options_.load = [pool = pool_](std::optional<int64_t> since_us, int lookback_seconds,
+                                       int limit) {
+            return timeline_queries::load_recent_events(*pool, since_us, lookback_seconds, limit);
+        };
+    }
+    loop_thread_.run();
+}
+
+EventFeed::~EventFeed() {
+    // Stop the poll loop before the state it uses goes away
+    loop_thread_.getLoop()->quit();
+    loop_thread_.wait();
+
+    std::lock_guard lock(mutex_);
+    for (auto& sub : subscribers_) {
+        if (sub.sink.close) sub.sink.close();
+    }
+    subscribers_.clear();
+}
+
+std::string EventFeed::frame(uint64_t id, std::string_view type, std::string_view data) {
+    std::string out;
+    out.reserve(data.size() + type.size() + 40);
+    out += "id: ";
+    out += std::to_string(id);
+    out += "\nevent: ";
+    out += type;
+    out += '\n';
+    // A line break inside data would end the field; each line gets its own
+    while (true) {
+        auto nl = data.find('\n');
+        out += "data: ";
+        out += data.substr(0, nl);
+        out += '\n';
+        if (nl == std::string_view::npos) break;
+        data.remove_prefix(nl + 1);
+    }
+    out += '\n';
+    return out;
+}
+
+void EventFeed::subscribe(ResponseStreamPtr stream,
+                          std::weak_ptr<trantor::TcpConnection> conn,
+                          std::unordered_set<std::string> cameras,
+                          std::optional<uint64_t> last_event_id) {
+    std::shared_ptr<drogon::ResponseStream> shared(std::move(stream));
+    Sink sink;
+    sink.send = [shared](const std::string& data) { return shared->send(data); };
+    sink.bytes_sent = [conn = std::move(conn)]() -> std::optional<uint64_t> {
+        auto c = conn.lock();
+        if (!c || c->disconnected()) return std::nullopt;
+        return c->bytesSent();
+    };
+    sink.close = [shared] { shared->close(); };
+    subscribe(std::move(sink), std::move(cameras), last_event_id);
+}
+
+void EventFeed::subscribe(Sink sink, std::unordered_set<std::string> cameras,
+                          std::optional<uint64_t> last_event_id) {
+    Subscriber sub;
+    sub.sink = std::move(sink);
+    sub.cameras = std::move(cameras);
+    auto sent = sub.sink.bytes_sent();
+    if (!sent) return;
+    sub.bytes_sent_base = *sent;
+    const size_t camera_count = sub.cameras.size();
+
+    bool start_polling = false;
+    {
+        std::lock_guard lock(mutex_);
+        // Idle too long to know what was missed: start over from the current window
+        if (!polling_ && std::chrono::steady_clock::now() - stopped_at_ > options_.lookback) {
+            replay_.reset();
+            reprime_ = true;
+        }
+
+        if (!deliver(sub, kStreamPreamble)) return;
+
+        if (last_event_id) {
+            if (!replay_.covers(*last_event_id)) {
+                resyncs_.fetch_add(1, std::memory_order_relaxed);
+                if (!deliver(sub, frame(replay_.latest(), "resync", "{}"))) return;
+            } else {
+                for (const auto& msg : replay_.messages()) {
+                    if (msg.id <= *last_event_id || !sub.wants(msg.camera_id)) continue;
+                    if (!deliver(sub, *msg.frame)) return;
+                    replayed_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        subscribers_.push_back(std::move(sub));
+        if (!polling_) {
+            polling_ = true;
+            start_polling = true;
+        }
+    }
+
+    spdlog::debug("EventFeed: subscriber added ({} cameras)",
+                  camera_count ? std::to_string(camera_count) : std::string("all"));
+    if (start_polling) loop_thread_.getLoop()->queueInLoop([this]() { tick(); });
+}
+
+void EventFeed::tick() {
+    {
+        std::lock_guard lock(mutex_);
+        if (std::exchange(reprime_, false)) {
+            tracker_.clear();
+            since_us_.reset();
+            primed_ = false;
+        }
+    }
+
+    // One query for every subscriber; no lock is held while it runs
+    auto rows = options_.load(since_us_, static_cast<int>(options_.lookback.count()),
+                              options_.max_rows);
+    polls_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!rows) {
+        poll_errors_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        int64_t newest_us = since_us_ ? *since_us_ : 0;
+        for (const auto& row : *rows) {
+            auto change = tracker_.observe(row);
+            // The first poll only learns what already exists
+            if (primed_ && change != Tracker::Change::None) {
+                publish(change == Tracker::Change::Added ? "event" : "update", row);
+            }
+            newest_us = std::max(newest_us, row.started_at_us);
+        }
+        primed_ = true;
+
+        if (!rows->empty()) {
+            const int64_t lookback_us =
+                std::chrono::duration_cast<std::chrono::microseconds>(options_.lookback).count();
+            since_us_ = std::max(since_us_.value_or(0), newest_us - lookback_us);
+            tracker_.forgetBefore(*since_us_);
+        }
+    }
+
+    // Keep polling only while someone is listening
+    {
+        std::lock_guard lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_heartbeat_ >= options_.heartbeat) {
+            last_heartbeat_ = now;
+            std::erase_if(subscribers_, [this](Subscriber& sub) { return !deliver(sub, kHeartbeat); });
+        } else {
+            std::erase_if(subscribers_, [](const Subscriber& sub) { return !sub.sink.bytes_sent(); });
+        }
+        if (subscribers_.empty()) {
+            polling_ = false;
+            stopped_at_ = now;
+            spdlog::debug("EventFeed: no subscribers left, polling stopped");
+            return;
+        }
+    }
+    loop_thread_.getLoop()->runAfter(
+        std::chrono::duration<double>(options_.poll_interval).count(), [this]() { tick(); });
+}
+
+void EventFeed::publish(std::string_view type, const timeline_queries::FeedRow& row) {
+    std::lock_guard lock(mutex_);
+    const auto& msg = replay_.push(row.camera_id, type, row.json);
+
+    std::erase_if(subscribers_, [&](Subscriber& sub) {
+        if (!sub.wants(msg.camera_id)) return false;
+        if (!deliver(sub, *msg.frame)) return true;
+        messages_sent_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    });
+    messages_published_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool EventFeed::deliver(Subscriber& sub, const std::string& data) {
+    auto bytes_sent = sub.sink.bytes_sent();
+    if (!bytes_sent) return false;
+
+    // Bytes handed to the stream but not yet written to the socket
+    auto sent = *bytes_sent - sub.bytes_sent_base;
+    auto backlog = sub.bytes_queued > sent ? sub.bytes_queued - sent : 0;
+    if (backlog > options_.max_backlog) {
+        // Skipping would lose events; the client reconnects and replays instead
+        slow_disconnects_.fetch_add(1, std::memory_order_relaxed);
+        sub.sink.close();
+        return false;
+    }
+
+    if (!sub.sink.send(data)) return false;
+    sub.bytes_queued += data.size();
+    return true;
+}
+
+EventFeed::Stats EventFeed::stats() const {
+    Stats s;
+    {
+        std::lock_guard lock(mutex_);
+        s.subscribers = subscribers_.size();
+    }
+    s.polls = polls_.load(std::memory_order_relaxed);
+    s.poll_errors = poll_errors_.load(std::memory_order_relaxed);
+    s.messages_published = messages_published_.load(std::memory_order_relaxed);
+    s.messages_sent = messages_sent_.load(std::memory_order_relaxed);
+    s.replayed = replayed_.load(std::memory_order_relaxed);
+    s.resyncs = resyncs_.load(std::memory_order_relaxed);
+    s.slow_disconnects = slow_disconnects_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace hms
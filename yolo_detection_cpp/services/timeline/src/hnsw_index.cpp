@@ -0,0 +1,215 @@
+#include "hnsw_index.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace hms {
+
+namespace {
+
+struct ByScoreDesc {
+    bool operator()(const HnswIndex::Match& a, const HnswIndex::Match& b) const {
+        return a.second < b.second;
+    }
+};
+struct ByScoreAsc {
+    bool operator()(const HnswIndex::Match& a, const HnswIndex::Match& b) const {
+        return a.second > b.second;
+    }
+};
+
+/// Per-thread visited marks, reset in O(1) by bumping the epoch
+class VisitedSet {
+public:
+    void reset(size_t n) {
+        if (marks_.size() < n) marks_.resize(n, 0);
+        if (++epoch_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+    bool insert(uint32_t id) {
+        if (marks_[id] == epoch_) return false;
+        marks_[id] = epoch_;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> marks_;
+    uint32_t epoch_ = 0;
+};
+
+thread_local VisitedSet t_visited;
+
+float dot(const float* a, const float* b, size_t n) {
+    return simd::dotF32(a, b, n);
+}
+
+} // anonymous namespace
+
+HnswIndex::HnswIndex(size_t dim, size_t m, size_t ef_construction, uint32_t seed)
+    : dim_(dim),
+      m_(std::max<size_t>(m, 2)),
+      ef_construction_(std::max(ef_construction, m_)),
+      level_mult_(1.0 / std::log(static_cast<double>(m_))),
+      rng_(seed),
+      vectors_(dim)
+{
+}
+
+float HnswIndex::similarity(const float* query, uint32_t id) const {
+    return dot(query, vector(id), dim_);
+}
+
+uint32_t HnswIndex::add(const float* vec) {
+    const auto id = vectors_.add(vec);
+    const float* q = vector(id);
+
+    std::uniform_real_distribution<double> unit(std::nextafter(0.0, 1.0), 1.0);
+    int level = static_cast<int>(-std::log(unit(rng_)) * level_mult_);
+    levels_.push_back(level);
+    links_.emplace_back(level + 1);
+
+    if (max_level_ < 0) {
+        entry_ = id;
+        max_level_ = level;
+        return id;
+    }
+
+    uint32_t ep = entry_;
+    for (int l = max_level_; l > level; --l) {
+        ep = greedyClosest(q, ep, l);
+    }
+
+    for (int l = std::min(level, max_level_); l >= 0; --l) {
+        auto candidates = searchLayer(q, ep, ef_construction_, l, {});
+        auto neighbors = selectNeighbors(candidates, m_);
+        links_[id][l] = neighbors;
+
+        for (auto nb : neighbors) {
+            auto& nb_links = links_[nb][l];
+            nb_links.push_back(id);
+            if (nb_links.size() > maxLinks(l)) {
+                // Over capacity — keep the most diverse set of the neighbour's links
+                std::vector<Match> scored;
+                scored.reserve(nb_links.size());
+                for (auto other : nb_links) {
+                    scored.emplace_back(other, dot(vector(nb), vector(other), dim_));
+                }
+                std::sort(scored.begin(), scored.end(), ByScoreAsc{});
+                nb_links = selectNeighbors(scored, maxLinks(l));
+            }
+        }
+        ep = candidates.front().first;
+    }
+
+    if (level > max_level_) {
+        entry_ = id;
+        max_level_ = level;
+    }
+    return id;
+}
+
+uint32_t HnswIndex::greedyClosest(const float* query, uint32_t entry, int level) const {
+    uint32_t best = entry;
+    float best_score = similarity(query, best);
+    for (bool improved = true; improved;) {
+        improved = false;
+        for (auto nb : links_[best][level]) {
+            float s = similarity(query, nb);
+            if (s > best_score) {
+                best_score = s;
+                best = nb;
+                improved = true;
+            }
+        }
+    }
+    return best;
+}
+
+std::vector<HnswIndex::Match> HnswIndex::searchLayer(const float* query, uint32_t entry,
+                                                      size_t ef, int level,
+                                                      const Filter& filter) const {
+    auto& visited = t_visited;
+    visited.reset(size());
+
+    // candidates: best first; results: worst on top so it can be evicted
+    std::priority_queue<Match, std::vector<Match>, ByScoreDesc> candidates;
+    std::priority_queue<Match, std::vector<Match>, ByScoreAsc> results;
+
+    float entry_score = similarity(query, entry);
+    visited.insert(entry);
+    candidates.emplace(entry, entry_score);
+    if (!filter || filter(entry)) results.emplace(entry, entry_score);
+
+    while (!candidates.empty()) {
+        auto current = candidates.top();
+        if (results.size() >= ef && current.second < results.top().second) break;
+        candidates.pop();
+
+        for (auto nb : links_[current.first][level]) {
+            if (!visited.insert(nb)) continue;
+            float s = similarity(query, nb);
+            if (results.size() < ef || s > results.top().second) {
+                candidates.emplace(nb, s);
+                if (!filter || filter(nb)) {
+                    results.emplace(nb, s);
+                    if (results.size() > ef) results.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Match> out;
+    out.reserve(results.size());
+    while (!results.empty()) {
+        out.push_back(results.top());
+        results.pop();
+    }
+    std::reverse(out.begin(), out.end());
+    return out;
+}
+
+std::vector<uint32_t> HnswIndex::selectNeighbors(const std::vector<Match>& candidates,
+                                                 size_t m) const {
+    // Heuristic from the paper: keep a candidate only if it is closer to the query
+    // than to every neighbour already chosen, which preserves long-range links
+    std::vector<uint32_t> selected;
+    selected.reserve(m);
+    for (const auto& [id, score] : candidates) {
+        if (selected.size() >= m) break;
+        bool diverse = std::all_of(selected.begin(), selected.end(), [&](uint32_t s) {
+            return dot(vector(id), vector(s), dim_) < score;
+        });
+        if (diverse) selected.push_back(id);
+    }
+    // Top up with the closest leftovers so sparse regions stay connected
+    for (const auto& [id, score] : candidates) {
+        if (selected.size() >= m) break;
+        if (std::find(selected.begin(), selected.end(), id) == selected.end()) {
+            selected.push_back(id);
+        }
+    }
+    return selected;
+}
+
+std::vector<HnswIndex::Match> HnswIndex::search(const float* query, size_t k, size_t ef,
+                                                const Filter& filter) const {
+    if (size() == 0 || k == 0) return {};
+
+    std::vector<float> q(query, query + dim_);
+    VectorMatrix::normalize(q.data(), dim_);
+
+    uint32_t ep = entry_;
+    for (int l = max_level_; l > 0; --l) {
+        ep = greedyClosest(q.data(), ep, l);
+    }
+
+    auto results = searchLayer(q.data(), ep, std::max(ef, k), 0, filter);
+    if (results.size() > k) results.resize(k);
+    return results;
+}
+
+} // namespace hms
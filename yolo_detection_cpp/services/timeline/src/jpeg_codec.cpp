@@ -0,0 +1,188 @@
+#include "jpeg_codec.h"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include <jpeglib.h>
+
+namespace hms {
+
+namespace {
+
+/// Sources above this many pixels are refused rather than decoded
+constexpr uint64_t kMaxSourcePixels = 64ull * 1024 * 1024;
+
+// ── libjpeg error handling ─────────────────────────────────────────────
+// libjpeg reports fatal errors through error_exit, which must not return.
+// The setjmp frames below hold only trivially destructible locals; buffers
+// live in the caller so nothing is skipped by the longjmp.
+
+struct JpegError {
+    jpeg_error_mgr mgr;
+    std::jmp_buf jump;
+};
+
+[[noreturn]] void onJpegError(j_common_ptr cinfo) {
+    std::longjmp(reinterpret_cast<JpegError*>(cinfo->err)->jump, 1);
+}
+
+void onJpegMessage(j_common_ptr, int) {
+    // Warnings (e.g. truncated data from a camera mid-write) are not actionable
+}
+
+/// Output size fitting width x height within the box without upscaling
+std::pair<int, int> fitWithin(int width, int height, int max_width, int max_height) {
+    double scale = 1.0;
+    if (max_width > 0) scale = std::min(scale, static_cast<double>(max_width) / width);
+    if (max_height > 0) scale = std::min(scale, static_cast<double>(max_height) / height);
+    return {std::max(1, static_cast<int>(width * scale + 0.5)),
+            std::max(1, static_cast<int>(height * scale + 0.5))};
+}
+
+/// Decode at the smallest M/8 scale that still covers target_width
+bool decodeScaled(std::string_view jpeg, int max_width, int max_height,
+                  RgbImage& image, std::pair<int, int>& target) {
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = onJpegError;
+    err.mgr.emit_message = onJpegMessage;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, reinterpret_cast<const unsigned char*>(jpeg.data()),
+                 static_cast<unsigned long>(jpeg.size()));
+    jpeg_read_header(&cinfo, TRUE);
+    if (static_cast<uint64_t>(cinfo.image_width) * cinfo.image_height > kMaxSourcePixels) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    target = fitWithin(static_cast<int>(cinfo.image_width), static_cast<int>(cinfo.image_height),
+                       max_width, max_height);
+    const auto target_width = static_cast<unsigned int>(target.first);
+    unsigned int num = (8 * target_width + cinfo.image_width - 1) / cinfo.image_width;
+    cinfo.scale_num = std::clamp(num, 1u, 8u);
+    cinfo.scale_denom = 8;
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&cinfo);
+
+    image.width = static_cast<int>(cinfo.output_width);
+    image.height = static_cast<int>(cinfo.output_height);
+    const size_t stride = static_cast<size_t>(cinfo.output_width) * 3;
+    image.pixels.resize(stride * cinfo.output_height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = image.pixels.data() + stride * cinfo.output_scanline;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+/// Box-filter src down to width x height; the DCT scale already brought it within 2x
+RgbImage boxResize(const RgbImage& src, int width, int height) {
+    RgbImage dst;
+    dst.width = width;
+    dst.height = height;
+    dst.pixels.resize(static_cast<size_t>(width) * height * 3);
+
+    auto span = [](int i, int src_len, int dst_len) {
+        int lo = static_cast<int>(static_cast<int64_t>(i) * src_len / dst_len);
+        int hi = static_cast<int>(static_cast<int64_t>(i + 1) * src_len / dst_len);
+        return std::pair{lo, std::max(hi, lo + 1)};
+    };
+    std::vector<std::pair<int, int>> xs(static_cast<size_t>(width));
+    for (int x = 0; x < width; ++x) xs[static_cast<size_t>(x)] = span(x, src.width, width);
+
+    const size_t src_stride = static_cast<size_t>(src.width) * 3;
+    unsigned char* out = dst.pixels.data();
+    for (int y = 0; y < height; ++y) {
+        auto [y0, y1] = span(y, src.height, height);
+        for (const auto& [x0, x1] : xs) {
+            uint32_t sum[3] = {0, 0, 0};
+            for (int sy = y0; sy < y1; ++sy) {
+                const unsigned char* p = src.pixels.data() + src_stride * static_cast<size_t>(sy) +
+                                         static_cast<size_t>(x0) * 3;
+                for (int sx = x0; sx < x1; ++sx, p += 3) {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                }
+            }
+            const uint32_t n = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+            for (uint32_t c : sum) *out++ = static_cast<unsigned char>((c + n / 2) / n);
+        }
+    }
+    return dst;
+}
+
+/// Encode into a malloc'd buffer owned (and freed) by the caller
+bool encode(const RgbImage& image, int quality, unsigned char*& out, unsigned long& out_size) {
+    jpeg_compress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = onJpegError;
+    err.mgr.emit_message = onJpegMessage;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &out, &out_size);
+    cinfo.image_width = static_cast<JDIMENSION>(image.width);
+    cinfo.image_height = static_cast<JDIMENSION>(image.height);
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    const size_t stride = static_cast<size_t>(image.width) * 3;
+    while (cinfo.next_scanline < cinfo.image_height) {
+        auto row = const_cast<JSAMPROW>(image.pixels.data() + stride * cinfo.next_scanline);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+} // anonymous namespace
+
+bool decodeJpeg(std::string_view jpeg, int max_width, int max_height, RgbImage& out) {
+    if (jpeg.empty()) return false;
+    std::pair<int, int> target;
+    if (!decodeScaled(jpeg, max_width, max_height, out, target)) return false;
+    if (out.width > target.first || out.height > target.second) {
+        out = boxResize(out, std::min(out.width, target.first), std::min(out.height, target.second));
+    }
+    return true;
+}
+
+std::optional<std::string> encodeJpeg(const RgbImage& image, int quality) {
+    if (image.width <= 0 || image.height <= 0 ||
+        image.pixels.size() != static_cast<size_t>(image.width) * image.height * 3) {
+        return std::nullopt;
+    }
+    unsigned char* out = nullptr;
+    unsigned long out_size = 0;
+    std::optional<std::string> body;
+    if (encode(image, quality, out, out_size)) {
+        body.emplace(reinterpret_cast<const char*>(out), out_size);
+    }
+    std::free(out);
+    return body;
+}
+
+} // namespace hms
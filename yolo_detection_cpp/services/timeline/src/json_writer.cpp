@@ -0,0 +1,216 @@
+#include "json_writer.h"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace hms {
+
+namespace {
+
+/// Characters that need escaping inside a JSON string
+bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+std::vector<std::string>& bufferPool() {
+    thread_local std::vector<std::string> pool = [] {
+        std::vector<std::string> v;
+        v.reserve(PooledBuffer::kMaxPooled);
+        return v;
+    }();
+    return pool;
+}
+
+} // anonymous namespace
+
+// ── JsonWriter ─────────────────────────────────────────────────────────
+
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (depth_ == 0) return;
+    const uint64_t bit = 1ull << (depth_ - 1);
+    if (has_items_ & bit) out_ += ',';
+    has_items_ |= bit;
+}
+
+void JsonWriter::push(bool object) {
+    separate();
+    if (depth_ == kMaxDepth) throw std::length_error("JsonWriter: nesting too deep");
+    ++depth_;
+    has_items_ &= ~(1ull << (depth_ - 1));
+    out_ += object ? '{' : '[';
+}
+
+void JsonWriter::pop() {
+    --depth_;
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    push(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    pop();
+    out_ += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    push(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    pop();
+    out_ += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separate();
+    writeString(name);
+    out_ += ':';
+    after_key_ = true;
+    return *this;
+}
+
+void JsonWriter::writeString(std::string_view text) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    out_ += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (!needsEscape(c)) continue;
+        out_.append(text.data() + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"':  out_ += "\\\""; break;
+        case '\\': out_ += "\\\\"; break;
+        case '\b': out_ += "\\b"; break;
+        case '\f': out_ += "\\f"; break;
+        case '\n': out_ += "\\n"; break;
+        case '\r': out_ += "\\r"; break;
+        case '\t': out_ += "\\t"; break;
+        default: {
+            const char escape[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+            out_.append(escape, sizeof(escape));
+        }
+        }
+    }
+    out_.append(text.data() + run, text.size() - run);
+    out_ += '"';
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separate();
+    writeString(text);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+    return text ? value(std::string_view(text)) : null();
+}
+
+JsonWriter& JsonWriter::value(int64_t number) {
+    separate();
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number);
+    out_.append(buf, end);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t number) {
+    separate();
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number);
+    out_.append(buf, end);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    if (!std::isfinite(number)) return null();
+    separate();
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number);
+    out_.append(buf, end);
+    // Shortest round-trip form; like dump(), keep integral doubles recognisable
+    if (std::string_view(buf, static_cast<size_t>(end - buf)).find_first_of(".e") == std::string_view::npos) {
+        out_ += ".0";
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    out_ += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out_ += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+    separate();
+    out_ += json;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const nlohmann::json& doc) {
+    using Type = nlohmann::json::value_t;
+    switch (doc.type()) {
+    case Type::null:
+        return null();
+    case Type::object:
+        beginObject();
+        for (auto it = doc.begin(); it != doc.end(); ++it) {
+            key(it.key());
+            value(it.value());
+        }
+        return endObject();
+    case Type::array:
+        beginArray();
+        for (const auto& element : doc) value(element);
+        return endArray();
+    case Type::string:
+        return value(std::string_view(doc.get_ref<const std::string&>()));
+    case Type::boolean:
+        return value(doc.get<bool>());
+    case Type::number_integer:
+        return value(doc.get<int64_t>());
+    case Type::number_unsigned:
+        return value(doc.get<uint64_t>());
+    case Type::number_float:
+        return value(doc.get<double>());
+    default:
+        // binary / discarded never come out of our queries; defer to nlohmann
+        return raw(doc.dump());
+    }
+}
+
+// ── PooledBuffer ───────────────────────────────────────────────────────
+
+PooledBuffer::PooledBuffer() {
+    auto& pool = bufferPool();
+    if (!pool.empty()) {
+        buffer_ = std::move(pool.back());
+        pool.pop_back();
+    }
+}
+
+PooledBuffer::~PooledBuffer() {
+    auto& pool = bufferPool();
+    if (buffer_.capacity() > kMaxRetained || pool.size() >= kMaxPooled) return;
+    buffer_.clear();
+    pool.push_back(std::move(buffer_));
+}
+
+} // namespace hms
@@ -0,0 +1,175 @@
+#include "live_stream_hub.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+using namespace drogon;
+
+namespace hms {
+
+// Unchanged scenes still get a frame this often, so idle-connection timeouts
+// do not close the stream and late-joining proxies see an image
+static constexpr auto kRepublishInterval = std::chrono::seconds(10);
+
+LiveStreamHub::LiveStreamHub(std::shared_ptr<SnapshotCache> cache,
+                             std::chrono::milliseconds frame_interval,
+                             size_t max_backlog)
+    : cache_(std::move(cache)),
+      frame_interval_(frame_interval),
+      max_backlog_(max_backlog),
+      loop_thread_("LiveStreamHub")
+{
+    loop_thread_.run();
+}
+
+LiveStreamHub::~LiveStreamHub() {
+    std::lock_guard lock(mutex_);
+    for (auto& [camera_id, channel] : channels_) {
+        for (auto& sub : channel.subscribers) {
+            if (sub.sink.close) sub.sink.close();
+        }
+    }
+    channels_.clear();
+}
+
+void LiveStreamHub::subscribe(const std::string& camera_id,
+                              ResponseStreamPtr stream,
+                              std::weak_ptr<trantor::TcpConnection> conn) {
+    std::shared_ptr<drogon::ResponseStream> shared(std::move(stream));
+    Sink sink;
+    sink.send = [shared](const std::string& part) { return shared->send(part); };
+    sink.bytes_sent = [conn = std::move(conn)]() -> std::optional<uint64_t> {
+        auto c = conn.lock();
+        if (!c || c->disconnected()) return std::nullopt;
+        return c->bytesSent();
+    };
+    sink.close = [shared] { shared->close(); };
+    subscribe(camera_id, std::move(sink));
+}
+
+void LiveStreamHub::subscribe(const std::string& camera_id, Sink sink) {
+    Subscriber sub;
+    sub.sink = std::move(sink);
+    auto sent = sub.sink.bytes_sent();
+    if (!sent) return;
+    sub.bytes_sent_base = *sent;
+
+    bool start_reader = false;
+    {
+        std::lock_guard lock(mutex_);
+        auto [it, created] = channels_.try_emplace(camera_id);
+        auto& channel = it->second;
+        // Send the last frame right away so the viewer is not blank until the next one
+        if (channel.frame && !deliver(sub, channel.frame)) return;
+        channel.subscribers.push_back(std::move(sub));
+        start_reader = created;
+    }
+
+    spdlog::debug("LiveStreamHub: subscriber added for {}", camera_id);
+    if (start_reader) startReader(camera_id);
+}
+
+void LiveStreamHub::startReader(const std::string& camera_id) {
+    loop_thread_.getLoop()->queueInLoop([this, camera_id]() { tick(camera_id); });
+}
+
+void LiveStreamHub::tick(const std::string& camera_id) {
+    cache_->get(camera_id, [this, camera_id](DetectionClient::Result result,
+                                             const SnapshotCache::SnapshotPtr& snap) {
+        if (result == DetectionClient::Result::Ok && snap->status == k200OK) {
+            publish(camera_id, snap);
+        }
+
+        // Keep reading only while someone is watching
+        {
+            std::lock_guard lock(mutex_);
+            auto it = channels_.find(camera_id);
+            if (it == channels_.end()) return;
+            // Prune closed viewers here too — no frames are published while a camera is down
+            auto& subs = it->second.subscribers;
+            subs.erase(std::remove_if(subs.begin(), subs.end(),
+                                      [](const Subscriber& sub) { return !sub.sink.bytes_sent(); }),
+                       subs.end());
+            if (subs.empty()) {
+                // The next subscriber creates the channel again and starts a reader
+                channels_.erase(it);
+                spdlog::debug("LiveStreamHub: no subscribers left for {}, reader stopped", camera_id);
+                return;
+            }
+        }
+        loop_thread_.getLoop()->runAfter(
+            std::chrono::duration<double>(frame_interval_).count(),
+            [this, camera_id]() { tick(camera_id); });
+    });
+}
+
+void LiveStreamHub::publish(const std::string& camera_id,
+                            const SnapshotCache::SnapshotPtr& snap) {
+    std::lock_guard lock(mutex_);
+    auto it = channels_.find(camera_id);
+    if (it == channels_.end()) return;
+    auto& channel = it->second;
+
+    auto now = std::chrono::steady_clock::now();
+    if (snap->etag == channel.etag && now - channel.published_at < kRepublishInterval) {
+        return;
+    }
+
+    // Frame the part once; each send copies it into that viewer's output buffer
+    std::string part;
+    part.reserve(snap->body.size() + 128);
+    part += "--";
+    part += kBoundary;
+    part += "\r\nContent-Type: ";
+    part += snap->content_type;
+    part += "\r\nContent-Length: ";
+    part += std::to_string(snap->body.size());
+    part += "\r\n\r\n";
+    part += snap->body;
+    part += "\r\n";
+
+    channel.frame = std::make_shared<const std::string>(std::move(part));
+    channel.etag = snap->etag;
+    channel.published_at = now;
+    frames_published_.fetch_add(1, std::memory_order_relaxed);
+
+    auto& subs = channel.subscribers;
+    subs.erase(std::remove_if(subs.begin(), subs.end(),
+                              [&](Subscriber& sub) { return !deliver(sub, channel.frame); }),
+               subs.end());
+}
+
+bool LiveStreamHub::deliver(Subscriber& sub, const FramePtr& frame) {
+    auto bytes_sent = sub.sink.bytes_sent();
+    if (!bytes_sent) return false;
+
+    // Bytes handed to the stream but not yet written to the socket
+    auto sent = *bytes_sent - sub.bytes_sent_base;
+    auto backlog = sub.bytes_queued > sent ? sub.bytes_queued - sent : 0;
+    if (backlog > max_backlog_) {
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (!sub.sink.send(*frame)) return false;
+    sub.bytes_queued += frame->size();
+    frames_sent_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+LiveStreamHub::Stats LiveStreamHub::stats() const {
+    Stats s;
+    {
+        std::lock_guard lock(mutex_);
+        s.channels = channels_.size();
+        for (const auto& [camera_id, channel] : channels_) {
+            s.subscribers += channel.subscribers.size();
+        }
+    }
+    s.frames_published = frames_published_.load(std::memory_order_relaxed);
+    s.frames_sent = frames_sent_.load(std::memory_order_relaxed);
+    s.frames_dropped = frames_dropped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace hms
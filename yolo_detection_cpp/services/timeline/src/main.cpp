@@ -2,14 +2,33 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
+#include <algorithm>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <csignal>
 
 #include "config_manager.h"
+#include "db_executor.h"
 #include "db_pool.h"
+#include "db_router.h"
 #include "cors_filter.h"
+#include "detection_client.h"
+#include "embedding_client.h"
+#include "event_feed.h"
+#include "live_stream_hub.h"
+#include "metrics.h"
+#include "mp4_index.h"
+#include "recording_index.h"
+#include "recording_name.h"
+#include "response_cache.h"
+#include "semantic_index.h"
+#include "snapshot_cache.h"
+#include "sprite_sheets.h"
+#include "static_assets.h"
+#include "thumbnail_cache.h"
+#include "timeline_queries.h"
+#include "timeline_rollup.h"
+#include "tuning_config.h"
 #include "controllers/ui_api_controller.h"
 #include "controllers/media_controller.h"
 
@@ -51,36 +70,13 @@ std::string find_config_path(int argc, char* argv[]) {
     return "config.yaml";
 }
 
-// Read index.html and optionally replace <base href="/"> with the HA ingress path.
-// Returns empty string if index.html doesn't exist.
-std::string load_index_html(const std::string& static_abs, const std::string& ingress_path) {
-    auto index_path = fs::path(static_abs) / "index.html";
-    std::ifstream f(index_path);
-    if (!f.is_open()) return {};
-
-    std::string html((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-
-    if (!ingress_path.empty()) {
-        // Ensure trailing slash — required for <base href> to work as a directory
-        std::string base_href = ingress_path;
-        if (base_href.back() != '/') base_href += '/';
-
-        // Replace Angular's compiled <base href="/">
-        const std::string needle = R"(<base href="/">)";
-        auto pos = html.find(needle);
-        if (pos != std::string::npos) {
-            html.replace(pos, needle.size(), R"(<base href=")" + base_href + R"(">)");
-        }
-    }
-    return html;
-}
-
 } // anonymous namespace
 
 int main(int argc, char* argv[]) {
     try {
         auto config_path = find_config_path(argc, argv);
         auto config = hms::ConfigManager::load(config_path);
+        auto tuning = hms::TuningConfig::load(config_path);
 
         setup_logging(config.logging);
         spdlog::info("Starting yolo-timeline service v1.0.0");
@@ -97,14 +93,133 @@ int main(int argc, char* argv[]) {
         };
         auto db_pool = std::make_shared<hms::DbPool>(db_config);
 
+        hms::timeline_queries::set_prepared_statements(tuning.prepared_statements);
+
         // Configure controllers with shared dependencies
         hms::UiApiController::setDbPool(db_pool);
-        hms::UiApiController::setDetectionServiceUrl(config.timeline.detection_service_url);
-        hms::UiApiController::setOllamaUrl(config.timeline.ollama_url);
+        std::shared_ptr<hms::DbRouter> db_router;
+        if (!tuning.db_replicas.empty()) {
+            db_router = std::make_shared<hms::DbRouter>(
+                db_pool, db_config, tuning.db_replicas, hms::DbRouter::Options{
+                    .check_interval = std::chrono::seconds(tuning.db_replica_check_s),
+                    .max_lag_seconds = tuning.db_replica_max_lag_s,
+                });
+            db_router->start();
+            hms::UiApiController::setDbRouter(db_router);
+            spdlog::info("Routing reads to {} replica(s)", tuning.db_replicas.size());
+        }
+        if (tuning.db_executor) {
+            // One thread per connection: jobs wait in the executor's queue, not the pool
+            hms::UiApiController::setDbExecutor(std::make_shared<hms::DbExecutor>(
+                hms::DbExecutor::Options{
+                    .threads = static_cast<size_t>(config.database.pool_size),
+                    .max_queue = static_cast<size_t>(tuning.db_executor_queue),
+                }));
+        }
+        if (!config.timeline.detection_service_url.empty()) {
+            auto detection_client = std::make_shared<hms::DetectionClient>(
+                config.timeline.detection_service_url, hms::DetectionClient::Options{});
+            auto snapshot_cache = std::make_shared<hms::SnapshotCache>(
+                detection_client, std::chrono::milliseconds(tuning.snapshot_refresh_ms));
+            hms::UiApiController::setDetectionClient(detection_client);
+            hms::UiApiController::setSnapshotCache(snapshot_cache);
+            hms::UiApiController::setLiveStreamHub(std::make_shared<hms::LiveStreamHub>(
+                snapshot_cache, std::chrono::milliseconds(tuning.snapshot_refresh_ms)));
+        }
+        if (tuning.event_stream) {
+            hms::UiApiController::setEventFeed(std::make_shared<hms::EventFeed>(
+                db_pool, hms::EventFeed::Options{
+                    .poll_interval = std::chrono::milliseconds(tuning.event_stream_poll_ms),
+                    .lookback = std::chrono::seconds(tuning.event_stream_lookback_s),
+                }));
+        }
+        if (!config.timeline.ollama_url.empty()) {
+            hms::UiApiController::setEmbeddingClient(std::make_shared<hms::EmbeddingClient>(
+                config.timeline.ollama_url, "nomic-embed-text"));
+        }
+        if (tuning.semantic_index) {
+            hms::SemanticIndex::Options index_options;
+            index_options.poll_interval = std::chrono::seconds(tuning.semantic_index_poll_s);
+            index_options.reconcile_interval =
+                std::chrono::seconds(tuning.semantic_index_reconcile_s);
+            index_options.min_similarity = static_cast<float>(tuning.semantic_min_similarity);
+            index_options.graph = tuning.semantic_index_graph;
+            if (auto storage = hms::VectorMatrix::parseStorage(tuning.semantic_exact_storage)) {
+                index_options.exact_storage = *storage;
+            } else {
+                spdlog::warn("Unknown semantic_exact_storage '{}', using f32",
+                             tuning.semantic_exact_storage);
+            }
+            auto semantic_index = std::make_shared<hms::SemanticIndex>(db_pool, index_options);
+            semantic_index->start();
+            hms::UiApiController::setSemanticIndex(semantic_index);
+        }
+        if (tuning.timeline_rollup) {
+            auto rollup = std::make_shared<hms::TimelineRollup>(db_pool, hms::TimelineRollup::Options{
+                .poll_interval = std::chrono::seconds(tuning.timeline_rollup_poll_s),
+                .persist_path = tuning.timeline_rollup_path,
+            });
+            rollup->start();
+            hms::UiApiController::setTimelineRollup(rollup);
+        }
+        hms::UiApiController::setHybridSearch(std::chrono::milliseconds(tuning.hybrid_budget_ms),
+                                              tuning.hybrid_rrf_k);
         hms::MediaController::setEventsDir(config.timeline.events_dir);
         hms::MediaController::setSnapshotsDir(config.timeline.snapshots_dir);
+        if (tuning.media_fd_cache > 0) {
+            hms::MediaController::setFileCache(std::make_shared<hms::MediaFileCache>(
+                hms::MediaFileCache::Options{.max_open = static_cast<size_t>(tuning.media_fd_cache)}));
+        }
+        if (tuning.thumbnail_cache_mb > 0) {
+            hms::MediaController::setThumbnailCache(std::make_shared<hms::ThumbnailCache>(
+                hms::ThumbnailCache::Options{
+                    .max_memory_bytes = static_cast<size_t>(tuning.thumbnail_cache_mb) * 1024 * 1024,
+                    .disk_dir = tuning.thumbnail_dir,
+                    .max_disk_bytes = static_cast<size_t>(tuning.thumbnail_disk_mb) * 1024 * 1024}));
+        }
+        if (tuning.sprite_sheets) {
+            hms::UiApiController::setSpriteSheets(std::make_shared<hms::SpriteSheets>(
+                hms::SpriteSheets::Options{
+                    .snapshots_dir = config.timeline.snapshots_dir,
+                    .max_tile_bytes = static_cast<size_t>(tuning.sprite_tile_cache_mb) * 1024 * 1024}));
+        }
+        std::shared_ptr<hms::Mp4IndexCache> mp4_index;
+        if (tuning.mp4_index_mb > 0) {
+            mp4_index = std::make_shared<hms::Mp4IndexCache>(hms::Mp4IndexCache::Options{
+                .events_dir = config.timeline.events_dir,
+                .max_bytes = static_cast<size_t>(tuning.mp4_index_mb) * 1024 * 1024});
+            mp4_index->start();
+            hms::MediaController::setMp4Index(mp4_index);
+            hms::UiApiController::setMp4Index(mp4_index);
+        }
         hms::CorsFilter::setAllowedOrigins(config.timeline.cors_origins);
 
+        // Recording filename index — replaces per-event stat() in /api/events
+        auto recording_index = std::make_shared<hms::RecordingIndex>(config.timeline.events_dir);
+        std::shared_ptr<hms::ResponseCache> response_cache;
+        if (tuning.response_cache) {
+            response_cache = std::make_shared<hms::ResponseCache>(hms::ResponseCache::Options{
+                .max_bytes = static_cast<size_t>(tuning.response_cache_mb) * 1024 * 1024,
+                .live_ttl = std::chrono::seconds(tuning.response_cache_live_ttl_s),
+                .final_ttl = std::chrono::seconds(tuning.response_cache_final_ttl_s),
+            });
+            hms::UiApiController::setResponseCache(response_cache);
+        }
+        if (response_cache || mp4_index) {
+            recording_index->setOnAdded([response_cache, mp4_index](const std::string& filename) {
+                // A new recording means a new (or finished) event for that camera and day
+                if (response_cache) {
+                    if (auto name = hms::RecordingName::parse(filename)) {
+                        response_cache->invalidate(name->camera_id, name->date);
+                    }
+                }
+                // Index it before anyone asks; retried until the muxer writes moov
+                if (mp4_index) mp4_index->enqueue(filename);
+            });
+        }
+        recording_index->start();
+        hms::UiApiController::setRecordingIndex(recording_index);
+
         // Resolve static files path (absolute)
         std::string static_path = config.timeline.static_files_path;
         if (!fs::path(static_path).is_absolute()) {
@@ -138,21 +253,26 @@ int main(int argc, char* argv[]) {
         //   /patio, /side_window, ...  → index.html (Angular client routes)
         //   /main-ABC.js               → static asset from dist/browser/
         //   /styles-XYZ.css            → static asset
+        //
+        // The whole tree is read into memory at startup (StaticAssets), with
+        // Brotli/gzip variants precomputed; rebuilding the UI needs a restart.
         // -------------------------------------------------------------------
-        const std::string captured_static = static_abs;
+        auto static_assets = std::make_shared<hms::StaticAssets>(static_abs, hms::StaticAssets::Options{});
+        if (!static_assets->load()) {
+            spdlog::warn("No index.html under {}; the UI will not be served", static_abs);
+        }
 
         app.registerHandlerViaRegex(
             R"(/(.*))",
-            [captured_static](const drogon::HttpRequestPtr& req,
-                               std::function<void(const drogon::HttpResponsePtr&)>&& cb,
-                               const std::string& sub_path) {
+            [static_assets](const drogon::HttpRequestPtr& req,
+                            std::function<void(const drogon::HttpResponsePtr&)>&& cb,
+                            const std::string& sub_path) {
 
                 // sub_path is everything after the leading /
                 // Try to serve as a static asset first (JS, CSS, fonts, favicons, etc.)
-                if (!sub_path.empty()) {
-                    auto file_path = fs::path(captured_static) / sub_path;
-                    if (fs::exists(file_path) && fs::is_regular_file(file_path)) {
-                        cb(drogon::HttpResponse::newFileResponse(file_path.string()));
+                if (!sub_path.empty() && sub_path != "index.html") {
+                    if (auto resp = static_assets->serve(req, sub_path)) {
+                        cb(resp);
                         return;
                     }
                 }
@@ -160,18 +280,8 @@ int main(int argc, char* argv[]) {
                 // Not a static file — serve index.html (Angular client-side routing)
                 // Inject X-Ingress-Path as <base href> for HA ingress support
                 auto ingress_path = std::string(req->getHeader("X-Ingress-Path"));
-                auto html = load_index_html(captured_static, ingress_path);
-
-                if (html.empty()) {
-                    cb(drogon::HttpResponse::newNotFoundResponse());
-                    return;
-                }
-
-                auto resp = drogon::HttpResponse::newHttpResponse();
-                resp->setStatusCode(drogon::k200OK);
-                resp->setContentTypeCode(drogon::CT_TEXT_HTML);
-                resp->setBody(std::move(html));
-                cb(resp);
+                auto resp = static_assets->serveIndex(req, ingress_path);
+                cb(resp ? resp : drogon::HttpResponse::newNotFoundResponse());
             },
             {drogon::Get}
         );
@@ -186,11 +296,34 @@ int main(int argc, char* argv[]) {
                 resp->addHeader("Access-Control-Allow-Headers",
                                 "Content-Type, Authorization, Accept");
                 if (allow_origin != "*") {
-                    resp->addHeader("Vary", "Origin");
+                    // Keep any Vary the handler set (e.g. Accept-Encoding)
+                    const auto& vary = resp->getHeader("Vary");
+                    resp->addHeader("Vary", vary.empty() ? "Origin" : vary + ", Origin");
                 }
             }
         );
 
+        if (tuning.metrics) {
+            // Latency runs from when the request was parsed to when the
+            // response is handed back; routes are labelled by pattern so
+            // path parameters do not multiply the series
+            app.registerPreRoutingAdvice([](const drogon::HttpRequestPtr&) {
+                hms::Metrics::global().requestStarted();
+            });
+            app.registerPostHandlingAdvice(
+                [](const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) {
+                    const auto latency_us = trantor::Date::now().microSecondsSinceEpoch() -
+                                            req->creationDate().microSecondsSinceEpoch();
+                    hms::Metrics::global().recordRequest(
+                        req->methodString(), req->matchedPathPattern(),
+                        static_cast<int>(resp->statusCode()),
+                        static_cast<uint64_t>(std::max<int64_t>(latency_us, 0)),
+                        resp->getBody().size());
+                }
+            );
+            spdlog::info("Prometheus metrics at /metrics");
+        }
+
         spdlog::info("Listening on {}:{}", config.timeline.host, config.timeline.port);
         spdlog::info("Angular UI: http://{}:{}/", config.timeline.host, config.timeline.port);
 
@@ -0,0 +1,99 @@
+#include "media_file_cache.h"
+
+#include <spdlog/spdlog.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hms {
+
+MediaFileCache::File::~File() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+MediaFileCache::MediaFileCache(Options options)
+    : options_(options), entries_(options.max_open)
+{
+    // Runs under mutex_ (from put() inside acquire)
+    entries_.setOnEvict([this](const std::string&, Entry& entry) { retire(std::move(entry.file)); });
+}
+
+void MediaFileCache::retire(FilePtr file) {
+    if (file) retired_.emplace_back(std::chrono::steady_clock::now(), std::move(file));
+}
+
+std::optional<MediaFileCache::Handle> MediaFileCache::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return std::nullopt;
+    Handle handle;
+    handle.file = std::make_shared<const File>(fd, path);
+    if (::fstat(fd, &handle.st) != 0 || !S_ISREG(handle.st.st_mode)) return std::nullopt;
+    opens_.fetch_add(1, std::memory_order_relaxed);
+    return handle;
+}
+
+std::optional<MediaFileCache::Handle> MediaFileCache::acquire(const std::string& path) {
+    const auto now = std::chrono::steady_clock::now();
+    Handle handle;
+    bool revalidate = false;
+    {
+        std::lock_guard lock(mutex_);
+        while (!retired_.empty() && now - retired_.front().first > options_.close_grace) {
+            retired_.pop_front();
+        }
+        if (const auto* entry = entries_.peek(path)) {
+            handle.file = entry->file;
+            revalidate = now - entry->checked > options_.revalidate;
+        }
+    }
+
+    if (handle.file) {
+        // Deleted (no links left) or replaced under the same name: reopen
+        bool stale = ::fstat(handle.file->fd(), &handle.st) != 0 || handle.st.st_nlink == 0;
+        if (!stale && revalidate) {
+            struct stat current {};
+            stale = ::stat(path.c_str(), &current) != 0 ||
+                    current.st_ino != handle.st.st_ino || current.st_dev != handle.st.st_dev;
+        }
+        if (!stale) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            if (revalidate) {
+                std::lock_guard lock(mutex_);
+                if (const auto* entry = entries_.peek(path); entry && entry->file == handle.file) {
+                    entries_.put(path, Entry{handle.file, now});
+                }
+            }
+            return handle;
+        }
+        reopened_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard lock(mutex_);
+        if (const auto* entry = entries_.peek(path); entry && entry->file == handle.file) {
+            retire(handle.file);
+            entries_.erase(path);
+        }
+    }
+
+    auto opened = open(path);
+    if (!opened) return std::nullopt;
+
+    std::lock_guard lock(mutex_);
+    if (entries_.peek(path)) {
+        // Another request opened it meanwhile; keep theirs cached, ours is retired
+        // with the handle once this response is done
+        retire(opened->file);
+        return opened;
+    }
+    entries_.put(path, Entry{opened->file, now});
+    return opened;
+}
+
+MediaFileCache::Stats MediaFileCache::stats() const {
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.opens = opens_.load(std::memory_order_relaxed);
+    s.reopened = reopened_.load(std::memory_order_relaxed);
+    std::lock_guard lock(mutex_);
+    s.open_fds = entries_.size() + retired_.size();
+    return s;
+}
+
+} // namespace hms
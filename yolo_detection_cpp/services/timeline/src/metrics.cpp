@@ -0,0 +1,318 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+
+namespace hms {
+
+namespace {
+
+/// Shard of the calling thread: threads are numbered as they first record
+size_t shardIndex() {
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed) % Metrics::kShards;
+    return index;
+}
+
+uint64_t fnv1a(std::string_view a, std::string_view b) {
+    uint64_t h = 1469598103934665603ull;
+    for (char c : a) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    h = (h ^ 0xff) * 1099511628211ull;     // separator, so ("ab","c") != ("a","bc")
+    for (char c : b) h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    return h;
+}
+
+/// Upper bounds of the exported Prometheus buckets, in seconds
+constexpr double kBucketBounds[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                    0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0};
+
+void appendNumber(std::string& out, double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    out += buf;
+}
+
+void appendLabelValue(std::string& out, std::string_view value) {
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+}
+
+void appendHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+/// name{labels[,extra]} value
+void appendSample(std::string& out, std::string_view name, std::string_view labels,
+                  std::string_view extra, double value) {
+    out += name;
+    if (!labels.empty() || !extra.empty()) {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra.empty()) out += ',';
+        out += extra;
+        out += '}';
+    }
+    out += ' ';
+    appendNumber(out, value);
+    out += '\n';
+}
+
+/// _bucket / _sum / _count lines of one histogram. A fine bucket is counted
+/// under the first exported bound it lies entirely below, so the exported
+/// buckets are exact to the histogram's 12.5% resolution.
+void appendHistogram(std::string& out, const std::string& name, std::string_view labels,
+                     const Metrics::Histogram::Snapshot& snap) {
+    const std::string bucket = name + "_bucket";
+    size_t fine = 0;
+    uint64_t cumulative = 0;
+    for (double bound : kBucketBounds) {
+        const auto bound_us = static_cast<uint64_t>(bound * 1e6);
+        while (fine < Metrics::Histogram::kBuckets - 1 &&
+               Metrics::Histogram::bucketLower(fine + 1) <= bound_us + 1) {
+            cumulative += snap.counts[fine++];
+        }
+        char le[40];
+        std::snprintf(le, sizeof(le), "le=\"%g\"", bound);
+        appendSample(out, bucket, labels, le, static_cast<double>(cumulative));
+    }
+    appendSample(out, bucket, labels, "le=\"+Inf\"", static_cast<double>(snap.count));
+    appendSample(out, name + "_sum", labels, "", static_cast<double>(snap.sum_us) / 1e6);
+    appendSample(out, name + "_count", labels, "", static_cast<double>(snap.count));
+}
+
+void appendQuantiles(std::string& out, const std::string& name, std::string_view labels,
+                     const Metrics::Histogram::Snapshot& snap) {
+    for (const char* q : {"0.5", "0.9", "0.99"}) {
+        std::string extra = "quantile=\"";
+        extra += q;
+        extra += '"';
+        appendSample(out, name, labels, extra, snap.quantile(std::atof(q)) / 1e6);
+    }
+}
+
+} // anonymous namespace
+
+void Metrics::Counter::add(uint64_t n) {
+    cells_[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& cell : cells_) total += cell.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+size_t Metrics::Histogram::bucketOf(uint64_t us) {
+    if (us < kSubBuckets) return static_cast<size_t>(us);
+    const int exponent = std::bit_width(us) - 1;
+    if (exponent >= kMaxExponent) return kBuckets - 1;
+    const auto sub = static_cast<size_t>((us >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return static_cast<size_t>(exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t Metrics::Histogram::bucketLower(size_t i) {
+    if (i < kSubBuckets) return i;
+    const int exponent = static_cast<int>(i / kSubBuckets) + kSubBucketBits - 1;
+    const uint64_t sub = i % kSubBuckets;
+    return (kSubBuckets + sub) << (exponent - kSubBucketBits);
+}
+
+void Metrics::Histogram::record(uint64_t us) {
+    auto& shard = shards_[shardIndex()];
+    shard.counts[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_us.fetch_add(us, std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Snapshot Metrics::Histogram::snapshot() const {
+    Snapshot snap;
+    for (const auto& shard : shards_) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            const auto n = shard.counts[i].load(std::memory_order_relaxed);
+            snap.counts[i] += n;
+            snap.count += n;
+        }
+        snap.sum_us += shard.sum_us.load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+double Metrics::Histogram::Snapshot::quantile(double q) const {
+    if (count == 0) return 0.0;
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // Exact below kSubBuckets, the middle of the bucket above
+            if (i < kSubBuckets || i == kBuckets - 1) return static_cast<double>(bucketLower(i));
+            return (static_cast<double>(bucketLower(i)) + static_cast<double>(bucketLower(i + 1))) / 2.0;
+        }
+    }
+    return static_cast<double>(bucketLower(kBuckets - 1));
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Route* Metrics::findOrAdd(std::string_view method, std::string_view route) {
+    const uint64_t hash = fnv1a(method, route);
+    auto matches = [&](const Route* r) {
+        return r->hash == hash && r->method == method && r->route == route;
+    };
+
+    // Lock-free probe; slots are only ever filled, never cleared
+    size_t slot = hash & (kRouteSlots - 1);
+    for (size_t i = 0; i < kRouteSlots; ++i, slot = (slot + 1) & (kRouteSlots - 1)) {
+        auto* r = slots_[slot].load(std::memory_order_acquire);
+        if (!r) break;
+        if (matches(r)) return r;
+    }
+
+    std::lock_guard lock(add_mutex_);
+    slot = hash & (kRouteSlots - 1);
+    for (size_t i = 0; i < kRouteSlots; ++i, slot = (slot + 1) & (kRouteSlots - 1)) {
+        auto* r = slots_[slot].load(std::memory_order_relaxed);
+        if (!r) break;
+        if (matches(r)) return r;      // added by another thread meanwhile
+    }
+    if (routes_.size() >= kMaxRoutes) return &overflow_;
+    routes_.push_back(std::make_unique<Route>(method, route, hash));
+    slots_[slot].store(routes_.back().get(), std::memory_order_release);
+    return routes_.back().get();
+}
+
+void Metrics::recordRequest(std::string_view method, std::string_view route, int status,
+                            uint64_t latency_us, uint64_t body_bytes) {
+    finished_.add();
+    auto* r = findOrAdd(method, route.empty() ? std::string_view("unmatched") : route);
+    r->latency.record(latency_us);
+    r->responses[static_cast<size_t>(std::clamp(status / 100, 1, 5) - 1)].add();
+    if (body_bytes) r->body_bytes.add(body_bytes);
+}
+
+void Metrics::appendGauge(std::string& out, const char* name, const char* help, double value) {
+    appendHeader(out, name, "gauge", help);
+    appendSample(out, name, "", "", value);
+}
+
+void Metrics::appendCounter(std::string& out, const char* name, const char* help, double value) {
+    appendHeader(out, name, "counter", help);
+    appendSample(out, name, "", "", value);
+}
+
+size_t Metrics::routeCount() const {
+    std::lock_guard lock(add_mutex_);
+    return routes_.size();
+}
+
+void Metrics::render(std::string& out) const {
+    std::vector<const Route*> routes;
+    {
+        std::lock_guard lock(add_mutex_);
+        for (const auto& r : routes_) routes.push_back(r.get());
+    }
+    if (overflow_.latency.snapshot().count > 0) routes.push_back(&overflow_);
+    std::sort(routes.begin(), routes.end(), [](const Route* a, const Route* b) {
+        return a->route != b->route ? a->route < b->route : a->method < b->method;
+    });
+
+    std::vector<std::string> labels;
+    std::vector<Histogram::Snapshot> snaps;
+    labels.reserve(routes.size());
+    snaps.reserve(routes.size());
+    for (const auto* r : routes) {
+        std::string l = "method=\"";
+        appendLabelValue(l, r->method);
+        l += "\",route=\"";
+        appendLabelValue(l, r->route);
+        l += '"';
+        labels.push_back(std::move(l));
+        snaps.push_back(r->latency.snapshot());
+    }
+
+    appendHeader(out, "hms_http_requests_total", "counter", "HTTP responses by route and status class");
+    for (size_t i = 0; i < routes.size(); ++i) {
+        for (size_t c = 0; c < 5; ++c) {
+            const auto n = routes[i]->responses[c].value();
+            if (n == 0) continue;
+            std::string code = "code=\"";
+            code += static_cast<char>('1' + c);
+            code += "xx\"";
+            appendSample(out, "hms_http_requests_total", labels[i], code, static_cast<double>(n));
+        }
+    }
+
+    appendHeader(out, "hms_http_request_duration_seconds", "histogram",
+                 "Time from request arrival to response, by route");
+    for (size_t i = 0; i < routes.size(); ++i) {
+        appendHistogram(out, "hms_http_request_duration_seconds", labels[i], snaps[i]);
+    }
+
+    appendHeader(out, "hms_http_request_duration_quantile_seconds", "gauge",
+                 "Latency quantiles since start, by route");
+    for (size_t i = 0; i < routes.size(); ++i) {
+        appendQuantiles(out, "hms_http_request_duration_quantile_seconds", labels[i], snaps[i]);
+    }
+
+    appendHeader(out, "hms_http_response_body_bytes_total", "counter",
+                 "Response body bytes held in memory, by route (file bodies are counted in hms_media_bytes_total)");
+    for (size_t i = 0; i < routes.size(); ++i) {
+        appendSample(out, "hms_http_response_body_bytes_total", labels[i], "",
+                     static_cast<double>(routes[i]->body_bytes.value()));
+    }
+
+    const auto started = started_.value();
+    const auto finished = finished_.value();
+    appendHeader(out, "hms_http_requests_in_flight", "gauge", "Requests in a handler");
+    appendSample(out, "hms_http_requests_in_flight", "", "",
+                 started > finished ? static_cast<double>(started - finished) : 0.0);
+
+    struct SeriesInfo {
+        Series series;
+        const char* name;
+        const char* help;
+    };
+    static constexpr SeriesInfo kSeries[] = {
+        {Series::DbWait, "hms_db_wait_seconds", "Wait for a DB executor thread"},
+        {Series::DbQuery, "hms_db_query_seconds", "DB executor job run time"},
+        {Series::Upstream, "hms_upstream_request_duration_seconds", "Detection service proxy calls"},
+        {Series::Embedding, "hms_embedding_request_duration_seconds", "Ollama embedding calls"},
+    };
+    for (const auto& info : kSeries) {
+        const auto snap = series_[static_cast<size_t>(info.series)].snapshot();
+        appendHeader(out, info.name, "histogram", info.help);
+        appendHistogram(out, info.name, "", snap);
+    }
+
+    appendHeader(out, "hms_media_bytes_total", "counter", "Media bytes served by kind");
+    static constexpr const char* kMediaKinds[] = {"recording", "snapshot", "thumbnail"};
+    for (size_t i = 0; i < media_.size(); ++i) {
+        std::string kind = "kind=\"";
+        kind += kMediaKinds[i];
+        kind += '"';
+        appendSample(out, "hms_media_bytes_total", kind, "", static_cast<double>(media_[i].value()));
+    }
+}
+
+} // namespace hms
@@ -0,0 +1,521 @@
+#include "mp4_index.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace hms {
+
+namespace {
+
+/// moov boxes above this are refused (a 5 minute clip's is well under 1 MiB)
+constexpr uint64_t kMaxMoovBytes = 64ull * 1024 * 1024;
+/// Boxes before the first mdat (ftyp, free, ...) copied into the head
+constexpr uint64_t kMaxPrefixBytes = 1024 * 1024;
+/// Boxes after moov (e.g. a trailing free or udta) moved into the head with it
+constexpr uint64_t kMaxTrailingBytes = 64 * 1024;
+/// Sanity cap on a track's sample count
+constexpr uint32_t kMaxSamples = 1u << 24;
+
+constexpr uint32_t fourcc(const char (&s)[5]) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(s[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(s[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(s[2])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[3]));
+}
+
+uint32_t be32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t be64(const unsigned char* p) {
+    return (static_cast<uint64_t>(be32(p)) << 32) | be32(p + 4);
+}
+
+void putBe32(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+void putBe64(unsigned char* p, uint64_t v) {
+    putBe32(p, static_cast<uint32_t>(v >> 32));
+    putBe32(p + 4, static_cast<uint32_t>(v));
+}
+
+/// Box types are four printable ASCII characters; anything else is media data
+bool plausibleType(uint32_t type) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        auto c = static_cast<unsigned char>(type >> shift);
+        if (c < 0x20 || c > 0x7e) return false;
+    }
+    return true;
+}
+
+bool readAt(int fd, uint64_t offset, void* buf, size_t n) {
+    auto* out = static_cast<unsigned char*>(buf);
+    while (n > 0) {
+        ssize_t r = ::pread(fd, out, n, static_cast<off_t>(offset));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        out += r;
+        offset += static_cast<uint64_t>(r);
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+/// A box's payload inside an in-memory moov
+struct Box {
+    uint32_t type = 0;
+    unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+/// Call fn for each box in [p, p + n); false when a box overruns the buffer.
+/// Fewer than 8 bytes left over (terminator padding) are ignored.
+template <typename Fn>
+bool forEachBox(unsigned char* p, size_t n, Fn&& fn) {
+    size_t pos = 0;
+    while (n - pos >= 8) {
+        uint64_t size = be32(p + pos);
+        const uint32_t type = be32(p + pos + 4);
+        size_t header = 8;
+        if (size == 1) {
+            if (n - pos < 16) return false;
+            size = be64(p + pos + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = n - pos;
+        }
+        if (size < header || size > n - pos) return false;
+        if (!fn(Box{type, p + pos + header, static_cast<size_t>(size - header)})) return false;
+        pos += static_cast<size_t>(size);
+    }
+    return true;
+}
+
+/// Sample tables of one trak
+struct Track {
+    uint32_t handler = 0;
+    uint32_t timescale = 0;
+    uint64_t duration = 0;
+    Box stss, stts, stsc, stsz, stco;
+    bool co64 = false;
+};
+
+bool collectTrack(const Box& box, Track& track) {
+    return forEachBox(box.data, box.size, [&](const Box& child) {
+        switch (child.type) {
+        case fourcc("mdia"):
+        case fourcc("minf"):
+        case fourcc("stbl"):
+            return collectTrack(child, track);
+        case fourcc("mdhd"):
+            if (child.size >= 4 && child.data[0] == 1 && child.size >= 32) {
+                track.timescale = be32(child.data + 20);
+                track.duration = be64(child.data + 24);
+            } else if (child.size >= 20) {
+                track.timescale = be32(child.data + 12);
+                track.duration = be32(child.data + 16);
+            }
+            return true;
+        case fourcc("hdlr"):
+            if (child.size >= 12) track.handler = be32(child.data + 8);
+            return true;
+        case fourcc("stss"): track.stss = child; return true;
+        case fourcc("stts"): track.stts = child; return true;
+        case fourcc("stsc"): track.stsc = child; return true;
+        case fourcc("stsz"): track.stsz = child; return true;
+        case fourcc("stco"): track.stco = child; track.co64 = false; return true;
+        case fourcc("co64"): track.stco = child; track.co64 = true; return true;
+        default:
+            return true;
+        }
+    });
+}
+
+/// Entry count of a full-box table whose entries start after the count,
+/// or nullopt when the entries overrun the box
+std::optional<uint32_t> tableCount(const Box& box, size_t entry_size) {
+    if (!box.data || box.size < 8) return std::nullopt;
+    const uint32_t count = be32(box.data + 4);
+    if ((box.size - 8) / entry_size < count) return std::nullopt;
+    return count;
+}
+
+bool computeKeyframes(const Track& track, std::vector<Mp4Index::Keyframe>& out, uint64_t& end_dts) {
+    auto stts_n = tableCount(track.stts, 8);
+    auto stsc_n = tableCount(track.stsc, 12);
+    auto chunk_n = tableCount(track.stco, track.co64 ? 8 : 4);
+    if (!stts_n || !stsc_n || !chunk_n || *stsc_n == 0 || !track.stsz.data || track.stsz.size < 12) {
+        return false;
+    }
+    const uint32_t uniform_size = be32(track.stsz.data + 4);
+    const uint32_t sample_n = be32(track.stsz.data + 8);
+    if (sample_n > kMaxSamples) return false;
+    if (uniform_size == 0 && (track.stsz.size - 12) / 4 < sample_n) return false;
+    // Without stss every sample is a sync sample
+    std::optional<uint32_t> sync_n;
+    if (track.stss.data) {
+        sync_n = tableCount(track.stss, 4);
+        if (!sync_n) return false;
+    }
+
+    const unsigned char* stts = track.stts.data + 8;
+    const unsigned char* stsc = track.stsc.data + 8;
+    const unsigned char* stco = track.stco.data + 8;
+    const unsigned char* sizes = track.stsz.data + 12;
+    const unsigned char* stss = sync_n ? track.stss.data + 8 : nullptr;
+
+    uint64_t dts = 0;
+    uint32_t stts_i = 0;
+    uint32_t stts_left = *stts_n > 0 ? be32(stts) : 0;
+    uint32_t stsc_i = 0;
+    uint32_t sync_i = 0;
+    uint32_t sample = 1;
+    for (uint32_t chunk = 1; chunk <= *chunk_n && sample <= sample_n; ++chunk) {
+        while (stsc_i + 1 < *stsc_n && be32(stsc + 12 * (stsc_i + 1)) <= chunk) ++stsc_i;
+        const uint32_t per_chunk = be32(stsc + 12 * stsc_i + 4);
+        uint64_t offset = track.co64 ? be64(stco + 8 * (chunk - 1)) : be32(stco + 4 * (chunk - 1));
+        for (uint32_t i = 0; i < per_chunk && sample <= sample_n; ++i, ++sample) {
+            bool sync = true;
+            if (stss) {
+                while (sync_i < *sync_n && be32(stss + 4 * sync_i) < sample) ++sync_i;
+                sync = sync_i < *sync_n && be32(stss + 4 * sync_i) == sample;
+            }
+            if (sync) {
+                out.push_back({static_cast<double>(dts) / track.timescale, offset});
+            }
+            offset += uniform_size ? uniform_size : be32(sizes + 4 * (sample - 1));
+            while (stts_left == 0 && stts_i + 1 < *stts_n) stts_left = be32(stts + 8 * ++stts_i);
+            if (stts_left > 0) {
+                dts += be32(stts + 8 * stts_i + 4);
+                --stts_left;
+            }
+        }
+    }
+    end_dts = dts;
+    return true;
+}
+
+/// Shift the chunk offsets of every track that point into [from, to) by delta.
+/// False when an offset points past `to` (into moov or what follows it) or
+/// a 32-bit stco entry would overflow.
+bool shiftChunkOffsets(const Box& box, uint64_t from, uint64_t to, uint64_t delta) {
+    return forEachBox(box.data, box.size, [&](const Box& child) {
+        switch (child.type) {
+        case fourcc("trak"):
+        case fourcc("mdia"):
+        case fourcc("minf"):
+        case fourcc("stbl"):
+            return shiftChunkOffsets(child, from, to, delta);
+        case fourcc("stco"):
+        case fourcc("co64"): {
+            const bool wide = child.type == fourcc("co64");
+            auto count = tableCount(child, wide ? 8 : 4);
+            if (!count) return false;
+            unsigned char* entry = child.data + 8;
+            for (uint32_t i = 0; i < *count; ++i, entry += wide ? 8 : 4) {
+                uint64_t offset = wide ? be64(entry) : be32(entry);
+                if (offset >= to) return false;
+                if (offset < from) continue;
+                offset += delta;
+                if (wide) {
+                    putBe64(entry, offset);
+                } else if (offset > std::numeric_limits<uint32_t>::max()) {
+                    return false;
+                } else {
+                    putBe32(entry, static_cast<uint32_t>(offset));
+                }
+            }
+            return true;
+        }
+        default:
+            return true;
+        }
+    });
+}
+
+} // anonymous namespace
+
+Mp4Index::Status Mp4Index::parse(int fd, uint64_t file_size, Mp4Index& out) {
+    out = Mp4Index{};
+    out.file_size = file_size;
+
+    // Top-level boxes: find moov and the first mdat without reading media data
+    struct TopBox {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t header = 0;
+    };
+    std::optional<TopBox> moov;
+    std::optional<uint64_t> first_mdat;
+    uint64_t offset = 0;
+    while (offset < file_size) {
+        unsigned char header[16];
+        if (file_size - offset < 8 || !readAt(fd, offset, header, 8)) return Status::Incomplete;
+        uint64_t size = be32(header);
+        const uint32_t type = be32(header + 4);
+        uint64_t header_size = 8;
+        if (size == 1) {
+            if (file_size - offset < 16 || !readAt(fd, offset + 8, header + 8, 8)) return Status::Incomplete;
+            size = be64(header + 8);
+            header_size = 16;
+        } else if (size == 0) {
+            size = file_size - offset;
+        }
+        if (!plausibleType(type) || size < header_size) {
+            // Garbage after the first box is most likely an mdat whose size
+            // the muxer has not patched in yet
+            return offset == 0 ? Status::Invalid : Status::Incomplete;
+        }
+        if (size > file_size - offset) return Status::Incomplete;
+
+        if (type == fourcc("moov")) {
+            if (moov) return Status::Invalid;
+            moov = TopBox{offset, size, header_size};
+        } else if (type == fourcc("mdat")) {
+            if (!first_mdat) first_mdat = offset;
+        } else if (type == fourcc("moof")) {
+            return Status::Invalid;   // fragmented MP4: no single sample table
+        }
+        offset += size;
+    }
+    if (!moov) return Status::Incomplete;
+    if (moov->size > kMaxMoovBytes) return Status::Invalid;
+
+    std::string moov_bytes(static_cast<size_t>(moov->size), '\0');
+    if (!readAt(fd, moov->offset, moov_bytes.data(), moov_bytes.size())) return Status::Incomplete;
+    auto* moov_data = reinterpret_cast<unsigned char*>(moov_bytes.data());
+    const Box moov_box{fourcc("moov"), moov_data + moov->header,
+                       static_cast<size_t>(moov->size - moov->header)};
+
+    // Keyframes come from the first video track
+    std::optional<Track> video;
+    bool parsed = forEachBox(moov_box.data, moov_box.size, [&](const Box& child) {
+        if (child.type != fourcc("trak") || video) return true;
+        Track track;
+        if (!collectTrack(child, track)) return false;
+        if (track.handler == fourcc("vide")) video = track;
+        return true;
+    });
+    if (!parsed || !video || video->timescale == 0) return Status::Invalid;
+    uint64_t end_dts = 0;
+    if (!computeKeyframes(*video, out.keyframes, end_dts)) return Status::Invalid;
+    out.timescale = video->timescale;
+    out.duration_s = static_cast<double>(video->duration ? video->duration : end_dts) / video->timescale;
+
+    out.moov_offset = moov->offset;
+    out.moov_first = !first_mdat || moov->offset < *first_mdat;
+    if (out.moov_first) return Status::Ok;
+
+    // Virtual fast-start: [prefix][moov, offsets shifted][trailing][mdat ... up to moov]
+    out.data_offset = *first_mdat;
+    const uint64_t moov_end = moov->offset + moov->size;
+    const uint64_t trailing = file_size - moov_end;
+    if (out.data_offset > kMaxPrefixBytes || trailing > kMaxTrailingBytes) {
+        spdlog::debug("Mp4Index: no fast-start layout (prefix {} bytes, trailing {} bytes)",
+                      out.data_offset, trailing);
+        return Status::Ok;
+    }
+    if (!shiftChunkOffsets(moov_box, out.data_offset, out.moov_offset, moov->size + trailing)) {
+        spdlog::debug("Mp4Index: no fast-start layout (chunk offsets cannot be shifted)");
+        return Status::Ok;
+    }
+    std::string head(static_cast<size_t>(out.data_offset + moov->size + trailing), '\0');
+    if (!readAt(fd, 0, head.data(), static_cast<size_t>(out.data_offset)) ||
+        !readAt(fd, moov_end, head.data() + out.data_offset + moov->size, static_cast<size_t>(trailing))) {
+        return Status::Incomplete;
+    }
+    std::copy(moov_bytes.begin(), moov_bytes.end(), head.begin() + static_cast<std::ptrdiff_t>(out.data_offset));
+    out.head = std::move(head);
+    return Status::Ok;
+}
+
+Mp4Index::Status Mp4Index::parseFile(const std::string& path, Mp4Index& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return Status::Invalid;
+    struct stat st {};
+    auto status = Status::Invalid;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        status = parse(fd, static_cast<uint64_t>(st.st_size), out);
+        out.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    ::close(fd);
+    return status;
+}
+
+// ── Mp4IndexCache ──────────────────────────────────────────────────────
+
+Mp4IndexCache::Mp4IndexCache(Options options)
+    : options_(std::move(options)), entries_(options_.max_bytes)
+{
+}
+
+Mp4IndexCache::~Mp4IndexCache() {
+    stop();
+}
+
+void Mp4IndexCache::start() {
+    if (thread_.joinable()) return;
+    thread_ = std::thread([this] { run(); });
+}
+
+void Mp4IndexCache::stop() {
+    {
+        std::lock_guard lock(jobs_mutex_);
+        stopping_ = true;
+    }
+    jobs_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void Mp4IndexCache::enqueue(const std::string& filename) {
+    if (fs::path(filename).extension() != ".mp4") return;
+    {
+        std::lock_guard lock(jobs_mutex_);
+        if (stopping_ || !queued_.insert(filename).second) return;
+        // Due now, so ahead of the retries (which are all due later)
+        jobs_.push_front(Job{std::chrono::steady_clock::now(), filename, 0});
+    }
+    jobs_cv_.notify_one();
+}
+
+Mp4IndexCache::IndexPtr Mp4IndexCache::get(const std::string& filename, int fd, const struct stat& st) {
+    Mp4Index::Status status;
+    return lookup(filename, fd, st, status);
+}
+
+Mp4IndexCache::IndexPtr Mp4IndexCache::load(const std::string& filename) {
+    Mp4Index::Status status;
+    return load(filename, status);
+}
+
+std::optional<Mp4IndexCache::IndexPtr> Mp4IndexCache::find(const std::string& filename,
+                                                           const struct stat& st) {
+    const auto size = static_cast<uint64_t>(st.st_size);
+    const int64_t mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    {
+        std::lock_guard lock(mutex_);
+        if (const auto* entry = entries_.peek(filename);
+            entry && entry->size == size && entry->mtime_ns == mtime_ns) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return entry->index;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    enqueue(filename);
+    return std::nullopt;
+}
+
+Mp4IndexCache::IndexPtr Mp4IndexCache::lookup(const std::string& filename, int fd,
+                                              const struct stat& st, Mp4Index::Status& status) {
+    const auto size = static_cast<uint64_t>(st.st_size);
+    const int64_t mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    {
+        std::lock_guard lock(mutex_);
+        if (const auto* entry = entries_.peek(filename);
+            entry && entry->size == size && entry->mtime_ns == mtime_ns) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            status = entry->status;
+            return entry->index;
+        }
+    }
+
+    auto index = std::make_shared<Mp4Index>();
+    status = Mp4Index::parse(fd, size, *index);
+    index->mtime_ns = mtime_ns;
+
+    Entry entry{size, mtime_ns, status, nullptr};
+    size_t cost = sizeof(Entry) + filename.size();
+    switch (status) {
+    case Mp4Index::Status::Ok:
+        parsed_.fetch_add(1, std::memory_order_relaxed);
+        if (index->hasVirtualLayout()) virtual_layouts_.fetch_add(1, std::memory_order_relaxed);
+        cost += sizeof(Mp4Index) + index->head.size() + index->keyframes.size() * sizeof(Mp4Index::Keyframe);
+        entry.index = std::move(index);
+        break;
+    case Mp4Index::Status::Incomplete:
+        incomplete_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Mp4Index::Status::Invalid:
+        invalid_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    auto result = entry.index;
+    std::lock_guard lock(mutex_);
+    entries_.put(filename, std::move(entry), cost);
+    return result;
+}
+
+Mp4IndexCache::IndexPtr Mp4IndexCache::load(const std::string& filename, Mp4Index::Status& status) {
+    status = Mp4Index::Status::Invalid;
+    if (filename.empty() || filename.find('/') != std::string::npos || filename == "..") return nullptr;
+    const auto path = (fs::path(options_.events_dir) / filename).string();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    IndexPtr index;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) index = lookup(filename, fd, st, status);
+    ::close(fd);
+    return index;
+}
+
+void Mp4IndexCache::run() {
+    std::unique_lock lock(jobs_mutex_);
+    while (!stopping_) {
+        if (jobs_.empty()) {
+            jobs_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            continue;
+        }
+        if (jobs_.front().due > std::chrono::steady_clock::now()) {
+            jobs_cv_.wait_until(lock, jobs_.front().due);
+            continue;
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        Mp4Index::Status status;
+        load(job.filename, status);
+
+        lock.lock();
+        // Still being written: look again later, up to max_attempts
+        if (status == Mp4Index::Status::Incomplete && ++job.attempts < options_.max_attempts) {
+            job.due = std::chrono::steady_clock::now() + options_.retry_delay;
+            jobs_.push_back(std::move(job));
+        } else {
+            queued_.erase(job.filename);
+        }
+    }
+}
+
+Mp4IndexCache::Stats Mp4IndexCache::stats() const {
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.parsed = parsed_.load(std::memory_order_relaxed);
+    s.incomplete = incomplete_.load(std::memory_order_relaxed);
+    s.invalid = invalid_.load(std::memory_order_relaxed);
+    s.virtual_layouts = virtual_layouts_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard lock(mutex_);
+        s.entries = entries_.size();
+        s.bytes = entries_.cost();
+    }
+    std::lock_guard lock(jobs_mutex_);
+    s.pending = queued_.size();
+    return s;
+}
+
+} // namespace hms
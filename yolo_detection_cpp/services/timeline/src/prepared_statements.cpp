@@ -0,0 +1,74 @@
+#include "prepared_statements.h"
+
+#include <spdlog/spdlog.h>
+#include <pqxx/pqxx>
+
+namespace hms {
+
+PreparedStatements::PreparedStatements(std::vector<Statement> statements, std::string session_setup)
+    : statements_(std::move(statements)), session_setup_(std::move(session_setup)) {}
+
+void PreparedStatements::ensure(pqxx::connection& conn) {
+    checkouts_.fetch_add(1, std::memory_order_relaxed);
+    const int pid = conn.backendpid();
+    size_t done = 0;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = sessions_.find(&conn);
+        if (it != sessions_.end() && it->second.pid == pid) {
+            if (it->second.prepared == statements_.size()) return;
+            done = it->second.prepared;
+        }
+    }
+
+    // The caller owns conn, so the round trips run without the lock. Progress
+    // is recorded on failure too: the next call must not prepare an existing
+    // name again.
+    auto record = [&] {
+        std::lock_guard lock(mutex_);
+        sessions_[&conn] = Session{pid, done};
+    };
+    if (done == 0 && !session_setup_.empty()) {
+        try {
+            pqxx::nontransaction txn(conn);
+            txn.exec(session_setup_);
+            txn.commit();
+        } catch (const pqxx::sql_error& e) {
+            // e.g. a setting an older server does not have; plans differ, results do not
+            spdlog::warn("PreparedStatements: session setup failed on backend {}: {}", pid, e.what());
+        }
+    }
+    try {
+        for (; done < statements_.size(); ++done) {
+            conn.prepare(statements_[done].name, statements_[done].sql);
+            prepares_.fetch_add(1, std::memory_order_relaxed);
+        }
+    } catch (...) {
+        record();
+        throw;
+    }
+    record();
+    spdlog::debug("PreparedStatements: prepared {} statements on backend {}",
+                  statements_.size(), pid);
+}
+
+void PreparedStatements::forget(const pqxx::connection& conn) {
+    std::lock_guard lock(mutex_);
+    if (sessions_.erase(&conn) > 0) resets_.fetch_add(1, std::memory_order_relaxed);
+}
+
+PreparedStatements::Stats PreparedStatements::stats() const {
+    Stats s;
+    {
+        std::lock_guard lock(mutex_);
+        for (const auto& [conn, session] : sessions_) {
+            if (session.prepared == statements_.size()) ++s.sessions;
+        }
+    }
+    s.checkouts = checkouts_.load(std::memory_order_relaxed);
+    s.prepares = prepares_.load(std::memory_order_relaxed);
+    s.resets = resets_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace hms
@@ -0,0 +1,195 @@
+#include "recording_index.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace hms {
+
+static constexpr uint32_t kWatchMask =
+    IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF;
+
+RecordingIndex::RecordingIndex(std::string dir, std::chrono::seconds rescan_interval)
+    : dir_(std::move(dir)), rescan_interval_(rescan_interval)
+{
+}
+
+RecordingIndex::~RecordingIndex() {
+    stop();
+}
+
+bool RecordingIndex::start() {
+    if (running_.exchange(true)) return isLive();
+
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        // No way to stop a watcher thread: scan once and leave lookups to stat()
+        spdlog::warn("RecordingIndex: eventfd unavailable, falling back to stat() lookups");
+        if (inotify_fd_ >= 0) ::close(inotify_fd_);
+        inotify_fd_ = -1;
+        rescan(false);
+        running_ = false;
+        return false;
+    }
+    if (inotify_fd_ < 0) {
+        // The thread still rescans periodically, so on_added_ keeps firing
+        spdlog::warn("RecordingIndex: inotify unavailable, falling back to stat() lookups");
+    }
+
+    // Watch before scanning so files created during the scan are not missed
+    bool watching = inotify_fd_ >= 0 && addWatch();
+    rescan(false);
+    live_.store(watching, std::memory_order_release);
+
+    thread_ = std::thread(&RecordingIndex::watchLoop, this);
+    spdlog::info("RecordingIndex: {} recordings indexed in {} (live={})", size(), dir_, watching);
+    return watching;
+}
+
+void RecordingIndex::stop() {
+    if (!running_.exchange(false)) return;
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(wake_fd_, &one, sizeof(one));
+    }
+    if (thread_.joinable()) thread_.join();
+    live_.store(false, std::memory_order_release);
+    if (inotify_fd_ >= 0) ::close(inotify_fd_);
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+    inotify_fd_ = wake_fd_ = watch_fd_ = -1;
+}
+
+bool RecordingIndex::contains(std::string_view filename) const {
+    std::shared_lock lock(mutex_);
+    return files_.find(filename) != files_.end();
+}
+
+std::size_t RecordingIndex::size() const {
+    std::shared_lock lock(mutex_);
+    return files_.size();
+}
+
+bool RecordingIndex::addWatch() {
+    watch_fd_ = ::inotify_add_watch(inotify_fd_, dir_.c_str(), kWatchMask);
+    if (watch_fd_ < 0) {
+        spdlog::warn("RecordingIndex: cannot watch {}: {}", dir_, std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void RecordingIndex::rescan(bool notify) {
+    decltype(files_) scanned;
+    std::error_code ec;
+    for (auto it = fs::directory_iterator(dir_, ec); !ec && it != fs::directory_iterator();
+         it.increment(ec)) {
+        // directory_entry caches d_type, so this does not stat each file
+        if (it->is_regular_file(ec)) {
+            scanned.insert(it->path().filename().string());
+        }
+    }
+    if (ec) {
+        spdlog::warn("RecordingIndex: scan of {} failed: {}", dir_, ec.message());
+    }
+
+    // Files the watch missed (overflow, another NAS client, no inotify) get
+    // the same hook as the ones it saw
+    std::vector<std::string> added;
+    {
+        std::unique_lock lock(mutex_);
+        if (notify && on_added_) {
+            for (const auto& name : scanned) {
+                if (!files_.count(name)) added.push_back(name);
+            }
+        }
+        files_.swap(scanned);
+    }
+    for (const auto& name : added) on_added_(name);
+}
+
+void RecordingIndex::watchLoop() {
+    alignas(struct inotify_event) char buf[64 * 1024];
+    auto next_rescan = std::chrono::steady_clock::now() + rescan_interval_;
+
+    while (running_.load()) {
+        struct pollfd fds[2] = {
+            {inotify_fd_, POLLIN, 0},
+            {wake_fd_, POLLIN, 0},
+        };
+        auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            next_rescan - std::chrono::steady_clock::now()).count();
+        int rc = ::poll(fds, 2, static_cast<int>(std::max<long long>(wait_ms, 0)));
+        if (rc < 0 && errno != EINTR) {
+            spdlog::error("RecordingIndex: poll failed: {}", std::strerror(errno));
+            break;
+        }
+        if (fds[1].revents & POLLIN) break;
+
+        if (fds[0].revents & POLLIN) {
+            ssize_t n;
+            while ((n = ::read(inotify_fd_, buf, sizeof(buf))) > 0) {
+                handleEvents(buf, static_cast<std::size_t>(n));
+            }
+        }
+
+        if (std::chrono::steady_clock::now() >= next_rescan) {
+            // Re-arm a lost watch (directory replaced or remounted) before rescanning
+            if (inotify_fd_ >= 0 && watch_fd_ < 0 && addWatch()) {
+                spdlog::info("RecordingIndex: watch on {} restored", dir_);
+            }
+            rescan(true);
+            live_.store(watch_fd_ >= 0, std::memory_order_release);
+            next_rescan = std::chrono::steady_clock::now() + rescan_interval_;
+        }
+    }
+}
+
+void RecordingIndex::handleEvents(const char* buf, std::size_t len) {
+    for (std::size_t off = 0; off < len;) {
+        const auto* ev = reinterpret_cast<const struct inotify_event*>(buf + off);
+        off += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+            // Events were dropped — the set is stale until a full rescan
+            spdlog::warn("RecordingIndex: inotify queue overflow, rescanning {}", dir_);
+            live_.store(false, std::memory_order_release);
+            rescan(true);
+            live_.store(watch_fd_ >= 0, std::memory_order_release);
+            continue;
+        }
+        if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+            spdlog::warn("RecordingIndex: {} is gone, falling back to stat() until it returns", dir_);
+            live_.store(false, std::memory_order_release);
+            if (watch_fd_ >= 0) ::inotify_rm_watch(inotify_fd_, watch_fd_);
+            watch_fd_ = -1;
+            continue;
+        }
+        if (ev->len == 0 || (ev->mask & IN_ISDIR)) continue;
+
+        std::string name(ev->name);
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+            bool inserted;
+            {
+                std::unique_lock lock(mutex_);
+                inserted = files_.insert(name).second;
+            }
+            if (inserted && on_added_) on_added_(name);
+        } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            std::unique_lock lock(mutex_);
+            files_.erase(name);
+        }
+    }
+}
+
+} // namespace hms
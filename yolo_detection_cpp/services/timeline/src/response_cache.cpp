@@ -0,0 +1,147 @@
+#include "response_cache.h"
+#include "compression.h"
+#include "http_utils.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <vector>
+
+namespace hms {
+
+namespace {
+
+/// Bodies below this size are sent uncompressed
+constexpr size_t kMinGzipBytes = 512;
+
+size_t entryCost(const std::string& key, const ResponseCache::Entry& e) {
+    return key.size() + e.body.size() + e.gzip.size() + e.etag.size() +
+           e.camera_id.size() + e.date.size() + sizeof(ResponseCache::Entry);
+}
+
+/// ETag of the gzip representation: a strong tag must differ per encoding
+std::string gzipEtag(const std::string& etag) {
+    return etag.substr(0, etag.size() - 1) + "-gz\"";
+}
+
+} // anonymous namespace
+
+ResponseCache::ResponseCache(Options options)
+    : options_(options), entries_(options.max_bytes)
+{
+}
+
+std::string ResponseCache::makeKey(
+    std::string_view route,
+    std::initializer_list<std::pair<std::string_view, std::string_view>> params) {
+    std::vector<std::pair<std::string_view, std::string_view>> sorted(params);
+    std::sort(sorted.begin(), sorted.end());
+    std::string key(route);
+    char sep = '?';
+    for (const auto& [name, value] : sorted) {
+        if (value.empty()) continue;
+        key += sep;
+        key += name;
+        key += '=';
+        key += value;
+        sep = '&';
+    }
+    return key;
+}
+
+ResponseCache::EntryPtr ResponseCache::get(const std::string& key) {
+    std::lock_guard lock(mutex_);
+    if (const auto* entry = entries_.peek(key)) {
+        if ((*entry)->expires > std::chrono::steady_clock::now()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return *entry;
+        }
+        entries_.erase(key);
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+ResponseCache::EntryPtr ResponseCache::put(const std::string& key, const nlohmann::json& body,
+                                           std::string camera_id, std::string date, bool final) {
+    PooledBuffer buffer;
+    JsonWriter(buffer.str()).value(body);
+    return putSerialized(key, std::string(buffer.str()), std::move(camera_id), std::move(date), final);
+}
+
+ResponseCache::EntryPtr ResponseCache::putSerialized(const std::string& key, std::string body,
+                                                     std::string camera_id, std::string date,
+                                                     bool final) {
+    // Compress outside the lock
+    auto entry = std::make_shared<Entry>();
+    entry->body = std::move(body);
+    entry->etag = makeEtag(entry->body);
+    if (entry->body.size() >= kMinGzipBytes) {
+        auto gz = gzipCompress(entry->body);
+        if (!gz.empty() && gz.size() < entry->body.size()) entry->gzip = std::move(gz);
+    }
+    entry->camera_id = std::move(camera_id);
+    entry->date = std::move(date);
+    entry->final = final;
+    entry->expires = std::chrono::steady_clock::now() +
+                     (final ? options_.final_ttl : options_.live_ttl);
+
+    const auto cost = entryCost(key, *entry);
+    std::lock_guard lock(mutex_);
+    entries_.put(key, entry, cost);
+    return entry;
+}
+
+size_t ResponseCache::invalidate(const std::string& camera_id, const std::string& date) {
+    size_t removed;
+    {
+        std::lock_guard lock(mutex_);
+        removed = entries_.eraseIf([&](const std::string&, const EntryPtr& e) {
+            return e->camera_id == camera_id && (date.empty() || e->date == date);
+        });
+    }
+    if (removed) {
+        invalidated_.fetch_add(removed, std::memory_order_relaxed);
+        spdlog::debug("ResponseCache: dropped {} entries for {} {}", removed, camera_id, date);
+    }
+    return removed;
+}
+
+drogon::HttpResponsePtr ResponseCache::respond(const drogon::HttpRequestPtr& req,
+                                               const EntryPtr& entry) {
+    const bool gzip = !entry->gzip.empty() && acceptsEncoding(req->getHeader("Accept-Encoding"), "gzip");
+    const auto etag = gzip ? gzipEtag(entry->etag) : entry->etag;
+    const char* cache_control = entry->final ? "public, max-age=31536000, immutable" : "no-cache";
+
+    if (isNotModified(req, etag, {})) {
+        not_modified_.fetch_add(1, std::memory_order_relaxed);
+        auto resp = makeNotModifiedResponse(etag, {});
+        resp->addHeader("Cache-Control", cache_control);
+        return resp;
+    }
+
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    // Drogon leaves bodies that already carry a Content-Encoding alone
+    resp->setBody(gzip ? entry->gzip : entry->body);
+    if (gzip) resp->addHeader("Content-Encoding", "gzip");
+    if (!entry->gzip.empty()) resp->addHeader("Vary", "Accept-Encoding");
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control", cache_control);
+    return resp;
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    Stats s;
+    {
+        std::lock_guard lock(mutex_);
+        s.entries = entries_.size();
+        s.bytes = entries_.cost();
+    }
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.not_modified = not_modified_.load(std::memory_order_relaxed);
+    s.invalidated = invalidated_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace hms
@@ -0,0 +1,179 @@
+#include "response_format.h"
+#include "http_utils.h"
+#include "json_writer.h"
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+namespace hms {
+
+namespace {
+
+/// Bodies are rewritten column-wise under these top-level keys
+constexpr const char* kColumnarKeys[] = {"events", "snapshots"};
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    while (!s.empty() && s.back() == ' ') s.remove_suffix(1);
+    return s;
+}
+
+} // anonymous namespace
+
+BodyFormat preferredBodyFormat(std::string_view accept) {
+    struct Candidate {
+        BodyFormat format;
+        double q = -1;           ///< -1: not mentioned
+        bool explicit_type = false;
+    };
+    Candidate candidates[] = {{BodyFormat::Json}, {BodyFormat::MsgPack}, {BodyFormat::Cbor}};
+
+    while (!accept.empty()) {
+        auto comma = accept.find(',');
+        auto token = accept.substr(0, comma);
+        accept = comma == std::string_view::npos ? std::string_view() : accept.substr(comma + 1);
+
+        auto semi = token.find(';');
+        auto type = trim(token.substr(0, semi));
+        double q = 1.0;
+        if (semi != std::string_view::npos) {
+            auto pos = token.find("q=", semi);
+            if (pos != std::string_view::npos) {
+                q = std::strtod(std::string(token.substr(pos + 2)).c_str(), nullptr);
+            }
+        }
+
+        auto consider = [&](Candidate& c, bool explicit_type) {
+            // An explicit entry overrides wildcards whatever its weight
+            if (c.explicit_type && !explicit_type) return;
+            if (explicit_type && !c.explicit_type) c.q = -1;
+            if (q > c.q) c.q = q;
+            c.explicit_type = explicit_type;
+        };
+        if (type == "application/json") {
+            consider(candidates[0], true);
+        } else if (type == "application/msgpack" || type == "application/x-msgpack" ||
+                   type == "application/vnd.msgpack") {
+            consider(candidates[1], true);
+        } else if (type == "application/cbor") {
+            consider(candidates[2], true);
+        } else if (type == "*/*" || type == "application/*") {
+            // Wildcards only ever select JSON
+            consider(candidates[0], false);
+        }
+    }
+
+    const Candidate* best = nullptr;
+    for (const auto& c : candidates) {
+        if (c.q <= 0) continue;
+        if (!best || c.q > best->q || (c.q == best->q && c.explicit_type && !best->explicit_type)) {
+            best = &c;
+        }
+    }
+    return best ? best->format : BodyFormat::Json;
+}
+
+ResponseFormat ResponseFormat::negotiate(const drogon::HttpRequestPtr& req) {
+    ResponseFormat format;
+    format.body = preferredBodyFormat(req->getHeader("Accept"));
+    format.columnar = req->getParameter("layout") == "columnar";
+    return format;
+}
+
+const char* ResponseFormat::contentType() const {
+    switch (body) {
+    case BodyFormat::MsgPack: return "application/msgpack";
+    case BodyFormat::Cbor: return "application/cbor";
+    case BodyFormat::Json: break;
+    }
+    return "application/json";
+}
+
+nlohmann::json columnarize(const nlohmann::json& rows) {
+    if (!rows.is_array()) return rows;
+    for (const auto& row : rows) {
+        if (!row.is_object()) return rows;
+    }
+
+    const size_t count = rows.size();
+    std::map<std::string, nlohmann::json> columns;
+    for (size_t i = 0; i < count; ++i) {
+        for (const auto& [key, value] : rows[i].items()) {
+            auto [it, inserted] = columns.try_emplace(key, nlohmann::json::array());
+            auto& column = it->second;
+            // A key first seen on a later row is null for the rows before it
+            while (column.size() < i) column.push_back(nullptr);
+            column.push_back(value);
+        }
+    }
+
+    nlohmann::json out_columns = nlohmann::json::object();
+    for (auto& [key, column] : columns) {
+        while (column.size() < count) column.push_back(nullptr);
+
+        bool strings = true;
+        std::unordered_map<std::string, size_t> codes;
+        for (const auto& value : column) {
+            if (value.is_null()) continue;
+            if (!value.is_string()) {
+                strings = false;
+                break;
+            }
+            codes.try_emplace(value.get<std::string>(), codes.size());
+        }
+        if (!strings || codes.empty() || codes.size() * 2 > count) {
+            out_columns[key] = std::move(column);
+            continue;
+        }
+
+        nlohmann::json dict = nlohmann::json::array();
+        dict.get_ref<nlohmann::json::array_t&>().resize(codes.size());
+        for (const auto& [text, code] : codes) dict[code] = text;
+        nlohmann::json indexes = nlohmann::json::array();
+        for (const auto& value : column) {
+            if (value.is_null()) {
+                indexes.push_back(nullptr);
+            } else {
+                indexes.push_back(codes.at(value.get_ref<const std::string&>()));
+            }
+        }
+        out_columns[key] = {{"dict", std::move(dict)}, {"codes", std::move(indexes)}};
+    }
+    return {{"layout", "columnar"}, {"count", count}, {"columns", std::move(out_columns)}};
+}
+
+void addVaryAccept(const drogon::HttpResponsePtr& resp) {
+    const auto& vary = resp->getHeader("Vary");
+    resp->addHeader("Vary", vary.empty() ? "Accept" : vary + ", Accept");
+}
+
+drogon::HttpResponsePtr makeApiResponse(const ResponseFormat& format, nlohmann::json body,
+                                        drogon::HttpStatusCode code) {
+    if (format.columnar && body.is_object()) {
+        for (const char* key : kColumnarKeys) {
+            auto it = body.find(key);
+            if (it != body.end()) *it = columnarize(*it);
+        }
+    }
+
+    PooledBuffer buffer;
+    switch (format.body) {
+    case BodyFormat::MsgPack:
+        nlohmann::json::to_msgpack(body, buffer.str());
+        break;
+    case BodyFormat::Cbor:
+        nlohmann::json::to_cbor(body, buffer.str());
+        break;
+    case BodyFormat::Json:
+        JsonWriter(buffer.str()).value(body);
+        break;
+    }
+    auto resp = makeJsonBodyResponse(buffer.str(), code);
+    if (format.body != BodyFormat::Json) resp->setContentTypeString(format.contentType());
+    addVaryAccept(resp);
+    return resp;
+}
+
+} // namespace hms
@@ -0,0 +1,363 @@
+#include "semantic_index.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+
+using json = nlohmann::json;
+
+namespace hms {
+
+namespace {
+
+constexpr size_t kInsertChunk = 256;
+constexpr size_t kIdBatch = 500;
+constexpr int kReconcilePage = 10000;
+
+std::string key(const std::string& type, const std::string& id) {
+    return type + ":" + id;
+}
+
+std::string lower(std::string s) {
+    for (auto& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::vector<std::string> splitClasses(const std::string& classes) {
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos <= classes.size()) {
+        auto comma = classes.find(',', pos);
+        if (comma == std::string::npos) comma = classes.size();
+        auto first = classes.find_first_not_of(" {}\"", pos);
+        auto last = classes.find_last_not_of(" {}\"", comma == 0 ? 0 : comma - 1);
+        if (first != std::string::npos && first < comma && last != std::string::npos && last >= first) {
+            out.push_back(lower(classes.substr(first, last - first + 1)));
+        }
+        pos = comma + 1;
+    }
+    return out;
+}
+
+} // anonymous namespace
+
+SemanticIndex::SemanticIndex(std::shared_ptr<DbPool> pool, Options options)
+    : pool_(std::move(pool)), options_(options)
+{
+    if (options_.graph) graph_ = std::make_unique<HnswIndex>(options_.dim);
+    // The graph already keeps float32 rows; a second matrix is only needed
+    // for a quantised layout or when there is no graph
+    if (!graph_ || options_.exact_storage != VectorMatrix::Storage::Float32) {
+        matrix_ = std::make_unique<VectorMatrix>(options_.dim, options_.exact_storage);
+    }
+}
+
+const VectorMatrix& SemanticIndex::exactMatrix() const {
+    return matrix_ ? *matrix_ : graph_->vectors();
+}
+
+SemanticIndex::~SemanticIndex() {
+    stop();
+}
+
+void SemanticIndex::start() {
+    if (thread_.joinable()) return;
+    thread_ = std::thread([this] { run(); });
+}
+
+void SemanticIndex::stop() {
+    {
+        std::lock_guard lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool SemanticIndex::waitFor(std::chrono::seconds interval) {
+    std::unique_lock lock(stop_mutex_);
+    return !stop_cv_.wait_for(lock, interval, [this] { return stopping_; });
+}
+
+void SemanticIndex::run() {
+    auto started = std::chrono::steady_clock::now();
+    initialLoad();
+    ready_.store(true, std::memory_order_release);
+    spdlog::info("SemanticIndex: loaded {} vectors in {} ms", stats().vectors,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - started).count());
+
+    auto last_reconcile = std::chrono::steady_clock::now();
+    while (waitFor(options_.poll_interval)) {
+        poll();
+        if (std::chrono::steady_clock::now() - last_reconcile >= options_.reconcile_interval) {
+            reconcile();
+            last_reconcile = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+void SemanticIndex::initialLoad() {
+    std::string last_event;
+    for (;;) {
+        auto rows = timeline_queries::load_event_embeddings(*pool_, last_event, options_.load_batch);
+        if (rows.empty()) break;
+        last_event = rows.back().id;
+        bool last_page = rows.size() < static_cast<size_t>(options_.load_batch);
+        insert(std::move(rows));
+        if (last_page) break;
+        std::lock_guard lock(stop_mutex_);
+        if (stopping_) return;
+    }
+
+    int64_t last_snapshot = 0;
+    for (;;) {
+        auto rows = timeline_queries::load_snapshot_embeddings(*pool_, last_snapshot,
+                                                               options_.load_batch);
+        if (rows.empty()) break;
+        last_snapshot = std::stoll(rows.back().id);
+        bool last_page = rows.size() < static_cast<size_t>(options_.load_batch);
+        insert(std::move(rows));
+        if (last_page) break;
+        std::lock_guard lock(stop_mutex_);
+        if (stopping_) return;
+    }
+}
+
+void SemanticIndex::poll() {
+    sync(timeline_queries::recent_embedded_ids(*pool_, options_.lookback_minutes));
+}
+
+void SemanticIndex::reconcile() {
+    // Id pages only; rows are fetched just for the few that are missing or
+    // changed. Whatever no page lists was deleted, but only a pass that read
+    // every page can say so.
+    ++pass_;
+    std::string last_event;
+    for (;;) {
+        auto ids = timeline_queries::embedded_event_ids(*pool_, last_event, kReconcilePage);
+        if (!ids) return;
+        if (ids->empty()) break;
+        last_event = ids->back().id;
+        sync(*ids);
+        if (ids->size() < static_cast<size_t>(kReconcilePage)) break;
+        std::lock_guard lock(stop_mutex_);
+        if (stopping_) return;
+    }
+
+    int64_t last_snapshot = 0;
+    for (;;) {
+        auto ids = timeline_queries::embedded_snapshot_ids(*pool_, last_snapshot, kReconcilePage);
+        if (!ids) return;
+        if (ids->empty()) break;
+        last_snapshot = std::stoll(ids->back().id);
+        sync(*ids);
+        if (ids->size() < static_cast<size_t>(kReconcilePage)) break;
+        std::lock_guard lock(stop_mutex_);
+        if (stopping_) return;
+    }
+
+    dropUnseen();
+}
+
+void SemanticIndex::sync(const std::vector<timeline_queries::EmbeddedId>& ids) {
+    std::vector<std::string> event_ids, snapshot_ids;
+    std::vector<uint32_t> seen;
+    {
+        std::shared_lock lock(mutex_);
+        for (const auto& id : ids) {
+            auto it = known_.find(key(id.type, id.id));
+            if (it != known_.end()) {
+                // Seen even when it is about to be replaced: if the reload
+                // fails, the old row is still better than none
+                seen.push_back(it->second);
+                if (items_[it->second].fingerprint == id.fingerprint) continue;
+            }
+            (id.type == "event" ? event_ids : snapshot_ids).push_back(id.id);
+        }
+    }
+    if (!seen.empty()) {
+        std::unique_lock lock(mutex_);
+        for (auto row : seen) items_[row].pass = pass_;
+    }
+    if (event_ids.empty() && snapshot_ids.empty()) return;
+
+    // Bounded IN lists so a long outage does not produce one huge query
+    for (size_t i = 0; i < std::max(event_ids.size(), snapshot_ids.size()); i += kIdBatch) {
+        auto slice = [&](const std::vector<std::string>& ids) {
+            if (i >= ids.size()) return std::vector<std::string>{};
+            return std::vector<std::string>(ids.begin() + i,
+                                            ids.begin() + std::min(ids.size(), i + kIdBatch));
+        };
+        insert(timeline_queries::load_embeddings_by_id(*pool_, slice(event_ids), slice(snapshot_ids)));
+    }
+    spdlog::debug("SemanticIndex: loaded {} events, {} snapshots",
+                  event_ids.size(), snapshot_ids.size());
+}
+
+void SemanticIndex::dropUnseen() {
+    size_t dropped = 0;
+    {
+        std::unique_lock lock(mutex_);
+        for (uint32_t row = 0; row < items_.size(); ++row) {
+            if (items_[row].removed || items_[row].pass == pass_) continue;
+            known_.erase(items_[row].key);
+            remove(row);
+            ++dropped;
+        }
+    }
+    if (dropped > 0) spdlog::info("SemanticIndex: dropped {} deleted rows", dropped);
+}
+
+void SemanticIndex::remove(uint32_t row) {
+    auto& item = items_[row];
+    item.removed = true;
+    item.doc = nullptr;
+    item.classes = {};
+    ++tombstones_;
+}
+
+void SemanticIndex::insert(std::vector<timeline_queries::EmbeddingRow>&& rows) {
+    size_t skipped = 0;
+    for (size_t begin = 0; begin < rows.size(); begin += kInsertChunk) {
+        // Short write-lock sections keep search latency flat during a bulk load
+        std::unique_lock lock(mutex_);
+        for (size_t i = begin; i < std::min(rows.size(), begin + kInsertChunk); ++i) {
+            auto& row = rows[i];
+            if (row.embedding.size() != options_.dim) {
+                ++skipped;
+                continue;
+            }
+            auto [it, added] = known_.try_emplace(key(row.type, row.id),
+                                                  static_cast<uint32_t>(items_.size()));
+            if (!added) {
+                if (items_[it->second].fingerprint == row.fingerprint) {
+                    items_[it->second].pass = pass_;
+                    continue;
+                }
+                remove(it->second);
+                it->second = static_cast<uint32_t>(items_.size());
+            }
+
+            if (graph_) graph_->add(row.embedding.data());
+            if (matrix_) matrix_->add(row.embedding.data());
+            items_.push_back(Item{
+                it->first,
+                std::move(row.camera_id),
+                row.timestamp_epoch,
+                splitClasses(row.detected_classes),
+                std::move(row.doc),
+                row.fingerprint,
+                pass_,
+            });
+        }
+    }
+    if (skipped > 0) {
+        spdlog::warn("SemanticIndex: skipped {} rows with embedding dimension != {}",
+                     skipped, options_.dim);
+    }
+}
+
+std::optional<json> SemanticIndex::search(const api_queries::SearchParams& params,
+                                          const std::vector<float>& embedding, bool exact) const {
+    std::optional<timeline_queries::SearchBounds> range;
+    if (isReady() && embedding.size() == options_.dim) range = bounds(params);
+    if (!range) {
+        fallbacks_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    searches_.fetch_add(1, std::memory_order_relaxed);
+
+    const auto& from = range->from_epoch;
+    const auto& to = range->to_epoch;
+    std::vector<std::string> wanted;
+    for (const auto& cls : params.class_filter) wanted.push_back(lower(cls));
+
+    const auto limit = static_cast<size_t>(std::max(params.limit, 1));
+
+    std::shared_lock lock(mutex_);
+
+    // Tombstones are filtered out like any other non-match
+    const bool filtered = params.camera_id || from || to || !wanted.empty() || tombstones_ > 0;
+    auto accept = [&](uint32_t id) {
+        const auto& item = items_[id];
+        if (item.removed) return false;
+        if (params.camera_id && item.camera_id != *params.camera_id) return false;
+        if (from && item.timestamp < *from) return false;
+        if (to && item.timestamp >= *to) return false;
+        if (!wanted.empty()) {
+            return std::any_of(wanted.begin(), wanted.end(), [&](const std::string& w) {
+                return std::find(item.classes.begin(), item.classes.end(), w) != item.classes.end();
+            });
+        }
+        return true;
+    };
+
+    std::vector<VectorMatrix::Match> matches;
+    if (graph_ && !exact) {
+        const size_t ef = std::max(options_.ef_search, limit * (filtered ? 4 : 2));
+        matches = graph_->search(embedding.data(), limit, ef,
+                                 filtered ? HnswIndex::Filter(accept) : HnswIndex::Filter{});
+    }
+
+    // Exact mode, no graph, or a selective filter that starved the graph walk:
+    // score every accepted row with the SIMD kernels
+    if (exact || !graph_ || (filtered && matches.size() < limit)) {
+        exact_scans_.fetch_add(1, std::memory_order_relaxed);
+        std::vector<float> q(embedding);
+        VectorMatrix::normalize(q.data(), q.size());
+        matches = exactMatrix().topK(q.data(), limit,
+                                     filtered ? VectorMatrix::Filter(accept) : VectorMatrix::Filter{});
+    }
+
+    json events = json::array();
+    for (const auto& [id, similarity] : matches) {
+        if (similarity < options_.min_similarity) break;
+        auto doc = items_[id].doc;
+        doc["similarity"] = similarity;
+        events.push_back(std::move(doc));
+    }
+
+    const auto count = events.size();
+    return json{
+        {"events", std::move(events)},
+        {"count", count},
+        {"search_mode", exact ? "semantic_exact" : "semantic"},
+        {"query", params.query},
+    };
+}
+
+std::optional<timeline_queries::SearchBounds>
+SemanticIndex::bounds(const api_queries::SearchParams& params) const {
+    if (!params.start_date && !params.end_date) return timeline_queries::SearchBounds{};
+    // The session time zone decides what a bare date means, so PostgreSQL
+    // converts; a repeated range costs no round trip
+    const auto cache_key = params.start_date.value_or("") + "|" + params.end_date.value_or("");
+    {
+        std::lock_guard lock(bounds_mutex_);
+        if (auto cached = bounds_.get(cache_key)) return cached;
+    }
+    auto converted = timeline_queries::search_bounds(*pool_, params.start_date, params.end_date);
+    if (converted) {
+        std::lock_guard lock(bounds_mutex_);
+        bounds_.put(cache_key, *converted);
+    }
+    return converted;
+}
+
+SemanticIndex::Stats SemanticIndex::stats() const {
+    Stats s;
+    {
+        std::shared_lock lock(mutex_);
+        s.vectors = items_.size() - tombstones_;
+        s.tombstones = tombstones_;
+        s.matrix_bytes = exactMatrix().bytes();
+    }
+    s.searches = searches_.load(std::memory_order_relaxed);
+    s.exact_scans = exact_scans_.load(std::memory_order_relaxed);
+    s.fallbacks = fallbacks_.load(std::memory_order_relaxed);
+    s.ready = isReady();
+    return s;
+}
+
+} // namespace hms
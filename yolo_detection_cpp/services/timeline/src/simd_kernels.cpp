@@ -0,0 +1,305 @@
+#include "simd_kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HMS_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace hms {
+namespace simd {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Scalar
+// ---------------------------------------------------------------------------
+
+float dotF32Scalar(const float* a, const float* b, size_t n) {
+    // Four partial sums so the compiler can keep the adds independent
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+float dotF16Scalar(const float* q, const uint16_t* row, size_t n) {
+    float sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += q[i] * halfToFloat(row[i]);
+    return sum;
+}
+
+float dotI8Scalar(const float* q, const int8_t* row, size_t n) {
+    float sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += q[i] * static_cast<float>(row[i]);
+    return sum;
+}
+
+#ifdef HMS_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// AVX2 + FMA (+ F16C, present on every AVX2 CPU)
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+inline float hsum256(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+    return _mm_cvtss_f32(lo);
+}
+
+__attribute__((target("avx2,fma")))
+float dotF32Avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = hsum256(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float dotF16Avx2(const float* q, const uint16_t* row, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 r0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        __m256 r1 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 8)));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), r0, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i + 8), r1, acc1);
+    }
+    float sum = hsum256(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) sum += q[i] * halfToFloat(row[i]);
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float dotI8Avx2(const float* q, const int8_t* row, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m256 r0 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+        __m256 r1 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(bytes, 8)));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), r0, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i + 8), r1, acc1);
+    }
+    float sum = hsum256(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) sum += q[i] * static_cast<float>(row[i]);
+    return sum;
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512F
+// ---------------------------------------------------------------------------
+
+// GCC 12's AVX-512 intrinsics seed results with _mm512_undefined_*(), which
+// trips -Wuninitialized under a function-level target attribute
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f")))
+float dotF32Avx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+float dotF16Avx512(const float* q, const uint16_t* row, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 r = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i)));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(q + i), r, acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; ++i) sum += q[i] * halfToFloat(row[i]);
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+float dotI8Avx512(const float* q, const int8_t* row, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m512 r = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(bytes));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(q + i), r, acc);
+    }
+    float sum = _mm512_reduce_add_ps(acc);
+    for (; i < n; ++i) sum += q[i] * static_cast<float>(row[i]);
+    return sum;
+}
+
+#pragma GCC diagnostic pop
+
+#endif // HMS_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------
+
+struct Kernels {
+    Isa isa;
+    float (*f32)(const float*, const float*, size_t);
+    float (*f16)(const float*, const uint16_t*, size_t);
+    float (*i8)(const float*, const int8_t*, size_t);
+};
+
+constexpr Kernels kScalar{Isa::Scalar, dotF32Scalar, dotF16Scalar, dotI8Scalar};
+#ifdef HMS_SIMD_X86
+constexpr Kernels kAvx2{Isa::Avx2, dotF32Avx2, dotF16Avx2, dotI8Avx2};
+constexpr Kernels kAvx512{Isa::Avx512, dotF32Avx512, dotF16Avx512, dotI8Avx512};
+#endif
+
+Isa bestSupported() {
+#ifdef HMS_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::Avx2;
+#endif
+    return Isa::Scalar;
+}
+
+const Kernels& kernelsFor(Isa isa) {
+#ifdef HMS_SIMD_X86
+    if (isa == Isa::Avx512) return kAvx512;
+    if (isa == Isa::Avx2) return kAvx2;
+#endif
+    (void)isa;
+    return kScalar;
+}
+
+const Kernels*& active() {
+    static const Kernels* kernels = &kernelsFor(bestSupported());
+    return kernels;
+}
+
+} // anonymous namespace
+
+Isa activeIsa() {
+    return active()->isa;
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::Avx512: return "avx512";
+        case Isa::Avx2: return "avx2";
+        case Isa::Scalar: break;
+    }
+    return "scalar";
+}
+
+Isa setIsa(Isa isa) {
+    auto best = bestSupported();
+    if (static_cast<int>(isa) > static_cast<int>(best)) isa = best;
+    active() = &kernelsFor(isa);
+    return isa;
+}
+
+float dotF32(const float* a, const float* b, size_t n) {
+    return active()->f32(a, b, n);
+}
+
+float dotF16(const float* q, const uint16_t* row, size_t n) {
+    return active()->f16(q, row, n);
+}
+
+float dotI8(const float* q, const int8_t* row, size_t n) {
+    return active()->i8(q, row, n);
+}
+
+uint16_t floatToHalf(float value) {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    const uint32_t raw_exp = (x >> 23) & 0xffu;
+    uint32_t mant = x & 0x7fffffu;
+
+    if (raw_exp == 0xff) return static_cast<uint16_t>(sign | 0x7c00u | (mant ? 0x200u : 0));
+    const int exp = static_cast<int>(raw_exp) - 127 + 15;
+    if (exp >= 31) return static_cast<uint16_t>(sign | 0x7c00u);
+
+    if (exp <= 0) {
+        // Subnormal half (or zero); round to nearest even
+        if (exp < -10) return static_cast<uint16_t>(sign);
+        mant |= 0x800000u;
+        const uint32_t shift = static_cast<uint32_t>(14 - exp);
+        uint32_t half = mant >> shift;
+        const uint32_t rem = mant & ((1u << shift) - 1);
+        const uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+    const uint32_t rem = mant & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (half & 1))) ++half;   // may carry into exp
+    return static_cast<uint16_t>(half);
+}
+
+float halfToFloat(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exp = (value >> 10) & 0x1fu;
+    uint32_t mant = value & 0x3ffu;
+    uint32_t bits;
+
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {
+            exp = 127 - 15 + 1;
+            while (!(mant & 0x400u)) {
+                mant <<= 1;
+                --exp;
+            }
+            bits = sign | (exp << 23) | ((mant & 0x3ffu) << 13);
+        }
+    } else if (exp == 31) {
+        bits = sign | 0x7f800000u | (mant << 13);
+    } else {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+
+    float out;
+    std::memcpy(&out, &bits, sizeof(out));
+    return out;
+}
+
+} // namespace simd
+} // namespace hms
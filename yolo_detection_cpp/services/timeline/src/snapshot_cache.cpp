@@ -0,0 +1,112 @@
+#include "snapshot_cache.h"
+#include "http_utils.h"
+
+#include <drogon/utils/Utilities.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+using namespace drogon;
+
+namespace hms {
+
+SnapshotCache::SnapshotCache(std::shared_ptr<DetectionClient> client,
+                             std::chrono::milliseconds refresh_interval,
+                             size_t max_cameras)
+    : client_(std::move(client)), refresh_interval_(refresh_interval),
+      entries_(std::max<size_t>(max_cameras, 1))
+{
+}
+
+SnapshotCache::EntryPtr SnapshotCache::entry(const std::string& camera_id) {
+    // An in-flight fetch holds its entry, so evicting one mid-fetch still
+    // answers its waiters
+    std::lock_guard lock(entries_mutex_);
+    if (auto existing = entries_.get(camera_id)) return *existing;
+    auto created = std::make_shared<Entry>();
+    entries_.put(camera_id, created);
+    return created;
+}
+
+void SnapshotCache::get(const std::string& camera_id, Callback&& callback) {
+    auto entry_ptr = entry(camera_id);
+    auto& e = *entry_ptr;
+    SnapshotPtr fresh;
+    {
+        std::lock_guard lock(e.mutex);
+        auto now = std::chrono::steady_clock::now();
+        if (e.latest && now - e.latest->fetched_at < refresh_interval_) {
+            fresh = e.latest;
+        } else {
+            e.waiters.push_back(std::move(callback));
+            if (e.fetching) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            e.fetching = true;
+        }
+    }
+
+    if (fresh) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        callback(DetectionClient::Result::Ok, fresh);
+        return;
+    }
+
+    fetches_.fetch_add(1, std::memory_order_relaxed);
+    client_->request(
+        Get, "/api/cameras/" + camera_id + "/snapshot", {},
+        [this, entry_ptr](DetectionClient::Result result, const HttpResponsePtr& upstream) {
+            complete(*entry_ptr, result, upstream);
+        });
+}
+
+void SnapshotCache::complete(Entry& e, DetectionClient::Result result,
+                             const HttpResponsePtr& upstream) {
+    SnapshotPtr snapshot;
+    std::vector<Callback> waiters;
+    {
+        std::lock_guard lock(e.mutex);
+
+        if (result == DetectionClient::Result::Ok) {
+            auto snap = std::make_shared<Snapshot>();
+            snap->status = upstream->statusCode();
+            snap->body = std::string(upstream->body());
+            snap->content_type = upstream->getHeader("Content-Type");
+            if (snap->content_type.empty()) snap->content_type = "image/jpeg";
+            snap->fetched_at = std::chrono::steady_clock::now();
+
+            if (snap->status == k200OK) {
+                snap->etag = makeEtag(snap->body);
+                // A static scene yields identical bytes — keep the original validators
+                if (e.latest && e.latest->etag == snap->etag) {
+                    snap->last_modified = e.latest->last_modified;
+                } else {
+                    snap->last_modified = utils::getHttpFullDate(trantor::Date::now());
+                }
+            }
+            // Errors are cached for one interval too, so a missing camera
+            // cannot turn every viewer's poll into an upstream request
+            e.latest = snap;
+            snapshot = std::move(snap);
+        }
+
+        e.fetching = false;
+        waiters.swap(e.waiters);
+    }
+
+    for (auto& waiter : waiters) {
+        waiter(result, snapshot);
+    }
+}
+
+SnapshotCache::Stats SnapshotCache::stats() const {
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.fetches = fetches_.load(std::memory_order_relaxed);
+    s.coalesced = coalesced_.load(std::memory_order_relaxed);
+    std::lock_guard lock(entries_mutex_);
+    s.cameras = entries_.size();
+    return s;
+}
+
+} // namespace hms
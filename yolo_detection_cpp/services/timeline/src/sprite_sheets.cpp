@@ -0,0 +1,281 @@
+#include "sprite_sheets.h"
+#include "http_utils.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace hms {
+
+namespace {
+
+/// Letterbox colour (matches the UI's gray-900 card background)
+constexpr unsigned char kBackground[3] = {0x11, 0x18, 0x27};
+
+/// Largest image dimension baseline JPEG can encode
+constexpr int kMaxJpegDimension = 65535;
+constexpr int kSecondsPerDay = 24 * 60 * 60;
+
+bool readFile(const fs::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+RgbImage blankImage(int width, int height) {
+    RgbImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < image.pixels.size(); i += 3) {
+        std::memcpy(&image.pixels[i], kBackground, 3);
+    }
+    return image;
+}
+
+/// Copy src into dst with its top-left corner at (x, y); src must fit
+void blit(const RgbImage& src, RgbImage& dst, int x, int y) {
+    const size_t row_bytes = static_cast<size_t>(src.width) * 3;
+    for (int row = 0; row < src.height; ++row) {
+        std::memcpy(&dst.pixels[(static_cast<size_t>(y + row) * dst.width + x) * 3],
+                    &src.pixels[static_cast<size_t>(row) * row_bytes], row_bytes);
+    }
+}
+
+/// Wall-clock hour of an ISO-8601 timestamp ("2026-03-04T10:15:00..." → "10")
+std::string hourOf(const std::string& captured_at) {
+    return captured_at.size() >= 13 ? captured_at.substr(11, 2) : std::string("--");
+}
+
+/// Wall-clock second of the day of an ISO-8601 timestamp, or -1
+int secondOfDay(const std::string& captured_at) {
+    int h = 0, m = 0, s = 0;
+    if (captured_at.size() < 19 ||
+        std::sscanf(captured_at.c_str() + 11, "%2d:%2d:%2d", &h, &m, &s) != 3) {
+        return -1;
+    }
+    return h * 3600 + m * 60 + s;
+}
+
+} // anonymous namespace
+
+SpriteSheets::SpriteSheets(Options options)
+    : options_(std::move(options)),
+      hours_(options_.max_tile_bytes),
+      sheets_(options_.max_sheets),
+      workers_(1, "sprite-sheets")
+{
+    const int max_rows = kMaxJpegDimension / std::max(options_.tile_height, 1);
+    options_.max_tiles = std::clamp(options_.max_tiles, 1, std::max(options_.columns, 1) * max_rows);
+}
+
+std::string SpriteSheets::snapshotFile(const nlohmann::json& snapshot) {
+    for (const char* field : {"thumbnail_url", "snapshot_url"}) {
+        auto it = snapshot.find(field);
+        if (it == snapshot.end() || !it->is_string()) continue;
+        const auto& url = it->get_ref<const std::string&>();
+        auto slash = url.rfind('/');
+        auto file = slash != std::string::npos ? url.substr(slash + 1) : url;
+        // Rows from the Python era store "None" for a missing snapshot
+        if (!file.empty() && file != "None") return file;
+    }
+    return {};
+}
+
+void SpriteSheets::get(const std::string& camera_id, const std::string& date,
+                       const nlohmann::json& snapshots, Callback&& callback) {
+    std::vector<Source> sources;
+    for (const auto& row : snapshots) {
+        Source source;
+        source.file = snapshotFile(row);
+        if (source.file.empty()) continue;
+        if (auto it = row.find("snapshot_id"); it != row.end() && it->is_number_integer()) {
+            source.snapshot_id = it->get<int64_t>();
+        }
+        if (auto it = row.find("captured_at"); it != row.end() && it->is_string()) {
+            source.captured_at = it->get<std::string>();
+        }
+        sources.push_back(std::move(source));
+    }
+    std::stable_sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) {
+        return a.captured_at < b.captured_at;
+    });
+
+    // The first snapshot of each slot; sorted, so a slot's snapshots are adjacent
+    const int slot_seconds = (kSecondsPerDay + options_.max_tiles - 1) / options_.max_tiles;
+    size_t kept = 0;
+    int last_slot = -1;
+    for (auto& source : sources) {
+        const int second = secondOfDay(source.captured_at);
+        if (second < 0 || second / slot_seconds == last_slot) continue;
+        last_slot = second / slot_seconds;
+        if (&sources[kept] != &source) sources[kept] = std::move(source);
+        ++kept;
+    }
+    sources.resize(kept);
+    if (sources.empty()) {
+        callback(nullptr);
+        return;
+    }
+
+    // Group by hour; an hour's signature is its list of snapshots
+    std::vector<HourGroup> groups;
+    std::string signatures;
+    for (auto& source : sources) {
+        auto hour = hourOf(source.captured_at);
+        if (groups.empty() || groups.back().hour != hour) groups.push_back(HourGroup{hour, {}, {}});
+        auto& group = groups.back();
+        group.signature += std::to_string(source.snapshot_id) + ':' + source.file + ';';
+        group.sources.push_back(std::move(source));
+    }
+    for (const auto& group : groups) signatures += group.hour + '=' + group.signature + '\n';
+    auto version = makeEtag(signatures);
+    version = version.substr(1, version.size() - 2);
+
+    const auto day_key = camera_id + "|" + date;
+    SheetPtr hit;
+    {
+        std::lock_guard lock(mutex_);
+        if (const auto* sheet = sheets_.peek(day_key); sheet && (*sheet)->version == version) {
+            hit = *sheet;
+        } else {
+            auto& waiters = inflight_[day_key];
+            waiters.push_back(std::move(callback));
+            if (waiters.size() > 1) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+    if (hit) {
+        sheet_hits_.fetch_add(1, std::memory_order_relaxed);
+        callback(hit);
+        return;
+    }
+
+    workers_.runTaskInQueue([this, day_key, groups = std::move(groups), version = std::move(version)] {
+        build(day_key, groups, version);
+    });
+}
+
+SpriteSheets::SheetPtr SpriteSheets::find(const std::string& camera_id, const std::string& date) {
+    std::lock_guard lock(mutex_);
+    const auto* sheet = sheets_.peek(camera_id + "|" + date);
+    return sheet ? *sheet : nullptr;
+}
+
+void SpriteSheets::build(const std::string& day_key, const std::vector<HourGroup>& groups,
+                         const std::string& version) {
+    std::vector<HourPtr> built;
+    for (const auto& group : groups) {
+        const auto hour_key = day_key + "|" + group.hour;
+        HourPtr hour;
+        {
+            std::lock_guard lock(mutex_);
+            if (const auto* h = hours_.peek(hour_key); h && (*h)->signature == group.signature) hour = *h;
+        }
+        if (!hour) {
+            hour = buildHour(group);
+            size_t cost = sizeof(Hour);
+            for (const auto& tile : hour->tiles) cost += tile.image.pixels.size() + sizeof(Tile);
+            std::lock_guard lock(mutex_);
+            hours_.put(hour_key, hour, cost);
+        }
+        built.push_back(std::move(hour));
+    }
+
+    auto sheet = compose(built, version);
+    std::vector<Callback> waiters;
+    {
+        std::lock_guard lock(mutex_);
+        if (sheet) sheets_.put(day_key, sheet);
+        auto it = inflight_.find(day_key);
+        if (it != inflight_.end()) {
+            waiters.swap(it->second);
+            inflight_.erase(it);
+        }
+    }
+    for (auto& waiter : waiters) {
+        waiter(sheet);
+    }
+}
+
+SpriteSheets::HourPtr SpriteSheets::buildHour(const HourGroup& group) {
+    auto hour = std::make_shared<Hour>();
+    hour->signature = group.signature;
+    std::string jpeg;
+    for (const auto& source : group.sources) {
+        RgbImage scaled;
+        if (!readFile(fs::path(options_.snapshots_dir) / source.file, jpeg) ||
+            !decodeJpeg(jpeg, options_.tile_width, options_.tile_height, scaled)) {
+            spdlog::debug("SpriteSheets: skipping unreadable snapshot {}", source.file);
+            continue;
+        }
+        tiles_decoded_.fetch_add(1, std::memory_order_relaxed);
+        Tile tile;
+        tile.snapshot_id = source.snapshot_id;
+        tile.captured_at = source.captured_at;
+        tile.image = blankImage(options_.tile_width, options_.tile_height);
+        blit(scaled, tile.image, (options_.tile_width - scaled.width) / 2,
+             (options_.tile_height - scaled.height) / 2);
+        hour->tiles.push_back(std::move(tile));
+    }
+    hours_built_.fetch_add(1, std::memory_order_relaxed);
+    return hour;
+}
+
+SpriteSheets::SheetPtr SpriteSheets::compose(const std::vector<HourPtr>& hours,
+                                             const std::string& version) {
+    size_t count = 0;
+    for (const auto& hour : hours) count += hour->tiles.size();
+    if (count == 0) return nullptr;
+
+    auto sheet = std::make_shared<Sheet>();
+    sheet->version = version;
+    sheet->columns = static_cast<int>(std::min<size_t>(count, static_cast<size_t>(options_.columns)));
+    sheet->rows = static_cast<int>((count + sheet->columns - 1) / sheet->columns);
+    sheet->tiles = nlohmann::json::array();
+
+    auto canvas = blankImage(sheet->columns * options_.tile_width, sheet->rows * options_.tile_height);
+    int index = 0;
+    for (const auto& hour : hours) {
+        for (const auto& tile : hour->tiles) {
+            const int x = (index % sheet->columns) * options_.tile_width;
+            const int y = (index / sheet->columns) * options_.tile_height;
+            blit(tile.image, canvas, x, y);
+            sheet->tiles.push_back({{"snapshot_id", tile.snapshot_id},
+                                    {"captured_at", tile.captured_at},
+                                    {"x", x},
+                                    {"y", y}});
+            ++index;
+        }
+    }
+
+    auto jpeg = encodeJpeg(canvas, options_.quality);
+    if (!jpeg) return nullptr;
+    sheet->jpeg = std::move(*jpeg);
+    sheet->etag = makeEtag(sheet->jpeg);
+    sheets_built_.fetch_add(1, std::memory_order_relaxed);
+    return sheet;
+}
+
+SpriteSheets::Stats SpriteSheets::stats() const {
+    Stats s;
+    s.sheet_hits = sheet_hits_.load(std::memory_order_relaxed);
+    s.sheets_built = sheets_built_.load(std::memory_order_relaxed);
+    s.hours_built = hours_built_.load(std::memory_order_relaxed);
+    s.tiles_decoded = tiles_decoded_.load(std::memory_order_relaxed);
+    s.coalesced = coalesced_.load(std::memory_order_relaxed);
+    std::lock_guard lock(mutex_);
+    s.tile_bytes = hours_.cost();
+    return s;
+}
+
+} // namespace hms
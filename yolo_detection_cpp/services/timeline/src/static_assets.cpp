@@ -0,0 +1,242 @@
+#include "static_assets.h"
+#include "compression.h"
+#include "http_utils.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace hms {
+
+namespace {
+
+/// Bodies below this size are not worth a compressed copy
+constexpr size_t kMinCompressBytes = 256;
+
+struct TypeInfo {
+    const char* mime;
+    bool compressible;
+};
+
+TypeInfo typeFor(const std::string& filename) {
+    static const std::unordered_map<std::string, TypeInfo> types = {
+        {".html", {"text/html; charset=utf-8", true}},
+        {".js", {"text/javascript; charset=utf-8", true}},
+        {".mjs", {"text/javascript; charset=utf-8", true}},
+        {".css", {"text/css; charset=utf-8", true}},
+        {".json", {"application/json", true}},
+        {".map", {"application/json", true}},
+        {".webmanifest", {"application/manifest+json", true}},
+        {".txt", {"text/plain; charset=utf-8", true}},
+        {".svg", {"image/svg+xml", true}},
+        {".ico", {"image/x-icon", true}},
+        {".png", {"image/png", false}},
+        {".jpg", {"image/jpeg", false}},
+        {".jpeg", {"image/jpeg", false}},
+        {".gif", {"image/gif", false}},
+        {".webp", {"image/webp", false}},
+        {".woff", {"font/woff", false}},
+        {".woff2", {"font/woff2", false}},
+        {".ttf", {"font/ttf", true}},
+    };
+    auto ext = fs::path(filename).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    auto it = types.find(ext);
+    return it != types.end() ? it->second : TypeInfo{"application/octet-stream", false};
+}
+
+bool readFile(const fs::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+} // anonymous namespace
+
+StaticAssets::StaticAssets(std::string root, Options options)
+    : root_(std::move(root)), options_(options)
+{
+}
+
+bool StaticAssets::isHashedName(std::string_view filename) {
+    // esbuild (Angular 17+): main-ABCD1234.js; webpack: main.0123456789abcdef.js
+    auto dot = filename.rfind('.');
+    if (dot == std::string_view::npos) return false;
+    auto stem = filename.substr(0, dot);
+    auto sep = stem.find_last_of("-.");
+    if (sep == std::string_view::npos || sep == 0) return false;
+    auto hash = stem.substr(sep + 1);
+
+    auto all_of = [&](auto pred) { return std::all_of(hash.begin(), hash.end(), pred); };
+    if (hash.size() == 8 && stem[sep] == '-') {
+        return all_of([](char c) { return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'); });
+    }
+    return hash.size() >= 16 && hash.size() <= 20 &&
+           all_of([](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); });
+}
+
+std::string StaticAssets::patchBaseHref(std::string html, const std::string& ingress_path) {
+    if (ingress_path.empty()) return html;
+    // Ensure trailing slash — required for <base href> to work as a directory
+    std::string base_href = ingress_path;
+    if (base_href.back() != '/') base_href += '/';
+
+    // Replace Angular's compiled <base href="/">
+    const std::string needle = R"(<base href="/">)";
+    auto pos = html.find(needle);
+    if (pos != std::string::npos) {
+        html.replace(pos, needle.size(), R"(<base href=")" + base_href + R"(">)");
+    }
+    return html;
+}
+
+StaticAssets::AssetPtr StaticAssets::makeAsset(std::string body, const std::string& filename,
+                                               bool immutable, bool compress) const {
+    auto asset = std::make_shared<Asset>();
+    auto type = typeFor(filename);
+    asset->content_type = type.mime;
+    asset->immutable = immutable;
+    asset->etag = makeEtag(body);
+    if (compress && type.compressible && body.size() >= kMinCompressBytes) {
+        auto br = brotliCompress(body);
+        if (!br.empty() && br.size() < body.size()) asset->brotli = std::move(br);
+        auto gz = gzipCompress(body);
+        if (!gz.empty() && gz.size() < body.size()) asset->gzip = std::move(gz);
+    }
+    asset->body = std::move(body);
+    return asset;
+}
+
+bool StaticAssets::load() {
+    std::error_code ec;
+    size_t bytes = 0;
+    for (auto it = fs::recursive_directory_iterator(root_, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        auto rel = fs::relative(it->path(), root_, ec).generic_string();
+        if (ec || rel.empty()) continue;
+        auto filename = it->path().filename().string();
+
+        if (it->file_size(ec) > options_.max_file_bytes) {
+            auto asset = std::make_shared<Asset>();
+            asset->disk_path = it->path().string();
+            asset->immutable = isHashedName(filename);
+            assets_[rel] = std::move(asset);
+            continue;
+        }
+
+        std::string body;
+        if (!readFile(it->path(), body)) {
+            spdlog::warn("StaticAssets: cannot read {}", it->path().string());
+            continue;
+        }
+        if (rel == "index.html") index_html_ = body;
+        auto asset = makeAsset(std::move(body), filename, isHashedName(filename));
+        bytes += asset->body.size() + asset->gzip.size() + asset->brotli.size();
+        assets_[rel] = std::move(asset);
+    }
+    if (ec) spdlog::warn("StaticAssets: cannot walk {}: {}", root_, ec.message());
+
+    spdlog::info("StaticAssets: {} files, {} KiB in memory from {}",
+                 assets_.size(), bytes / 1024, root_);
+    return !index_html_.empty();
+}
+
+drogon::HttpResponsePtr StaticAssets::respond(const drogon::HttpRequestPtr& req, const Asset& asset) {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    const char* cache_control = asset.immutable ? "public, max-age=31536000, immutable" : "no-cache";
+
+    if (!asset.disk_path.empty()) {
+        auto resp = drogon::HttpResponse::newFileResponse(asset.disk_path);
+        resp->addHeader("Cache-Control", cache_control);
+        return resp;
+    }
+
+    const auto& accept = req->getHeader("Accept-Encoding");
+    const std::string* body = &asset.body;
+    const char* encoding = nullptr;
+    if (!asset.brotli.empty() && acceptsEncoding(accept, "br")) {
+        body = &asset.brotli;
+        encoding = "br";
+    } else if (!asset.gzip.empty() && acceptsEncoding(accept, "gzip")) {
+        body = &asset.gzip;
+        encoding = "gzip";
+    }
+    // A strong validator must differ per encoding
+    auto etag = encoding ? asset.etag.substr(0, asset.etag.size() - 1) + "-" + encoding + "\""
+                         : asset.etag;
+
+    if (isNotModified(req, etag, {})) {
+        not_modified_.fetch_add(1, std::memory_order_relaxed);
+        auto resp = makeNotModifiedResponse(etag, {});
+        resp->addHeader("Cache-Control", cache_control);
+        return resp;
+    }
+
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeString(asset.content_type);
+    // Drogon leaves bodies that already carry a Content-Encoding alone
+    resp->setBody(*body);
+    if (encoding) resp->addHeader("Content-Encoding", encoding);
+    if (!asset.brotli.empty() || !asset.gzip.empty()) resp->addHeader("Vary", "Accept-Encoding");
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Cache-Control", cache_control);
+    return resp;
+}
+
+drogon::HttpResponsePtr StaticAssets::serve(const drogon::HttpRequestPtr& req,
+                                            std::string_view sub_path) {
+    auto it = assets_.find(std::string(sub_path));
+    if (it == assets_.end()) return nullptr;
+    return respond(req, *it->second);
+}
+
+drogon::HttpResponsePtr StaticAssets::serveIndex(const drogon::HttpRequestPtr& req,
+                                                 const std::string& ingress_path) {
+    if (index_html_.empty()) return nullptr;
+
+    AssetPtr asset;
+    bool full;
+    {
+        std::lock_guard lock(index_mutex_);
+        auto it = index_variants_.find(ingress_path);
+        if (it != index_variants_.end()) asset = it->second;
+        full = index_variants_.size() >= options_.max_index_variants;
+    }
+    if (!asset && full) {
+        // The header is client-controlled: past the cap, a per-request patch
+        // must stay cheap, so no Brotli/gzip on the request thread
+        index_uncached_.fetch_add(1, std::memory_order_relaxed);
+        asset = makeAsset(patchBaseHref(index_html_, ingress_path), "index.html", false, false);
+    } else if (!asset) {
+        asset = makeAsset(patchBaseHref(index_html_, ingress_path), "index.html", false);
+        std::lock_guard lock(index_mutex_);
+        if (index_variants_.size() < options_.max_index_variants) {
+            index_variants_.emplace(ingress_path, asset);
+        }
+    }
+    return respond(req, *asset);
+}
+
+StaticAssets::Stats StaticAssets::stats() const {
+    Stats s;
+    s.files = assets_.size();
+    for (const auto& [path, asset] : assets_) {
+        s.bytes += asset->body.size() + asset->gzip.size() + asset->brotli.size();
+    }
+    {
+        std::lock_guard lock(index_mutex_);
+        s.index_variants = index_variants_.size();
+    }
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.not_modified = not_modified_.load(std::memory_order_relaxed);
+    s.index_uncached = index_uncached_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace hms
@@ -0,0 +1,248 @@
+#include "thumbnail_cache.h"
+#include "http_utils.h"
+#include "jpeg_codec.h"
+
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <tuple>
+
+namespace fs = std::filesystem;
+
+namespace hms {
+
+namespace {
+
+/// Cache key, also the on-disk file name: <stem>.w<width>.<size>-<mtime>.jpg
+/// (source names are validated by MediaController, so they are filesystem-safe)
+std::string makeKey(const std::string& source_path, int width, const struct stat& st) {
+    char suffix[80];
+    const auto mtime_ns = static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ull +
+                          static_cast<unsigned long long>(st.st_mtim.tv_nsec);
+    std::snprintf(suffix, sizeof(suffix), ".w%d.%llx-%llx.jpg", width,
+                  static_cast<unsigned long long>(st.st_size), mtime_ns);
+    return fs::path(source_path).stem().string() + suffix;
+}
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+ThumbnailCache::ThumbnailPtr makeThumbnail(std::string body) {
+    auto thumb = std::make_shared<ThumbnailCache::Thumbnail>();
+    thumb->etag = makeEtag(body);
+    thumb->body = std::move(body);
+    return thumb;
+}
+
+} // anonymous namespace
+
+ThumbnailCache::ThumbnailCache(Options options)
+    : options_(std::move(options)),
+      memory_(options_.max_memory_bytes),
+      disk_(options_.max_disk_bytes),
+      workers_(std::max<size_t>(options_.workers, 1), "thumbnails")
+{
+    if (!options_.disk_dir.empty()) {
+        // Runs under disk_mutex_ (from put() in writeDisk / loadDiskIndex)
+        disk_.setOnEvict([this](const std::string& key, bool&) {
+            std::error_code ec;
+            fs::remove(diskPath(key), ec);
+        });
+        loadDiskIndex();
+    }
+}
+
+int ThumbnailCache::bucketWidth(int requested) {
+    if (requested <= 0) return 0;
+    for (int width : kWidths) {
+        if (requested <= width) return width;
+    }
+    return kWidths[std::size(kWidths) - 1];
+}
+
+std::optional<std::string> ThumbnailCache::scaleJpeg(std::string_view jpeg, int max_width,
+                                                     int quality) {
+    if (max_width <= 0 || jpeg.empty()) return std::nullopt;
+    RgbImage image;
+    if (!decodeJpeg(jpeg, max_width, 0, image)) return std::nullopt;
+    return encodeJpeg(image, quality);
+}
+
+void ThumbnailCache::get(const std::string& source_path, int width, Callback&& callback) {
+    struct stat st {};
+    if (width <= 0 || ::stat(source_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        callback(nullptr);
+        return;
+    }
+    auto key = makeKey(source_path, width, st);
+
+    ThumbnailPtr hit;
+    {
+        std::lock_guard lock(mutex_);
+        if (const auto* cached = memory_.peek(key)) {
+            hit = *cached;
+        } else {
+            auto& waiters = inflight_[key];
+            waiters.push_back(std::move(callback));
+            if (waiters.size() > 1) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    if (hit) {
+        memory_hits_.fetch_add(1, std::memory_order_relaxed);
+        callback(hit);
+        return;
+    }
+
+    workers_.runTaskInQueue([this, key = std::move(key), source_path, width] {
+        generate(key, source_path, width);
+    });
+}
+
+void ThumbnailCache::generate(const std::string& key, const std::string& source_path, int width) {
+    if (auto thumb = readDisk(key)) {
+        disk_hits_.fetch_add(1, std::memory_order_relaxed);
+        complete(key, thumb);
+        return;
+    }
+
+    std::string source;
+    std::optional<std::string> body;
+    if (readFile(source_path, source)) {
+        body = scaleJpeg(source, width, options_.quality);
+    }
+    if (!body) {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        spdlog::debug("ThumbnailCache: cannot thumbnail {}", source_path);
+        complete(key, nullptr);
+        return;
+    }
+
+    generated_.fetch_add(1, std::memory_order_relaxed);
+    writeDisk(key, *body);
+    complete(key, makeThumbnail(std::move(*body)));
+}
+
+void ThumbnailCache::complete(const std::string& key, const ThumbnailPtr& thumb) {
+    std::vector<Callback> waiters;
+    {
+        std::lock_guard lock(mutex_);
+        if (thumb) memory_.put(key, thumb, key.size() + thumb->body.size() + sizeof(Thumbnail));
+        auto it = inflight_.find(key);
+        if (it != inflight_.end()) {
+            waiters.swap(it->second);
+            inflight_.erase(it);
+        }
+    }
+    for (auto& waiter : waiters) {
+        waiter(thumb);
+    }
+}
+
+std::string ThumbnailCache::diskPath(const std::string& key) const {
+    return (fs::path(options_.disk_dir) / key).string();
+}
+
+ThumbnailCache::ThumbnailPtr ThumbnailCache::readDisk(const std::string& key) {
+    if (options_.disk_dir.empty()) return nullptr;
+    {
+        std::lock_guard lock(disk_mutex_);
+        if (!disk_.peek(key)) return nullptr;
+    }
+    std::string body;
+    if (!readFile(diskPath(key), body) || body.empty()) {
+        std::lock_guard lock(disk_mutex_);
+        disk_.erase(key);
+        return nullptr;
+    }
+    return makeThumbnail(std::move(body));
+}
+
+void ThumbnailCache::writeDisk(const std::string& key, const std::string& body) {
+    if (options_.disk_dir.empty()) return;
+    // Write-then-rename so a crash never leaves a truncated thumbnail behind
+    const auto path = diskPath(key);
+    const auto tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(body.data(), static_cast<std::streamsize>(body.size()));
+        if (!out) {
+            spdlog::warn("ThumbnailCache: cannot write {}", tmp);
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    std::lock_guard lock(disk_mutex_);
+    disk_.put(key, true, body.size());
+}
+
+void ThumbnailCache::loadDiskIndex() {
+    std::error_code ec;
+    fs::create_directories(options_.disk_dir, ec);
+    if (ec) {
+        spdlog::warn("ThumbnailCache: cannot create {}: {}; disk cache disabled",
+                     options_.disk_dir, ec.message());
+        options_.disk_dir.clear();
+        return;
+    }
+
+    // Oldest first, so the most recently written thumbnails end up most recently used
+    std::vector<std::tuple<fs::file_time_type, std::string, size_t>> files;
+    for (auto it = fs::directory_iterator(options_.disk_dir, ec);
+         !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        auto name = it->path().filename().string();
+        if (it->path().extension() != ".jpg") {
+            if (it->path().extension() == ".tmp") fs::remove(it->path(), ec);
+            continue;
+        }
+        files.emplace_back(it->last_write_time(ec), std::move(name),
+                           static_cast<size_t>(it->file_size(ec)));
+    }
+    std::sort(files.begin(), files.end());
+
+    std::lock_guard lock(disk_mutex_);
+    for (auto& [mtime, name, size] : files) {
+        disk_.put(name, true, size);
+    }
+    spdlog::info("ThumbnailCache: {} thumbnails, {} KiB on disk in {}",
+                 disk_.size(), disk_.cost() / 1024, options_.disk_dir);
+}
+
+ThumbnailCache::Stats ThumbnailCache::stats() const {
+    Stats s;
+    s.memory_hits = memory_hits_.load(std::memory_order_relaxed);
+    s.disk_hits = disk_hits_.load(std::memory_order_relaxed);
+    s.generated = generated_.load(std::memory_order_relaxed);
+    s.coalesced = coalesced_.load(std::memory_order_relaxed);
+    s.failures = failures_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard lock(mutex_);
+        s.memory_bytes = memory_.cost();
+    }
+    {
+        std::lock_guard lock(disk_mutex_);
+        s.disk_bytes = disk_.cost();
+    }
+    return s;
+}
+
+} // namespace hms
@@ -0,0 +1,798 @@
+#include "timeline_queries.h"
+#include "json_writer.h"
+
+#include <spdlog/spdlog.h>
+#include <pqxx/pqxx>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+using json = nlohmann::json;
+
+namespace hms {
+namespace timeline_queries {
+
+namespace {
+
+// Column lists shared by the paging and by-id loaders
+constexpr const char* kEventEmbeddingColumns = R"(
+    e.event_id, e.camera_id, e.camera_name,
+    to_char(e.started_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS ts,
+    floor(EXTRACT(EPOCH FROM e.started_at))::bigint AS ts_epoch,
+    e.recording_url, e.snapshot_url, e.total_detections, e.duration_seconds,
+    e.detected_classes, e.ai_context, e.embedding::text AS embedding,
+    hashtext(coalesce(e.ai_context::text, '')) AS fingerprint)";
+
+constexpr const char* kSnapshotEmbeddingColumns = R"(
+    s.snapshot_id, s.camera_id,
+    to_char(s.captured_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS ts,
+    floor(EXTRACT(EPOCH FROM s.captured_at))::bigint AS ts_epoch,
+    s.snapshot_url, s.ai_context, s.embedding::text AS embedding,
+    hashtext(coalesce(s.ai_context::text, '')) AS fingerprint)";
+
+// /api/events row columns, read by writeEventRow
+constexpr const char* kEventListColumns = R"(
+    event_id, camera_id, camera_name,
+    to_char(started_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS started_at,
+    to_char(ended_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS ended_at,
+    (EXTRACT(EPOCH FROM started_at) * 1000000)::bigint AS started_at_us,
+    duration_seconds, total_detections, status, recording_url, snapshot_url,
+    detected_classes, max_confidence, ai_context)";
+
+// Events per camera, session-time-zone day and 15-minute slot (RollupRow)
+constexpr const char* kRollupSelect = R"(
+    SELECT camera_id,
+           to_char(started_at, 'YYYY-MM-DD') AS day,
+           EXTRACT(HOUR FROM started_at)::int * 4
+               + EXTRACT(MINUTE FROM started_at)::int / 15 AS slot,
+           COUNT(*) AS event_count,
+           COALESCE(SUM(total_detections), 0) AS total_detections
+    FROM detection_events)";
+
+// Detection columns, read by writeDetection
+constexpr const char* kDetectionColumns = R"(
+    detection_id, event_id, class_name, confidence,
+    bbox_x1, bbox_y1, bbox_x2, bbox_y2, frame_number,
+    to_char(detected_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS.MS"Z"') AS detected_at)";
+
+json textOrNull(const pqxx::field& f) {
+    return f.is_null() ? json(nullptr) : json(f.c_str());
+}
+
+/// Parse pgvector's text form "[0.1,0.2,...]"
+std::vector<float> parseVector(const pqxx::field& f) {
+    std::vector<float> out;
+    if (f.is_null()) return out;
+    const char* p = f.c_str();
+    if (*p == '[') ++p;
+    out.reserve(768);
+    while (*p && *p != ']') {
+        char* end = nullptr;
+        float v = std::strtof(p, &end);
+        if (end == p) break;
+        out.push_back(v);
+        p = end;
+        if (*p == ',') ++p;
+    }
+    return out;
+}
+
+EmbeddingRow eventRow(const pqxx::row& r) {
+    EmbeddingRow row;
+    row.type = "event";
+    row.id = r["event_id"].c_str();
+    row.camera_id = r["camera_id"].c_str();
+    row.timestamp_epoch = r["ts_epoch"].as<int64_t>(0);
+    row.detected_classes = r["detected_classes"].is_null() ? "" : r["detected_classes"].c_str();
+    row.embedding = parseVector(r["embedding"]);
+    row.fingerprint = r["fingerprint"].as<int32_t>(0);
+    row.doc = {
+        {"type", "event"},
+        {"id", row.id},
+        {"camera_id", row.camera_id},
+        {"camera_name", textOrNull(r["camera_name"])},
+        {"timestamp", textOrNull(r["ts"])},
+        {"recording_url", textOrNull(r["recording_url"])},
+        {"snapshot_url", textOrNull(r["snapshot_url"])},
+        {"total_detections", r["total_detections"].as<int>(0)},
+        {"duration_seconds", r["duration_seconds"].is_null()
+                                 ? json(nullptr) : json(r["duration_seconds"].as<double>())},
+        {"detected_classes", textOrNull(r["detected_classes"])},
+        {"ai_context", textOrNull(r["ai_context"])},
+    };
+    return row;
+}
+
+EmbeddingRow snapshotRow(const pqxx::row& r) {
+    EmbeddingRow row;
+    row.type = "snapshot";
+    row.id = r["snapshot_id"].c_str();
+    row.camera_id = r["camera_id"].c_str();
+    row.timestamp_epoch = r["ts_epoch"].as<int64_t>(0);
+    row.embedding = parseVector(r["embedding"]);
+    row.fingerprint = r["fingerprint"].as<int32_t>(0);
+    row.doc = {
+        {"type", "snapshot"},
+        {"id", row.id},
+        {"camera_id", row.camera_id},
+        {"camera_name", row.camera_id},
+        {"timestamp", textOrNull(r["ts"])},
+        {"recording_url", nullptr},
+        {"snapshot_url", textOrNull(r["snapshot_url"])},
+        {"total_detections", 0},
+        {"detected_classes", nullptr},
+        {"ai_context", textOrNull(r["ai_context"])},
+    };
+    return row;
+}
+
+void writeText(JsonWriter& out, const pqxx::field& f) {
+    if (f.is_null()) {
+        out.null();
+    } else {
+        out.value(std::string_view(f.c_str(), f.size()));
+    }
+}
+
+void writeNumber(JsonWriter& out, const pqxx::field& f) {
+    if (f.is_null()) {
+        out.null();
+    } else {
+        out.value(f.as<double>());
+    }
+}
+
+void writeInteger(JsonWriter& out, const pqxx::field& f) {
+    if (f.is_null()) {
+        out.null();
+    } else {
+        out.value(f.as<int64_t>());
+    }
+}
+
+/// Append one kEventListColumns row to json_out as an /api/events object
+void writeEventRow(std::string& json_out, const pqxx::row& r) {
+    JsonWriter out(json_out);
+    out.beginObject();
+    out.key("event_id"); writeText(out, r["event_id"]);
+    out.key("camera_id"); writeText(out, r["camera_id"]);
+    out.key("camera_name"); writeText(out, r["camera_name"]);
+    out.key("started_at"); writeText(out, r["started_at"]);
+    out.key("ended_at"); writeText(out, r["ended_at"]);
+    out.key("duration_seconds"); writeNumber(out, r["duration_seconds"]);
+    out.key("total_detections").value(r["total_detections"].as<int>(0));
+    out.key("status"); writeText(out, r["status"]);
+    out.key("recording_url"); writeText(out, r["recording_url"]);
+    out.key("snapshot_url"); writeText(out, r["snapshot_url"]);
+    out.key("detected_classes"); writeText(out, r["detected_classes"]);
+    out.key("max_confidence"); writeNumber(out, r["max_confidence"]);
+    out.key("ai_context"); writeText(out, r["ai_context"]);
+    out.endObject();
+}
+
+/// Write one kDetectionColumns row as a detection object
+void writeDetection(JsonWriter& out, const pqxx::row& r) {
+    out.beginObject();
+    out.key("detection_id"); writeInteger(out, r["detection_id"]);
+    out.key("class_name"); writeText(out, r["class_name"]);
+    out.key("confidence"); writeNumber(out, r["confidence"]);
+    out.key("bbox_x1"); writeNumber(out, r["bbox_x1"]);
+    out.key("bbox_y1"); writeNumber(out, r["bbox_y1"]);
+    out.key("bbox_x2"); writeNumber(out, r["bbox_x2"]);
+    out.key("bbox_y2"); writeNumber(out, r["bbox_y2"]);
+    out.key("frame_number"); writeInteger(out, r["frame_number"]);
+    out.key("detected_at"); writeText(out, r["detected_at"]);
+    out.endObject();
+}
+
+/// Text form of a PostgreSQL text[] literal
+std::string toPgArray(const std::vector<std::string>& values) {
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i) out += ',';
+        out += '"';
+        for (char c : values[i]) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        out += '"';
+    }
+    out += '}';
+    return out;
+}
+
+/// pgvector's binary wire form (vector_recv): dimension and an unused
+/// int16, then the floats, all big-endian. 3 KiB for 768 floats instead of
+/// ~7 KiB of text the server would have to parse.
+std::basic_string<std::byte> vectorBinary(const std::vector<float>& v) {
+    std::basic_string<std::byte> out;
+    out.reserve(4 + v.size() * 4);
+    auto put = [&out](uint32_t value, int bytes) {
+        for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<std::byte>((value >> shift) & 0xff));
+        }
+    };
+    put(static_cast<uint32_t>(v.size()), 2);
+    put(0, 2);
+    for (float f : v) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        put(bits, 4);
+    }
+    return out;
+}
+
+// Statements the hot paths run; index into registry().statements()
+enum Stmt : size_t {
+    kEventsPage,
+    kRecentEvents,
+    kRollup,
+    kRollupCameras,
+    kEventsById,
+    kSnapshotsById,
+    kRecentIds,
+    kCurrentDate,
+    kSemanticSearch,
+    kEventsByIds,
+    kDetectionsByEvent,
+    kSearchBounds,
+    kEmbeddedEventIds,
+    kEmbeddedSnapshotIds,
+};
+
+// Several statements take optional filters as "$n IS NULL OR ...". A generic
+// plan has to serve every combination, so those predicates become filters
+// and the events page's keyset seek a backward scan of the whole index.
+// Rather than one statement per combination of filters (16 for the events
+// page alone), these sessions plan every execution for its actual
+// parameters, where the NULL branches fold away; prepared execution still
+// saves the parse and analysis.
+constexpr const char* kSessionSetup = "SET plan_cache_mode = force_custom_plan";
+
+PreparedStatements& registry() {
+    static PreparedStatements statements({
+        // The cursor is applied as one row-value comparison rather than
+        // "a < x OR (a = x AND b < y)" so the planner turns it into an index bound.
+        // Microseconds go through interval arithmetic to stay exact.
+        {"timeline_events_page", std::string("SELECT ") + kEventListColumns + R"(
+            FROM detection_events
+            WHERE ($1::text IS NULL OR camera_id = $1)
+              AND ($2::text IS NULL OR started_at >= $2::timestamptz)
+              AND ($3::text IS NULL OR started_at <= $3::timestamptz)
+              AND ($4::bigint IS NULL OR (started_at, event_id) <
+                   (timestamptz 'epoch' + $4::bigint * interval '1 microsecond', $5::text))
+            ORDER BY started_at DESC, event_id DESC
+            LIMIT $6)"},
+        // Newest first so a burst larger than limit still reaches the latest events
+        {"timeline_recent_events", std::string("SELECT ") + kEventListColumns + R"(
+            FROM detection_events
+            WHERE started_at >= COALESCE(timestamptz 'epoch' + $1::bigint * interval '1 microsecond',
+                                         now() - make_interval(secs => $2))
+            ORDER BY started_at DESC, event_id DESC
+            LIMIT $3)"},
+        {"timeline_rollup", std::string(kRollupSelect) + R"(
+            WHERE started_at >= $1::date AND started_at < $2::date + 1
+            GROUP BY 1, 2, 3)"},
+        {"timeline_rollup_cameras", std::string(kRollupSelect) + R"(
+            WHERE started_at >= $1::date AND started_at < $2::date + 1
+              AND camera_id = ANY($3::text[])
+            GROUP BY 1, 2, 3)"},
+        {"timeline_events_by_id", std::string("SELECT ") + kEventEmbeddingColumns + R"(
+            FROM detection_events e
+            WHERE e.embedding IS NOT NULL AND e.event_id = ANY($1::text[]))"},
+        {"timeline_snapshots_by_id", std::string("SELECT ") + kSnapshotEmbeddingColumns + R"(
+            FROM periodic_snapshots s
+            WHERE s.embedding IS NOT NULL AND s.snapshot_id::text = ANY($1::text[]))"},
+        {"timeline_recent_embedded_ids", R"(
+            SELECT 'event' AS type, event_id AS id,
+                   hashtext(coalesce(ai_context::text, '')) AS fingerprint
+            FROM detection_events
+            WHERE embedding IS NOT NULL
+              AND started_at > now() - make_interval(mins => $1)
+            UNION ALL
+            SELECT 'snapshot', snapshot_id::text, hashtext(coalesce(ai_context::text, ''))
+            FROM periodic_snapshots
+            WHERE embedding IS NOT NULL
+              AND captured_at > now() - make_interval(mins => $1))"},
+        {"timeline_current_date", "SELECT to_char(CURRENT_DATE, 'YYYY-MM-DD')"},
+        // Each table's nearest `limit` rows (an index scan with an HNSW index
+        // on embedding), then the best `limit` overall. Bounds are in the
+        // session time zone, like /api/events; a date-only end includes that
+        // whole day. Snapshots have no classes,
+        // so a class filter excludes them.
+        {"timeline_semantic_search", R"(
+            SELECT * FROM (
+                (SELECT 'event' AS type, e.event_id AS id, e.camera_id, e.camera_name,
+                        to_char(e.started_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS"Z"') AS ts,
+                        e.recording_url, e.snapshot_url, e.total_detections, e.duration_seconds,
+                        e.detected_classes, e.ai_context,
+                        1 - (e.embedding <=> $1::vector) AS similarity
+                 FROM detection_events e
+                 WHERE e.embedding IS NOT NULL
+                   AND ($2::text IS NULL OR e.camera_id = $2)
+                   AND ($3::text IS NULL OR e.started_at >= $3::text::timestamptz)
+                   AND ($4::text IS NULL OR e.started_at < CASE WHEN length($4::text) = 10
+                        THEN ($4::text::date + 1)::timestamptz
+                        ELSE $4::text::timestamptz + interval '1 second' END)
+                   AND ($5::text[] IS NULL OR EXISTS (
+                        SELECT 1 FROM unnest(string_to_array(e.detected_classes, ',')) AS c
+                        WHERE lower(btrim(c, ' {}"')) = ANY($5::text[])))
+                 ORDER BY e.embedding <=> $1::vector
+                 LIMIT $6)
+                UNION ALL
+                (SELECT 'snapshot', s.snapshot_id::text, s.camera_id, s.camera_id,
+                        to_char(s.captured_at AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS"Z"'),
+                        NULL, s.snapshot_url, 0, NULL, NULL, s.ai_context,
+                        1 - (s.embedding <=> $1::vector)
+                 FROM periodic_snapshots s
+                 WHERE s.embedding IS NOT NULL
+                   AND $5::text[] IS NULL
+                   AND ($2::text IS NULL OR s.camera_id = $2)
+                   AND ($3::text IS NULL OR s.captured_at >= $3::text::timestamptz)
+                   AND ($4::text IS NULL OR s.captured_at < CASE WHEN length($4::text) = 10
+                        THEN ($4::text::date + 1)::timestamptz
+                        ELSE $4::text::timestamptz + interval '1 second' END)
+                 ORDER BY s.embedding <=> $1::vector
+                 LIMIT $6)
+            ) hits
+            WHERE similarity >= $7
+            ORDER BY similarity DESC
+            LIMIT $6)"},
+        {"timeline_events_by_ids", std::string("SELECT ") + kEventListColumns + R"(
+            FROM detection_events
+            WHERE event_id = ANY($1::text[]))"},
+        {"timeline_detections_by_event", std::string("SELECT ") + kDetectionColumns + R"(
+            FROM detections
+            WHERE event_id = ANY($1::text[])
+            ORDER BY event_id, detected_at, detection_id)"},
+        // The search bounds of timeline_semantic_search as epoch seconds, for
+        // the in-process index: start inclusive, end exclusive
+        {"timeline_search_bounds", R"(
+            SELECT floor(EXTRACT(EPOCH FROM $1::text::timestamptz))::bigint AS from_epoch,
+                   floor(EXTRACT(EPOCH FROM CASE WHEN length($2::text) = 10
+                        THEN ($2::text::date + 1)::timestamptz
+                        ELSE $2::text::timestamptz + interval '1 second' END))::bigint AS to_epoch)"},
+        {"timeline_embedded_event_ids", R"(
+            SELECT event_id, hashtext(coalesce(ai_context::text, '')) FROM detection_events
+            WHERE embedding IS NOT NULL AND event_id > $1
+            ORDER BY event_id
+            LIMIT $2)"},
+        {"timeline_embedded_snapshot_ids", R"(
+            SELECT snapshot_id::text, hashtext(coalesce(ai_context::text, '')) FROM periodic_snapshots
+            WHERE embedding IS NOT NULL AND snapshot_id > $1
+            ORDER BY snapshot_id
+            LIMIT $2)"},
+    }, kSessionSetup);
+    return statements;
+}
+
+std::atomic<bool> g_prepared{true};
+
+/// Prepare the registry on conn (once per session) when prepared execution is on
+void prepare(pqxx::connection& conn) {
+    if (g_prepared.load(std::memory_order_relaxed)) registry().ensure(conn);
+}
+
+/// Run stmt by name when prepared, otherwise parse its text with the same parameters
+template <typename... Args>
+pqxx::result exec(pqxx::transaction_base& txn, Stmt stmt, Args&&... args) {
+    const auto& statement = registry().statements()[stmt];
+    if (!g_prepared.load(std::memory_order_relaxed)) {
+        return txn.exec_params(statement.sql, std::forward<Args>(args)...);
+    }
+    try {
+        return txn.exec_prepared(statement.name, std::forward<Args>(args)...);
+    } catch (const pqxx::sql_error& e) {
+        // invalid_sql_statement_name: the session lost its statements
+        // (DISCARD ALL, a pooler handing out another backend); prepare again next time
+        if (e.sqlstate() == "26000") registry().forget(txn.conn());
+        throw;
+    }
+}
+
+} // anonymous namespace
+
+void set_prepared_statements(bool enabled) {
+    g_prepared.store(enabled, std::memory_order_relaxed);
+}
+
+bool prepared_statements_enabled() {
+    return g_prepared.load(std::memory_order_relaxed);
+}
+
+PreparedStatements::Stats prepared_statement_stats() {
+    return registry().stats();
+}
+
+std::vector<EmbeddingRow> load_event_embeddings(DbPool& pool, const std::string& after_event_id,
+                                                int batch_size) {
+    std::vector<EmbeddingRow> rows;
+    try {
+        auto conn = pool.acquire();
+        pqxx::read_transaction txn(*conn);
+        auto result = txn.exec_params(
+            std::string("SELECT ") + kEventEmbeddingColumns + R"(
+            FROM detection_events e
+            WHERE e.embedding IS NOT NULL AND e.event_id > $1
+            ORDER BY e.event_id
+            LIMIT $2)",
+            after_event_id, batch_size);
+        rows.reserve(result.size());
+        for (const auto& r : result) rows.push_back(eventRow(r));
+    } catch (const std::exception& e) {
+        spdlog::error("load_event_embeddings failed: {}", e.what());
+    }
+    return rows;
+}
+
+std::vector<EmbeddingRow> load_snapshot_embeddings(DbPool& pool, int64_t after_snapshot_id,
+                                                   int batch_size) {
+    std::vector<EmbeddingRow> rows;
+    try {
+        auto conn = pool.acquire();
+        pqxx::read_transaction txn(*conn);
+        auto result = txn.exec_params(
+            std::string("SELECT ") + kSnapshotEmbeddingColumns + R"(
+            FROM periodic_snapshots s
+            WHERE s.embedding IS NOT NULL AND s.snapshot_id > $1
+            ORDER BY s.snapshot_id
+            LIMIT $2)",
+            after_snapshot_id, batch_size);
+        rows.reserve(result.size());
+        for (const auto& r : result) rows.push_back(snapshotRow(r));
+    } catch (const std::exception& e) {
+        spdlog::error("load_snapshot_embeddings failed: {}", e.what());
+    }
+    return rows;
+}
+
+std::vector<EmbeddedId> recent_embedded_ids(DbPool& pool, int lookback_minutes) {
+    std::vector<EmbeddedId> ids;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kRecentIds, lookback_minutes);
+        ids.reserve(result.size());
+        for (const auto& r : result) {
+            ids.push_back(EmbeddedId{r["type"].c_str(), r["id"].c_str(),
+                                     r["fingerprint"].as<int32_t>(0)});
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("recent_embedded_ids failed: {}", e.what());
+    }
+    return ids;
+}
+
+std::optional<std::vector<EmbeddedId>> embedded_event_ids(DbPool& pool,
+                                                         const std::string& after_event_id,
+                                                         int limit) {
+    std::vector<EmbeddedId> ids;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kEmbeddedEventIds, after_event_id, limit);
+        ids.reserve(result.size());
+        for (const auto& r : result) {
+            ids.push_back(EmbeddedId{"event", r[0].c_str(), r[1].as<int32_t>(0)});
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("embedded_event_ids failed: {}", e.what());
+        return std::nullopt;
+    }
+    return ids;
+}
+
+std::optional<std::vector<EmbeddedId>> embedded_snapshot_ids(DbPool& pool,
+                                                            int64_t after_snapshot_id,
+                                                            int limit) {
+    std::vector<EmbeddedId> ids;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kEmbeddedSnapshotIds, after_snapshot_id, limit);
+        ids.reserve(result.size());
+        for (const auto& r : result) {
+            ids.push_back(EmbeddedId{"snapshot", r[0].c_str(), r[1].as<int32_t>(0)});
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("embedded_snapshot_ids failed: {}", e.what());
+        return std::nullopt;
+    }
+    return ids;
+}
+
+std::vector<EmbeddingRow> load_embeddings_by_id(DbPool& pool,
+                                                const std::vector<std::string>& event_ids,
+                                                const std::vector<std::string>& snapshot_ids) {
+    std::vector<EmbeddingRow> rows;
+    if (event_ids.empty() && snapshot_ids.empty()) return rows;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        if (!event_ids.empty()) {
+            auto result = exec(txn, kEventsById, toPgArray(event_ids));
+            for (const auto& r : result) rows.push_back(eventRow(r));
+        }
+        if (!snapshot_ids.empty()) {
+            auto result = exec(txn, kSnapshotsById, toPgArray(snapshot_ids));
+            for (const auto& r : result) rows.push_back(snapshotRow(r));
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("load_embeddings_by_id failed: {}", e.what());
+    }
+    return rows;
+}
+
+std::optional<std::vector<RollupRow>> load_rollup(DbPool& pool, const std::string& from_date,
+                                                  const std::string& to_date,
+                                                  const std::vector<std::string>& camera_ids) {
+    std::vector<RollupRow> rows;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        // A separate statement rather than "$3 IS NULL OR ...", so the camera
+        // filter stays an index condition under a generic plan
+        auto result = camera_ids.empty()
+            ? exec(txn, kRollup, from_date, to_date)
+            : exec(txn, kRollupCameras, from_date, to_date, toPgArray(camera_ids));
+        rows.reserve(result.size());
+        for (const auto& r : result) {
+            rows.push_back(RollupRow{
+                r["camera_id"].c_str(),
+                r["day"].c_str(),
+                r["slot"].as<int>(),
+                r["event_count"].as<int64_t>(),
+                r["total_detections"].as<int64_t>(),
+            });
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("load_rollup failed: {}", e.what());
+        return std::nullopt;
+    }
+    return rows;
+}
+
+std::optional<EventPage> load_events_page(DbPool& pool, const EventPageQuery& query) {
+    EventPage page;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        const auto& before = query.before;
+        auto result = exec(
+            txn, kEventsPage, query.camera_id, query.start, query.end,
+            before ? std::optional<int64_t>(before->started_at_us) : std::nullopt,
+            before ? std::optional<std::string>(before->event_id) : std::nullopt,
+            query.limit);
+
+        page.rows.reserve(result.size());
+        page.json.reserve(result.size() * 512);
+        for (const auto& r : result) {
+            EventPage::Row row;
+            row.key.started_at_us = r["started_at_us"].as<int64_t>();
+            row.key.event_id = r["event_id"].c_str();
+            if (!r["recording_url"].is_null()) row.recording_url = r["recording_url"].c_str();
+            row.begin = page.json.size();
+
+            writeEventRow(page.json, r);
+            row.size = page.json.size() - row.begin;
+            page.rows.push_back(std::move(row));
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("load_events_page failed: {}", e.what());
+        return std::nullopt;
+    }
+    return page;
+}
+
+std::optional<std::vector<FeedRow>> load_recent_events(DbPool& pool,
+                                                       std::optional<int64_t> since_us,
+                                                       int lookback_seconds, int limit) {
+    std::vector<FeedRow> rows;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kRecentEvents, since_us, lookback_seconds, limit);
+        rows.resize(result.size());
+        auto out = rows.rbegin();
+        for (const auto& r : result) {
+            out->event_id = r["event_id"].c_str();
+            out->camera_id = r["camera_id"].is_null() ? "" : r["camera_id"].c_str();
+            out->started_at_us = r["started_at_us"].as<int64_t>();
+            writeEventRow(out->json, r);
+            ++out;
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("load_recent_events failed: {}", e.what());
+        return std::nullopt;
+    }
+    return rows;
+}
+
+std::optional<EventDetails> load_event_details(DbPool& pool, const std::vector<std::string>& ids) {
+    EventDetails details;
+    if (ids.empty()) return details;
+    try {
+        const auto id_array = toPgArray(ids);
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+
+        auto events = exec(txn, kEventsByIds, id_array);
+        details.by_id.reserve(events.size());
+        for (const auto& r : events) {
+            auto& entry = details.by_id[r["event_id"].c_str()];
+            writeEventRow(entry.event, r);
+        }
+
+        // Rows arrive grouped by event_id; each group becomes one array
+        auto detections = exec(txn, kDetectionsByEvent, id_array);
+        std::string current;
+        EventDetails::Entry* entry = nullptr;
+        std::optional<JsonWriter> out;
+        auto close = [&out] {
+            if (out) out->endArray();
+            out.reset();
+        };
+        for (const auto& r : detections) {
+            std::string_view event_id(r["event_id"].c_str(), r["event_id"].size());
+            if (event_id != current) {
+                close();
+                current.assign(event_id);
+                auto it = details.by_id.find(current);
+                entry = it == details.by_id.end() ? nullptr : &it->second;
+                if (entry) {
+                    out.emplace(entry->detections);
+                    out->beginArray();
+                }
+            }
+            if (!entry) continue;
+            writeDetection(*out, r);
+            ++entry->detection_count;
+        }
+        close();
+
+        for (auto& [id, e] : details.by_id) {
+            if (e.detections.empty()) e.detections = "[]";
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("load_event_details failed: {}", e.what());
+        return std::nullopt;
+    }
+    return details;
+}
+
+std::optional<std::string> current_wal_lsn(DbPool& pool) {
+    try {
+        auto conn = pool.acquire();
+        pqxx::read_transaction txn(*conn);
+        auto result = txn.exec("SELECT pg_current_wal_lsn()::text");
+        if (!result.empty()) return std::string(result[0][0].c_str());
+    } catch (const std::exception& e) {
+        spdlog::error("current_wal_lsn failed: {}", e.what());
+    }
+    return std::nullopt;
+}
+
+std::optional<ReplicaStatus> replica_status(DbPool& pool,
+                                            const std::optional<std::string>& primary_lsn) {
+    // Health checks run every few seconds; they are not worth preparing
+    auto conn = pool.acquire();
+    pqxx::read_transaction txn(*conn);
+    auto result = txn.exec_params(R"(
+        SELECT pg_is_in_recovery() AS in_recovery,
+               CASE WHEN pg_is_in_recovery() AND $1::text IS NOT NULL
+                    THEN pg_wal_lsn_diff($1::pg_lsn, pg_last_wal_replay_lsn())
+               END AS lag_bytes,
+               EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) AS replay_age)",
+        primary_lsn);
+    if (result.empty()) return std::nullopt;
+    const auto& r = result[0];
+    ReplicaStatus status;
+    status.in_recovery = r["in_recovery"].as<bool>();
+    if (!r["lag_bytes"].is_null()) status.lag_bytes = r["lag_bytes"].as<double>();
+    if (!r["replay_age"].is_null()) status.replay_age = r["replay_age"].as<double>();
+    return status;
+}
+
+std::optional<std::string> current_date(DbPool& pool) {
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kCurrentDate);
+        if (!result.empty()) return std::string(result[0][0].c_str());
+    } catch (const std::exception& e) {
+        spdlog::error("current_date failed: {}", e.what());
+    }
+    return std::nullopt;
+}
+
+std::optional<SearchBounds> search_bounds(DbPool& pool, const std::optional<std::string>& start,
+                                          const std::optional<std::string>& end) {
+    SearchBounds bounds;
+    if (!start && !end) return bounds;
+    try {
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kSearchBounds, start, end);
+        if (result.empty()) return std::nullopt;
+        const auto& r = result[0];
+        if (!r["from_epoch"].is_null()) bounds.from_epoch = r["from_epoch"].as<int64_t>();
+        if (!r["to_epoch"].is_null()) bounds.to_epoch = r["to_epoch"].as<int64_t>();
+    } catch (const std::exception& e) {
+        // Also a malformed date: the caller falls back to the SQL search,
+        // which reports it the same way as before
+        spdlog::debug("search_bounds failed: {}", e.what());
+        return std::nullopt;
+    }
+    return bounds;
+}
+
+std::optional<json> search_semantic(DbPool& pool, const api_queries::SearchParams& params,
+                                    const std::vector<float>& embedding, float min_similarity) {
+    json events = json::array();
+    try {
+        std::optional<std::string> classes;
+        if (!params.class_filter.empty()) {
+            std::vector<std::string> wanted;
+            for (auto cls : params.class_filter) {
+                for (auto& c : cls) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                wanted.push_back(std::move(cls));
+            }
+            classes = toPgArray(wanted);
+        }
+
+        auto conn = pool.acquire();
+        prepare(*conn);
+        pqxx::read_transaction txn(*conn);
+        auto result = exec(txn, kSemanticSearch, vectorBinary(embedding), params.camera_id,
+                           params.start_date, params.end_date, classes,
+                           std::max(params.limit, 1), min_similarity);
+        for (const auto& r : result) {
+            const bool is_event = std::string_view(r["type"].c_str()) == "event";
+            json doc = {
+                {"type", r["type"].c_str()},
+                {"id", r["id"].c_str()},
+                {"camera_id", textOrNull(r["camera_id"])},
+                {"camera_name", textOrNull(r["camera_name"])},
+                {"timestamp", textOrNull(r["ts"])},
+                {"recording_url", textOrNull(r["recording_url"])},
+                {"snapshot_url", textOrNull(r["snapshot_url"])},
+                {"total_detections", r["total_detections"].as<int>(0)},
+                {"detected_classes", textOrNull(r["detected_classes"])},
+                {"ai_context", textOrNull(r["ai_context"])},
+                {"similarity", r["similarity"].as<double>()},
+            };
+            if (is_event) {
+                doc["duration_seconds"] = r["duration_seconds"].is_null()
+                    ? json(nullptr) : json(r["duration_seconds"].as<double>());
+            }
+            events.push_back(std::move(doc));
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("search_semantic failed: {}", e.what());
+        return std::nullopt;
+    }
+
+    const auto count = events.size();
+    return json{
+        {"events", std::move(events)},
+        {"count", count},
+        {"search_mode", "semantic"},
+        {"query", params.query},
+    };
+}
+
+} // namespace timeline_queries
+} // namespace hms
@@ -0,0 +1,321 @@
+#include "timeline_rollup.h"
+#include "timeline_queries.h"
+
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace hms {
+
+namespace {
+
+void addRows(std::map<TimelineRollup::Date, std::unordered_map<std::string, TimelineRollup::Day>>& days,
+             const std::vector<timeline_queries::RollupRow>& rows,
+             TimelineRollup::Date from, TimelineRollup::Date to) {
+    for (const auto& row : rows) {
+        auto date = TimelineRollup::parseDate(row.date);
+        if (!date || *date < from || *date > to) continue;
+        if (row.slot < 0 || row.slot >= TimelineRollup::kSlotsPerDay) continue;
+        auto& bucket = days[*date][row.camera_id][row.slot];
+        bucket.event_count = static_cast<uint32_t>(row.event_count);
+        bucket.total_detections = static_cast<uint32_t>(row.total_detections);
+    }
+}
+
+} // anonymous namespace
+
+TimelineRollup::TimelineRollup(std::shared_ptr<DbPool> pool, Options options)
+    : pool_(std::move(pool)), options_(std::move(options))
+{
+    if (!options_.load) {
+        options_.load = [pool = pool_](const std::string& from, const std::string& to) {
+            return timeline_queries::load_rollup(*pool, from, to);
+        };
+    }
+    if (!options_.today) {
+        options_.today = [pool = pool_] { return timeline_queries::current_date(*pool); };
+    }
+}
+
+TimelineRollup::~TimelineRollup() {
+    stop();
+}
+
+std::optional<TimelineRollup::Date> TimelineRollup::parseDate(const std::string& text) {
+    int y = 0;
+    unsigned m = 0, d = 0;
+    if (text.size() != 10 || std::sscanf(text.c_str(), "%4d-%2u-%2u", &y, &m, &d) != 3) {
+        return std::nullopt;
+    }
+    std::chrono::year_month_day ymd{std::chrono::year(y), std::chrono::month(m), std::chrono::day(d)};
+    if (!ymd.ok()) return std::nullopt;
+    return Date(ymd);
+}
+
+std::string TimelineRollup::formatDate(Date date) {
+    std::chrono::year_month_day ymd(date);
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u", static_cast<int>(ymd.year()),
+                  static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()));
+    return buf;
+}
+
+void TimelineRollup::start() {
+    if (thread_.joinable()) return;
+    loadPersisted();
+    thread_ = std::thread([this] { run(); });
+}
+
+void TimelineRollup::stop() {
+    {
+        std::lock_guard lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool TimelineRollup::waitFor(std::chrono::seconds interval) {
+    std::unique_lock lock(stop_mutex_);
+    return !stop_cv_.wait_for(lock, interval, [this] { return stopping_; });
+}
+
+void TimelineRollup::run() {
+    do {
+        refreshRecent();
+        persist();
+    } while (waitFor(options_.poll_interval));
+}
+
+void TimelineRollup::refreshRecent() {
+    auto today_str = options_.today();
+    auto today = today_str ? parseDate(*today_str) : std::nullopt;
+    if (!today) return;
+    const Date yesterday = *today - std::chrono::days(1);
+
+    auto rows = options_.load(formatDate(yesterday), formatDate(*today));
+    if (!rows) return;
+
+    std::map<Date, CameraDays> fresh;
+    fresh[yesterday];
+    fresh[*today];
+    addRows(fresh, *rows, yesterday, *today);
+
+    std::unique_lock lock(mutex_);
+    // The day that just dropped out of the refresh window is now final
+    if (mutable_from_ && *mutable_from_ < yesterday) dirty_ = true;
+    for (auto& [date, cameras] : fresh) days_[date] = std::move(cameras);
+    mutable_from_ = yesterday;
+    refreshes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TimelineRollup::ensureLoaded(Date from, Date to) {
+    std::map<Date, CameraDays> loaded;
+    return load(from, to, loaded);
+}
+
+bool TimelineRollup::load(Date from, Date to, std::map<Date, CameraDays>& loaded) {
+    std::optional<Date> first_missing, last_missing;
+    {
+        std::shared_lock lock(mutex_);
+        // Nothing to load after today; those dates simply read as empty
+        if (mutable_from_) to = std::min(to, *mutable_from_ + std::chrono::days(1));
+        for (Date d = from; d <= to; d += std::chrono::days(1)) {
+            if (days_.count(d)) continue;
+            if (!first_missing) first_missing = d;
+            last_missing = d;
+        }
+    }
+    if (!first_missing) return true;
+
+    auto rows = options_.load(formatDate(*first_missing), formatDate(*last_missing));
+    if (!rows) return false;
+    loads_.fetch_add(1, std::memory_order_relaxed);
+
+    for (Date d = *first_missing; d <= *last_missing; d += std::chrono::days(1)) loaded[d];
+    addRows(loaded, *rows, *first_missing, *last_missing);
+
+    std::unique_lock lock(mutex_);
+    for (const auto& [date, cameras] : loaded) {
+        // The poller may have refreshed this date meanwhile; its copy is newer
+        if (days_.emplace(date, cameras).second && mutable_from_ && date < *mutable_from_) {
+            dirty_ = true;
+        }
+    }
+    evict(from, to);
+    return true;
+}
+
+void TimelineRollup::evict(Date keep_from, Date keep_to) {
+    for (auto it = days_.begin(); days_.size() > options_.max_days && it != days_.end();) {
+        const Date date = it->first;
+        // Yesterday and today stay with the poller; the range being read stays too
+        if ((mutable_from_ && date >= *mutable_from_) || (date >= keep_from && date <= keep_to)) {
+            ++it;
+            continue;
+        }
+        it = days_.erase(it);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool TimelineRollup::visit(const std::vector<std::string>& camera_ids, Date from, Date to,
+                           const Visitor& fn) {
+    std::map<Date, CameraDays> loaded;
+    if (!load(from, to, loaded)) return false;
+
+    std::shared_lock lock(mutex_);
+    size_t day_index = 0;
+    for (Date d = from; d <= to; d += std::chrono::days(1), ++day_index) {
+        const CameraDays* cameras = nullptr;
+        if (auto it = days_.find(d); it != days_.end()) {
+            cameras = &it->second;
+        } else if (auto own = loaded.find(d); own != loaded.end()) {
+            cameras = &own->second;
+        }
+        if (!cameras) continue;
+        for (size_t c = 0; c < camera_ids.size(); ++c) {
+            auto cam = cameras->find(camera_ids[c]);
+            if (cam != cameras->end()) fn(c, day_index, cam->second);
+        }
+    }
+    return true;
+}
+
+bool TimelineRollup::isFinal(Date date) const {
+    std::shared_lock lock(mutex_);
+    return mutable_from_ && date < *mutable_from_ && days_.count(date);
+}
+
+TimelineRollup::Stats TimelineRollup::stats() const {
+    Stats s;
+    {
+        std::shared_lock lock(mutex_);
+        s.days = days_.size();
+        s.live = mutable_from_.has_value();
+    }
+    s.loads = loads_.load(std::memory_order_relaxed);
+    s.evictions = evictions_.load(std::memory_order_relaxed);
+    s.refreshes = refreshes_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void TimelineRollup::loadPersisted() {
+    if (options_.persist_path.empty() || !fs::exists(options_.persist_path)) return;
+    try {
+        std::ifstream in(options_.persist_path);
+        auto root = json::parse(in);
+        std::unique_lock lock(mutex_);
+        for (const auto& [date_str, cameras] : root.at("days").items()) {
+            auto date = parseDate(date_str);
+            if (!date) continue;
+            auto& day_map = days_[*date];
+            for (const auto& [camera_id, slots] : cameras.items()) {
+                auto& day = day_map[camera_id];
+                // Sparse [slot, event_count, total_detections] triples
+                for (const auto& s : slots) {
+                    int slot = s.at(0).get<int>();
+                    if (slot < 0 || slot >= kSlotsPerDay) continue;
+                    day[slot] = Bucket{s.at(1).get<uint32_t>(), s.at(2).get<uint32_t>()};
+                }
+            }
+        }
+        // Newest history first when the file holds more than max_days
+        while (days_.size() > options_.max_days) days_.erase(days_.begin());
+        spdlog::info("TimelineRollup: loaded {} days from {}", days_.size(), options_.persist_path);
+    } catch (const std::exception& e) {
+        spdlog::warn("TimelineRollup: ignoring {}: {}", options_.persist_path, e.what());
+    }
+}
+
+void TimelineRollup::persist() {
+    if (options_.persist_path.empty()) return;
+
+    // Copy the final days under the lock; building the JSON can take a while
+    std::vector<std::pair<Date, CameraDays>> final_days;
+    {
+        std::unique_lock lock(mutex_);
+        if (!dirty_ || !mutable_from_) return;
+        dirty_ = false;
+        for (const auto& [date, cameras] : days_) {
+            if (date >= *mutable_from_) break;
+            final_days.emplace_back(date, cameras);
+        }
+    }
+
+    json days = json::object();
+    for (const auto& [date, cameras] : final_days) {
+        json day_json = json::object();
+        for (const auto& [camera_id, day] : cameras) {
+            json slots = json::array();
+            for (int i = 0; i < kSlotsPerDay; ++i) {
+                if (day[i].event_count == 0) continue;
+                slots.push_back({i, day[i].event_count, day[i].total_detections});
+            }
+            day_json[camera_id] = std::move(slots);
+        }
+        days[formatDate(date)] = std::move(day_json);
+    }
+
+    // Write-then-rename so a crash never leaves a truncated file behind
+    auto tmp = options_.persist_path + ".tmp";
+    try {
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << json{{"version", 1}, {"days", std::move(days)}}.dump();
+            if (!out) throw std::runtime_error("write failed");
+        }
+        fs::rename(tmp, options_.persist_path);
+    } catch (const std::exception& e) {
+        spdlog::warn("TimelineRollup: cannot persist to {}: {}", options_.persist_path, e.what());
+        std::lock_guard<std::shared_mutex> lock(mutex_);
+        dirty_ = true;
+    }
+}
+
+TimelineBuckets::TimelineBuckets(size_t cameras, size_t days, int bucket_minutes)
+    : days_(days),
+      slots_per_bucket_(bucket_minutes / TimelineRollup::kSlotMinutes),
+      buckets_per_day_(TimelineRollup::kSlotsPerDay / slots_per_bucket_),
+      bucket_count_(days * buckets_per_day_),
+      event_count_(cameras, std::vector<uint64_t>(bucket_count_, 0)),
+      total_detections_(event_count_)
+{
+}
+
+void TimelineBuckets::add(size_t camera, size_t day_index, int slot, uint64_t events,
+                          uint64_t detections) {
+    if (camera >= event_count_.size() || day_index >= days_) return;
+    if (slot < 0 || slot >= TimelineRollup::kSlotsPerDay) return;
+    auto i = day_index * buckets_per_day_ + static_cast<size_t>(slot / slots_per_bucket_);
+    event_count_[camera][i] += events;
+    total_detections_[camera][i] += detections;
+}
+
+void TimelineBuckets::add(size_t camera, size_t day_index, const TimelineRollup::Day& day) {
+    for (int slot = 0; slot < TimelineRollup::kSlotsPerDay; ++slot) {
+        if (day[slot].event_count == 0) continue;
+        add(camera, day_index, slot, day[slot].event_count, day[slot].total_detections);
+    }
+}
+
+void TimelineBuckets::add(const std::vector<timeline_queries::RollupRow>& rows,
+                          const std::vector<std::string>& cameras, TimelineRollup::Date start) {
+    std::unordered_map<std::string, size_t> camera_index;
+    for (size_t c = 0; c < cameras.size(); ++c) camera_index.emplace(cameras[c], c);
+    for (const auto& row : rows) {
+        auto cam = camera_index.find(row.camera_id);
+        auto date = TimelineRollup::parseDate(row.date);
+        if (cam == camera_index.end() || !date || *date < start) continue;
+        add(cam->second, static_cast<size_t>((*date - start).count()), row.slot,
+            static_cast<uint64_t>(row.event_count), static_cast<uint64_t>(row.total_detections));
+    }
+}
+
+} // namespace hms
@@ -0,0 +1,123 @@
+#include "tuning_config.h"
+
+#include <spdlog/spdlog.h>
+#include <yaml-cpp/yaml.h>
+
+namespace hms {
+
+TuningConfig TuningConfig::load(const std::string& config_path) {
+    TuningConfig tuning;
+    try {
+        auto root = YAML::LoadFile(config_path);
+        auto timeline = root["timeline"];
+        if (!timeline) return tuning;
+
+        if (timeline["db_executor"]) {
+            tuning.db_executor = timeline["db_executor"].as<bool>();
+        }
+        if (timeline["db_executor_queue"]) {
+            tuning.db_executor_queue = timeline["db_executor_queue"].as<int>();
+        }
+        if (timeline["prepared_statements"]) {
+            tuning.prepared_statements = timeline["prepared_statements"].as<bool>();
+        }
+        if (auto replicas = timeline["db_replicas"]; replicas && replicas.IsSequence()) {
+            for (const auto& replica : replicas) {
+                tuning.db_replicas.emplace_back(replica["host"].as<std::string>(),
+                                                replica["port"] ? replica["port"].as<int>() : 5432);
+            }
+        }
+        if (timeline["db_replica_max_lag_s"]) {
+            tuning.db_replica_max_lag_s = timeline["db_replica_max_lag_s"].as<double>();
+        }
+        if (timeline["db_replica_check_s"]) {
+            tuning.db_replica_check_s = timeline["db_replica_check_s"].as<int>();
+        }
+        if (timeline["snapshot_refresh_ms"]) {
+            tuning.snapshot_refresh_ms = timeline["snapshot_refresh_ms"].as<int>();
+        }
+        if (timeline["event_stream"]) {
+            tuning.event_stream = timeline["event_stream"].as<bool>();
+        }
+        if (timeline["event_stream_poll_ms"]) {
+            tuning.event_stream_poll_ms = timeline["event_stream_poll_ms"].as<int>();
+        }
+        if (timeline["event_stream_lookback_s"]) {
+            tuning.event_stream_lookback_s = timeline["event_stream_lookback_s"].as<int>();
+        }
+        if (timeline["semantic_index"]) {
+            tuning.semantic_index = timeline["semantic_index"].as<bool>();
+        }
+        if (timeline["semantic_index_poll_s"]) {
+            tuning.semantic_index_poll_s = timeline["semantic_index_poll_s"].as<int>();
+        }
+        if (timeline["semantic_index_reconcile_s"]) {
+            tuning.semantic_index_reconcile_s = timeline["semantic_index_reconcile_s"].as<int>();
+        }
+        if (timeline["semantic_min_similarity"]) {
+            tuning.semantic_min_similarity = timeline["semantic_min_similarity"].as<double>();
+        }
+        if (timeline["semantic_index_graph"]) {
+            tuning.semantic_index_graph = timeline["semantic_index_graph"].as<bool>();
+        }
+        if (timeline["semantic_exact_storage"]) {
+            tuning.semantic_exact_storage = timeline["semantic_exact_storage"].as<std::string>();
+        }
+        if (timeline["hybrid_budget_ms"]) {
+            tuning.hybrid_budget_ms = timeline["hybrid_budget_ms"].as<int>();
+        }
+        if (timeline["hybrid_rrf_k"]) {
+            tuning.hybrid_rrf_k = timeline["hybrid_rrf_k"].as<int>();
+        }
+        if (timeline["timeline_rollup"]) {
+            tuning.timeline_rollup = timeline["timeline_rollup"].as<bool>();
+        }
+        if (timeline["timeline_rollup_poll_s"]) {
+            tuning.timeline_rollup_poll_s = timeline["timeline_rollup_poll_s"].as<int>();
+        }
+        if (timeline["timeline_rollup_path"]) {
+            tuning.timeline_rollup_path = timeline["timeline_rollup_path"].as<std::string>();
+        }
+        if (timeline["response_cache"]) {
+            tuning.response_cache = timeline["response_cache"].as<bool>();
+        }
+        if (timeline["response_cache_mb"]) {
+            tuning.response_cache_mb = timeline["response_cache_mb"].as<int>();
+        }
+        if (timeline["response_cache_live_ttl_s"]) {
+            tuning.response_cache_live_ttl_s = timeline["response_cache_live_ttl_s"].as<int>();
+        }
+        if (timeline["response_cache_final_ttl_s"]) {
+            tuning.response_cache_final_ttl_s = timeline["response_cache_final_ttl_s"].as<int>();
+        }
+        if (timeline["media_fd_cache"]) {
+            tuning.media_fd_cache = timeline["media_fd_cache"].as<int>();
+        }
+        if (timeline["thumbnail_cache_mb"]) {
+            tuning.thumbnail_cache_mb = timeline["thumbnail_cache_mb"].as<int>();
+        }
+        if (timeline["thumbnail_dir"]) {
+            tuning.thumbnail_dir = timeline["thumbnail_dir"].as<std::string>();
+        }
+        if (timeline["thumbnail_disk_mb"]) {
+            tuning.thumbnail_disk_mb = timeline["thumbnail_disk_mb"].as<int>();
+        }
+        if (timeline["sprite_sheets"]) {
+            tuning.sprite_sheets = timeline["sprite_sheets"].as<bool>();
+        }
+        if (timeline["sprite_tile_cache_mb"]) {
+            tuning.sprite_tile_cache_mb = timeline["sprite_tile_cache_mb"].as<int>();
+        }
+        if (timeline["mp4_index_mb"]) {
+            tuning.mp4_index_mb = timeline["mp4_index_mb"].as<int>();
+        }
+        if (timeline["metrics"]) {
+            tuning.metrics = timeline["metrics"].as<bool>();
+        }
+    } catch (const YAML::Exception& e) {
+        spdlog::warn("TuningConfig: using defaults, cannot read {}: {}", config_path, e.what());
+    }
+    return tuning;
+}
+
+} // namespace hms
@@ -0,0 +1,129 @@
+#include "vector_matrix.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hms {
+
+namespace {
+
+size_t elementSize(VectorMatrix::Storage storage) {
+    switch (storage) {
+        case VectorMatrix::Storage::Float16: return sizeof(uint16_t);
+        case VectorMatrix::Storage::Int8: return sizeof(int8_t);
+        case VectorMatrix::Storage::Float32: break;
+    }
+    return sizeof(float);
+}
+
+size_t paddedStride(size_t dim, VectorMatrix::Storage storage) {
+    const size_t per_line = 64 / elementSize(storage);
+    return (dim + per_line - 1) / per_line * per_line;
+}
+
+} // anonymous namespace
+
+VectorMatrix::VectorMatrix(size_t dim, Storage storage)
+    : dim_(dim), stride_(paddedStride(dim, storage)), storage_(storage)
+{
+}
+
+void VectorMatrix::normalize(float* v, size_t n) {
+    float norm = std::sqrt(simd::dotF32(v, v, n));
+    if (norm > 0.0f) {
+        for (size_t i = 0; i < n; ++i) v[i] /= norm;
+    }
+}
+
+uint32_t VectorMatrix::add(const float* vec) {
+    const auto id = static_cast<uint32_t>(rows_);
+    std::vector<float> unit(vec, vec + dim_);
+    normalize(unit.data(), dim_);
+
+    switch (storage_) {
+        case Storage::Float32:
+            f32_.resize(f32_.size() + stride_, 0.0f);
+            std::copy(unit.begin(), unit.end(), f32_.end() - stride_);
+            break;
+
+        case Storage::Float16: {
+            f16_.resize(f16_.size() + stride_, 0);
+            auto* out = f16_.data() + static_cast<size_t>(id) * stride_;
+            for (size_t i = 0; i < dim_; ++i) out[i] = simd::floatToHalf(unit[i]);
+            break;
+        }
+
+        case Storage::Int8: {
+            // Symmetric per-row quantisation: q = round(x / scale), scale = max|x| / 127
+            float max_abs = 0.0f;
+            for (float v : unit) max_abs = std::max(max_abs, std::fabs(v));
+            float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+            i8_.resize(i8_.size() + stride_, 0);
+            auto* out = i8_.data() + static_cast<size_t>(id) * stride_;
+            for (size_t i = 0; i < dim_; ++i) {
+                out[i] = static_cast<int8_t>(std::lround(unit[i] / scale));
+            }
+            scales_.push_back(scale);
+            break;
+        }
+    }
+    ++rows_;
+    return id;
+}
+
+float VectorMatrix::similarity(const float* query, uint32_t id) const {
+    const size_t offset = static_cast<size_t>(id) * stride_;
+    switch (storage_) {
+        case Storage::Float16: return simd::dotF16(query, f16_.data() + offset, dim_);
+        case Storage::Int8: return simd::dotI8(query, i8_.data() + offset, dim_) * scales_[id];
+        case Storage::Float32: break;
+    }
+    return simd::dotF32(query, f32_.data() + offset, dim_);
+}
+
+std::vector<VectorMatrix::Match> VectorMatrix::topK(const float* query, size_t k,
+                                                     const Filter& filter) const {
+    std::vector<Match> heap;   // min-heap on similarity: the weakest kept match on top
+    if (k == 0) return heap;
+    heap.reserve(k + 1);
+    auto weaker = [](const Match& a, const Match& b) { return a.second > b.second; };
+
+    for (uint32_t id = 0; id < rows_; ++id) {
+        if (filter && !filter(id)) continue;
+        float s = similarity(query, id);
+        if (heap.size() < k) {
+            heap.emplace_back(id, s);
+            std::push_heap(heap.begin(), heap.end(), weaker);
+        } else if (s > heap.front().second) {
+            std::pop_heap(heap.begin(), heap.end(), weaker);
+            heap.back() = {id, s};
+            std::push_heap(heap.begin(), heap.end(), weaker);
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), weaker);   // best first
+    return heap;
+}
+
+size_t VectorMatrix::bytes() const {
+    return rows_ * stride_ * elementSize(storage_) + scales_.size() * sizeof(float);
+}
+
+std::optional<VectorMatrix::Storage> VectorMatrix::parseStorage(std::string_view name) {
+    if (name == "f32") return Storage::Float32;
+    if (name == "f16") return Storage::Float16;
+    if (name == "int8") return Storage::Int8;
+    return std::nullopt;
+}
+
+const char* VectorMatrix::storageName(Storage storage) {
+    switch (storage) {
+        case Storage::Float16: return "f16";
+        case Storage::Int8: return "int8";
+        case Storage::Float32: break;
+    }
+    return "f32";
+}
+
+} // namespace hms
@@ -1,10 +1,69 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <jpeglib.h>
+
+#include "api_queries.h"
+#include "compression.h"
+#include "db_executor.h"
+#include "db_pool.h"
+#include "db_router.h"
+#include "detection_client.h"
+#include "embedding_client.h"
+#include "event_cursor.h"
+#include "event_details.h"
+#include "event_feed.h"
+#include "hnsw_index.h"
+#include "json_writer.h"
+#include "live_stream_hub.h"
+#include "http_utils.h"
+#include "lru_cache.h"
+#include "media_file_cache.h"
+#include "metrics.h"
+#include "mp4_index.h"
+#include "recording_index.h"
+#include "recording_name.h"
+#include "response_cache.h"
+#include "response_format.h"
+#include "search_fusion.h"
+#include "simd_kernels.h"
+#include "snapshot_cache.h"
+#include "sprite_sheets.h"
+#include "static_assets.h"
+#include "thumbnail_cache.h"
+#include "timeline_queries.h"
+#include "timeline_rollup.h"
+#include "vector_matrix.h"
 
 using json = nlohmann::json;
 
@@ -109,6 +168,316 @@ TEST_CASE("Limit parameter validation", "[api]") {
     CHECK(parse_limit("") == 100);        // Invalid: empty
 }
 
+TEST_CASE("Event cursor round-trips and rejects garbage", "[api]") {
+    hms::EventCursor cursor{1772015400123456, "patio_20260225_103000"};
+    auto token = cursor.encode();
+    CHECK(token.find_first_not_of(
+              "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_") ==
+          std::string::npos);
+
+    auto decoded = hms::EventCursor::decode(token);
+    REQUIRE(decoded);
+    CHECK(decoded->started_at_us == cursor.started_at_us);
+    CHECK(decoded->event_id == cursor.event_id);
+
+    // Event ids may themselves contain ':'
+    auto odd = hms::EventCursor::decode(hms::EventCursor{-5, "a:b"}.encode());
+    REQUIRE(odd);
+    CHECK(odd->started_at_us == -5);
+    CHECK(odd->event_id == "a:b");
+
+    CHECK_FALSE(hms::EventCursor::decode(""));
+    CHECK_FALSE(hms::EventCursor::decode("not a cursor!"));
+    CHECK_FALSE(hms::EventCursor::decode("bm9wZQ"));          // "nope"
+    CHECK_FALSE(hms::EventCursor::decode("MTp4eXo6aWQ"));     // "1:xyz:id"
+    CHECK_FALSE(hms::EventCursor::decode("MToxMjM6"));        // "1:123:" (no event id)
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Timeline rollup
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("Timeline rollup date parsing and slot layout", "[api][timeline]") {
+    using hms::TimelineRollup;
+    auto date = TimelineRollup::parseDate("2026-03-04");
+    REQUIRE(date.has_value());
+    CHECK(TimelineRollup::formatDate(*date) == "2026-03-04");
+    CHECK(TimelineRollup::formatDate(*date + std::chrono::days(1)) == "2026-03-05");
+    CHECK(TimelineRollup::formatDate(*TimelineRollup::parseDate("2024-02-28") + std::chrono::days(1))
+          == "2024-02-29");
+
+    CHECK_FALSE(TimelineRollup::parseDate("2026-02-30").has_value());
+    CHECK_FALSE(TimelineRollup::parseDate("2026-3-4").has_value());
+    CHECK_FALSE(TimelineRollup::parseDate("today").has_value());
+    CHECK_FALSE(TimelineRollup::parseDate("").has_value());
+
+    // 15-minute slots: four per hour, 96 per day
+    CHECK(TimelineRollup::kSlotsPerDay == 96);
+    CHECK(TimelineRollup::Day{}.size() == 96);
+}
+
+namespace {
+
+using hms::TimelineRollup;
+using hms::timeline_queries::RollupRow;
+
+TimelineRollup::Date day(const char* text) {
+    return *TimelineRollup::parseDate(text);
+}
+
+/// Canned rollup rows in place of PostgreSQL; records every range asked for
+struct FakeRollupSource {
+    std::mutex mutex;
+    std::vector<RollupRow> rows;
+    std::vector<std::pair<std::string, std::string>> requests;
+    bool fail = false;
+    std::string today = "2026-03-10";
+
+    TimelineRollup::Options options(size_t max_days = 400) {
+        TimelineRollup::Options options;
+        options.poll_interval = std::chrono::seconds(3600);
+        options.max_days = max_days;
+        options.load = [this](const std::string& from, const std::string& to)
+            -> std::optional<std::vector<RollupRow>> {
+            std::lock_guard lock(mutex);
+            requests.emplace_back(from, to);
+            if (fail) return std::nullopt;
+            std::vector<RollupRow> out;
+            for (const auto& row : rows) {
+                if (row.date >= from && row.date <= to) out.push_back(row);
+            }
+            return out;
+        };
+        options.today = [this]() -> std::optional<std::string> {
+            std::lock_guard lock(mutex);
+            return today;
+        };
+        return options;
+    }
+};
+
+/// (camera, day_index, slot) -> {event_count, total_detections} for non-empty slots
+std::map<std::tuple<size_t, size_t, int>, std::pair<uint32_t, uint32_t>>
+collect(TimelineRollup& rollup, const std::vector<std::string>& cameras, const char* from,
+        const char* to, bool* ok = nullptr) {
+    std::map<std::tuple<size_t, size_t, int>, std::pair<uint32_t, uint32_t>> out;
+    bool loaded = rollup.visit(cameras, day(from), day(to),
+                               [&](size_t c, size_t d, const TimelineRollup::Day& buckets) {
+        for (int slot = 0; slot < TimelineRollup::kSlotsPerDay; ++slot) {
+            if (buckets[slot].event_count == 0) continue;
+            out[{c, d, slot}] = {buckets[slot].event_count, buckets[slot].total_detections};
+        }
+    });
+    if (ok) *ok = loaded;
+    return out;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Timeline rollup loads missing dates in one query and keeps them", "[api][timeline]") {
+    FakeRollupSource source;
+    source.rows = {
+        {"patio", "2026-03-02", 4, 3, 7},
+        {"garage", "2026-03-03", 95, 1, 2},
+        {"side", "2026-03-03", 10, 9, 9},
+    };
+    TimelineRollup rollup(nullptr, source.options());
+
+    bool ok = false;
+    auto buckets = collect(rollup, {"patio", "garage"}, "2026-03-01", "2026-03-03", &ok);
+    CHECK(ok);
+    CHECK(buckets.size() == 2);
+    CHECK(buckets[{0, 1, 4}] == std::make_pair(3u, 7u));
+    CHECK(buckets[{1, 2, 95}] == std::make_pair(1u, 2u));
+    REQUIRE(source.requests.size() == 1);
+    CHECK(source.requests[0] == std::make_pair(std::string("2026-03-01"), std::string("2026-03-03")));
+
+    // Held dates need no query; the gaps around them are filled by one
+    CHECK(rollup.ensureLoaded(day("2026-03-02"), day("2026-03-03")));
+    CHECK(source.requests.size() == 1);
+    CHECK(rollup.ensureLoaded(day("2026-02-28"), day("2026-03-04")));
+    REQUIRE(source.requests.size() == 2);
+    CHECK(source.requests[1] == std::make_pair(std::string("2026-02-28"), std::string("2026-03-04")));
+    CHECK(rollup.stats().loads == 2);
+    CHECK(rollup.stats().days == 5);
+
+    // A failed load is reported, and nothing is cached for those dates
+    source.fail = true;
+    CHECK_FALSE(rollup.ensureLoaded(day("2026-03-05"), day("2026-03-06")));
+    collect(rollup, {"patio"}, "2026-03-05", "2026-03-05", &ok);
+    CHECK_FALSE(ok);
+    CHECK(rollup.stats().days == 5);
+}
+
+TEST_CASE("Timeline rollup refresh keeps yesterday and today open", "[api][timeline]") {
+    FakeRollupSource source;
+    source.rows = {
+        {"patio", "2026-03-05", 10, 4, 4},
+        {"patio", "2026-03-09", 0, 1, 1},
+        {"patio", "2026-03-10", 1, 2, 2},
+    };
+    TimelineRollup rollup(nullptr, source.options());
+    CHECK_FALSE(rollup.stats().live);
+
+    // The poller refreshes once before it first waits, so start/stop is one refresh
+    rollup.start();
+    rollup.stop();
+    CHECK(rollup.stats().live);
+    CHECK(rollup.stats().refreshes == 1);
+    REQUIRE(source.requests.size() == 1);
+    CHECK(source.requests[0] == std::make_pair(std::string("2026-03-09"), std::string("2026-03-10")));
+
+    // Dates after today are never queried
+    auto buckets = collect(rollup, {"patio"}, "2026-03-05", "2026-03-12");
+    REQUIRE(source.requests.size() == 2);
+    CHECK(source.requests[1] == std::make_pair(std::string("2026-03-05"), std::string("2026-03-08")));
+    CHECK(buckets.size() == 3);
+    CHECK(buckets[{0, 0, 10}] == std::make_pair(4u, 4u));
+    CHECK(buckets[{0, 4, 0}] == std::make_pair(1u, 1u));
+    CHECK(buckets[{0, 5, 1}] == std::make_pair(2u, 2u));
+
+    CHECK(rollup.isFinal(day("2026-03-05")));
+    CHECK(rollup.isFinal(day("2026-03-08")));
+    CHECK_FALSE(rollup.isFinal(day("2026-03-09")));
+    CHECK_FALSE(rollup.isFinal(day("2026-03-10")));
+    CHECK_FALSE(rollup.isFinal(day("2026-03-01")));   // never loaded
+
+    // Today keeps changing until the next refresh picks it up
+    source.rows.back() = {"patio", "2026-03-10", 1, 5, 6};
+    CHECK(collect(rollup, {"patio"}, "2026-03-10", "2026-03-10")[{0, 0, 1}] == std::make_pair(2u, 2u));
+    rollup.start();
+    rollup.stop();
+    CHECK(collect(rollup, {"patio"}, "2026-03-10", "2026-03-10")[{0, 0, 1}] == std::make_pair(5u, 6u));
+
+    // Once the date moves on, yesterday's predecessor is final
+    source.today = "2026-03-11";
+    rollup.start();
+    rollup.stop();
+    CHECK(rollup.isFinal(day("2026-03-09")));
+    CHECK_FALSE(rollup.isFinal(day("2026-03-10")));
+}
+
+TEST_CASE("Timeline rollup holds at most max_days dates", "[api][timeline]") {
+    FakeRollupSource source;
+    source.rows = {{"patio", "2026-01-03", 0, 1, 1}};
+    TimelineRollup rollup(nullptr, source.options(5));
+
+    CHECK(rollup.ensureLoaded(day("2026-03-01"), day("2026-03-03")));
+    CHECK(rollup.ensureLoaded(day("2026-03-10"), day("2026-03-12")));
+    CHECK(rollup.stats().days == 5);
+    CHECK(rollup.stats().evictions == 1);
+
+    // A range longer than max_days is still read in full; older days make room
+    auto buckets = collect(rollup, {"patio"}, "2026-01-01", "2026-01-10");
+    CHECK(buckets.size() == 1);
+    CHECK(buckets[{0, 2, 0}] == std::make_pair(1u, 1u));
+    CHECK(rollup.stats().days == 10);
+
+    // ...and is trimmed by the next load
+    CHECK(rollup.ensureLoaded(day("2026-02-01"), day("2026-02-01")));
+    CHECK(rollup.stats().days == 5);
+    CHECK(rollup.stats().evictions == 12);
+}
+
+TEST_CASE("Timeline rollup persists final days across restarts", "[api][timeline]") {
+    namespace fs = std::filesystem;
+    auto path = fs::temp_directory_path() / "timeline_rollup_test.json";
+    fs::remove(path);
+
+    FakeRollupSource source;
+    source.rows = {{"patio", "2026-03-05", 10, 4, 4}};
+    auto options = source.options();
+    options.persist_path = path.string();
+    {
+        TimelineRollup rollup(nullptr, options);
+        rollup.start();
+        rollup.stop();
+        CHECK(rollup.ensureLoaded(day("2026-03-05"), day("2026-03-05")));
+        rollup.start();   // the next round writes the newly loaded final day
+        rollup.stop();
+    }
+    REQUIRE(fs::exists(path));
+
+    // Served from the file: the database is down
+    source.fail = true;
+    {
+        TimelineRollup rollup(nullptr, options);
+        rollup.start();
+        rollup.stop();
+        bool ok = false;
+        auto buckets = collect(rollup, {"patio"}, "2026-03-05", "2026-03-05", &ok);
+        CHECK(ok);
+        CHECK(buckets[{0, 0, 10}] == std::make_pair(4u, 4u));
+    }
+    fs::remove(path);
+}
+
+TEST_CASE("Timeline range buckets fold rollup slots", "[api][timeline]") {
+    using hms::TimelineBuckets;
+
+    SECTION("hourly buckets over two days") {
+        TimelineBuckets buckets(2, 2, 60);
+        CHECK(buckets.bucketCount() == 48);
+        buckets.add(0, 0, 4, 1, 2);    // 01:00
+        buckets.add(0, 0, 7, 3, 4);    // 01:45, same hour
+        buckets.add(1, 1, 95, 5, 6);   // 23:45 on day two
+        CHECK(buckets.eventCount()[0][1] == 4);
+        CHECK(buckets.totalDetections()[0][1] == 6);
+        CHECK(buckets.eventCount()[1][47] == 5);
+        CHECK(buckets.totalDetections()[1][47] == 6);
+
+        // Off the grid: ignored rather than written out of bounds
+        buckets.add(2, 0, 0, 1, 1);
+        buckets.add(0, 2, 0, 1, 1);
+        buckets.add(0, 0, -1, 1, 1);
+        buckets.add(0, 0, 96, 1, 1);
+        uint64_t total = 0;
+        for (const auto& row : buckets.eventCount()) {
+            for (auto n : row) total += n;
+        }
+        CHECK(total == 9);
+    }
+
+    SECTION("15-minute buckets are the slots, daily buckets sum them") {
+        TimelineRollup::Day day{};
+        day[0] = {1, 1};
+        day[50] = {2, 3};
+        day[95] = {4, 5};
+
+        TimelineBuckets slots(1, 1, 15);
+        slots.add(0, 0, day);
+        CHECK(slots.bucketCount() == 96);
+        CHECK(slots.eventCount()[0][50] == 2);
+        CHECK(slots.totalDetections()[0][95] == 5);
+
+        TimelineBuckets daily(1, 3, 1440);
+        daily.add(0, 2, day);
+        CHECK(daily.bucketCount() == 3);
+        CHECK(daily.eventCount()[0] == std::vector<uint64_t>{0, 0, 7});
+        CHECK(daily.totalDetections()[0] == std::vector<uint64_t>{0, 0, 9});
+    }
+
+    SECTION("query rows land by camera order and date") {
+        std::vector<RollupRow> rows = {
+            {"garage", "2026-03-02", 8, 1, 1},
+            {"patio", "2026-03-01", 0, 2, 2},
+            {"side", "2026-03-01", 0, 9, 9},        // not requested
+            {"patio", "2026-02-28", 0, 9, 9},       // before start
+            {"patio", "2026-03-03", 0, 9, 9},       // after end
+            {"patio", "bad-date!!", 0, 9, 9},
+        };
+        TimelineBuckets buckets(2, 2, 60);
+        buckets.add(rows, {"patio", "garage"}, day("2026-03-01"));
+        CHECK(buckets.eventCount()[0][0] == 2);
+        CHECK(buckets.eventCount()[1][24 + 2] == 1);
+        uint64_t total = 0;
+        for (const auto& row : buckets.eventCount()) {
+            for (auto n : row) total += n;
+        }
+        CHECK(total == 3);
+    }
+}
+
 // ────────────────────────────────────────────────────────────────────
 // Search endpoint parameter parsing + response structure tests
 // ────────────────────────────────────────────────────────────────────
@@ -138,14 +507,16 @@ TEST_CASE("Search limit parameter validation (capped at 200)", "[api][search]")
 
 TEST_CASE("Search mode parameter validation", "[api][search]") {
     auto is_valid_mode = [](const std::string& mode) -> bool {
-        return mode == "auto" || mode == "fts" || mode == "semantic";
+        return mode == "auto" || mode == "fts" || mode == "semantic" || mode == "semantic_exact" ||
+               mode == "hybrid";
     };
 
     CHECK(is_valid_mode("auto"));
     CHECK(is_valid_mode("fts"));
     CHECK(is_valid_mode("semantic"));
+    CHECK(is_valid_mode("semantic_exact"));
+    CHECK(is_valid_mode("hybrid"));
     CHECK_FALSE(is_valid_mode(""));
-    CHECK_FALSE(is_valid_mode("hybrid"));
     CHECK_FALSE(is_valid_mode("keyword"));
 }
 
@@ -283,6 +654,39 @@ TEST_CASE("Search auto-mode fallback logic", "[api][search]") {
     CHECK_FALSE(should_try_semantic("semantic", 0)); // Semantic-only → no fallback
 }
 
+TEST_CASE("Hybrid search reciprocal-rank fusion", "[api][search]") {
+    json fts = json::array({
+        {{"type", "event"}, {"id", "a"}, {"rank", 0.9}},
+        {{"type", "event"}, {"id", "b"}, {"rank", 0.5}},
+        {{"type", "snapshot"}, {"id", "7"}, {"rank", 0.1}},
+    });
+    json semantic = json::array({
+        {{"type", "event"}, {"id", "b"}, {"similarity", 0.8}},
+        {{"type", "event"}, {"id", "c"}, {"similarity", 0.7}},
+        {{"type", "event"}, {"id", "7"}, {"similarity", 0.6}},   // same id, other type
+    });
+
+    auto fused = hms::reciprocalRankFusion({&fts, &semantic}, 60, 10);
+    REQUIRE(fused.size() == 5);
+    // "b" is in both lists: 1/62 + 1/61 beats "a" at 1/61
+    CHECK(fused[0]["id"] == "b");
+    CHECK(fused[0]["rank"] == 0.5);
+    CHECK(fused[0]["similarity"] == 0.8);
+    CHECK(fused[1]["id"] == "a");
+    CHECK(fused[0]["rrf_score"].get<double>() > fused[1]["rrf_score"].get<double>());
+
+    CHECK(fused[2]["id"] == "c");
+
+    // Equal scores keep first-seen order, so the FTS hit wins the tie
+    CHECK(fused[3]["type"] == "snapshot");
+    CHECK(fused[4]["type"] == "event");
+    CHECK(fused[4]["id"] == "7");
+
+    CHECK(hms::reciprocalRankFusion({&fts, &semantic}, 60, 2).size() == 2);
+    CHECK(hms::reciprocalRankFusion({&fts}, 60, 10).size() == 3);
+    CHECK(hms::reciprocalRankFusion({}, 60, 10).empty());
+}
+
 TEST_CASE("Filename validation for periodic snapshot filenames", "[media][search]") {
     // Periodic snapshots follow a specific naming convention
     CHECK(isValidFilename("patio_periodic_20260304_143000.jpg"));
@@ -297,3 +701,2404 @@ TEST_CASE("Filename validation for periodic snapshot filenames", "[media][search
     CHECK_FALSE(isValidFilename("../patio_periodic_20260304.jpg"));
     CHECK_FALSE(isValidFilename("patio_periodic/20260304.jpg"));
 }
+
+// ────────────────────────────────────────────────────────────────────
+// Recording index (replaces per-event stat() in GET /api/events)
+// ────────────────────────────────────────────────────────────────────
+
+namespace {
+
+// Poll a condition for up to 2s — inotify delivery is asynchronous
+template <typename Pred>
+bool eventually(Pred pred) {
+    for (int i = 0; i < 200; ++i) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+} // anonymous namespace
+
+TEST_CASE("Recording index tracks files in events_dir", "[media][index]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_recording_index_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::ofstream(dir / "patio_20260304_103000.mp4") << "x";
+
+    hms::RecordingIndex index(dir.string());
+    REQUIRE(index.start());
+    CHECK(index.isLive());
+    CHECK(index.contains("patio_20260304_103000.mp4"));
+    CHECK_FALSE(index.contains("patio_20260304_110000.mp4"));
+
+    std::ofstream(dir / "patio_20260304_110000.mp4") << "x";
+    CHECK(eventually([&] { return index.contains("patio_20260304_110000.mp4"); }));
+
+    fs::remove(dir / "patio_20260304_103000.mp4");
+    CHECK(eventually([&] { return !index.contains("patio_20260304_103000.mp4"); }));
+    CHECK(index.size() == 1);
+
+    index.stop();
+    CHECK_FALSE(index.isLive());
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Recording index reports each new file once across watch and rescans", "[media][index]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_recording_index_added_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::ofstream(dir / "patio_20260304_103000.mp4") << "x";
+
+    std::mutex mutex;
+    std::vector<std::string> added;
+    hms::RecordingIndex index(dir.string(), std::chrono::seconds(1));
+    index.setOnAdded([&](const std::string& name) {
+        std::lock_guard lock(mutex);
+        added.push_back(name);
+    });
+    REQUIRE(index.start());
+
+    std::ofstream(dir / "patio_20260304_110000.mp4") << "x";
+    REQUIRE(eventually([&] { return index.contains("patio_20260304_110000.mp4"); }));
+    // Let the periodic rescan run over a set that already has the file
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    index.stop();
+
+    // The file present at startup is not new; the one inotify saw is not
+    // reported again by the rescan
+    std::lock_guard lock(mutex);
+    CHECK(added == std::vector<std::string>{"patio_20260304_110000.mp4"});
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Static assets are served from memory with negotiated encoding", "[media][static]") {
+    namespace fs = std::filesystem;
+    CHECK(hms::StaticAssets::isHashedName("main-5INURTSO.js"));
+    CHECK(hms::StaticAssets::isHashedName("chunk-ABCD1234.js"));
+    CHECK(hms::StaticAssets::isHashedName("main.0123456789abcdef.js"));
+    CHECK_FALSE(hms::StaticAssets::isHashedName("favicon.ico"));
+    CHECK_FALSE(hms::StaticAssets::isHashedName("index.html"));
+    CHECK_FALSE(hms::StaticAssets::isHashedName("side-window.png"));
+
+    CHECK(hms::StaticAssets::patchBaseHref(R"(<base href="/">)", "/api/hassio_ingress/abc") ==
+          R"(<base href="/api/hassio_ingress/abc/">)");
+    CHECK(hms::StaticAssets::patchBaseHref(R"(<base href="/">)", "") == R"(<base href="/">)");
+
+    auto dir = fs::temp_directory_path() / "timeline_static_assets_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "media");
+    std::ofstream(dir / "index.html") << R"(<html><head><base href="/"></head></html>)";
+    std::string js;
+    for (int i = 0; i < 200; ++i) js += "console.log('timeline " + std::to_string(i % 7) + "');\n";
+    std::ofstream(dir / "main-5INURTSO.js") << js;
+    std::ofstream(dir / "media" / "logo.svg") << "<svg/>";
+
+    hms::StaticAssets assets(dir.string(), hms::StaticAssets::Options{});
+    REQUIRE(assets.load());
+    CHECK(assets.stats().files == 3);
+
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->addHeader("Accept-Encoding", "gzip, br");
+    auto resp = assets.serve(req, "main-5INURTSO.js");
+    REQUIRE(resp);
+    CHECK(resp->getHeader("Content-Encoding") == "br");
+    CHECK(resp->getBody().size() < js.size());
+    CHECK(resp->getHeader("Cache-Control") == "public, max-age=31536000, immutable");
+
+    auto plain = assets.serve(drogon::HttpRequest::newHttpRequest(), "main-5INURTSO.js");
+    REQUIRE(plain);
+    CHECK(plain->getHeader("Content-Encoding").empty());
+    CHECK(plain->getBody() == js);
+    CHECK(plain->getHeader("ETag") != resp->getHeader("ETag"));
+
+    auto revalidate = drogon::HttpRequest::newHttpRequest();
+    revalidate->addHeader("If-None-Match", plain->getHeader("ETag"));
+    CHECK(assets.serve(revalidate, "main-5INURTSO.js")->statusCode() == drogon::k304NotModified);
+
+    CHECK(assets.serve(req, "media/logo.svg"));
+    CHECK(assets.serve(req, "../etc/passwd") == nullptr);
+    CHECK(assets.serve(req, "missing.js") == nullptr);
+
+    auto index = assets.serveIndex(drogon::HttpRequest::newHttpRequest(), "/ingress/xyz");
+    REQUIRE(index);
+    CHECK(std::string(index->getBody()).find(R"(<base href="/ingress/xyz/">)") != std::string::npos);
+    CHECK(index->getHeader("Cache-Control") == "no-cache");
+    assets.serveIndex(drogon::HttpRequest::newHttpRequest(), "/ingress/xyz");
+    CHECK(assets.stats().index_variants == 1);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Static assets keep compressing index.html only for cached ingress paths", "[media][static]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_static_index_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::string html = R"(<html><head><base href="/"></head><body>)";
+    for (int i = 0; i < 100; ++i) html += "<p>timeline</p>";
+    html += "</body></html>";
+    std::ofstream(dir / "index.html") << html;
+
+    hms::StaticAssets::Options options;
+    options.max_index_variants = 1;
+    hms::StaticAssets assets(dir.string(), options);
+    REQUIRE(assets.load());
+
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->addHeader("Accept-Encoding", "gzip, br");
+
+    auto cached = assets.serveIndex(req, "/ingress/a");
+    REQUIRE(cached);
+    CHECK(cached->getHeader("Content-Encoding") == "br");
+    CHECK(assets.stats().index_variants == 1);
+    CHECK(assets.stats().index_uncached == 0);
+
+    // Past the cap: patched per request, sent as is
+    for (int i = 0; i < 3; ++i) {
+        auto path = "/ingress/other" + std::to_string(i);
+        auto resp = assets.serveIndex(req, path);
+        REQUIRE(resp);
+        CHECK(resp->getHeader("Content-Encoding").empty());
+        CHECK(std::string(resp->getBody()).find(R"(<base href=")" + path + R"(/">)") !=
+              std::string::npos);
+    }
+    CHECK(assets.stats().index_variants == 1);
+    CHECK(assets.stats().index_uncached == 3);
+
+    // The cached path keeps its compressed variant
+    CHECK(assets.serveIndex(req, "/ingress/a")->getHeader("Content-Encoding") == "br");
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Range header parsing", "[media][range]") {
+    using hms::RangeResult;
+    uint64_t offset = 0, length = 0;
+
+    CHECK(hms::parseRange("bytes=0-99", 1000, offset, length) == RangeResult::Partial);
+    CHECK((offset == 0 && length == 100));
+    CHECK(hms::parseRange("bytes=500-", 1000, offset, length) == RangeResult::Partial);
+    CHECK((offset == 500 && length == 500));
+    CHECK(hms::parseRange("bytes=-200", 1000, offset, length) == RangeResult::Partial);
+    CHECK((offset == 800 && length == 200));
+    CHECK(hms::parseRange("bytes=900-5000", 1000, offset, length) == RangeResult::Partial);
+    CHECK((offset == 900 && length == 100));
+    CHECK(hms::parseRange("bytes=-5000", 1000, offset, length) == RangeResult::Partial);
+    CHECK((offset == 0 && length == 1000));
+
+    CHECK(hms::parseRange("bytes=1000-", 1000, offset, length) == RangeResult::Unsatisfiable);
+    CHECK(hms::parseRange("bytes=-0", 1000, offset, length) == RangeResult::Unsatisfiable);
+
+    // Ignored: whole body instead
+    CHECK(hms::parseRange("bytes=0-1,5-9", 1000, offset, length) == RangeResult::Full);
+    CHECK(hms::parseRange("items=0-1", 1000, offset, length) == RangeResult::Full);
+    CHECK(hms::parseRange("bytes=9-1", 1000, offset, length) == RangeResult::Full);
+    CHECK(hms::parseRange("bytes=a-b", 1000, offset, length) == RangeResult::Full);
+}
+
+TEST_CASE("Media fd cache reuses descriptors and notices replaced files", "[media][index]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_media_fd_cache_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    auto path = (dir / "patio_20260304_103000.mp4").string();
+    std::ofstream(path) << "first";
+
+    hms::MediaFileCache cache(hms::MediaFileCache::Options{
+        .max_open = 2, .revalidate = std::chrono::seconds(0)});
+    auto a = cache.acquire(path);
+    REQUIRE(a);
+    CHECK(a->st.st_size == 5);
+    auto b = cache.acquire(path);
+    REQUIRE(b);
+    CHECK(b->file == a->file);
+    CHECK(cache.stats().opens == 1);
+
+    // The cached fd reads the file through /proc without a path lookup
+    std::ifstream via_proc(a->file->procPath());
+    std::string content;
+    via_proc >> content;
+    CHECK(content == "first");
+
+    // Replaced under the same name (new inode): reopened
+    std::ofstream(path + ".tmp") << "second!";
+    fs::rename(path + ".tmp", path);
+    auto c = cache.acquire(path);
+    REQUIRE(c);
+    CHECK(c->file != a->file);
+    CHECK(c->st.st_size == 7);
+    CHECK(cache.stats().reopened == 1);
+
+    CHECK_FALSE(cache.acquire((dir / "missing.mp4").string()));
+    CHECK_FALSE(cache.acquire(dir.string()));
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Media scrub replay benchmark", "[.][benchmark]") {
+    // Replays a recorded scrub: the player's initial probe of the moov box, then
+    // drags back and forth through a 60 MB recording with 1 MB range reads.
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_scrub_bench";
+    fs::create_directories(dir);
+    auto path = (dir / "scrub_20260304_103000.mp4").string();
+    constexpr size_t kFileBytes = 60u << 20;
+    constexpr size_t kChunk = 1u << 20;
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::string block(kChunk, 'x');
+        for (size_t i = 0; i < kFileBytes / kChunk; ++i) out << block;
+    }
+    const std::vector<double> pattern = {0.0, 0.98, 0.1, 0.25, 0.4, 0.33, 0.5, 0.62, 0.58,
+                                         0.75, 0.9, 0.7, 0.45, 0.2, 0.05, 0.8, 0.85, 0.87};
+    std::vector<char> buf(kChunk);
+    auto offsetAt = [&](double frac) {
+        return static_cast<off_t>(frac * static_cast<double>(kFileBytes - kChunk));
+    };
+
+    BENCHMARK("stat + open per seek") {
+        size_t total = 0;
+        for (double frac : pattern) {
+            if (!fs::exists(path)) continue;
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            total += static_cast<size_t>(::pread(fd, buf.data(), kChunk, offsetAt(frac)));
+            ::close(fd);
+        }
+        return total;
+    };
+
+    // What serveFile does with the cache: Drogon still opens (and stats) the
+    // response's /proc/self/fd path once per response
+    hms::MediaFileCache cache(hms::MediaFileCache::Options{});
+    BENCHMARK("fd cache + open(procPath) per seek") {
+        size_t total = 0;
+        for (double frac : pattern) {
+            auto handle = cache.acquire(path);
+            int fd = ::open(handle->file->procPath().c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st {};
+            ::fstat(fd, &st);
+            total += static_cast<size_t>(::pread(fd, buf.data(), kChunk, offsetAt(frac)));
+            ::close(fd);
+        }
+        return total;
+    };
+
+    fs::remove_all(dir);
+}
+
+namespace {
+
+/// Gradient test frame encoded with libjpeg (quality 90)
+std::string makeTestJpeg(int width, int height) {
+    std::vector<unsigned char> rgb(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            auto* p = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+            p[0] = static_cast<unsigned char>(x * 255 / width);
+            p[1] = static_cast<unsigned char>(y * 255 / height);
+            p[2] = 128;
+        }
+    }
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_compress(&cinfo);
+    unsigned char* out = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&cinfo, &out, &size);
+    cinfo.image_width = static_cast<JDIMENSION>(width);
+    cinfo.image_height = static_cast<JDIMENSION>(height);
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = &rgb[static_cast<size_t>(cinfo.next_scanline) * width * 3];
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    std::string jpeg(reinterpret_cast<const char*>(out), size);
+    free(out);
+    return jpeg;
+}
+
+std::pair<int, int> jpegSize(const std::string& jpeg) {
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, reinterpret_cast<const unsigned char*>(jpeg.data()), jpeg.size());
+    jpeg_read_header(&cinfo, TRUE);
+    std::pair<int, int> size{static_cast<int>(cinfo.image_width), static_cast<int>(cinfo.image_height)};
+    jpeg_destroy_decompress(&cinfo);
+    return size;
+}
+
+} // anonymous namespace
+
+TEST_CASE("JPEG thumbnails are scaled to the requested width", "[media][thumbnail]") {
+    CHECK(hms::ThumbnailCache::bucketWidth(0) == 0);
+    CHECK(hms::ThumbnailCache::bucketWidth(1) == 160);
+    CHECK(hms::ThumbnailCache::bucketWidth(200) == 320);
+    CHECK(hms::ThumbnailCache::bucketWidth(320) == 320);
+    CHECK(hms::ThumbnailCache::bucketWidth(5000) == 640);
+
+    auto frame = makeTestJpeg(1920, 1080);
+    auto thumb = hms::ThumbnailCache::scaleJpeg(frame, 320, 80);
+    REQUIRE(thumb);
+    CHECK(jpegSize(*thumb) == std::pair{320, 180});
+    CHECK(thumb->size() < frame.size() / 4);
+
+    // Never upscaled
+    auto small = hms::ThumbnailCache::scaleJpeg(makeTestJpeg(100, 60), 320, 80);
+    REQUIRE(small);
+    CHECK(jpegSize(*small) == std::pair{100, 60});
+
+    CHECK_FALSE(hms::ThumbnailCache::scaleJpeg("not a jpeg", 320, 80));
+    CHECK_FALSE(hms::ThumbnailCache::scaleJpeg(frame.substr(0, 64), 320, 80));
+}
+
+TEST_CASE("Thumbnail cache coalesces, persists to disk and follows rewrites", "[media][thumbnail]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_thumbnail_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "snapshots");
+    auto source = (dir / "snapshots" / "patio_20260304_103000.jpg").string();
+    std::ofstream(source, std::ios::binary) << makeTestJpeg(1280, 720);
+
+    hms::ThumbnailCache::Options options;
+    options.disk_dir = (dir / "thumbs").string();
+
+    auto fetch = [](hms::ThumbnailCache& cache, const std::string& path, int width) {
+        std::promise<hms::ThumbnailCache::ThumbnailPtr> done;
+        auto future = done.get_future();
+        cache.get(path, width, [&done](const hms::ThumbnailCache::ThumbnailPtr& t) { done.set_value(t); });
+        return future.get();
+    };
+
+    std::string etag;
+    {
+        hms::ThumbnailCache cache(options);
+        std::vector<std::shared_future<hms::ThumbnailCache::ThumbnailPtr>> futures;
+        std::vector<std::promise<hms::ThumbnailCache::ThumbnailPtr>> promises(8);
+        for (auto& promise : promises) {
+            futures.push_back(promise.get_future().share());
+            cache.get(source, 320, [&promise](const hms::ThumbnailCache::ThumbnailPtr& t) {
+                promise.set_value(t);
+            });
+        }
+        auto first = futures[0].get();
+        REQUIRE(first);
+        for (const auto& future : futures) CHECK(future.get() == first);
+        CHECK(cache.stats().generated == 1);
+        CHECK(cache.stats().coalesced + cache.stats().memory_hits == 7);
+        CHECK(jpegSize(first->body).first == 320);
+        etag = first->etag;
+
+        CHECK(fetch(cache, source, 320) == first);
+        CHECK_FALSE(fetch(cache, (dir / "snapshots" / "missing.jpg").string(), 320));
+    }
+
+    // A fresh instance finds the thumbnail on disk
+    {
+        hms::ThumbnailCache cache(options);
+        auto thumb = fetch(cache, source, 320);
+        REQUIRE(thumb);
+        CHECK(thumb->etag == etag);
+        CHECK(cache.stats().disk_hits == 1);
+        CHECK(cache.stats().generated == 0);
+
+        // A rewritten snapshot is thumbnailed again
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::ofstream(source, std::ios::binary | std::ios::trunc) << makeTestJpeg(640, 480);
+        auto rewritten = fetch(cache, source, 320);
+        REQUIRE(rewritten);
+        CHECK(rewritten->etag != etag);
+        CHECK(jpegSize(rewritten->body) == std::pair{320, 240});
+    }
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Sprite sheets tile a day of snapshots and rebuild only changed hours", "[media][sprites]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_sprite_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    nlohmann::json rows = nlohmann::json::array();
+    auto addSnapshot = [&](int id, const std::string& time, bool write = true) {
+        auto file = "patio_periodic_20260304_" + time.substr(0, 2) + time.substr(3, 2) + "00.jpg";
+        if (write) std::ofstream(dir / file, std::ios::binary) << makeTestJpeg(640, 480);
+        rows.push_back({{"snapshot_id", id},
+                        {"captured_at", "2026-03-04T" + time + ":00"},
+                        {"snapshot_url", "http://192.168.2.5:8000/snapshots/" + file}});
+    };
+    addSnapshot(1, "09:00");
+    addSnapshot(2, "09:15");
+    addSnapshot(3, "10:00");
+    addSnapshot(4, "10:15", false);   // row without a file: skipped
+
+    hms::SpriteSheets sheets(hms::SpriteSheets::Options{.snapshots_dir = dir.string(), .columns = 2});
+    auto fetch = [&] {
+        std::promise<hms::SpriteSheets::SheetPtr> done;
+        auto future = done.get_future();
+        sheets.get("patio", "2026-03-04", rows,
+                   [&done](const hms::SpriteSheets::SheetPtr& sheet) { done.set_value(sheet); });
+        return future.get();
+    };
+
+    auto sheet = fetch();
+    REQUIRE(sheet);
+    CHECK(sheet->columns == 2);
+    CHECK(sheet->rows == 2);
+    REQUIRE(sheet->tiles.size() == 3);
+    CHECK(sheet->tiles[0]["snapshot_id"] == 1);
+    CHECK(sheet->tiles[1]["x"] == 160);
+    CHECK(sheet->tiles[2]["y"] == 90);
+    CHECK(jpegSize(sheet->jpeg) == std::pair{320, 180});
+    CHECK(sheets.stats().hours_built == 2);
+
+    // Same snapshots: served as is
+    CHECK(fetch() == sheet);
+    CHECK(sheets.stats().sheet_hits == 1);
+    CHECK(sheets.find("patio", "2026-03-04") == sheet);
+
+    // A new snapshot re-decodes only its hour
+    addSnapshot(5, "11:00");
+    auto updated = fetch();
+    REQUIRE(updated);
+    CHECK(updated->version != sheet->version);
+    CHECK(updated->tiles.size() == 4);
+    CHECK(sheets.stats().hours_built == 3);
+    CHECK(sheets.stats().tiles_decoded == 4);
+
+    CHECK(hms::SpriteSheets::snapshotFile({{"snapshot_url", "None"}}).empty());
+    CHECK(hms::SpriteSheets::snapshotFile({{"snapshot_url", "a.jpg"}, {"thumbnail_url", "/x/a_thumb.jpg"}}) ==
+          "a_thumb.jpg");
+    fs::remove_all(dir);
+}
+
+TEST_CASE("Sprite sheets draw at most one snapshot per slot of the day", "[media][sprites]") {
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "timeline_sprite_slots_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    nlohmann::json rows = nlohmann::json::array();
+    auto addSnapshot = [&](int id, const std::string& captured_at) {
+        auto file = "patio_" + std::to_string(id) + ".jpg";
+        std::ofstream(dir / file, std::ios::binary) << makeTestJpeg(320, 180);
+        rows.push_back({{"snapshot_id", id}, {"captured_at", captured_at}, {"snapshot_url", file}});
+    };
+    // Four slots of six hours
+    hms::SpriteSheets sheets(hms::SpriteSheets::Options{
+        .snapshots_dir = dir.string(), .columns = 2, .max_tiles = 4});
+    auto ids = [&] {
+        std::promise<hms::SpriteSheets::SheetPtr> done;
+        auto future = done.get_future();
+        sheets.get("patio", "2026-03-04", rows,
+                   [&done](const hms::SpriteSheets::SheetPtr& sheet) { done.set_value(sheet); });
+        auto sheet = future.get();
+        std::vector<int64_t> out;
+        if (sheet) {
+            for (const auto& tile : sheet->tiles) out.push_back(tile["snapshot_id"].get<int64_t>());
+        }
+        return out;
+    };
+
+    addSnapshot(1, "2026-03-04T00:00:00");
+    addSnapshot(2, "2026-03-04T03:00:00");
+    addSnapshot(3, "2026-03-04T07:00:00");
+    addSnapshot(4, "2026-03-04T12:30:00");
+    addSnapshot(5, "2026-03-04T13:00:00");
+    addSnapshot(6, "2026-03-04");             // no time of day: never drawn
+    CHECK(ids() == std::vector<int64_t>{1, 3, 4});
+
+    // An earlier snapshot takes over its slot; the others stay as they were
+    addSnapshot(7, "2026-03-04T06:30:00");
+    addSnapshot(8, "2026-03-04T23:59:59");
+    CHECK(ids() == std::vector<int64_t>{1, 7, 4, 8});
+
+    // A sheet taller than JPEG allows is never attempted
+    hms::SpriteSheets tall(hms::SpriteSheets::Options{.tile_height = 90, .columns = 12,
+                                                      .max_tiles = 100000});
+    CHECK(tall.options().max_tiles == 12 * (65535 / 90));
+    fs::remove_all(dir);
+}
+
+// ────────────────────────────────────────────────────────────────────
+// MP4 keyframe index and virtual fast-start layout
+// ────────────────────────────────────────────────────────────────────
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string be32Bytes(uint32_t v) {
+    return {static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+            static_cast<char>(v >> 8), static_cast<char>(v)};
+}
+
+std::string mp4Box(const char* type, const std::string& payload) {
+    return be32Bytes(static_cast<uint32_t>(8 + payload.size())) + type + payload;
+}
+
+std::string mp4FullBox(const char* type, const std::string& body) {
+    return mp4Box(type, std::string(4, '\0') + body);
+}
+
+/// Ten 100-byte video samples (byte value = sample number), two per chunk,
+/// 0.1 s each, keyframes at samples 1, 4, 7 and 10, plus an audio track
+/// sharing the first chunk. moov goes last unless moov_first.
+std::string makeTestMp4(bool moov_first) {
+    constexpr uint32_t kSamples = 10, kSampleSize = 100;
+    std::string ftyp = mp4Box("ftyp", std::string("isom") + be32Bytes(0) + "isom");
+    std::string media;
+    for (uint32_t i = 1; i <= kSamples; ++i) media += std::string(kSampleSize, static_cast<char>(i));
+    std::string mdat = mp4Box("mdat", media);
+
+    auto moovFor = [&](uint32_t media_offset) {
+        std::string stco = be32Bytes(kSamples / 2);
+        for (uint32_t c = 0; c < kSamples / 2; ++c) stco += be32Bytes(media_offset + c * 2 * kSampleSize);
+        std::string stsz = be32Bytes(0) + be32Bytes(kSamples);
+        for (uint32_t i = 0; i < kSamples; ++i) stsz += be32Bytes(kSampleSize);
+        std::string stss = be32Bytes(4) + be32Bytes(1) + be32Bytes(4) + be32Bytes(7) + be32Bytes(10);
+        auto trak = [](const char* handler, const std::string& stbl) {
+            std::string mdhd = mp4FullBox("mdhd", be32Bytes(0) + be32Bytes(0) + be32Bytes(1000) +
+                                                      be32Bytes(1000) + be32Bytes(0));
+            std::string hdlr = mp4FullBox("hdlr", be32Bytes(0) + handler + std::string(13, '\0'));
+            return mp4Box("trak", mp4Box("mdia", mdhd + hdlr + mp4Box("minf", mp4Box("stbl", stbl))));
+        };
+        std::string video = mp4FullBox("stts", be32Bytes(1) + be32Bytes(kSamples) + be32Bytes(100)) +
+                            mp4FullBox("stss", stss) +
+                            mp4FullBox("stsc", be32Bytes(1) + be32Bytes(1) + be32Bytes(2) + be32Bytes(1)) +
+                            mp4FullBox("stsz", stsz) + mp4FullBox("stco", stco);
+        std::string audio = mp4FullBox("stts", be32Bytes(1) + be32Bytes(1) + be32Bytes(1024)) +
+                            mp4FullBox("stsc", be32Bytes(1) + be32Bytes(1) + be32Bytes(1) + be32Bytes(1)) +
+                            mp4FullBox("stsz", be32Bytes(16) + be32Bytes(1)) +
+                            mp4FullBox("stco", be32Bytes(1) + be32Bytes(media_offset));
+        return mp4Box("moov", trak("soun", audio) + trak("vide", video));
+    };
+
+    if (!moov_first) {
+        return ftyp + mdat + moovFor(static_cast<uint32_t>(ftyp.size() + 8));
+    }
+    auto moov_size = static_cast<uint32_t>(moovFor(0).size());
+    return ftyp + moovFor(static_cast<uint32_t>(ftyp.size() + moov_size + 8)) + mdat;
+}
+
+} // anonymous namespace
+
+TEST_CASE("MP4 index finds keyframes and builds a fast-start head", "[media][mp4]") {
+    auto dir = fs::temp_directory_path() / ("hms_mp4_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    const auto path = (dir / "cam_20260304_101500.mp4").string();
+    const auto original = makeTestMp4(false);
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << original;
+
+    hms::Mp4Index index;
+    REQUIRE(hms::Mp4Index::parseFile(path, index) == hms::Mp4Index::Status::Ok);
+    CHECK(index.timescale == 1000);
+    CHECK(index.duration_s == 1.0);
+    CHECK_FALSE(index.moov_first);
+    REQUIRE(index.keyframes.size() == 4);
+    const double times[] = {0.0, 0.3, 0.6, 0.9};
+    const char markers[] = {1, 4, 7, 10};
+    for (size_t i = 0; i < 4; ++i) {
+        CHECK_THAT(index.keyframes[i].time_s, Catch::Matchers::WithinAbs(times[i], 1e-9));
+        CHECK(original[index.keyframes[i].offset] == markers[i]);
+    }
+
+    // The virtual layout is the same size and is itself a valid moov-first MP4
+    REQUIRE(index.hasVirtualLayout());
+    auto served = index.head + original.substr(index.data_offset, index.moov_offset - index.data_offset);
+    CHECK(served.size() == original.size());
+    CHECK(served.compare(4, 4, "ftyp") == 0);
+    const auto served_path = (dir / "served.mp4").string();
+    std::ofstream(served_path, std::ios::binary | std::ios::trunc) << served;
+    hms::Mp4Index reparsed;
+    REQUIRE(hms::Mp4Index::parseFile(served_path, reparsed) == hms::Mp4Index::Status::Ok);
+    CHECK(reparsed.moov_first);
+    CHECK_FALSE(reparsed.hasVirtualLayout());
+    REQUIRE(reparsed.keyframes.size() == 4);
+    for (size_t i = 0; i < 4; ++i) {
+        CHECK(reparsed.keyframes[i].offset == index.servedOffset(index.keyframes[i].offset));
+        CHECK(served[reparsed.keyframes[i].offset] == markers[i]);
+    }
+
+    SECTION("moov already first needs no head") {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << makeTestMp4(true);
+        REQUIRE(hms::Mp4Index::parseFile(path, index) == hms::Mp4Index::Status::Ok);
+        CHECK(index.moov_first);
+        CHECK_FALSE(index.hasVirtualLayout());
+        CHECK(index.keyframes.size() == 4);
+    }
+
+    SECTION("a recording still being written is incomplete, garbage is invalid") {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << original.substr(0, original.size() - 40);
+        CHECK(hms::Mp4Index::parseFile(path, index) == hms::Mp4Index::Status::Incomplete);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << std::string(64, '\x01');
+        CHECK(hms::Mp4Index::parseFile(path, index) == hms::Mp4Index::Status::Invalid);
+    }
+    fs::remove_all(dir);
+}
+
+TEST_CASE("MP4 index cache reuses parses and follows rewrites", "[media][mp4]") {
+    auto dir = fs::temp_directory_path() / ("hms_mp4_cache_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    const std::string name = "cam_20260304_101500.mp4";
+    std::ofstream(dir / name, std::ios::binary | std::ios::trunc) << makeTestMp4(false);
+
+    hms::Mp4IndexCache cache(hms::Mp4IndexCache::Options{.events_dir = dir.string()});
+    cache.start();
+    cache.enqueue(name);
+    cache.enqueue("notes.txt");   // not a recording: ignored
+    for (int i = 0; i < 200 && cache.stats().pending > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(cache.stats().parsed == 1);
+
+    auto index = cache.load(name);
+    REQUIRE(index);
+    CHECK(index->hasVirtualLayout());
+    CHECK(cache.stats().hits == 1);
+    CHECK(cache.load("../etc/passwd") == nullptr);
+    CHECK(cache.load("missing.mp4") == nullptr);
+
+    // Rewritten as fast-start (and a different size): parsed again
+    std::ofstream(dir / name, std::ios::binary | std::ios::trunc) << makeTestMp4(true) + mp4Box("free", "pad");
+    index = cache.load(name);
+    REQUIRE(index);
+    CHECK(index->moov_first);
+    CHECK(cache.stats().parsed == 2);
+    cache.stop();
+    fs::remove_all(dir);
+}
+
+TEST_CASE("MP4 index cache lookups for requests queue instead of parsing", "[media][mp4]") {
+    auto dir = fs::temp_directory_path() / ("hms_mp4_find_" + std::to_string(::getpid()));
+    fs::create_directories(dir);
+    const std::string name = "cam_20260304_101500.mp4";
+    const auto path = (dir / name).string();
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << makeTestMp4(false);
+    struct stat st {};
+    REQUIRE(::stat(path.c_str(), &st) == 0);
+
+    hms::Mp4IndexCache cache(hms::Mp4IndexCache::Options{.events_dir = dir.string()});
+    CHECK_FALSE(cache.find(name, st).has_value());
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().parsed == 0);
+    CHECK(cache.stats().pending == 1);
+
+    cache.start();
+    for (int i = 0; i < 200 && cache.stats().pending > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto hit = cache.find(name, st);
+    REQUIRE(hit.has_value());
+    REQUIRE(*hit);
+    CHECK((*hit)->hasVirtualLayout());
+    CHECK(cache.stats().hits == 1);
+
+    // Grown since: a miss again until the parser catches up
+    std::ofstream(path, std::ios::binary | std::ios::app) << mp4Box("free", "pad");
+    REQUIRE(::stat(path.c_str(), &st) == 0);
+    CHECK_FALSE(cache.find(name, st).has_value());
+    CHECK(cache.stats().misses == 2);
+    cache.stop();
+    fs::remove_all(dir);
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Conditional requests (snapshot cache and other cached responses)
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("ETag is stable per body and changes with content", "[api][cache]") {
+    auto a = hms::makeEtag("jpeg-bytes-1");
+    CHECK(a == hms::makeEtag("jpeg-bytes-1"));
+    CHECK(a != hms::makeEtag("jpeg-bytes-2"));
+    CHECK(a.front() == '"');
+    CHECK(a.back() == '"');
+}
+
+TEST_CASE("If-None-Match / If-Modified-Since evaluation", "[api][cache]") {
+    const std::string etag = hms::makeEtag("frame");
+    const std::string last_modified = "Wed, 04 Mar 2026 10:30:00 GMT";
+
+    SECTION("Matching ETag") {
+        auto req = drogon::HttpRequest::newHttpRequest();
+        req->addHeader("If-None-Match", etag);
+        CHECK(hms::isNotModified(req, etag, last_modified));
+    }
+
+    SECTION("ETag in a list, weak form") {
+        auto req = drogon::HttpRequest::newHttpRequest();
+        req->addHeader("If-None-Match", "\"other\", W/" + etag);
+        CHECK(hms::isNotModified(req, etag, last_modified));
+    }
+
+    SECTION("Stale ETag wins over a matching date") {
+        auto req = drogon::HttpRequest::newHttpRequest();
+        req->addHeader("If-None-Match", "\"stale\"");
+        req->addHeader("If-Modified-Since", last_modified);
+        CHECK_FALSE(hms::isNotModified(req, etag, last_modified));
+    }
+
+    SECTION("Date only") {
+        auto req = drogon::HttpRequest::newHttpRequest();
+        req->addHeader("If-Modified-Since", last_modified);
+        CHECK(hms::isNotModified(req, etag, last_modified));
+    }
+
+    SECTION("Unconditional request") {
+        auto req = drogon::HttpRequest::newHttpRequest();
+        CHECK_FALSE(hms::isNotModified(req, etag, last_modified));
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Streaming JSON serialization
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("JSON writer output matches nlohmann dump", "[api][json]") {
+    nlohmann::json doc = {
+        {"text", "quote \" backslash \\ newline \n tab \t bell \x07 del \x7f caf\xc3\xa9"},
+        {"ints", {0, -1, 42, std::numeric_limits<int64_t>::min()}},
+        {"big", std::numeric_limits<uint64_t>::max()},
+        {"floats", {0.1, 1.0, -3.0, 2.5, 123.456}},
+        {"nan", std::nan("")},
+        {"flags", {true, false}},
+        {"none", nullptr},
+        {"empty_object", nlohmann::json::object()},
+        {"empty_array", nlohmann::json::array()},
+        {"nested", {{"a", {{"b", {1, {{"c", "d"}}}}}}}},
+    };
+    std::string out;
+    hms::JsonWriter(out).value(doc);
+    CHECK(out == doc.dump());
+
+    SECTION("streamed by hand") {
+        std::string streamed;
+        hms::JsonWriter writer(streamed);
+        writer.beginObject()
+            .key("events").beginArray().raw(R"({"id":"a"})").raw(R"({"id":"b"})").endArray()
+            .key("count").value(2)
+            .key("next_cursor").value(static_cast<const char*>(nullptr))
+            .key("tags").beginArray().value("x").value(std::string("y")).endArray()
+            .endObject();
+        CHECK(streamed == R"({"events":[{"id":"a"},{"id":"b"}],"count":2,"next_cursor":null,"tags":["x","y"]})");
+        CHECK(nlohmann::json::parse(streamed)["count"] == 2);
+    }
+
+    SECTION("large integral doubles parse back to the same value") {
+        // dump() switches to an exponent past 15 digits; the writer does not
+        const double big = 1234567890123456.0;
+        std::string text;
+        hms::JsonWriter(text).value(big);
+        CHECK(nlohmann::json::parse(text).get<double>() == big);
+    }
+}
+
+TEST_CASE("Pooled buffers are reused per thread", "[api][json]") {
+    const char* data = nullptr;
+    {
+        hms::PooledBuffer buffer;
+        buffer.str().assign(1000, 'x');
+        data = buffer.str().data();
+    }
+    {
+        hms::PooledBuffer buffer;
+        CHECK(buffer.str().empty());
+        CHECK(buffer.str().capacity() >= 1000);
+        CHECK(buffer.str().data() == data);
+        hms::PooledBuffer nested;    // a second concurrent borrower gets its own
+        CHECK(nested.str().data() != data);
+    }
+    {
+        // Oversized buffers are dropped rather than kept on the thread
+        hms::PooledBuffer buffer;
+        buffer.str().assign(hms::PooledBuffer::kMaxRetained + 1, 'x');
+    }
+    hms::PooledBuffer buffer;
+    CHECK(buffer.str().capacity() <= hms::PooledBuffer::kMaxRetained);
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Batch event details (GET /api/events/details, POST /api/events/batch)
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("Event id lists parse query and body in request order", "[api][events]") {
+    using hms::EventIdList;
+    using Ids = std::vector<std::string>;
+
+    auto query = EventIdList::fromQuery("evt-3,evt-1,,evt-3,evt-2,evt-1");
+    CHECK(query.error == EventIdList::Error::None);
+    CHECK(query.ids == Ids{"evt-3", "evt-1", "evt-2"});
+    CHECK(EventIdList::fromQuery("evt-1").ids == Ids{"evt-1"});
+    CHECK(EventIdList::fromQuery("").error == EventIdList::Error::Empty);
+    CHECK(EventIdList::fromQuery(",,").error == EventIdList::Error::Empty);
+
+    auto body = EventIdList::fromBody(R"({"ids": ["b", "a", "b", 7, null, "", "c"]})");
+    CHECK(body.error == EventIdList::Error::None);
+    CHECK(body.ids == Ids{"b", "a", "c"});
+    CHECK(EventIdList::fromBody(R"({"ids": []})").error == EventIdList::Error::Empty);
+    CHECK(EventIdList::fromBody(R"({"ids": [1, 2]})").error == EventIdList::Error::Empty);
+    for (const char* malformed : {"", "not json", R"(["a"])", R"({"id": ["a"]})", R"({"ids": "a"})"}) {
+        CAPTURE(malformed);
+        CHECK(EventIdList::fromBody(malformed).error == EventIdList::Error::Malformed);
+    }
+}
+
+TEST_CASE("Event id lists cap distinct ids, not repeats", "[api][events]") {
+    using hms::EventIdList;
+    auto join = [](size_t count, bool repeat) {
+        std::string out;
+        for (size_t i = 0; i < count; ++i) {
+            if (i) out += ',';
+            out += "evt-" + std::to_string(i);
+            if (repeat) out += ",evt-" + std::to_string(i);
+        }
+        return out;
+    };
+    CHECK(EventIdList::fromQuery(join(EventIdList::kMaxIds, false)).error == EventIdList::Error::None);
+    CHECK(EventIdList::fromQuery(join(EventIdList::kMaxIds, true)).ids.size() == EventIdList::kMaxIds);
+    CHECK(EventIdList::fromQuery(join(EventIdList::kMaxIds + 1, false)).error ==
+          EventIdList::Error::TooMany);
+
+    nlohmann::json body = {{"ids", json::array()}};
+    for (size_t i = 0; i <= EventIdList::kMaxIds; ++i) body["ids"].push_back("evt-" + std::to_string(i));
+    CHECK(EventIdList::fromBody(body.dump()).error == EventIdList::Error::TooMany);
+}
+
+TEST_CASE("Event details follow request order and list missing ids", "[api][events]") {
+    hms::timeline_queries::EventDetails details;
+    details.by_id["evt-1"] = {R"({"event_id":"evt-1"})", R"([{"class_name":"person"}])", 1};
+    details.by_id["evt-2"] = {R"({"event_id":"evt-2"})", "[]", 0};
+
+    std::string text;
+    hms::JsonWriter out(text);
+    hms::writeEventDetails(out, {"evt-2", "gone", "evt-1", "also-gone"}, details);
+
+    auto doc = json::parse(text);
+    REQUIRE(doc["events"].size() == 2);
+    CHECK(doc["events"][0]["event"]["event_id"] == "evt-2");
+    CHECK(doc["events"][0]["detections"].empty());
+    CHECK(doc["events"][1]["event"]["event_id"] == "evt-1");
+    CHECK(doc["events"][1]["detections"][0]["class_name"] == "person");
+    CHECK(doc["count"] == 2);
+    CHECK(doc["missing"] == json::array({"gone", "also-gone"}));
+
+    std::string none;
+    hms::JsonWriter empty(none);
+    hms::writeEventDetails(empty, {"gone"}, {});
+    CHECK(none == R"({"events":[],"count":0,"missing":["gone"]})");
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Binary and columnar response formats
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("Accept negotiation picks the response body format", "[api][format]") {
+    using hms::BodyFormat;
+    using hms::preferredBodyFormat;
+    CHECK(preferredBodyFormat("") == BodyFormat::Json);
+    CHECK(preferredBodyFormat("*/*") == BodyFormat::Json);
+    CHECK(preferredBodyFormat("application/json") == BodyFormat::Json);
+    CHECK(preferredBodyFormat("application/msgpack") == BodyFormat::MsgPack);
+    CHECK(preferredBodyFormat("application/x-msgpack") == BodyFormat::MsgPack);
+    CHECK(preferredBodyFormat("application/cbor") == BodyFormat::Cbor);
+    CHECK(preferredBodyFormat("application/msgpack, */*;q=0.1") == BodyFormat::MsgPack);
+    CHECK(preferredBodyFormat("application/json;q=0.5, application/cbor") == BodyFormat::Cbor);
+    CHECK(preferredBodyFormat("application/cbor;q=0.5, application/json") == BodyFormat::Json);
+    CHECK(preferredBodyFormat("application/msgpack, */*") == BodyFormat::MsgPack);
+    CHECK(preferredBodyFormat("application/msgpack;q=0, application/json") == BodyFormat::Json);
+    CHECK(preferredBodyFormat("text/html") == BodyFormat::Json);
+
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->addHeader("Accept", "application/cbor");
+    req->setParameter("layout", "columnar");
+    auto format = hms::ResponseFormat::negotiate(req);
+    CHECK(format.body == BodyFormat::Cbor);
+    CHECK(format.columnar);
+    CHECK_FALSE(format.isDefault());
+    CHECK(std::string(format.contentType()) == "application/cbor");
+}
+
+TEST_CASE("Columnar layout dictionary-encodes repeated strings", "[api][format]") {
+    nlohmann::json rows = nlohmann::json::array();
+    for (int i = 0; i < 6; ++i) {
+        nlohmann::json row = {
+            {"event_id", "evt-" + std::to_string(i)},
+            {"camera_name", i % 2 ? "Patio" : "Driveway"},
+            {"confidence", 0.5 + i * 0.05},
+        };
+        if (i == 3) row["thumbnail_url"] = "/snapshots/evt-3.jpg";
+        rows.push_back(row);
+    }
+
+    auto out = hms::columnarize(rows);
+    CHECK(out["layout"] == "columnar");
+    CHECK(out["count"] == 6);
+    const auto& columns = out["columns"];
+
+    // Unique strings and numbers stay plain
+    CHECK(columns["event_id"].is_array());
+    CHECK(columns["event_id"][5] == "evt-5");
+    CHECK(columns["confidence"].is_array());
+
+    // Repeated strings become a dictionary plus one code per row
+    const auto& camera = columns["camera_name"];
+    REQUIRE(camera.is_object());
+    CHECK(camera["dict"].size() == 2);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        CHECK(camera["dict"][camera["codes"][i].get<size_t>()] == rows[i]["camera_name"]);
+    }
+
+    // Rows without a key read as null
+    REQUIRE(columns["thumbnail_url"].is_array());
+    CHECK(columns["thumbnail_url"].size() == 6);
+    CHECK(columns["thumbnail_url"][0].is_null());
+    CHECK(columns["thumbnail_url"][3] == "/snapshots/evt-3.jpg");
+
+    CHECK(hms::columnarize(nlohmann::json::array({1, 2})) == nlohmann::json::array({1, 2}));
+    CHECK(hms::columnarize(nlohmann::json::array())["count"] == 0);
+}
+
+TEST_CASE("Binary responses decode to the JSON body", "[api][format]") {
+    nlohmann::json body = {
+        {"events", {{{"event_id", "a"}, {"camera_name", "Patio"}},
+                    {{"event_id", "b"}, {"camera_name", "Patio"}}}},
+        {"count", 2},
+    };
+
+    SECTION("MessagePack") {
+        auto resp = hms::makeApiResponse({hms::BodyFormat::MsgPack, false}, body);
+        CHECK(resp->contentTypeString() == "application/msgpack");
+        CHECK(resp->getHeader("Vary") == "Accept");
+        auto body_view = resp->getBody();
+        CHECK(nlohmann::json::from_msgpack(body_view.begin(), body_view.end()) == body);
+    }
+
+    SECTION("CBOR, columnar") {
+        auto resp = hms::makeApiResponse({hms::BodyFormat::Cbor, true}, body);
+        auto body_view = resp->getBody();
+        auto decoded = nlohmann::json::from_cbor(body_view.begin(), body_view.end());
+        CHECK(decoded["count"] == 2);
+        CHECK(decoded["events"]["layout"] == "columnar");
+        CHECK(decoded["events"]["columns"]["camera_name"]["dict"] == nlohmann::json::array({"Patio"}));
+    }
+
+    SECTION("JSON") {
+        auto resp = hms::makeApiResponse({}, body);
+        CHECK(nlohmann::json::parse(resp->getBody()) == body);
+    }
+}
+
+// Counts global operator new calls, only while an AllocationCounter is alive,
+// so every other test pays one relaxed load per allocation
+namespace {
+std::atomic<bool> g_count_allocations{false};
+std::atomic<uint64_t> g_allocations{0};
+
+/// Turns counting on for its lifetime (tests run one at a time)
+class AllocationCounter {
+public:
+    AllocationCounter() { g_count_allocations.store(true, std::memory_order_relaxed); }
+    ~AllocationCounter() { g_count_allocations.store(false, std::memory_order_relaxed); }
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    uint64_t count() const { return g_allocations.load(std::memory_order_relaxed); }
+};
+}
+
+void* operator new(std::size_t size) {
+    if (g_count_allocations.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+TEST_CASE("Event list serialization benchmark", "[.][benchmark]") {
+    // 1000 /api/events rows as they come off the database: the old path built
+    // a DOM per row, copied it into the events array and dumped the response;
+    // the streaming path writes the rows into a pooled buffer.
+    struct Row {
+        std::string event_id, camera_id, started_at, ended_at, status, recording_url,
+                    snapshot_url, detected_classes, ai_context;
+        double duration_seconds, max_confidence;
+        int total_detections;
+    };
+    std::vector<Row> rows;
+    for (int i = 0; i < 1000; ++i) {
+        auto id = "patio_20260304_" + std::to_string(100000 + i);
+        rows.push_back({id, "patio", "2026-03-04T10:15:00Z", "2026-03-04T10:15:42Z", "completed",
+                        "/events/" + id + ".mp4", "/snapshots/" + id + ".jpg", "person,dog",
+                        "A person walks a dog along the fence toward the gate.", 42.0, 0.91, 17});
+    }
+
+    auto viaDom = [&] {
+        auto page = nlohmann::json::array();
+        for (const auto& r : rows) {
+            page.push_back({{"event_id", r.event_id}, {"camera_id", r.camera_id},
+                            {"camera_name", r.camera_id}, {"started_at", r.started_at},
+                            {"ended_at", r.ended_at}, {"duration_seconds", r.duration_seconds},
+                            {"total_detections", r.total_detections}, {"status", r.status},
+                            {"recording_url", r.recording_url}, {"snapshot_url", r.snapshot_url},
+                            {"detected_classes", r.detected_classes},
+                            {"max_confidence", r.max_confidence}, {"ai_context", r.ai_context}});
+        }
+        nlohmann::json events = nlohmann::json::array();
+        for (auto& doc : page) events.push_back(std::move(doc));
+        nlohmann::json response;
+        response["events"] = events;
+        response["count"] = static_cast<int>(events.size());
+        response["next_cursor"] = nullptr;
+        return hms::makeJsonBodyResponse(response.dump());
+    };
+    auto streamed = [&] {
+        hms::PooledBuffer buffer;
+        hms::JsonWriter out(buffer.str());
+        out.beginObject().key("events").beginArray();
+        for (const auto& r : rows) {
+            out.beginObject()
+                .key("event_id").value(r.event_id).key("camera_id").value(r.camera_id)
+                .key("camera_name").value(r.camera_id).key("started_at").value(r.started_at)
+                .key("ended_at").value(r.ended_at).key("duration_seconds").value(r.duration_seconds)
+                .key("total_detections").value(r.total_detections).key("status").value(r.status)
+                .key("recording_url").value(r.recording_url).key("snapshot_url").value(r.snapshot_url)
+                .key("detected_classes").value(r.detected_classes)
+                .key("max_confidence").value(r.max_confidence).key("ai_context").value(r.ai_context)
+                .endObject();
+        }
+        out.endArray().key("count").value(static_cast<int64_t>(rows.size()));
+        out.key("next_cursor").null().endObject();
+        return hms::makeJsonBodyResponse(buffer.str());
+    };
+    CHECK(nlohmann::json::parse(viaDom()->getBody()) == nlohmann::json::parse(streamed()->getBody()));
+
+    // Allocations and p50/p99 latency over repeated requests
+    auto measure = [](const char* name, auto&& serialize) {
+        constexpr int kRuns = 500;
+        std::vector<double> micros;
+        micros.reserve(kRuns);
+        AllocationCounter counter;
+        const auto before = counter.count();
+        for (int i = 0; i < kRuns; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            auto resp = serialize();
+            micros.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        const auto allocations = (counter.count() - before) / kRuns;
+        std::sort(micros.begin(), micros.end());
+        WARN(name << ": " << allocations << " allocations/response, p50 " << micros[kRuns / 2]
+                  << " us, p99 " << micros[kRuns * 99 / 100] << " us");
+        return allocations;
+    };
+    auto dom_allocations = measure("DOM + dump", viaDom);
+    auto streamed_allocations = measure("JsonWriter + pooled buffer", streamed);
+    CHECK(streamed_allocations < dom_allocations);
+
+    BENCHMARK("DOM + dump") { return viaDom(); };
+    BENCHMARK("JsonWriter + pooled buffer") { return streamed(); };
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Query-embedding cache
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("DB executor runs jobs off the caller and caps its queue", "[api][db]") {
+    hms::DbExecutor executor(hms::DbExecutor::Options{.threads = 1, .max_queue = 2});
+
+    // Hold the only thread so later jobs queue up behind it
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<std::thread::id> started;
+    REQUIRE(executor.submit([&] {
+        started.set_value(std::this_thread::get_id());
+        released.wait();
+    }));
+    CHECK(started.get_future().get() != std::this_thread::get_id());
+
+    std::atomic<int> ran{0};
+    CHECK(executor.submit([&] { ++ran; }));
+    CHECK(executor.submit([&] { throw std::runtime_error("query failed"); }));
+    CHECK_FALSE(executor.submit([&] { ++ran; }));   // queue full
+    CHECK(executor.stats().queued == 2);
+    CHECK(executor.stats().running == 1);
+
+    release.set_value();
+    executor.stop();
+    CHECK(ran == 1);
+    CHECK_FALSE(executor.submit([&] { ++ran; }));   // stopped
+
+    auto stats = executor.stats();
+    CHECK(stats.submitted == 3);
+    CHECK(stats.rejected == 2);
+    CHECK(stats.completed == 3);
+    CHECK(stats.queued == 0);
+    CHECK(stats.max_wait_ms >= stats.avg_wait_ms);
+}
+
+TEST_CASE("DB executor still answers a request whose job throws", "[api][db]") {
+    // runQuery's shape: the job answers through a OnceCallback and the
+    // error handler answers 500 only if the job did not get that far
+    hms::DbExecutor executor(hms::DbExecutor::Options{.threads = 1});
+    auto run = [&](std::function<void(const std::function<void(const int&)>&)> work) {
+        auto responses = std::make_shared<std::vector<int>>();
+        auto done = std::make_shared<std::promise<void>>();
+        auto answer = std::make_shared<hms::OnceCallback<int>>([responses, done](const int& status) {
+            responses->push_back(status);
+            done->set_value();
+        });
+        std::function<void(const int&)> once = [answer](const int& status) { (*answer)(status); };
+        REQUIRE(executor.submit([once, work] { work(once); }, [answer] { (*answer)(500); }));
+        REQUIRE(done->get_future().wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        executor.stop();
+        return *responses;
+    };
+
+    SECTION("throws before answering") {
+        auto responses = run([](const auto&) { throw std::runtime_error("column type mismatch"); });
+        CHECK(responses == std::vector<int>{500});
+    }
+
+    SECTION("throws after answering") {
+        auto responses = run([](const auto& callback) {
+            callback(200);
+            throw std::runtime_error("late failure");
+        });
+        CHECK(responses == std::vector<int>{200});
+    }
+
+    SECTION("succeeds") {
+        CHECK(run([](const auto& callback) { callback(200); }) == std::vector<int>{200});
+    }
+
+    CHECK(executor.stats().completed == 1);
+}
+
+TEST_CASE("Replica lag ignores an idle primary", "[api][db]") {
+    using hms::DbRouter;
+    // Everything replayed: current, however old the last transaction is
+    CHECK(DbRouter::lagSeconds(0.0, 3600.0) == 0.0);
+    CHECK(DbRouter::lagSeconds(0.0, std::nullopt) == 0.0);
+    // WAL outstanding: as far behind as the last replayed transaction
+    CHECK(DbRouter::lagSeconds(4096.0, 2.5) == 2.5);
+    CHECK(DbRouter::lagSeconds(std::nullopt, 7.0) == 7.0);
+    CHECK(DbRouter::lagSeconds(4096.0, -0.2) == 0.0);
+    // Nothing replayed yet: never eligible
+    CHECK(std::isinf(DbRouter::lagSeconds(4096.0, std::nullopt)));
+
+    // Primary position unknown: a recent replay is still proof enough, an
+    // old one keeps whatever the replica was before
+    CHECK(DbRouter::inService(std::nullopt, 2.0, 10.0, false));
+    CHECK(DbRouter::inService(std::nullopt, 600.0, 10.0, true));
+    CHECK_FALSE(DbRouter::inService(std::nullopt, 600.0, 10.0, false));
+    CHECK_FALSE(DbRouter::inService(std::nullopt, std::nullopt, 10.0, true));
+    // Known position: the lag decides
+    CHECK(DbRouter::inService(0.0, 600.0, 10.0, false));
+    CHECK_FALSE(DbRouter::inService(4096.0, 600.0, 10.0, true));
+    CHECK(DbRouter::inService(4096.0, 10.0, 10.0, false));
+
+    // Without replicas there is nothing to check and no fallback to count
+    DbRouter router(nullptr, hms::DbPool::Config{}, {}, DbRouter::Options{});
+    auto stats = router.stats();
+    CHECK(stats.replicas.empty());
+    CHECK(stats.fallbacks == 0);
+}
+
+TEST_CASE("Replica reads pick the least busy replica and fall back to the primary", "[api][db]") {
+    using hms::DbRouter;
+    using Load = std::vector<std::optional<size_t>>;
+    auto pick = [](const Load& load, size_t first) {
+        return DbRouter::pickReplica(load.size(), first, [&](size_t i) { return load[i]; });
+    };
+
+    CHECK(pick({3, 1, 2}, 0) == 1u);
+    CHECK(pick({std::nullopt, 5, 2}, 0) == 2u);          // out of service is skipped
+    // Ties go to the first replica from the rotating start
+    CHECK(pick({1, 1, 1}, 0) == 0u);
+    CHECK(pick({1, 1, 1}, 1) == 1u);
+    CHECK(pick({1, 1, 1}, 5) == 2u);
+    // Nothing in service: the caller reads from the primary
+    CHECK_FALSE(pick({std::nullopt, std::nullopt}, 0).has_value());
+    CHECK_FALSE(pick({}, 0).has_value());
+
+    // The retry rule, with pools stood in by names
+    std::string replica = "replica", primary = "primary";
+    std::vector<std::string> ran;
+    int probes = 0;
+    auto query = [&](bool fail_on_replica) {
+        return [&ran, fail_on_replica](std::string& pool) -> std::optional<std::string> {
+            ran.push_back(pool);
+            if (pool == "replica" && fail_on_replica) return std::nullopt;
+            return pool;
+        };
+    };
+    auto gone = [&] { ++probes; return true; };
+    auto alive = [&] { ++probes; return false; };
+
+    // Healthy replica: one query, no probe
+    CHECK(hms::readWithFallback(&replica, primary, query(false), gone) == "replica");
+    CHECK(ran == std::vector<std::string>{"replica"});
+    CHECK(probes == 0);
+
+    // Replica gone: the same query runs once on the primary
+    ran.clear();
+    CHECK(hms::readWithFallback(&replica, primary, query(true), gone) == "primary");
+    CHECK(ran == std::vector<std::string>{"replica", "primary"});
+    CHECK(probes == 1);
+
+    // Replica still answers: a failed query is the query's own failure
+    ran.clear();
+    CHECK_FALSE(hms::readWithFallback(&replica, primary, query(true), alive).has_value());
+    CHECK(ran == std::vector<std::string>{"replica"});
+
+    // A throw from a lost connection is retried too, and rethrown when the replica is fine
+    auto throwing = [&](std::string& pool) -> std::optional<std::string> {
+        if (pool == "replica") throw std::runtime_error("connection lost");
+        return pool;
+    };
+    CHECK(hms::readWithFallback(&replica, primary, throwing, gone) == "primary");
+    CHECK_THROWS_AS(hms::readWithFallback(&replica, primary, throwing, alive), std::runtime_error);
+
+    // Already on the primary: nothing to fall back to
+    ran.clear();
+    probes = 0;
+    CHECK(hms::readWithFallback<std::string>(nullptr, primary, query(true), gone) == "primary");
+    CHECK(ran == std::vector<std::string>{"primary"});
+    CHECK(probes == 0);
+
+    // Results that are not optionals or JSON fail only by throwing
+    CHECK(hms::readWithFallback(&replica, primary, [](std::string& pool) { return pool.size(); },
+                                gone) == replica.size());
+}
+
+TEST_CASE("Replica reads retry JSON queries that came back empty", "[api][db]") {
+    // api_queries functions swallow database errors and return empty JSON
+    CHECK(hms::isFailedRead(json()));
+    CHECK(hms::isFailedRead(json::array()));
+    CHECK(hms::isFailedRead(json::object()));
+    CHECK(hms::isFailedRead(json{{"events", json::array()}, {"count", 0}, {"query", "dog"}}));
+    CHECK_FALSE(hms::isFailedRead(json::array({json{{"snapshot_id", 1}}})));
+    CHECK_FALSE(hms::isFailedRead(json{{"events", json::array({json{{"id", "e1"}}})}, {"count", 1}}));
+    CHECK_FALSE(hms::isFailedRead(json{{"event", {{"event_id", "e1"}}}, {"detections", json::array()}}));
+
+    std::string replica = "replica", primary = "primary";
+    std::vector<std::string> ran;
+    int probes = 0;
+    // A search that finds nothing on the replica; the primary has a row
+    auto search = [&](std::string& pool) {
+        ran.push_back(pool);
+        json events = json::array();
+        if (pool == "primary") events.push_back({{"id", "e1"}});
+        return json{{"events", events}, {"count", events.size()}};
+    };
+    auto gone = [&] { ++probes; return true; };
+    auto alive = [&] { ++probes; return false; };
+
+    // Replica down: its empty answer was the failure, the primary's counts
+    CHECK(hms::readWithFallback(&replica, primary, search, gone)["count"] == 1);
+    CHECK(ran == std::vector<std::string>{"replica", "primary"});
+    CHECK(probes == 1);
+
+    // Replica up: nothing matched, and that is the answer
+    ran.clear();
+    probes = 0;
+    CHECK(hms::readWithFallback(&replica, primary, search, alive)["count"] == 0);
+    CHECK(ran == std::vector<std::string>{"replica"});
+    CHECK(probes == 1);
+
+    // Rows on the replica: no probe
+    ran.clear();
+    probes = 0;
+    auto found = [&](std::string& pool) {
+        ran.push_back(pool);
+        return json::array({json{{"snapshot_id", 7}}});
+    };
+    CHECK(hms::readWithFallback(&replica, primary, found, gone).size() == 1);
+    CHECK(ran == std::vector<std::string>{"replica"});
+    CHECK(probes == 0);
+}
+
+TEST_CASE("Metrics histograms bucket within 12.5%", "[api][metrics]") {
+    using H = hms::Metrics::Histogram;
+    // Exact below the sub-bucket count, then eight buckets per power of two
+    CHECK(H::bucketOf(0) == 0);
+    CHECK(H::bucketOf(7) == 7);
+    CHECK(H::bucketOf(8) == 8);
+    CHECK(H::bucketOf(15) == 15);
+    CHECK(H::bucketOf(16) == 16);
+    CHECK(H::bucketOf(17) == 16);
+    CHECK(H::bucketOf(std::numeric_limits<uint64_t>::max()) == H::kBuckets - 1);
+    for (uint64_t v : {1ull, 9ull, 100ull, 1234ull, 999999ull, 123456789ull}) {
+        const auto b = H::bucketOf(v);
+        CHECK(H::bucketLower(b) <= v);
+        CHECK(H::bucketLower(b + 1) > v);
+        CHECK(static_cast<double>(v - H::bucketLower(b)) <= 0.125 * static_cast<double>(v));
+    }
+
+    H h;
+    CHECK(h.snapshot().quantile(0.5) == 0.0);
+    for (uint64_t ms = 1; ms <= 1000; ++ms) h.record(ms * 1000);
+    auto snap = h.snapshot();
+    CHECK(snap.count == 1000);
+    CHECK(snap.sum_us == 500500 * 1000);
+    CHECK_THAT(snap.quantile(0.5), Catch::Matchers::WithinRel(500000.0, 0.07));
+    CHECK_THAT(snap.quantile(0.99), Catch::Matchers::WithinRel(990000.0, 0.07));
+}
+
+TEST_CASE("Metrics record from many threads and render Prometheus text", "[api][metrics]") {
+    hms::Metrics metrics;
+    constexpr int kThreads = 8, kPerThread = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&metrics, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                metrics.requestStarted();
+                metrics.recordRequest("GET", t % 2 ? "/api/events/{event_id}" : "/api/events",
+                                      i % 10 ? 200 : 503, 1500, 100);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    metrics.recordRequest("GET", "", 404, 50, 0);
+    metrics.observe(hms::Metrics::Series::DbWait, 250);
+    metrics.addMediaBytes(hms::Metrics::Media::Recording, 1 << 20);
+    CHECK(metrics.routeCount() == 3);
+
+    std::string text;
+    metrics.render(text);
+    using Catch::Matchers::ContainsSubstring;
+    CHECK_THAT(text, ContainsSubstring(
+        "hms_http_requests_total{method=\"GET\",route=\"/api/events\",code=\"2xx\"} 18000\n"));
+    CHECK_THAT(text, ContainsSubstring(
+        "hms_http_requests_total{method=\"GET\",route=\"/api/events\",code=\"5xx\"} 2000\n"));
+    CHECK_THAT(text, ContainsSubstring(
+        "hms_http_requests_total{method=\"GET\",route=\"unmatched\",code=\"4xx\"} 1\n"));
+    // 1.5 ms is above the 1 ms bound and below 2.5 ms
+    CHECK_THAT(text, ContainsSubstring(
+        "hms_http_request_duration_seconds_bucket{method=\"GET\",route=\"/api/events\",le=\"0.001\"} 0\n"));
+    CHECK_THAT(text, ContainsSubstring(
+        "hms_http_request_duration_seconds_bucket{method=\"GET\",route=\"/api/events\",le=\"0.0025\"} 20000\n"));
+    CHECK_THAT(text, ContainsSubstring(
+        "hms_http_request_duration_seconds_count{method=\"GET\",route=\"/api/events/{event_id}\"} 20000\n"));
+    CHECK_THAT(text, ContainsSubstring("hms_http_requests_in_flight 0\n"));
+    CHECK_THAT(text, ContainsSubstring("hms_db_wait_seconds_count 1\n"));
+    CHECK_THAT(text, ContainsSubstring("hms_media_bytes_total{kind=\"recording\"} 1048576\n"));
+
+    // Values sampled at scrape time keep their own type
+    text.clear();
+    hms::Metrics::appendGauge(text, "hms_db_executor_queued", "Queued", 3);
+    hms::Metrics::appendCounter(text, "hms_db_executor_rejected_total", "Rejected", 7);
+    CHECK_THAT(text, ContainsSubstring("# TYPE hms_db_executor_queued gauge\nhms_db_executor_queued 3\n"));
+    CHECK_THAT(text, ContainsSubstring(
+        "# TYPE hms_db_executor_rejected_total counter\nhms_db_executor_rejected_total 7\n"));
+}
+
+TEST_CASE("Metrics record known routes without allocating", "[api][metrics]") {
+    hms::Metrics metrics;
+    metrics.recordRequest("GET", "/api/timeline", 200, 800, 2048);    // first sighting allocates
+
+    AllocationCounter counter;
+    const auto before = counter.count();
+    for (int i = 0; i < 1000; ++i) {
+        metrics.requestStarted();
+        metrics.recordRequest("GET", "/api/timeline", 200, 800 + i, 2048);
+        metrics.observe(hms::Metrics::Series::DbQuery, 300);
+        metrics.addMediaBytes(hms::Metrics::Media::Snapshot, 4096);
+    }
+    CHECK(counter.count() == before);
+    CHECK(metrics.routeCount() == 1);
+}
+
+TEST_CASE("LRU cache evicts least recently used entries", "[cache]") {
+    hms::LruCache<std::string, int> cache(3);
+    cache.put("a", 1);
+    cache.put("b", 2);
+    cache.put("c", 3);
+    CHECK(cache.get("a") == 1);     // "a" becomes most recent
+
+    cache.put("d", 4);              // evicts "b"
+    CHECK_FALSE(cache.get("b").has_value());
+    CHECK(cache.get("a") == 1);
+    CHECK(cache.get("c") == 3);
+    CHECK(cache.get("d") == 4);
+    CHECK(cache.size() == 3);
+}
+
+TEST_CASE("LRU cache honours per-entry cost", "[cache]") {
+    hms::LruCache<std::string, std::string> cache(10);
+    cache.put("small", "x", 4);
+    cache.put("medium", "y", 5);
+    CHECK(cache.cost() == 9);
+
+    cache.put("big", "z", 6);       // needs 6 units → evicts "small" then "medium"
+    CHECK(cache.size() == 1);
+    CHECK(cache.cost() == 6);
+
+    cache.put("huge", "w", 11);     // larger than capacity → not stored
+    CHECK_FALSE(cache.get("huge").has_value());
+    CHECK(cache.get("big") == "z");
+
+    cache.put("p1", "a", 1);
+    cache.put("p2", "b", 1);
+    CHECK(cache.eraseIf([](const std::string& k) { return k.rfind("p", 0) == 0; }) == 2);
+    CHECK(cache.cost() == 6);
+}
+
+TEST_CASE("Response cache stores, compresses and invalidates by tag", "[api][cache]") {
+    hms::ResponseCache cache(hms::ResponseCache::Options{});
+
+    // Parameter order and empty values do not change the key
+    auto key = hms::ResponseCache::makeKey("/api/timeline", {{"date", "2026-02-25"}, {"camera_id", "patio"}});
+    CHECK(key == "/api/timeline?camera_id=patio&date=2026-02-25");
+    CHECK(hms::ResponseCache::makeKey("/api/timeline", {{"camera_id", "patio"}, {"date", "2026-02-25"},
+                                                        {"extra", ""}}) == key);
+
+    json hours = json::array();
+    for (int h = 0; h < 24; ++h) hours.push_back({{"hour", h}, {"event_count", 0}, {"total_detections", 0}});
+    json body{{"camera_id", "patio"}, {"date", "2026-02-25"}, {"hours", hours}};
+
+    CHECK(cache.get(key) == nullptr);
+    auto stored = cache.put(key, body, "patio", "2026-02-25", true);
+    REQUIRE(stored);
+    CHECK(stored->body == body.dump());
+    CHECK(stored->etag == hms::makeEtag(stored->body));
+
+    // The gzip copy inflates back to the same bytes
+    REQUIRE_FALSE(stored->gzip.empty());
+    CHECK(stored->gzip.size() < stored->body.size());
+    std::string inflated(stored->body.size(), '\0');
+    z_stream zs{};
+    REQUIRE(inflateInit2(&zs, 15 + 16) == Z_OK);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(stored->gzip.data()));
+    zs.avail_in = static_cast<uInt>(stored->gzip.size());
+    zs.next_out = reinterpret_cast<Bytef*>(inflated.data());
+    zs.avail_out = static_cast<uInt>(inflated.size());
+    CHECK(inflate(&zs, Z_FINISH) == Z_STREAM_END);
+    inflateEnd(&zs);
+    CHECK(inflated == stored->body);
+
+    CHECK(cache.get(key) == stored);
+
+    // Another camera or day is untouched; the tagged entry goes
+    CHECK(cache.invalidate("patio", "2026-02-26") == 0);
+    CHECK(cache.invalidate("garage", "2026-02-25") == 0);
+    CHECK(cache.invalidate("patio", "2026-02-25") == 1);
+    CHECK(cache.get(key) == nullptr);
+
+    auto stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.invalidated == 1);
+    CHECK(stats.entries == 0);
+}
+
+TEST_CASE("Response cache honours TTL and memory cap", "[api][cache]") {
+    hms::ResponseCache expiring(hms::ResponseCache::Options{.live_ttl = std::chrono::seconds(0)});
+    expiring.put("k", json{{"a", 1}}, "patio", "2026-02-25", false);
+    CHECK(expiring.get("k") == nullptr);
+
+    hms::ResponseCache small(hms::ResponseCache::Options{.max_bytes = 4096});
+    json big{{"blob", std::string(1500, 'x')}};
+    small.put("a", big, "patio", "2026-02-20", true);
+    small.put("b", big, "patio", "2026-02-21", true);
+    small.put("c", big, "patio", "2026-02-22", true);
+    CHECK(small.stats().bytes <= 4096);
+    CHECK(small.get("a") == nullptr);
+    CHECK(small.get("c") != nullptr);
+}
+
+TEST_CASE("Recording names parse to camera and local day", "[api][cache]") {
+    auto name = hms::RecordingName::parse("front_door_20260225_231500.mp4");
+    REQUIRE(name);
+    CHECK(name->camera_id == "front_door");
+    CHECK(name->date == "2026-02-25");
+
+    CHECK(hms::RecordingName::parse("patio_20260225_231500")->camera_id == "patio");
+    CHECK_FALSE(hms::RecordingName::parse("patio.mp4"));
+    CHECK_FALSE(hms::RecordingName::parse("_20260225_231500.mp4"));
+    CHECK_FALSE(hms::RecordingName::parse("patio_2026022_231500.mp4"));
+    CHECK_FALSE(hms::RecordingName::parse("patio_2026O225_231500.mp4"));
+}
+
+namespace {
+
+/// Sets TZ for one test and restores it
+struct ScopedTimeZone {
+    explicit ScopedTimeZone(const char* tz) {
+        if (const char* old = std::getenv("TZ")) saved = old;
+        ::setenv("TZ", tz, 1);
+        ::tzset();
+    }
+    ~ScopedTimeZone() {
+        if (saved) ::setenv("TZ", saved->c_str(), 1);
+        else ::unsetenv("TZ");
+        ::tzset();
+    }
+    std::optional<std::string> saved;
+};
+
+} // anonymous namespace
+
+TEST_CASE("Event detail cache tags match the recording that invalidates them", "[api][cache]") {
+    ScopedTimeZone tz("CET-1");     // UTC+1, no DST in February
+
+    CHECK(hms::localDateOf("2026-02-25T22:59:59Z") == "2026-02-25");
+    CHECK(hms::localDateOf("2026-02-25T23:30:00Z") == "2026-02-26");
+    CHECK(hms::localDateOf("2026-02-25T23:30:00.250Z") == "2026-02-26");
+    CHECK(hms::localDateOf("2026-02-25 23:30:00") == "2026-02-26");
+    CHECK(hms::localDateOf("2026-02-26T00:30:00+02:00") == "2026-02-25");
+    CHECK(hms::localDateOf("not a time").empty());
+
+    // An event at 00:30 local starts on the previous UTC day; its recording
+    // still names the local day, and that is what the entry must be tagged with
+    hms::ResponseCache cache(hms::ResponseCache::Options{});
+    cache.put("/api/events/e1", json{{"event", {{"event_id", "e1"}}}}, "patio",
+              hms::localDateOf("2026-02-25T23:30:00Z"), false);
+    auto name = hms::RecordingName::parse("patio_20260226_003000.mp4");
+    REQUIRE(name);
+    CHECK(cache.invalidate(name->camera_id, name->date) == 1);
+}
+
+TEST_CASE("Accept-Encoding negotiation", "[api][cache]") {
+    using hms::acceptsEncoding;
+    CHECK(acceptsEncoding("gzip", "gzip"));
+    CHECK(acceptsEncoding("gzip, deflate, br", "gzip"));
+    CHECK(acceptsEncoding("gzip, deflate, br", "br"));
+    CHECK(acceptsEncoding("br;q=1.0, gzip;q=0.8", "gzip"));
+    CHECK(acceptsEncoding("*", "br"));
+    CHECK_FALSE(acceptsEncoding("", "gzip"));
+    CHECK_FALSE(acceptsEncoding("identity", "gzip"));
+    CHECK_FALSE(acceptsEncoding("br, gzip;q=0", "gzip"));
+    CHECK_FALSE(acceptsEncoding("gzip; q=0.0", "gzip"));
+    CHECK_FALSE(acceptsEncoding("*, br;q=0", "br"));
+    CHECK_FALSE(acceptsEncoding("gzip", "br"));
+}
+
+TEST_CASE("Accept-Encoding codings and weights are case-insensitive", "[api][cache]") {
+    using hms::acceptsEncoding;
+    CHECK(acceptsEncoding("GZIP", "gzip"));
+    CHECK(acceptsEncoding("deflate, Br;q=0.5", "br"));
+    CHECK(acceptsEncoding("GZip;level=1;Q=0.7", "gzip"));
+    CHECK_FALSE(acceptsEncoding("gzip;level=1;Q=0", "gzip"));
+    CHECK_FALSE(acceptsEncoding("br, GZIP;Q=0", "gzip"));
+    CHECK_FALSE(acceptsEncoding("*, BR; q=0", "br"));
+}
+
+TEST_CASE("Embedding cache key normalization", "[search][cache]") {
+    using hms::EmbeddingClient;
+    CHECK(EmbeddingClient::normalize("Person at night") == "person at night");
+    CHECK(EmbeddingClient::normalize("  person   at\tnight \n") == "person at night");
+    CHECK(EmbeddingClient::normalize("Car in DRIVEWAY") == EmbeddingClient::normalize("car in driveway"));
+    CHECK(EmbeddingClient::normalize("   ").empty());
+}
+
+TEST_CASE("HNSW index finds nearest neighbours and honours filters", "[search][index]") {
+    constexpr size_t kDim = 32;
+    constexpr size_t kCount = 2000;
+    std::mt19937 rng(7);
+    std::normal_distribution<float> dist;
+
+    std::vector<std::vector<float>> vectors(kCount, std::vector<float>(kDim));
+    hms::HnswIndex index(kDim);
+    for (auto& v : vectors) {
+        for (auto& x : v) x = dist(rng);
+        index.add(v.data());
+    }
+    REQUIRE(index.size() == kCount);
+
+    // A stored vector is its own best match
+    for (uint32_t id : {0u, 17u, 999u, 1999u}) {
+        auto matches = index.search(vectors[id].data(), 5, 64);
+        REQUIRE_FALSE(matches.empty());
+        CHECK(matches.front().first == id);
+        CHECK(matches.front().second > 0.999f);
+    }
+
+    // Only ids accepted by the filter are returned
+    auto even = index.search(vectors[10].data(), 10, 64, [](uint32_t id) { return id % 2 == 0; });
+    CHECK(even.size() == 10);
+    CHECK(std::all_of(even.begin(), even.end(), [](const auto& m) { return m.first % 2 == 0; }));
+    CHECK(even.front().first == 10);
+}
+
+TEST_CASE("SIMD dot kernels agree with scalar", "[search][simd]") {
+    using Catch::Matchers::WithinAbs;
+    std::mt19937 rng(3);
+    std::normal_distribution<float> dist;
+    auto best = hms::simd::activeIsa();
+
+    for (size_t n : {1, 7, 16, 33, 768}) {
+        std::vector<float> a(n), b(n);
+        std::vector<uint16_t> half(n);
+        std::vector<int8_t> bytes(n);
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = dist(rng);
+            b[i] = dist(rng);
+            half[i] = hms::simd::floatToHalf(b[i]);
+            bytes[i] = static_cast<int8_t>(std::clamp(b[i] * 40.0f, -127.0f, 127.0f));
+        }
+
+        hms::simd::setIsa(hms::simd::Isa::Scalar);
+        float f32 = hms::simd::dotF32(a.data(), b.data(), n);
+        float f16 = hms::simd::dotF16(a.data(), half.data(), n);
+        float i8 = hms::simd::dotI8(a.data(), bytes.data(), n);
+        hms::simd::setIsa(best);
+
+        CHECK_THAT(hms::simd::dotF32(a.data(), b.data(), n), WithinAbs(f32, 1e-3));
+        CHECK_THAT(hms::simd::dotF16(a.data(), half.data(), n), WithinAbs(f16, 1e-3));
+        CHECK_THAT(hms::simd::dotI8(a.data(), bytes.data(), n), WithinAbs(i8, 1e-1));
+    }
+
+    CHECK(hms::simd::halfToFloat(hms::simd::floatToHalf(1.0f)) == 1.0f);
+    CHECK(hms::simd::halfToFloat(hms::simd::floatToHalf(-2.5f)) == -2.5f);
+    CHECK(hms::simd::halfToFloat(hms::simd::floatToHalf(65504.0f)) == 65504.0f);
+}
+
+TEST_CASE("Exact top-k ranks the same rows in every storage layout", "[search][simd]") {
+    using Storage = hms::VectorMatrix::Storage;
+    constexpr size_t kDim = 768;
+    constexpr size_t kCount = 500;
+    std::mt19937 rng(11);
+    std::normal_distribution<float> dist;
+    std::vector<float> data(kCount * kDim);
+    for (auto& x : data) x = dist(rng);
+
+    std::vector<float> query(data.begin() + 42 * kDim, data.begin() + 43 * kDim);
+    hms::VectorMatrix::normalize(query.data(), kDim);
+
+    for (auto storage : {Storage::Float32, Storage::Float16, Storage::Int8}) {
+        hms::VectorMatrix matrix(kDim, storage);
+        for (size_t i = 0; i < kCount; ++i) matrix.add(&data[i * kDim]);
+
+        auto top = matrix.topK(query.data(), 5);
+        REQUIRE(top.size() == 5);
+        CHECK(top.front().first == 42);
+        CHECK(top.front().second > 0.99f);
+        CHECK(std::is_sorted(top.begin(), top.end(),
+                             [](const auto& x, const auto& y) { return x.second > y.second; }));
+
+        auto odd = matrix.topK(query.data(), 3, [](uint32_t id) { return id % 2 == 1; });
+        CHECK(std::all_of(odd.begin(), odd.end(), [](const auto& m) { return m.first % 2 == 1; }));
+    }
+
+    CHECK(hms::VectorMatrix(kDim, Storage::Int8).bytes() == 0);
+}
+
+TEST_CASE("Semantic exact scan benchmark", "[.][benchmark]") {
+    // 100k x 768 stored embeddings, one query. Set HMS_BENCH_DB_HOST (plus
+    // _USER/_PASSWORD/_NAME) to also time api_queries::search_events_semantic.
+    constexpr size_t kDim = 768;
+    constexpr size_t kCount = 100000;
+    std::mt19937 rng(5);
+    std::normal_distribution<float> dist;
+    std::vector<float> row(kDim);
+    std::vector<float> query(kDim);
+    for (auto& x : query) x = dist(rng);
+    hms::VectorMatrix::normalize(query.data(), kDim);
+
+    using Storage = hms::VectorMatrix::Storage;
+    hms::VectorMatrix f32(kDim, Storage::Float32), f16(kDim, Storage::Float16), i8(kDim, Storage::Int8);
+    for (size_t i = 0; i < kCount; ++i) {
+        for (auto& x : row) x = dist(rng);
+        f32.add(row.data());
+        f16.add(row.data());
+        i8.add(row.data());
+    }
+
+    auto best = hms::simd::activeIsa();
+    hms::simd::setIsa(hms::simd::Isa::Scalar);
+    BENCHMARK("f32 scalar") { return f32.topK(query.data(), 50); };
+    hms::simd::setIsa(best);
+    BENCHMARK(std::string("f32 ") + hms::simd::isaName(best)) { return f32.topK(query.data(), 50); };
+    BENCHMARK(std::string("f16 ") + hms::simd::isaName(best)) { return f16.topK(query.data(), 50); };
+    BENCHMARK(std::string("int8 ") + hms::simd::isaName(best)) { return i8.topK(query.data(), 50); };
+
+    if (const char* host = std::getenv("HMS_BENCH_DB_HOST")) {
+        auto env = [](const char* name, const char* fallback) {
+            const char* value = std::getenv(name);
+            return std::string(value ? value : fallback);
+        };
+        hms::DbPool pool(hms::DbPool::Config{
+            .host = host,
+            .port = 5432,
+            .user = env("HMS_BENCH_DB_USER", "maestro"),
+            .password = env("HMS_BENCH_DB_PASSWORD", ""),
+            .database = env("HMS_BENCH_DB_NAME", "ai_context"),
+            .pool_size = 1,
+        });
+        hms::api_queries::SearchParams params;
+        params.query = "benchmark";
+        params.mode = "semantic";
+        params.limit = 50;
+        BENCHMARK("sql search_events_semantic") {
+            return hms::api_queries::search_events_semantic(pool, params, query);
+        };
+    }
+}
+
+TEST_CASE("Prepared timeline queries benchmark", "[.][benchmark]") {
+    // Each timeline_queries endpoint parsed and planned per call versus run
+    // as a statement prepared on the pooled connection. Needs HMS_BENCH_DB_HOST
+    // (plus _USER/_PASSWORD/_NAME); one connection so every call reuses it.
+    const char* host = std::getenv("HMS_BENCH_DB_HOST");
+    if (!host) {
+        WARN("HMS_BENCH_DB_HOST not set; skipping");
+        return;
+    }
+    auto env = [](const char* name, const char* fallback) {
+        const char* value = std::getenv(name);
+        return std::string(value ? value : fallback);
+    };
+    hms::DbPool pool(hms::DbPool::Config{
+        .host = host,
+        .port = 5432,
+        .user = env("HMS_BENCH_DB_USER", "maestro"),
+        .password = env("HMS_BENCH_DB_PASSWORD", ""),
+        .database = env("HMS_BENCH_DB_NAME", "ai_context"),
+        .pool_size = 1,
+    });
+
+    std::mt19937 rng(9);
+    std::normal_distribution<float> dist;
+    std::vector<float> query(768);
+    for (auto& x : query) x = dist(rng);
+    hms::VectorMatrix::normalize(query.data(), query.size());
+
+    hms::api_queries::SearchParams params;
+    params.query = "benchmark";
+    params.mode = "semantic";
+    params.limit = 50;
+
+    hms::timeline_queries::EventPageQuery page;
+    page.limit = 100;
+    auto today = hms::timeline_queries::current_date(pool).value_or("2026-01-01");
+    auto recent = hms::timeline_queries::recent_embedded_ids(pool, 24 * 60);
+    std::vector<std::string> event_ids;
+    for (const auto& row : recent) {
+        if (row.type == "event" && event_ids.size() < 50) event_ids.push_back(row.id);
+    }
+
+    for (bool prepared : {false, true}) {
+        hms::timeline_queries::set_prepared_statements(prepared);
+        const std::string mode = prepared ? " (prepared)" : " (parsed)";
+        BENCHMARK("events page" + mode) {
+            return hms::timeline_queries::load_events_page(pool, page);
+        };
+        BENCHMARK("recent events" + mode) {
+            return hms::timeline_queries::load_recent_events(pool, std::nullopt, 300, 500);
+        };
+        BENCHMARK("rollup" + mode) {
+            return hms::timeline_queries::load_rollup(pool, today, today);
+        };
+        BENCHMARK("embeddings by id" + mode) {
+            return hms::timeline_queries::load_embeddings_by_id(pool, event_ids, {});
+        };
+        BENCHMARK("current date" + mode) {
+            return hms::timeline_queries::current_date(pool);
+        };
+        BENCHMARK("semantic, binary vector" + mode) {
+            return hms::timeline_queries::search_semantic(pool, params, query);
+        };
+        BENCHMARK("event details, batch" + mode) {
+            return hms::timeline_queries::load_event_details(pool, event_ids);
+        };
+    }
+    BENCHMARK("event details, one request per event") {
+        size_t found = 0;
+        for (const auto& id : event_ids) {
+            found += !hms::api_queries::get_event_detail(pool, id).is_null();
+        }
+        return found;
+    };
+    hms::timeline_queries::set_prepared_statements(true);
+    BENCHMARK("semantic, api_queries text vector") {
+        return hms::api_queries::search_events_semantic(pool, params, query);
+    };
+
+    auto stats = hms::timeline_queries::prepared_statement_stats();
+    CHECK(stats.sessions == 1);
+    CHECK(stats.prepares == 14);
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Detection service client
+// ────────────────────────────────────────────────────────────────────
+
+namespace {
+
+/// Answers every request on 127.0.0.1 with 200 and respond(request body)
+/// (default "{}") and closes the connection
+class LoopbackHttpServer {
+public:
+    using Responder = std::function<std::string(const std::string& body)>;
+
+    explicit LoopbackHttpServer(Responder respond = [](const std::string&) { return std::string("{}"); })
+        : respond_(std::move(respond)) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE(::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        REQUIRE(::listen(fd_, 16) == 0);
+        socklen_t len = sizeof(addr);
+        ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~LoopbackHttpServer() {
+        ::shutdown(fd_, SHUT_RDWR);     // wakes accept()
+        thread_.join();
+        ::close(fd_);
+    }
+
+    uint16_t port() const { return port_; }
+
+private:
+    void serve() {
+        while (true) {
+            int conn = ::accept(fd_, nullptr, nullptr);
+            if (conn < 0) return;
+            std::string request;
+            char buf[4096];
+            auto readMore = [&] {
+                auto n = ::read(conn, buf, sizeof(buf));
+                if (n > 0) request.append(buf, static_cast<size_t>(n));
+                return n > 0;
+            };
+            while (request.find("\r\n\r\n") == std::string::npos && readMore()) {}
+            const auto header_end = request.find("\r\n\r\n");
+            size_t content_length = 0;
+            for (const char* name : {"Content-Length: ", "content-length: "}) {
+                if (auto at = request.find(name); at != std::string::npos && at < header_end) {
+                    content_length = std::stoul(request.substr(at + std::strlen(name)));
+                }
+            }
+            if (header_end != std::string::npos) {
+                while (request.size() < header_end + 4 + content_length && readMore()) {}
+            }
+            const auto body = respond_(header_end == std::string::npos ? std::string()
+                                                                        : request.substr(header_end + 4));
+            const auto response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                  "Content-Length: " + std::to_string(body.size()) +
+                                  "\r\nConnection: close\r\n\r\n" + body;
+            (void)!::write(conn, response.data(), response.size());
+            ::close(conn);
+        }
+    }
+
+    Responder respond_;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::thread thread_;
+};
+
+hms::DetectionClient::Result sendAndWait(hms::DetectionClient& client) {
+    auto done = std::make_shared<std::promise<hms::DetectionClient::Result>>();
+    auto result = done->get_future();
+    client.request(drogon::Get, "/api/cameras/status", {},
+                   [done](hms::DetectionClient::Result r, const drogon::HttpResponsePtr&) {
+                       done->set_value(r);
+                   });
+    REQUIRE(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    return result.get();
+}
+
+} // anonymous namespace
+
+TEST_CASE("Detection client re-resolves off its request loop and fails over", "[api][proxy]") {
+    using Result = hms::DetectionClient::Result;
+    LoopbackHttpServer upstream;
+
+    // The host first resolves to an address nobody listens on, then moves
+    std::atomic<int> lookups{0};
+    std::promise<void> dns_answer;
+    std::shared_future<void> answered = dns_answer.get_future().share();
+    hms::DetectionClient::Options options;
+    options.resolve_interval = std::chrono::milliseconds(0);
+    std::atomic<bool> other_host{false};
+    options.resolver = [&](const std::string& host) -> std::string {
+        if (host != "detector.test") other_host = true;
+        if (lookups.fetch_add(1) == 0) return "127.0.0.2";
+        answered.wait_for(std::chrono::seconds(5));     // a slow DNS server
+        return "127.0.0.1";
+    };
+    hms::DetectionClient client("http://detector.test:" + std::to_string(upstream.port()), options);
+    CHECK(client.resolvedAddress() == "127.0.0.2");
+
+    // The refused connection starts a lookup that hangs...
+    CHECK(sendAndWait(client) == Result::Unavailable);
+    REQUIRE(eventually([&] { return lookups.load() == 2; }));
+
+    // ...but requests on the client's loop still complete, and the pending
+    // lookup is not started twice
+    CHECK(sendAndWait(client) == Result::Unavailable);
+    CHECK(lookups.load() == 2);
+    CHECK(client.resolvedAddress() == "127.0.0.2");
+
+    // Once DNS answers, the connections move to the new address
+    dns_answer.set_value();
+    REQUIRE(eventually([&] { return client.resolvedAddress() == "127.0.0.1"; }));
+    CHECK(sendAndWait(client) == Result::Ok);
+
+    auto stats = client.stats();
+    CHECK(stats.requests == 3);
+    CHECK(stats.errors == 2);
+    CHECK(stats.in_flight == 0);
+    CHECK_FALSE(other_host);
+}
+
+TEST_CASE("Detection client rate-limits re-resolution", "[api][proxy]") {
+    using Result = hms::DetectionClient::Result;
+    std::atomic<int> lookups{0};
+    hms::DetectionClient::Options options;
+    options.resolve_interval = std::chrono::milliseconds(300);
+    options.resolver = [&](const std::string&) -> std::string {
+        ++lookups;
+        return {};                      // never resolves
+    };
+    hms::DetectionClient client("http://detector.test:9", options);
+    CHECK(lookups == 1);
+    CHECK(client.resolvedAddress().empty());
+
+    // Without connections requests fail at once; within the interval no
+    // failure triggers another lookup
+    CHECK(sendAndWait(client) == Result::Unavailable);
+    CHECK(sendAndWait(client) == Result::Unavailable);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(lookups == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(sendAndWait(client) == Result::Unavailable);
+    CHECK(eventually([&] { return lookups.load() == 2; }));
+    CHECK(sendAndWait(client) == Result::Unavailable);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(lookups == 2);
+}
+
+TEST_CASE("Snapshot cache keeps a bounded set of cameras", "[api][proxy]") {
+    LoopbackHttpServer upstream;
+    auto client = std::make_shared<hms::DetectionClient>(
+        "http://127.0.0.1:" + std::to_string(upstream.port()), hms::DetectionClient::Options{});
+    hms::SnapshotCache cache(client, std::chrono::minutes(1), 2);
+
+    auto get = [&](const std::string& camera) {
+        auto done = std::make_shared<std::promise<hms::DetectionClient::Result>>();
+        auto result = done->get_future();
+        cache.get(camera, [done](hms::DetectionClient::Result r, const hms::SnapshotCache::SnapshotPtr&) {
+            done->set_value(r);
+        });
+        REQUIRE(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        return result.get();
+    };
+
+    CHECK(get("patio") == hms::DetectionClient::Result::Ok);
+    CHECK(get("driveway") == hms::DetectionClient::Result::Ok);
+    CHECK(get("patio") == hms::DetectionClient::Result::Ok);       // hit
+    CHECK(cache.stats().fetches == 2);
+
+    // A third camera drops the least recently viewed one
+    CHECK(get("no-such-camera") == hms::DetectionClient::Result::Ok);
+    CHECK(cache.stats().cameras == 2);
+    CHECK(get("patio") == hms::DetectionClient::Result::Ok);       // still cached
+    CHECK(cache.stats().fetches == 3);
+    CHECK(get("driveway") == hms::DetectionClient::Result::Ok);    // fetched again
+    auto stats = cache.stats();
+    CHECK(stats.fetches == 4);
+    CHECK(stats.hits == 2);
+    CHECK(stats.cameras == 2);
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Live event stream (Server-Sent Events)
+// ────────────────────────────────────────────────────────────────────
+
+namespace {
+
+/// EventFeed::Sink that records what it is sent; `flushed` controls whether
+/// its socket keeps up
+struct TestStream {
+    std::mutex mutex;
+    std::string text;
+    std::atomic<uint64_t> queued{0};
+    std::atomic<bool> flushed{true};
+    std::atomic<bool> open{true};
+
+    hms::EventFeed::Sink sink() {
+        hms::EventFeed::Sink s;
+        s.send = [this](const std::string& data) {
+            if (!open) return false;
+            std::lock_guard lock(mutex);
+            text += data;
+            queued += data.size();
+            return true;
+        };
+        s.bytes_sent = [this]() -> std::optional<uint64_t> {
+            if (!open) return std::nullopt;
+            return flushed ? queued.load() : 0;
+        };
+        s.close = [this] { open = false; };
+        return s;
+    }
+
+    /// Occurrences of needle in everything sent so far
+    int count(std::string_view needle) {
+        std::lock_guard lock(mutex);
+        int n = 0;
+        for (auto pos = text.find(needle); pos != std::string::npos;
+             pos = text.find(needle, pos + needle.size())) {
+            ++n;
+        }
+        return n;
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("Event stream frames SSE messages", "[api][stream]") {
+    using hms::EventFeed;
+    CHECK(EventFeed::frame(7, "event", R"({"event_id":"a"})") ==
+          "id: 7\nevent: event\ndata: {\"event_id\":\"a\"}\n\n");
+    // Line breaks in the payload become continuation data lines
+    CHECK(EventFeed::frame(8, "update", "a\nb") == "id: 8\nevent: update\ndata: a\ndata: b\n\n");
+}
+
+TEST_CASE("Event stream tracker reports new and changed rows once", "[api][stream]") {
+    using Change = hms::EventFeed::Tracker::Change;
+    hms::EventFeed::Tracker tracker;
+    hms::timeline_queries::FeedRow row{"evt-1", "patio", 1'000'000, R"({"status":"active"})"};
+
+    CHECK(tracker.observe(row) == Change::Added);
+    CHECK(tracker.observe(row) == Change::None);
+    row.json = R"({"status":"completed"})";
+    CHECK(tracker.observe(row) == Change::Updated);
+    CHECK(tracker.observe(row) == Change::None);
+
+    hms::timeline_queries::FeedRow later{"evt-2", "driveway", 5'000'000, "{}"};
+    CHECK(tracker.observe(later) == Change::Added);
+    CHECK(tracker.size() == 2);
+
+    // Rows that left the window are forgotten
+    tracker.forgetBefore(2'000'000);
+    CHECK(tracker.size() == 1);
+    CHECK(tracker.observe(later) == Change::None);
+}
+
+TEST_CASE("Event stream replay buffer covers only reconnects it can complete", "[api][stream]") {
+    hms::EventFeed::ReplayBuffer replay(3);
+    // Nothing issued yet, so no id can be replayed
+    CHECK(replay.latest() == 0);
+    CHECK_FALSE(replay.covers(0));
+    CHECK_FALSE(replay.covers(1));
+
+    for (int i = 0; i < 5; ++i) replay.push(i % 2 ? "driveway" : "patio", "event", "{}");
+    REQUIRE(replay.messages().size() == 3);
+    CHECK(replay.messages().front().id == 3);
+    CHECK(replay.latest() == 5);
+    CHECK(*replay.messages().back().frame == hms::EventFeed::frame(5, "event", "{}"));
+
+    CHECK(replay.covers(5));          // up to date
+    CHECK(replay.covers(4));
+    CHECK(replay.covers(2));          // needs 3..5, all buffered
+    CHECK_FALSE(replay.covers(1));    // 2 was evicted
+    CHECK_FALSE(replay.covers(6));    // an id this process never issued
+
+    // After an idle gap nothing issued before it can be trusted
+    replay.reset();
+    CHECK(replay.messages().empty());
+    CHECK(replay.latest() == 5);
+    CHECK_FALSE(replay.covers(5));
+    CHECK(replay.push("patio", "event", "{}").id == 6);
+    CHECK(replay.covers(6));
+    CHECK_FALSE(replay.covers(5));
+}
+
+TEST_CASE("Event stream replays, resyncs and disconnects slow subscribers", "[api][stream]") {
+    using hms::timeline_queries::FeedRow;
+    std::mutex rows_mutex;
+    std::vector<FeedRow> rows{{"evt-1", "patio", 1'000'000, R"({"event_id":"evt-1"})"}};
+    auto add_row = [&](std::string id, std::string camera) {
+        std::lock_guard lock(rows_mutex);
+        const int64_t started_at = 1'000'000 + static_cast<int64_t>(rows.size());
+        // Long enough that a single unsent message exceeds max_backlog
+        rows.push_back({id, std::move(camera), started_at,
+                        R"({"event_id":")" + id + R"(","pad":")" + std::string(80, 'x') + "\"}"});
+    };
+
+    // Streams outlive the feed, which closes them on destruction
+    TestStream all, other;
+
+    hms::EventFeed::Options options;
+    options.poll_interval = std::chrono::milliseconds(5);
+    options.lookback = std::chrono::seconds(1);
+    options.replay_size = 2;
+    options.max_backlog = 64;
+    options.heartbeat = std::chrono::seconds(3600);
+    options.load = [&](std::optional<int64_t>, int, int) {
+        std::lock_guard lock(rows_mutex);
+        return std::optional<std::vector<FeedRow>>(rows);
+    };
+    hms::EventFeed feed(nullptr, options);
+
+    feed.subscribe(all.sink(), {}, std::nullopt);
+    // The first poll only learns the existing rows
+    REQUIRE(eventually([&] { return feed.stats().polls >= 1; }));
+    add_row("evt-2", "patio");
+    add_row("evt-3", "driveway");
+    REQUIRE(eventually([&] { return all.count("id: ") == 2; }));
+    CHECK(all.count("event: event") == 2);
+
+    SECTION("reconnects within the buffer replay, filtered by camera") {
+        feed.subscribe(other.sink(), {"driveway"}, 1);
+        CHECK(other.count("evt-3") == 1);
+        CHECK(other.count("id: ") == 1);
+        CHECK(feed.stats().replayed == 1);
+        CHECK(feed.stats().resyncs == 0);
+    }
+
+    SECTION("reconnects past the buffer get a resync") {
+        add_row("evt-4", "patio");
+        add_row("evt-5", "patio");
+        REQUIRE(eventually([&] { return all.count("id: ") == 4; }));
+        feed.subscribe(other.sink(), {}, 1);   // 2 was evicted (replay_size 2)
+        CHECK(other.count("event: resync") == 1);
+        CHECK(other.count("event: event") == 0);
+        CHECK(feed.stats().resyncs == 1);
+    }
+
+    SECTION("a subscriber whose socket stops draining is disconnected") {
+        other.flushed = false;
+        feed.subscribe(other.sink(), {}, std::nullopt);
+        add_row("evt-4", "patio");
+        REQUIRE(eventually([&] { return all.count("id: ") == 3; }));
+        CHECK(other.open);                // one message in flight is within max_backlog
+        add_row("evt-5", "patio");
+        REQUIRE(eventually([&] { return !other.open; }));
+        CHECK(other.count("id: ") == 1);
+        CHECK(all.count("id: ") == 4);
+        CHECK(feed.stats().slow_disconnects == 1);
+        CHECK(feed.stats().subscribers == 1);
+    }
+
+    SECTION("a reconnect after polling stopped for longer than lookback resyncs") {
+        all.open = false;
+        REQUIRE(eventually([&] { return feed.stats().subscribers == 0; }));
+
+        // A quick reconnect still replays
+        feed.subscribe(other.sink(), {}, 2);
+        CHECK(other.count("event: resync") == 0);
+        other.open = false;
+        REQUIRE(eventually([&] { return feed.stats().subscribers == 0; }));
+
+        // Events may have been missed while nobody polled
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        all.open = true;
+        feed.subscribe(all.sink(), {}, 2);
+        CHECK(all.count("event: resync") == 1);
+        CHECK(feed.stats().resyncs == 1);
+    }
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Live MJPEG fan-out
+// ────────────────────────────────────────────────────────────────────
+
+namespace {
+
+/// LiveStreamHub::Sink that records parts; `flushed` controls whether its
+/// socket keeps up
+struct TestViewer {
+    std::atomic<int> parts{0};
+    std::atomic<uint64_t> queued{0};
+    std::atomic<bool> flushed{true};
+    std::atomic<bool> open{true};
+    std::atomic<int> malformed{0};
+
+    hms::LiveStreamHub::Sink sink() {
+        hms::LiveStreamHub::Sink s;
+        s.send = [this](const std::string& part) {
+            if (!open) return false;
+            if (part.rfind("--frame\r\nContent-Type: application/json\r\n", 0) != 0) ++malformed;
+            queued += part.size();
+            ++parts;
+            return true;
+        };
+        s.bytes_sent = [this]() -> std::optional<uint64_t> {
+            if (!open) return std::nullopt;
+            return flushed ? queued.load() : 0;
+        };
+        s.close = [this] { open = false; };
+        return s;
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("Live stream hub fans frames out and skips slow viewers", "[api][stream]") {
+    std::atomic<int> fetches{0};
+    LoopbackHttpServer upstream([&](const std::string&) {
+        return "{\"frame\":" + std::to_string(fetches++) + "}";
+    });
+    auto client = std::make_shared<hms::DetectionClient>(
+        "http://127.0.0.1:" + std::to_string(upstream.port()), hms::DetectionClient::Options{});
+    auto cache = std::make_shared<hms::SnapshotCache>(client, std::chrono::milliseconds(5));
+    hms::LiveStreamHub hub(cache, std::chrono::milliseconds(10), 16);
+
+    TestViewer fast, slow;
+    slow.flushed = false;
+    hub.subscribe("patio", fast.sink());
+    hub.subscribe("patio", slow.sink());
+    CHECK(hub.stats().channels == 1);
+
+    // One reader feeds both; the slow one gets its first part and then
+    // skips frames while more than 16 bytes are unsent
+    REQUIRE(eventually([&] { return fast.parts >= 5; }));
+    CHECK(slow.parts == 1);
+    auto stats = hub.stats();
+    CHECK(stats.subscribers == 2);
+    CHECK(stats.frames_dropped >= 4);
+    CHECK(fast.malformed == 0);
+
+    // Once its socket drains it is fed again
+    slow.flushed = true;
+    REQUIRE(eventually([&] { return slow.parts >= 2; }));
+
+    // A late viewer gets the current frame at once
+    TestViewer late;
+    hub.subscribe("patio", late.sink());
+    CHECK(late.parts == 1);
+}
+
+TEST_CASE("Live stream hub drops a camera's channel with its last viewer", "[api][stream]") {
+    LoopbackHttpServer upstream;
+    auto client = std::make_shared<hms::DetectionClient>(
+        "http://127.0.0.1:" + std::to_string(upstream.port()), hms::DetectionClient::Options{});
+    auto cache = std::make_shared<hms::SnapshotCache>(client, std::chrono::milliseconds(5));
+    hms::LiveStreamHub hub(cache, std::chrono::milliseconds(10));
+
+    TestViewer a, b;
+    hub.subscribe("patio", a.sink());
+    hub.subscribe("driveway", b.sink());
+    REQUIRE(eventually([&] { return a.parts >= 1 && b.parts >= 1; }));
+    CHECK(hub.stats().channels == 2);
+
+    a.open = false;
+    REQUIRE(eventually([&] { return hub.stats().channels == 1; }));
+    b.open = false;
+    REQUIRE(eventually([&] { return hub.stats().channels == 0; }));
+    CHECK(hub.stats().subscribers == 0);
+
+    // A closed viewer is not attached; a new one restarts the reader
+    hub.subscribe("patio", a.sink());
+    CHECK(hub.stats().channels == 0);
+    TestViewer c;
+    hub.subscribe("patio", c.sink());
+    REQUIRE(eventually([&] { return c.parts >= 1; }));
+    CHECK(hub.stats().channels == 1);
+}
+
+// ────────────────────────────────────────────────────────────────────
+// Embedding client batching
+// ────────────────────────────────────────────────────────────────────
+
+TEST_CASE("Embedding client coalesces concurrent queries into batches", "[search][embedding]") {
+    // Fake Ollama: each query embeds to {its length}
+    std::mutex seen_mutex;
+    std::vector<size_t> batch_sizes;
+    LoopbackHttpServer ollama([&](const std::string& body) {
+        auto inputs = json::parse(body).at("input");
+        {
+            std::lock_guard lock(seen_mutex);
+            batch_sizes.push_back(inputs.size());
+        }
+        json embeddings = json::array();
+        for (const auto& input : inputs) {
+            embeddings.push_back({static_cast<float>(input.get<std::string>().size())});
+        }
+        return json{{"embeddings", embeddings}}.dump();
+    });
+
+    hms::EmbeddingClient::Options options;
+    options.max_batch = 4;
+    options.batch_window = std::chrono::milliseconds(100);
+    hms::EmbeddingClient client("http://127.0.0.1:" + std::to_string(ollama.port()), "test-model", options);
+
+    // Ten callers at once, two of them asking the same thing
+    const std::vector<std::string> queries = {"a", "bb", "ccc", "dddd", "eeeee", "ffffff",
+                                              "ggggggg", "hhhhhhhh", "ccc", "iiiiiiiii"};
+    std::vector<std::vector<float>> results(queries.size());
+    std::vector<std::thread> callers;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        callers.emplace_back([&, i] { results[i] = client.embed(queries[i]); });
+    }
+    for (auto& t : callers) t.join();
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        REQUIRE(results[i].size() == 1);
+        CHECK(results[i][0] == static_cast<float>(queries[i].size()));
+    }
+    std::lock_guard lock(seen_mutex);
+    auto stats = client.stats();
+    CHECK(stats.batches == batch_sizes.size());
+    CHECK(stats.batches >= 3);                  // ten callers, at most four per batch
+    CHECK(stats.batches < queries.size());      // ...and not one call per caller
+    CHECK(stats.errors == 0);
+    for (auto n : batch_sizes) CHECK(n <= options.max_batch);
+
+    // Answers are cached: no new call
+    CHECK(client.embed("  CCC ") == results[2]);
+    CHECK(client.stats().batches == stats.batches);
+}
+
+TEST_CASE("Embedding client sends the query as written and caches it normalized", "[search][embedding]") {
+    std::mutex seen_mutex;
+    std::vector<std::string> sent;
+    LoopbackHttpServer ollama([&](const std::string& body) {
+        auto inputs = json::parse(body).at("input");
+        json embeddings = json::array();
+        for (const auto& input : inputs) {
+            std::lock_guard lock(seen_mutex);
+            sent.push_back(input.get<std::string>());
+            embeddings.push_back({1.0f});
+        }
+        return json{{"embeddings", embeddings}}.dump();
+    });
+    hms::EmbeddingClient::Options options;
+    options.batch_window = std::chrono::milliseconds(5);
+    hms::EmbeddingClient client("http://127.0.0.1:" + std::to_string(ollama.port()), "test-model", options);
+
+    // Case can matter to the model, so it reaches Ollama untouched
+    CHECK(client.embed("Red Car near GARAGE") == std::vector<float>{1.0f});
+    CHECK(client.embed("red car  near garage") == std::vector<float>{1.0f});
+    std::lock_guard lock(seen_mutex);
+    CHECK(sent == std::vector<std::string>{"Red Car near GARAGE"});
+    CHECK(client.stats().cache_hits == 1);
+}
+
+TEST_CASE("Embedding client answers a lone query after the window", "[search][embedding]") {
+    LoopbackHttpServer ollama([](const std::string&) { return std::string(R"({"embeddings":[[1.0,2.0]]})"); });
+    hms::EmbeddingClient::Options options;
+    options.batch_window = std::chrono::milliseconds(20);
+    hms::EmbeddingClient client("http://127.0.0.1:" + std::to_string(ollama.port()), "test-model", options);
+
+    auto started = std::chrono::steady_clock::now();
+    CHECK(client.embed("person") == std::vector<float>{1.0f, 2.0f});
+    CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(2));
+
+    // A failed call answers its callers with an empty vector
+    CHECK(client.embed(std::string("bad \xff utf8")).empty());
+    CHECK(client.stats().errors == 1);
+}